@@ -0,0 +1,1449 @@
+/**
+ * @file css-selector.c
+ * @date 2022/08/26
+ * @brief The compiler and the matcher of CSS Level 3 selectors.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "purc-document.h"
+#include "purc-errors.h"
+
+#include "private/document.h"
+#include "private/hashtable.h"
+
+#include <strings.h>
+
+/*
+ * A selector is compiled to a list of complex selectors (separated by
+ * commas), and every complex selector is an array of compound selectors
+ * stored from right to left. An element is matched against the rightmost
+ * compound first, then the combinators are followed to its ancestors
+ * or its previous siblings.
+ *
+ * Namespaces are not supported: a namespace prefix is accepted and
+ * ignored. The dynamic pseudo-classes (`:hover`, `:visited`, ...) and
+ * the pseudo-elements never match an element of a document.
+ */
+
+enum sel_test_type {
+    SEL_TEST_ID = 0,
+    SEL_TEST_CLASS,
+    SEL_TEST_ATTR_EXISTS,       // [attr]
+    SEL_TEST_ATTR_EQUAL,        // [attr=val]
+    SEL_TEST_ATTR_INCLUDE,      // [attr~=val]
+    SEL_TEST_ATTR_DASH,         // [attr|=val]
+    SEL_TEST_ATTR_PREFIX,       // [attr^=val]
+    SEL_TEST_ATTR_SUFFIX,       // [attr$=val]
+    SEL_TEST_ATTR_SUBSTR,       // [attr*=val]
+    SEL_TEST_ROOT,
+    SEL_TEST_NTH_CHILD,
+    SEL_TEST_NTH_LAST_CHILD,
+    SEL_TEST_NTH_OF_TYPE,
+    SEL_TEST_NTH_LAST_OF_TYPE,
+    SEL_TEST_ONLY_CHILD,
+    SEL_TEST_ONLY_OF_TYPE,
+    SEL_TEST_EMPTY,
+    SEL_TEST_LINK,
+    SEL_TEST_ENABLED,
+    SEL_TEST_DISABLED,
+    SEL_TEST_CHECKED,
+    SEL_TEST_LANG,
+    SEL_TEST_NOT,
+    SEL_TEST_NEVER,
+};
+
+struct sel_compound;
+
+struct sel_test {
+    enum sel_test_type  type;
+
+    /* the attribute name in lower case */
+    char               *name;
+    /* the identifier, the class name, the attribute value, or the language */
+    char               *value;
+    size_t              value_len;
+
+    /* for :nth-*(an+b) */
+    int                 a, b;
+
+    /* for :not() */
+    struct sel_compound *not;
+};
+
+enum sel_combinator {
+    SEL_COMB_NONE = 0,
+    SEL_COMB_DESCENDANT,        // A B
+    SEL_COMB_CHILD,             // A > B
+    SEL_COMB_ADJACENT,          // A + B
+    SEL_COMB_SIBLING,           // A ~ B
+};
+
+struct sel_compound {
+    /* the tag name in lower case; NULL for the universal selector */
+    char               *tag;
+    size_t              tag_len;
+    uintptr_t           tag_atom;
+
+    struct sel_test    *tests;
+    size_t              nr_tests;
+    size_t              sz_tests;
+
+    /* the combinator between this compound and the one on its left */
+    enum sel_combinator comb;
+};
+
+struct sel_complex {
+    /* the compounds from right to left */
+    struct sel_compound *compounds;
+    size_t              nr;
+    size_t              sz;
+};
+
+struct pcdoc_selector {
+    char               *text;
+
+    struct sel_complex *complexes;
+    size_t              nr;
+    size_t              sz;
+};
+
+#define MAX_CACHED_SELECTORS    64
+
+static bool
+grow_array(void **array, size_t *sz, size_t nr, size_t unit)
+{
+    if (nr < *sz)
+        return true;
+
+    size_t new_sz = *sz ? *sz * 2 : 4;
+    void *p = realloc(*array, new_sz * unit);
+    if (p == NULL)
+        return false;
+
+    memset((char *)p + *sz * unit, 0, (new_sz - *sz) * unit);
+    *array = p;
+    *sz = new_sz;
+    return true;
+}
+
+static void compound_release(struct sel_compound *cpd);
+
+static void
+test_release(struct sel_test *test)
+{
+    free(test->name);
+    free(test->value);
+    if (test->not) {
+        compound_release(test->not);
+        free(test->not);
+    }
+}
+
+static void
+compound_release(struct sel_compound *cpd)
+{
+    for (size_t i = 0; i < cpd->nr_tests; i++)
+        test_release(cpd->tests + i);
+    free(cpd->tests);
+    free(cpd->tag);
+}
+
+void
+pcdoc_selector_delete(pcdoc_selector_t sel)
+{
+    for (size_t i = 0; i < sel->nr; i++) {
+        struct sel_complex *cx = sel->complexes + i;
+        for (size_t j = 0; j < cx->nr; j++)
+            compound_release(cx->compounds + j);
+        free(cx->compounds);
+    }
+
+    free(sel->complexes);
+    free(sel->text);
+    free(sel);
+}
+
+/* The parser */
+struct sel_parser {
+    purc_document_t     doc;
+    const char         *p;
+    bool                oom;
+};
+
+struct sel_buf {
+    char   *buf;
+    size_t  len;
+    size_t  sz;
+};
+
+static bool
+buf_append(struct sel_buf *sb, const char *s, size_t len)
+{
+    if (sb->len + len + 1 > sb->sz) {
+        size_t sz = sb->sz ? sb->sz * 2 : 32;
+        while (sb->len + len + 1 > sz)
+            sz *= 2;
+
+        char *buf = realloc(sb->buf, sz);
+        if (buf == NULL)
+            return false;
+        sb->buf = buf;
+        sb->sz = sz;
+    }
+
+    memcpy(sb->buf + sb->len, s, len);
+    sb->len += len;
+    sb->buf[sb->len] = '\0';
+    return true;
+}
+
+static inline bool
+is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static inline bool
+is_nmstart(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+        (unsigned char)c >= 0x80;
+}
+
+static inline bool
+is_nmchar(char c)
+{
+    return is_nmstart(c) || (c >= '0' && c <= '9') || c == '-';
+}
+
+static inline int
+hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static bool
+skip_spaces(struct sel_parser *ps)
+{
+    const char *start = ps->p;
+    while (is_space(*ps->p))
+        ps->p++;
+    return ps->p > start;
+}
+
+/* Parses an escape sequence after the backslash. */
+static bool
+parse_escape(struct sel_parser *ps, struct sel_buf *sb)
+{
+    const char *p = ps->p;
+    int v;
+
+    if (*p == '\0' || *p == '\n' || *p == '\r' || *p == '\f')
+        return false;
+
+    if ((v = hex_value(*p)) < 0) {
+        ps->p = p + 1;
+        if (!buf_append(sb, p, 1))
+            ps->oom = true;
+        return !ps->oom;
+    }
+
+    uint32_t uc = 0;
+    for (int i = 0; i < 6 && (v = hex_value(*p)) >= 0; i++, p++)
+        uc = (uc << 4) | v;
+    if (is_space(*p))
+        p++;
+    ps->p = p;
+
+    if (uc == 0 || uc > 0x10FFFF || (uc >= 0xD800 && uc <= 0xDFFF))
+        uc = 0xFFFD;
+
+    char utf8[4];
+    size_t n;
+    if (uc < 0x80) {
+        utf8[0] = (char)uc;
+        n = 1;
+    }
+    else if (uc < 0x800) {
+        utf8[0] = (char)(0xC0 | (uc >> 6));
+        utf8[1] = (char)(0x80 | (uc & 0x3F));
+        n = 2;
+    }
+    else if (uc < 0x10000) {
+        utf8[0] = (char)(0xE0 | (uc >> 12));
+        utf8[1] = (char)(0x80 | ((uc >> 6) & 0x3F));
+        utf8[2] = (char)(0x80 | (uc & 0x3F));
+        n = 3;
+    }
+    else {
+        utf8[0] = (char)(0xF0 | (uc >> 18));
+        utf8[1] = (char)(0x80 | ((uc >> 12) & 0x3F));
+        utf8[2] = (char)(0x80 | ((uc >> 6) & 0x3F));
+        utf8[3] = (char)(0x80 | (uc & 0x3F));
+        n = 4;
+    }
+
+    if (!buf_append(sb, utf8, n))
+        ps->oom = true;
+    return !ps->oom;
+}
+
+/*
+ * Parses an identifier, or a name if @name_only is true (for `#id`).
+ * Returns NULL if there is no valid identifier.
+ */
+static char *
+parse_ident(struct sel_parser *ps, size_t *len, bool lower, bool name_only)
+{
+    struct sel_buf sb = { };
+    const char *p = ps->p;
+
+    if (!name_only) {
+        const char *q = p;
+        if (*q == '-')
+            q++;
+        if (!is_nmstart(*q) && *q != '\\')
+            return NULL;
+    }
+
+    while (*p) {
+        if (*p == '\\') {
+            ps->p = p + 1;
+            if (!parse_escape(ps, &sb))
+                goto failed;
+            p = ps->p;
+        }
+        else if (is_nmchar(*p)) {
+            char c = (lower && *p >= 'A' && *p <= 'Z') ? *p + 0x20 : *p;
+            if (!buf_append(&sb, &c, 1)) {
+                ps->oom = true;
+                goto failed;
+            }
+            p++;
+        }
+        else {
+            break;
+        }
+    }
+
+    if (sb.len == 0)
+        goto failed;
+
+    ps->p = p;
+    *len = sb.len;
+    return sb.buf;
+
+failed:
+    free(sb.buf);
+    return NULL;
+}
+
+static char *
+parse_string(struct sel_parser *ps, size_t *len)
+{
+    struct sel_buf sb = { };
+    char quote = *ps->p++;
+
+    if (!buf_append(&sb, "", 0)) {
+        ps->oom = true;
+        return NULL;
+    }
+
+    while (*ps->p != quote) {
+        if (*ps->p == '\0' || *ps->p == '\n')
+            goto failed;
+
+        if (*ps->p == '\\') {
+            ps->p++;
+            if (*ps->p == '\n') {
+                ps->p++;
+                continue;
+            }
+            if (!parse_escape(ps, &sb))
+                goto failed;
+        }
+        else {
+            if (!buf_append(&sb, ps->p, 1)) {
+                ps->oom = true;
+                goto failed;
+            }
+            ps->p++;
+        }
+    }
+
+    ps->p++;
+    *len = sb.len;
+    return sb.buf;
+
+failed:
+    free(sb.buf);
+    return NULL;
+}
+
+static struct sel_test *
+new_test(struct sel_parser *ps, struct sel_compound *cpd,
+        enum sel_test_type type)
+{
+    if (!grow_array((void **)&cpd->tests, &cpd->sz_tests, cpd->nr_tests,
+                sizeof(struct sel_test))) {
+        ps->oom = true;
+        return NULL;
+    }
+
+    struct sel_test *test = cpd->tests + cpd->nr_tests++;
+    memset(test, 0, sizeof(*test));
+    test->type = type;
+    return test;
+}
+
+static bool
+has_space(const char *s, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (is_space(s[i]))
+            return true;
+    }
+    return false;
+}
+
+static bool
+parse_attribute(struct sel_parser *ps, struct sel_compound *cpd)
+{
+    size_t len;
+    char *name, *value = NULL;
+    enum sel_test_type type = SEL_TEST_ATTR_EXISTS;
+
+    skip_spaces(ps);
+    if ((name = parse_ident(ps, &len, true, false)) == NULL)
+        return false;
+    skip_spaces(ps);
+
+    switch (*ps->p) {
+    case ']':
+        break;
+    case '=':
+        type = SEL_TEST_ATTR_EQUAL;
+        break;
+    case '~':
+        type = SEL_TEST_ATTR_INCLUDE;
+        break;
+    case '|':
+        type = SEL_TEST_ATTR_DASH;
+        break;
+    case '^':
+        type = SEL_TEST_ATTR_PREFIX;
+        break;
+    case '$':
+        type = SEL_TEST_ATTR_SUFFIX;
+        break;
+    case '*':
+        type = SEL_TEST_ATTR_SUBSTR;
+        break;
+    default:
+        goto failed;
+    }
+
+    if (type != SEL_TEST_ATTR_EXISTS) {
+        if (type != SEL_TEST_ATTR_EQUAL) {
+            ps->p++;
+            if (*ps->p != '=')
+                goto failed;
+        }
+        ps->p++;
+        skip_spaces(ps);
+
+        if (*ps->p == '"' || *ps->p == '\'')
+            value = parse_string(ps, &len);
+        else
+            value = parse_ident(ps, &len, false, false);
+        if (value == NULL)
+            goto failed;
+        skip_spaces(ps);
+    }
+
+    if (*ps->p != ']')
+        goto failed;
+    ps->p++;
+
+    /* the fast paths which can use the indexes of the document */
+    if (type == SEL_TEST_ATTR_EQUAL && strcmp(name, "id") == 0 && len > 0) {
+        type = SEL_TEST_ID;
+    }
+    else if (type == SEL_TEST_ATTR_INCLUDE && strcmp(name, "class") == 0 &&
+            len > 0 && !has_space(value, len)) {
+        type = SEL_TEST_CLASS;
+    }
+
+    struct sel_test *test = new_test(ps, cpd, type);
+    if (test == NULL)
+        goto failed;
+
+    if (type == SEL_TEST_ID || type == SEL_TEST_CLASS) {
+        free(name);
+    }
+    else {
+        test->name = name;
+    }
+    test->value = value;
+    test->value_len = value ? len : 0;
+    return true;
+
+failed:
+    free(name);
+    free(value);
+    return false;
+}
+
+/* Parses `an+b`, `odd`, or `even`. */
+static bool
+parse_nth(const char *s, size_t len, int *a, int *b)
+{
+    const char *end = s + len;
+    long sign = 1, n;
+    char *e;
+
+    if (len == 3 && strncasecmp(s, "odd", 3) == 0) {
+        *a = 2;
+        *b = 1;
+        return true;
+    }
+    if (len == 4 && strncasecmp(s, "even", 4) == 0) {
+        *a = 2;
+        *b = 0;
+        return true;
+    }
+
+    if (s < end && (*s == '+' || *s == '-')) {
+        sign = (*s == '-') ? -1 : 1;
+        s++;
+    }
+
+    if (s < end && *s >= '0' && *s <= '9') {
+        n = strtol(s, &e, 10);
+        s = e;
+    }
+    else {
+        n = -1;
+    }
+
+    if (s < end && (*s == 'n' || *s == 'N')) {
+        *a = (int)(sign * (n < 0 ? 1 : n));
+        s++;
+        while (s < end && is_space(*s))
+            s++;
+
+        if (s == end) {
+            *b = 0;
+            return true;
+        }
+
+        if (*s != '+' && *s != '-')
+            return false;
+        sign = (*s == '-') ? -1 : 1;
+        s++;
+        while (s < end && is_space(*s))
+            s++;
+
+        if (s == end || *s < '0' || *s > '9')
+            return false;
+        n = strtol(s, &e, 10);
+        s = e;
+        *b = (int)(sign * n);
+    }
+    else {
+        if (n < 0)
+            return false;
+        *a = 0;
+        *b = (int)(sign * n);
+    }
+
+    return s == end;
+}
+
+static bool parse_compound(struct sel_parser *ps, struct sel_compound *cpd,
+        bool in_not);
+
+static const struct {
+    const char         *name;
+    enum sel_test_type  type;
+    int                 a, b;
+} simple_pseudo_classes[] = {
+    { "root",           SEL_TEST_ROOT,              0, 0 },
+    { "first-child",    SEL_TEST_NTH_CHILD,         0, 1 },
+    { "last-child",     SEL_TEST_NTH_LAST_CHILD,    0, 1 },
+    { "first-of-type",  SEL_TEST_NTH_OF_TYPE,       0, 1 },
+    { "last-of-type",   SEL_TEST_NTH_LAST_OF_TYPE,  0, 1 },
+    { "only-child",     SEL_TEST_ONLY_CHILD,        0, 0 },
+    { "only-of-type",   SEL_TEST_ONLY_OF_TYPE,      0, 0 },
+    { "empty",          SEL_TEST_EMPTY,             0, 0 },
+    { "link",           SEL_TEST_LINK,              0, 0 },
+    { "enabled",        SEL_TEST_ENABLED,           0, 0 },
+    { "disabled",       SEL_TEST_DISABLED,          0, 0 },
+    { "checked",        SEL_TEST_CHECKED,           0, 0 },
+    { "visited",        SEL_TEST_NEVER,             0, 0 },
+    { "hover",          SEL_TEST_NEVER,             0, 0 },
+    { "active",         SEL_TEST_NEVER,             0, 0 },
+    { "focus",          SEL_TEST_NEVER,             0, 0 },
+    { "target",         SEL_TEST_NEVER,             0, 0 },
+    /* the pseudo-elements in the single-colon notation */
+    { "first-line",     SEL_TEST_NEVER,             0, 0 },
+    { "first-letter",   SEL_TEST_NEVER,             0, 0 },
+    { "before",         SEL_TEST_NEVER,             0, 0 },
+    { "after",          SEL_TEST_NEVER,             0, 0 },
+};
+
+static const struct {
+    const char         *name;
+    enum sel_test_type  type;
+} nth_pseudo_classes[] = {
+    { "nth-child",          SEL_TEST_NTH_CHILD },
+    { "nth-last-child",     SEL_TEST_NTH_LAST_CHILD },
+    { "nth-of-type",        SEL_TEST_NTH_OF_TYPE },
+    { "nth-last-of-type",   SEL_TEST_NTH_LAST_OF_TYPE },
+};
+
+static bool
+parse_pseudo(struct sel_parser *ps, struct sel_compound *cpd, bool in_not)
+{
+    bool element = false;
+    struct sel_test *test;
+    size_t len;
+    char *name;
+
+    if (*ps->p == ':') {
+        ps->p++;
+        element = true;
+    }
+
+    if ((name = parse_ident(ps, &len, true, false)) == NULL)
+        return false;
+
+    if (element) {
+        free(name);
+        if (in_not)
+            return false;
+        return new_test(ps, cpd, SEL_TEST_NEVER) != NULL;
+    }
+
+    if (*ps->p != '(') {
+        for (size_t i = 0; i < PCA_TABLESIZE(simple_pseudo_classes); i++) {
+            if (strcmp(name, simple_pseudo_classes[i].name) == 0) {
+                free(name);
+                test = new_test(ps, cpd, simple_pseudo_classes[i].type);
+                if (test == NULL)
+                    return false;
+                test->a = simple_pseudo_classes[i].a;
+                test->b = simple_pseudo_classes[i].b;
+                return true;
+            }
+        }
+
+        free(name);
+        return false;
+    }
+
+    /* functional pseudo-classes */
+    ps->p++;
+    skip_spaces(ps);
+
+    if (strcmp(name, "not") == 0) {
+        free(name);
+        if (in_not)
+            return false;
+
+        struct sel_compound *not = calloc(1, sizeof(*not));
+        if (not == NULL) {
+            ps->oom = true;
+            return false;
+        }
+
+        if (!parse_compound(ps, not, true) ||
+                (skip_spaces(ps), *ps->p != ')') ||
+                (test = new_test(ps, cpd, SEL_TEST_NOT)) == NULL) {
+            compound_release(not);
+            free(not);
+            return false;
+        }
+
+        ps->p++;
+        test->not = not;
+        return true;
+    }
+
+    const char *arg = ps->p;
+    const char *end = strchr(arg, ')');
+    if (end == NULL) {
+        free(name);
+        return false;
+    }
+    ps->p = end + 1;
+
+    while (end > arg && is_space(end[-1]))
+        end--;
+
+    if (strcmp(name, "lang") == 0) {
+        free(name);
+        if (end == arg)
+            return false;
+
+        test = new_test(ps, cpd, SEL_TEST_LANG);
+        if (test == NULL)
+            return false;
+        test->value = strndup(arg, end - arg);
+        test->value_len = end - arg;
+        if (test->value == NULL) {
+            ps->oom = true;
+            return false;
+        }
+        return true;
+    }
+
+    for (size_t i = 0; i < PCA_TABLESIZE(nth_pseudo_classes); i++) {
+        if (strcmp(name, nth_pseudo_classes[i].name) == 0) {
+            int a, b;
+            free(name);
+            if (!parse_nth(arg, end - arg, &a, &b))
+                return false;
+
+            test = new_test(ps, cpd, nth_pseudo_classes[i].type);
+            if (test == NULL)
+                return false;
+            test->a = a;
+            test->b = b;
+            return true;
+        }
+    }
+
+    free(name);
+    return false;
+}
+
+static bool
+parse_type(struct sel_parser *ps, struct sel_compound *cpd)
+{
+    size_t len;
+    char *name = NULL;
+
+    if (*ps->p == '*') {
+        ps->p++;
+    }
+    else if (*ps->p != '|' &&
+            (name = parse_ident(ps, &len, true, false)) == NULL) {
+        return !ps->oom;
+    }
+
+    /* ignore the namespace prefix */
+    if (*ps->p == '|' && ps->p[1] != '=') {
+        free(name);
+        name = NULL;
+
+        ps->p++;
+        if (*ps->p == '*')
+            ps->p++;
+        else if ((name = parse_ident(ps, &len, true, false)) == NULL)
+            return false;
+    }
+
+    if (name) {
+        cpd->tag = name;
+        cpd->tag_len = len;
+        if (ps->doc->ops->tag_name_atom)
+            cpd->tag_atom = ps->doc->ops->tag_name_atom(ps->doc, name, len);
+    }
+
+    return true;
+}
+
+static bool
+parse_compound(struct sel_parser *ps, struct sel_compound *cpd, bool in_not)
+{
+    const char *start = ps->p;
+
+    if (!parse_type(ps, cpd))
+        return false;
+
+    while (*ps->p) {
+        struct sel_test *test;
+        size_t len;
+        char *name;
+
+        switch (*ps->p) {
+        case '#':
+            ps->p++;
+            if ((name = parse_ident(ps, &len, false, true)) == NULL)
+                return false;
+            if ((test = new_test(ps, cpd, SEL_TEST_ID)) == NULL) {
+                free(name);
+                return false;
+            }
+            test->value = name;
+            test->value_len = len;
+            break;
+
+        case '.':
+            ps->p++;
+            if ((name = parse_ident(ps, &len, false, false)) == NULL)
+                return false;
+            if ((test = new_test(ps, cpd, SEL_TEST_CLASS)) == NULL) {
+                free(name);
+                return false;
+            }
+            test->value = name;
+            test->value_len = len;
+            break;
+
+        case '[':
+            ps->p++;
+            if (!parse_attribute(ps, cpd))
+                return false;
+            break;
+
+        case ':':
+            ps->p++;
+            if (!parse_pseudo(ps, cpd, in_not))
+                return false;
+            break;
+
+        default:
+            goto done;
+        }
+    }
+
+done:
+    return ps->p > start;
+}
+
+static bool
+parse_complex(struct sel_parser *ps, struct sel_complex *cx)
+{
+    enum sel_combinator comb = SEL_COMB_NONE;
+
+    for (;;) {
+        if (!grow_array((void **)&cx->compounds, &cx->sz, cx->nr,
+                    sizeof(struct sel_compound))) {
+            ps->oom = true;
+            return false;
+        }
+
+        struct sel_compound *cpd = cx->compounds + cx->nr++;
+        cpd->comb = comb;
+        if (!parse_compound(ps, cpd, false))
+            return false;
+
+        bool space = skip_spaces(ps);
+        switch (*ps->p) {
+        case '>':
+            comb = SEL_COMB_CHILD;
+            break;
+        case '+':
+            comb = SEL_COMB_ADJACENT;
+            break;
+        case '~':
+            comb = SEL_COMB_SIBLING;
+            break;
+        case ',':
+        case '\0':
+            goto done;
+        default:
+            if (!space)
+                return false;
+            comb = SEL_COMB_DESCENDANT;
+            break;
+        }
+
+        if (comb != SEL_COMB_DESCENDANT) {
+            ps->p++;
+            skip_spaces(ps);
+        }
+    }
+
+done:
+    /* reverse the compounds; the leftmost one has no combinator */
+    for (size_t i = 0; i < cx->nr / 2; i++) {
+        struct sel_compound tmp = cx->compounds[i];
+        cx->compounds[i] = cx->compounds[cx->nr - 1 - i];
+        cx->compounds[cx->nr - 1 - i] = tmp;
+    }
+
+    return true;
+}
+
+pcdoc_selector_t
+pcdoc_selector_new(purc_document_t doc, const char *selector)
+{
+    struct sel_parser ps = { doc, selector, false };
+    pcdoc_selector_t sel = calloc(1, sizeof(*sel));
+    if (sel == NULL || (sel->text = strdup(selector)) == NULL) {
+        ps.oom = true;
+        goto failed;
+    }
+
+    skip_spaces(&ps);
+    for (;;) {
+        if (!grow_array((void **)&sel->complexes, &sel->sz, sel->nr,
+                    sizeof(struct sel_complex))) {
+            ps.oom = true;
+            goto failed;
+        }
+
+        if (!parse_complex(&ps, sel->complexes + sel->nr++))
+            goto failed;
+
+        if (*ps.p == '\0')
+            break;
+
+        /* parse_complex() stops at a comma or the end */
+        ps.p++;
+        skip_spaces(&ps);
+    }
+
+    return sel;
+
+failed:
+    if (sel)
+        pcdoc_selector_delete(sel);
+    purc_set_error(ps.oom ? PURC_ERROR_OUT_OF_MEMORY :
+            PURC_ERROR_INVALID_VALUE);
+    return NULL;
+}
+
+static void
+cached_selector_free(struct pchash_entry *e)
+{
+    pcdoc_selector_delete(pchash_entry_v(e));
+}
+
+pcdoc_selector_t
+pcdoc_document_get_selector(purc_document_t doc, const char *selector)
+{
+    struct pchash_entry *e;
+
+    if (doc->selectors == NULL) {
+        doc->selectors = pchash_kstr_table_new(MAX_CACHED_SELECTORS * 2,
+                cached_selector_free);
+        if (doc->selectors == NULL) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+    }
+    else if ((e = pchash_table_lookup_entry(doc->selectors, selector))) {
+        return pchash_entry_v(e);
+    }
+
+    pcdoc_selector_t sel = pcdoc_selector_new(doc, selector);
+    if (sel == NULL)
+        return NULL;
+
+    /* evict the oldest one */
+    if (doc->selectors->count >= MAX_CACHED_SELECTORS)
+        pchash_table_delete_entry(doc->selectors, doc->selectors->head);
+
+    if (pchash_table_insert(doc->selectors, sel->text, sel)) {
+        pcdoc_selector_delete(sel);
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    return sel;
+}
+
+void
+pcdoc_document_clear_selectors(purc_document_t doc)
+{
+    if (doc->selectors) {
+        pchash_table_free(doc->selectors);
+        doc->selectors = NULL;
+    }
+}
+
+/* The matcher */
+struct match_ctxt {
+    purc_document_t     doc;
+    pcdoc_element_t     root;
+};
+
+static inline pcdoc_element_t
+parent_element(struct match_ctxt *ctxt, pcdoc_element_t elem)
+{
+    /* the parent of the root element is not an element */
+    if (elem == ctxt->root)
+        return NULL;
+
+    pcdoc_node node;
+    node.type = PCDOC_NODE_ELEMENT;
+    node.elem = elem;
+    return ctxt->doc->ops->get_parent(ctxt->doc, node);
+}
+
+static inline pcdoc_element_t
+sibling_element(struct match_ctxt *ctxt, pcdoc_element_t elem, bool next)
+{
+    if (ctxt->doc->ops->sibling_element == NULL)
+        return NULL;
+    return ctxt->doc->ops->sibling_element(ctxt->doc, elem, next);
+}
+
+static bool
+is_tag(struct match_ctxt *ctxt, pcdoc_element_t elem,
+        const char *tag, size_t tag_len, uintptr_t tag_atom)
+{
+    purc_document_t doc = ctxt->doc;
+
+    if (tag_atom && doc->ops->get_tag_atom)
+        return doc->ops->get_tag_atom(doc, elem) == tag_atom;
+
+    if (doc->ops->get_tag_name == NULL)
+        return false;
+
+    size_t len;
+    const char *name = doc->ops->get_tag_name(doc, elem, &len);
+    return name && len == tag_len && strncasecmp(name, tag, len) == 0;
+}
+
+static bool
+same_tag(struct match_ctxt *ctxt, pcdoc_element_t e1, pcdoc_element_t e2)
+{
+    purc_document_t doc = ctxt->doc;
+
+    if (doc->ops->get_tag_atom)
+        return doc->ops->get_tag_atom(doc, e1) ==
+            doc->ops->get_tag_atom(doc, e2);
+
+    if (doc->ops->get_tag_name == NULL)
+        return false;
+
+    size_t len;
+    const char *name = doc->ops->get_tag_name(doc, e1, &len);
+    return name && is_tag(ctxt, e2, name, len, 0);
+}
+
+static inline bool
+match_nth(int a, int b, long pos)
+{
+    if (a == 0)
+        return pos == b;
+
+    long diff = pos - b;
+    return (diff % a) == 0 && (diff / a) >= 0;
+}
+
+static long
+element_position(struct match_ctxt *ctxt, pcdoc_element_t elem,
+        bool from_end, bool of_type)
+{
+    long pos = 1;
+    pcdoc_element_t sibling = elem;
+
+    while ((sibling = sibling_element(ctxt, sibling, from_end))) {
+        if (!of_type || same_tag(ctxt, elem, sibling))
+            pos++;
+    }
+
+    return pos;
+}
+
+static const char *
+get_attribute(struct match_ctxt *ctxt, pcdoc_element_t elem,
+        const char *name, size_t *len)
+{
+    const char *val = NULL;
+    if (ctxt->doc->ops->get_attribute(ctxt->doc, elem, name, &val, len))
+        return NULL;
+
+    /* an attribute without value */
+    if (val == NULL) {
+        val = "";
+        *len = 0;
+    }
+    return val;
+}
+
+static bool
+match_attribute(const struct sel_test *test, const char *val, size_t len)
+{
+    const char *v = test->value;
+    size_t vlen = test->value_len;
+
+    switch (test->type) {
+    case SEL_TEST_ATTR_EXISTS:
+        return true;
+
+    case SEL_TEST_ATTR_EQUAL:
+        return len == vlen && memcmp(val, v, len) == 0;
+
+    case SEL_TEST_ATTR_INCLUDE: {
+        if (vlen == 0 || has_space(v, vlen))
+            return false;
+
+        const char *end = val + len;
+        while (val < end) {
+            while (val < end && is_space(*val))
+                val++;
+            const char *token = val;
+            while (val < end && !is_space(*val))
+                val++;
+            if ((size_t)(val - token) == vlen && memcmp(token, v, vlen) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    case SEL_TEST_ATTR_DASH:
+        return len >= vlen && memcmp(val, v, vlen) == 0 &&
+            (len == vlen || val[vlen] == '-');
+
+    case SEL_TEST_ATTR_PREFIX:
+        return vlen > 0 && len >= vlen && memcmp(val, v, vlen) == 0;
+
+    case SEL_TEST_ATTR_SUFFIX:
+        return vlen > 0 && len >= vlen &&
+            memcmp(val + len - vlen, v, vlen) == 0;
+
+    case SEL_TEST_ATTR_SUBSTR:
+        if (vlen == 0 || len < vlen)
+            return false;
+        for (size_t i = 0; i + vlen <= len; i++) {
+            if (memcmp(val + i, v, vlen) == 0)
+                return true;
+        }
+        return false;
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+static bool
+is_empty(struct match_ctxt *ctxt, pcdoc_element_t elem)
+{
+    purc_document_t doc = ctxt->doc;
+    size_t nrs[PCDOC_NODE_OTHERS + 1] = { };
+
+    if (doc->ops->children_count == NULL ||
+            doc->ops->children_count(doc, elem, nrs))
+        return false;
+
+    if (nrs[PCDOC_NODE_ELEMENT] || nrs[PCDOC_NODE_DATA] ||
+            nrs[PCDOC_NODE_CDATA_SECTION])
+        return false;
+
+    for (size_t i = 0; i < nrs[PCDOC_NODE_TEXT]; i++) {
+        pcdoc_node node = doc->ops->get_child(doc, elem, PCDOC_NODE_TEXT, i);
+        const char *text;
+        size_t len = 0;
+
+        if (node.type == PCDOC_NODE_TEXT && doc->ops->get_text &&
+                doc->ops->get_text(doc, node.text_node, &text, &len) == 0 &&
+                len > 0)
+            return false;
+    }
+
+    return true;
+}
+
+#define IS_TAG(ctxt, elem, name) \
+    is_tag(ctxt, elem, name, sizeof(name) - 1, 0)
+
+static bool
+is_form_control(struct match_ctxt *ctxt, pcdoc_element_t elem)
+{
+    return IS_TAG(ctxt, elem, "input") || IS_TAG(ctxt, elem, "button") ||
+        IS_TAG(ctxt, elem, "select") || IS_TAG(ctxt, elem, "textarea") ||
+        IS_TAG(ctxt, elem, "option") || IS_TAG(ctxt, elem, "optgroup") ||
+        IS_TAG(ctxt, elem, "fieldset");
+}
+
+static bool
+match_lang(struct match_ctxt *ctxt, pcdoc_element_t elem,
+        const char *lang, size_t lang_len)
+{
+    for (; elem; elem = parent_element(ctxt, elem)) {
+        size_t len;
+        const char *val = get_attribute(ctxt, elem, "lang", &len);
+        if (val == NULL)
+            continue;
+
+        return len >= lang_len && strncasecmp(val, lang, lang_len) == 0 &&
+            (len == lang_len || val[lang_len] == '-');
+    }
+
+    return false;
+}
+
+static bool match_compound(struct match_ctxt *ctxt,
+        const struct sel_compound *cpd, pcdoc_element_t elem);
+
+static bool
+match_test(struct match_ctxt *ctxt, const struct sel_test *test,
+        pcdoc_element_t elem)
+{
+    purc_document_t doc = ctxt->doc;
+    const char *val;
+    size_t len;
+
+    switch (test->type) {
+    case SEL_TEST_ID:
+        val = pcdoc_element_id(doc, elem, &len);
+        return val && len == test->value_len &&
+            memcmp(val, test->value, len) == 0;
+
+    case SEL_TEST_CLASS: {
+        bool found = false;
+        pcdoc_element_has_class(doc, elem, test->value, &found);
+        return found;
+    }
+
+    case SEL_TEST_ATTR_EXISTS:
+    case SEL_TEST_ATTR_EQUAL:
+    case SEL_TEST_ATTR_INCLUDE:
+    case SEL_TEST_ATTR_DASH:
+    case SEL_TEST_ATTR_PREFIX:
+    case SEL_TEST_ATTR_SUFFIX:
+    case SEL_TEST_ATTR_SUBSTR:
+        val = get_attribute(ctxt, elem, test->name, &len);
+        return val && match_attribute(test, val, len);
+
+    case SEL_TEST_ROOT:
+        return elem == ctxt->root;
+
+    case SEL_TEST_NTH_CHILD:
+        return match_nth(test->a, test->b,
+                element_position(ctxt, elem, false, false));
+
+    case SEL_TEST_NTH_LAST_CHILD:
+        return match_nth(test->a, test->b,
+                element_position(ctxt, elem, true, false));
+
+    case SEL_TEST_NTH_OF_TYPE:
+        return match_nth(test->a, test->b,
+                element_position(ctxt, elem, false, true));
+
+    case SEL_TEST_NTH_LAST_OF_TYPE:
+        return match_nth(test->a, test->b,
+                element_position(ctxt, elem, true, true));
+
+    case SEL_TEST_ONLY_CHILD:
+        return sibling_element(ctxt, elem, false) == NULL &&
+            sibling_element(ctxt, elem, true) == NULL;
+
+    case SEL_TEST_ONLY_OF_TYPE:
+        return element_position(ctxt, elem, false, true) == 1 &&
+            element_position(ctxt, elem, true, true) == 1;
+
+    case SEL_TEST_EMPTY:
+        return is_empty(ctxt, elem);
+
+    case SEL_TEST_LINK:
+        return (IS_TAG(ctxt, elem, "a") || IS_TAG(ctxt, elem, "area") ||
+                IS_TAG(ctxt, elem, "link")) &&
+            get_attribute(ctxt, elem, "href", &len) != NULL;
+
+    case SEL_TEST_ENABLED:
+        return is_form_control(ctxt, elem) &&
+            get_attribute(ctxt, elem, "disabled", &len) == NULL;
+
+    case SEL_TEST_DISABLED:
+        return is_form_control(ctxt, elem) &&
+            get_attribute(ctxt, elem, "disabled", &len) != NULL;
+
+    case SEL_TEST_CHECKED:
+        if (IS_TAG(ctxt, elem, "input"))
+            return get_attribute(ctxt, elem, "checked", &len) != NULL;
+        if (IS_TAG(ctxt, elem, "option"))
+            return get_attribute(ctxt, elem, "selected", &len) != NULL;
+        return false;
+
+    case SEL_TEST_LANG:
+        return match_lang(ctxt, elem, test->value, test->value_len);
+
+    case SEL_TEST_NOT:
+        return !match_compound(ctxt, test->not, elem);
+
+    case SEL_TEST_NEVER:
+        break;
+    }
+
+    return false;
+}
+
+static bool
+match_compound(struct match_ctxt *ctxt, const struct sel_compound *cpd,
+        pcdoc_element_t elem)
+{
+    if (cpd->tag &&
+            !is_tag(ctxt, elem, cpd->tag, cpd->tag_len, cpd->tag_atom))
+        return false;
+
+    for (size_t i = 0; i < cpd->nr_tests; i++) {
+        if (!match_test(ctxt, cpd->tests + i, elem))
+            return false;
+    }
+
+    return true;
+}
+
+/* The compound @idx of the complex is known to match @elem. */
+static bool
+match_rest(struct match_ctxt *ctxt, const struct sel_complex *cx,
+        size_t idx, pcdoc_element_t elem)
+{
+    if (idx + 1 == cx->nr)
+        return true;
+
+    const struct sel_compound *next = cx->compounds + idx + 1;
+    pcdoc_element_t e;
+
+    switch (cx->compounds[idx].comb) {
+    case SEL_COMB_CHILD:
+        e = parent_element(ctxt, elem);
+        return e && match_compound(ctxt, next, e) &&
+            match_rest(ctxt, cx, idx + 1, e);
+
+    case SEL_COMB_DESCENDANT:
+        for (e = parent_element(ctxt, elem); e; e = parent_element(ctxt, e)) {
+            if (match_compound(ctxt, next, e) &&
+                    match_rest(ctxt, cx, idx + 1, e))
+                return true;
+        }
+        break;
+
+    case SEL_COMB_ADJACENT:
+        e = sibling_element(ctxt, elem, false);
+        return e && match_compound(ctxt, next, e) &&
+            match_rest(ctxt, cx, idx + 1, e);
+
+    case SEL_COMB_SIBLING:
+        for (e = sibling_element(ctxt, elem, false); e;
+                e = sibling_element(ctxt, e, false)) {
+            if (match_compound(ctxt, next, e) &&
+                    match_rest(ctxt, cx, idx + 1, e))
+                return true;
+        }
+        break;
+
+    case SEL_COMB_NONE:
+        break;
+    }
+
+    return false;
+}
+
+static bool
+match_complex(struct match_ctxt *ctxt, const struct sel_complex *cx,
+        pcdoc_element_t elem)
+{
+    return match_compound(ctxt, cx->compounds, elem) &&
+        match_rest(ctxt, cx, 0, elem);
+}
+
+static bool
+match_selector(struct match_ctxt *ctxt, pcdoc_selector_t sel,
+        pcdoc_element_t elem)
+{
+    for (size_t i = 0; i < sel->nr; i++) {
+        if (match_complex(ctxt, sel->complexes + i, elem))
+            return true;
+    }
+
+    return false;
+}
+
+bool
+pcdoc_selector_match(purc_document_t doc, pcdoc_selector_t sel,
+        pcdoc_element_t elem)
+{
+    struct match_ctxt ctxt = { doc,
+        doc->ops->special_elem(doc, PCDOC_SPECIAL_ELEM_ROOT) };
+    return match_selector(&ctxt, sel, elem);
+}
+
+struct travel_args {
+    struct match_ctxt   ctxt;
+    pcdoc_selector_t    sel;
+    pcdoc_element_cb    cb;
+    void               *cb_ctxt;
+    size_t              nr;
+};
+
+static int
+match_element_cb(purc_document_t doc, pcdoc_element_t elem, void *ctxt)
+{
+    struct travel_args *args = ctxt;
+
+    if (match_selector(&args->ctxt, args->sel, elem)) {
+        if (args->cb(doc, elem, args->cb_ctxt))
+            return -1;
+        args->nr++;
+    }
+
+    return 0;
+}
+
+int
+pcdoc_selector_travel(purc_document_t doc, pcdoc_selector_t sel,
+        pcdoc_element_t ancestor, pcdoc_element_cb cb, void *ctxt, size_t *n)
+{
+    struct travel_args args = { { doc, NULL }, sel, cb, ctxt, 0 };
+    int r = 0;
+
+    args.ctxt.root = doc->ops->special_elem(doc, PCDOC_SPECIAL_ELEM_ROOT);
+    if (ancestor == NULL)
+        ancestor = args.ctxt.root;
+
+    /* use the indexes if the rightmost compound has an id or a class */
+    const struct sel_test *key = NULL;
+    if (sel->nr == 1) {
+        const struct sel_compound *cpd = sel->complexes[0].compounds;
+        for (size_t i = 0; i < cpd->nr_tests; i++) {
+            if (cpd->tests[i].type == SEL_TEST_ID) {
+                key = cpd->tests + i;
+                break;
+            }
+            else if (cpd->tests[i].type == SEL_TEST_CLASS && key == NULL) {
+                key = cpd->tests + i;
+            }
+        }
+    }
+
+    if (key && key->type == SEL_TEST_ID) {
+        r = pcdoc_travel_descendant_elements_by_id(doc, ancestor,
+                key->value, match_element_cb, &args, NULL);
+    }
+    else if (key) {
+        r = pcdoc_travel_descendant_elements_by_class(doc, ancestor,
+                key->value, match_element_cb, &args, NULL);
+    }
+    else if (doc->ops->travel) {
+        struct pcdoc_travel_info info = { PCDOC_NODE_ELEMENT, 0, &args };
+        r = doc->ops->travel(doc, ancestor,
+                (pcdoc_node_cb)match_element_cb, &info);
+    }
+
+    if (n)
+        *n = args.nr;
+    return r;
+}
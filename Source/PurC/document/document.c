@@ -112,6 +112,7 @@ purc_document_unref(purc_document_t doc)
 
     unsigned int refc = doc->refc;
     if (refc == 0) {
+        pcdoc_document_clear_selectors(doc);
         doc->ops->destroy(doc);
     }
 
@@ -122,6 +123,7 @@ unsigned int
 purc_document_delete(purc_document_t doc)
 {
     unsigned int refc = doc->refc;
+    pcdoc_document_clear_selectors(doc);
     doc->ops->destroy(doc);
     return refc;
 }
@@ -494,11 +496,20 @@ purc_document_serialize_contents_to_stream(purc_document_t doc,
     return 0;
 }
 
+static int
+found_element(purc_document_t doc, pcdoc_element_t elem, void *ctxt)
+{
+    UNUSED_PARAM(doc);
+
+    *(pcdoc_element_t *)ctxt = elem;
+    return -1;
+}
+
 pcdoc_element_t
 pcdoc_find_element_in_descendants(purc_document_t doc,
         pcdoc_element_t ancestor, const char *selector)
 {
-    pcdoc_element_t found;
+    pcdoc_element_t found = NULL;
 
     if (doc->ops->find_elem) {
         if (ancestor == NULL)
@@ -507,7 +518,11 @@ pcdoc_find_element_in_descendants(purc_document_t doc,
         found = doc->ops->find_elem(doc, ancestor, selector);
     }
     else {
-        found = NULL;
+        pcdoc_selector_t sel = pcdoc_document_get_selector(doc, selector);
+        if (sel) {
+            pcdoc_selector_travel(doc, sel, ancestor,
+                    found_element, &found, NULL);
+        }
     }
 
     return found;
@@ -524,6 +539,20 @@ element_collection_new(const char *selector)
     return coll;
 }
 
+static int
+append_element(purc_document_t doc, pcdoc_element_t elem, void *ctxt)
+{
+    UNUSED_PARAM(doc);
+
+    pcdoc_elem_coll_t coll = ctxt;
+    if (pcutils_arrlist_append(coll->elems, elem)) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    return 0;
+}
+
 pcdoc_elem_coll_t
 pcdoc_elem_coll_new_from_descendants(purc_document_t doc,
         pcdoc_element_t ancestor, const char *selector)
@@ -541,12 +570,20 @@ pcdoc_elem_coll_new_from_descendants(purc_document_t doc,
             coll = NULL;
         }
     }
+    else {
+        pcdoc_selector_t sel = pcdoc_document_get_selector(doc, selector);
+        if (sel == NULL || pcdoc_selector_travel(doc, sel, ancestor,
+                    append_element, coll, NULL)) {
+            pcdoc_elem_coll_delete(doc, coll);
+            coll = NULL;
+        }
+    }
 
     return coll;
 }
 
 pcdoc_elem_coll_t
-pcdoc_elem_coll_filter(purc_document_t doc,
+pcdoc_elem_coll_select(purc_document_t doc,
         pcdoc_elem_coll_t elem_coll, const char *selector)
 {
     pcdoc_elem_coll_t dst_coll = element_collection_new(selector);
@@ -558,8 +595,25 @@ pcdoc_elem_coll_filter(purc_document_t doc,
             dst_coll = NULL;
         }
     }
+    else {
+        pcdoc_selector_t sel = pcdoc_document_get_selector(doc, selector);
+        if (sel == NULL)
+            goto failed;
+
+        size_t nr = pcutils_arrlist_length(elem_coll->elems);
+        for (size_t i = 0; i < nr; i++) {
+            pcdoc_element_t elem = pcutils_arrlist_get_idx(elem_coll->elems, i);
+            if (pcdoc_selector_match(doc, sel, elem) &&
+                    append_element(doc, elem, dst_coll))
+                goto failed;
+        }
+    }
 
     return dst_coll;
+
+failed:
+    pcdoc_elem_coll_delete(doc, dst_coll);
+    return NULL;
 }
 
 void
@@ -569,6 +623,7 @@ pcdoc_elem_coll_delete(purc_document_t doc,
     UNUSED_PARAM(doc);
 
     pcutils_arrlist_free(elem_coll->elems);
+    free(elem_coll->selector);
     return free(elem_coll);
 }
 
@@ -0,0 +1,610 @@
+/**
+ * @file element-index.c
+ * @date 2022/08/25
+ * @brief The indexes of elements by identifier and by class name.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "purc-document.h"
+#include "purc-errors.h"
+
+#include "private/document.h"
+#include "private/hashtable.h"
+#include "private/stringbuilder.h"
+
+/*
+ * Every index maps a key (an identifier or a class name) to a bucket
+ * holding the elements in no particular order; the elements found are
+ * sorted in document order by the query.
+ */
+struct elem_bucket {
+    char                   *key;
+    struct pchash_table    *owner;
+
+    pcdoc_element_t        *elems;
+    size_t                  nr;
+    size_t                  sz;
+
+    /* whether the bucket is in the list of a pending removal */
+    bool                    dirty;
+};
+
+#define INDEX_INIT_SIZE         64
+#define BUCKET_MIN_SIZE         4
+
+/* the number of removed elements which are searched linearly */
+#define REMOVAL_LINEAR_MAX      8
+
+/* the maximal number of class names of one element handled */
+#define MAX_CLASS_NAMES         32
+
+static void bucket_free(struct pchash_entry *e)
+{
+    struct elem_bucket *bucket = pchash_entry_v(e);
+
+    free(bucket->elems);
+    free(bucket->key);
+    free(bucket);
+}
+
+static struct elem_bucket *
+bucket_get(struct pchash_table *index, const char *key, size_t len,
+        bool create)
+{
+    char buf[128];
+    char *tmp = NULL;
+    const char *k = key;
+
+    /* the key in the attribute may not be null-terminated */
+    if (key[len] != '\0') {
+        if (len < sizeof(buf)) {
+            memcpy(buf, key, len);
+            buf[len] = '\0';
+            k = buf;
+        }
+        else if ((tmp = strndup(key, len)) == NULL) {
+            return NULL;
+        }
+        else {
+            k = tmp;
+        }
+    }
+
+    struct elem_bucket *bucket = NULL;
+    struct pchash_entry *e = pchash_table_lookup_entry(index, k);
+    if (e) {
+        bucket = pchash_entry_v(e);
+    }
+    else if (create) {
+        bucket = calloc(1, sizeof(*bucket));
+        if (bucket == NULL)
+            goto done;
+
+        bucket->key = strndup(key, len);
+        bucket->owner = index;
+        if (bucket->key == NULL ||
+                pchash_table_insert(index, bucket->key, bucket)) {
+            free(bucket->key);
+            free(bucket);
+            bucket = NULL;
+        }
+    }
+
+done:
+    free(tmp);
+    return bucket;
+}
+
+static int
+bucket_append(struct elem_bucket *bucket, pcdoc_element_t elem)
+{
+    if (bucket->nr == bucket->sz) {
+        size_t sz = bucket->sz ? bucket->sz * 2 : BUCKET_MIN_SIZE;
+        pcdoc_element_t *elems = realloc(bucket->elems, sizeof(*elems) * sz);
+        if (elems == NULL)
+            return -1;
+
+        bucket->elems = elems;
+        bucket->sz = sz;
+    }
+
+    bucket->elems[bucket->nr++] = elem;
+    return 0;
+}
+
+struct class_names {
+    const char *names[MAX_CLASS_NAMES];
+    size_t      lens[MAX_CLASS_NAMES];
+    size_t      nr;
+};
+
+static int
+class_name_found(const char *token, const char *end, void *ud)
+{
+    struct class_names *names = ud;
+    size_t len = end - token;
+
+    /* the same tokenizer as pcdoc_element_has_class() */
+    if (len == 0)
+        return 0;
+
+    for (size_t i = 0; i < names->nr; i++) {
+        if (names->lens[i] == len && strncmp(names->names[i], token, len) == 0)
+            return 0;
+    }
+
+    if (names->nr == MAX_CLASS_NAMES)
+        return 1;
+
+    names->names[names->nr] = token;
+    names->lens[names->nr] = len;
+    names->nr++;
+    return 0;
+}
+
+static void
+get_class_names(purc_document_t doc, pcdoc_element_t elem,
+        struct class_names *names)
+{
+    const char *s;
+    size_t len;
+
+    names->nr = 0;
+    s = pcdoc_element_class(doc, elem, &len);
+    if (s && len > 0)
+        pcutils_token_by_delim(s, s + len, ' ', names, class_name_found);
+}
+
+static int
+index_add_element(purc_document_t doc, pcdoc_element_t elem)
+{
+    const char *s;
+    size_t len;
+    struct elem_bucket *bucket;
+
+    s = pcdoc_element_id(doc, elem, &len);
+    if (s && len > 0) {
+        bucket = bucket_get(doc->id_index, s, len, true);
+        if (bucket == NULL || bucket_append(bucket, elem))
+            return -1;
+    }
+
+    struct class_names names;
+    get_class_names(doc, elem, &names);
+    for (size_t i = 0; i < names.nr; i++) {
+        bucket = bucket_get(doc->class_index, names.names[i], names.lens[i],
+                true);
+        if (bucket == NULL || bucket_append(bucket, elem))
+            return -1;
+    }
+
+    return 0;
+}
+
+struct index_travel_args {
+    pcdoc_element_t skip;
+    int             error;
+
+    /* for removal */
+    pcdoc_element_t    *gone;
+    size_t              nr_gone;
+    size_t              sz_gone;
+    struct elem_bucket **dirty;
+    size_t              nr_dirty;
+    size_t              sz_dirty;
+};
+
+static int
+add_element_cb(purc_document_t doc, pcdoc_element_t elem, void *ctxt)
+{
+    struct index_travel_args *args = ctxt;
+
+    if (elem != args->skip && index_add_element(doc, elem)) {
+        args->error = PURC_ERROR_OUT_OF_MEMORY;
+        return -1;
+    }
+
+    return 0;
+}
+
+static bool
+index_build(purc_document_t doc)
+{
+    doc->id_index = pchash_kstr_table_new(INDEX_INIT_SIZE, bucket_free);
+    doc->class_index = pchash_kstr_table_new(INDEX_INIT_SIZE, bucket_free);
+    if (doc->id_index == NULL || doc->class_index == NULL)
+        goto failed;
+
+    pcdoc_element_t root;
+    root = doc->ops->special_elem(doc, PCDOC_SPECIAL_ELEM_ROOT);
+    if (root) {
+        struct index_travel_args args = { };
+        struct pcdoc_travel_info info = { PCDOC_NODE_ELEMENT, 0, &args };
+        if (doc->ops->travel(doc, root,
+                    (pcdoc_node_cb)add_element_cb, &info))
+            goto failed;
+    }
+
+    return true;
+
+failed:
+    pcdoc_index_destroy(doc);
+    return false;
+}
+
+static bool
+mark_dirty(struct index_travel_args *args, struct elem_bucket *bucket)
+{
+    if (bucket->dirty)
+        return true;
+
+    if (args->nr_dirty == args->sz_dirty) {
+        size_t sz = args->sz_dirty ? args->sz_dirty * 2 : 8;
+        struct elem_bucket **dirty;
+        dirty = realloc(args->dirty, sizeof(*dirty) * sz);
+        if (dirty == NULL)
+            return false;
+
+        args->dirty = dirty;
+        args->sz_dirty = sz;
+    }
+
+    bucket->dirty = true;
+    args->dirty[args->nr_dirty++] = bucket;
+    return true;
+}
+
+static int
+remove_element_cb(purc_document_t doc, pcdoc_element_t elem, void *ctxt)
+{
+    struct index_travel_args *args = ctxt;
+    struct elem_bucket *bucket;
+    bool indexed = false;
+    const char *s;
+    size_t len;
+
+    if (elem == args->skip)
+        return 0;
+
+    s = pcdoc_element_id(doc, elem, &len);
+    if (s && len > 0) {
+        bucket = bucket_get(doc->id_index, s, len, false);
+        if (bucket) {
+            if (!mark_dirty(args, bucket))
+                goto failed;
+            indexed = true;
+        }
+    }
+
+    struct class_names names;
+    get_class_names(doc, elem, &names);
+    for (size_t i = 0; i < names.nr; i++) {
+        bucket = bucket_get(doc->class_index, names.names[i], names.lens[i],
+                false);
+        if (bucket) {
+            if (!mark_dirty(args, bucket))
+                goto failed;
+            indexed = true;
+        }
+    }
+
+    if (!indexed)
+        return 0;
+
+    if (args->nr_gone == args->sz_gone) {
+        size_t sz = args->sz_gone ? args->sz_gone * 2 : REMOVAL_LINEAR_MAX;
+        pcdoc_element_t *gone = realloc(args->gone, sizeof(*gone) * sz);
+        if (gone == NULL)
+            goto failed;
+
+        args->gone = gone;
+        args->sz_gone = sz;
+    }
+
+    args->gone[args->nr_gone++] = elem;
+    return 0;
+
+failed:
+    args->error = PURC_ERROR_OUT_OF_MEMORY;
+    return -1;
+}
+
+static bool
+is_gone(struct index_travel_args *args, struct pchash_table *set,
+        pcdoc_element_t elem)
+{
+    if (set)
+        return pchash_table_lookup_entry(set, elem) != NULL;
+
+    for (size_t i = 0; i < args->nr_gone; i++) {
+        if (args->gone[i] == elem)
+            return true;
+    }
+
+    return false;
+}
+
+/* Removes the collected elements from the dirty buckets. */
+static bool
+compact_buckets(struct index_travel_args *args)
+{
+    struct pchash_table *set = NULL;
+
+    if (args->nr_gone > REMOVAL_LINEAR_MAX) {
+        set = pchash_kptr_table_new(args->nr_gone * 2, NULL);
+        if (set == NULL)
+            return false;
+
+        for (size_t i = 0; i < args->nr_gone; i++) {
+            if (pchash_table_insert(set, args->gone[i], NULL)) {
+                pchash_table_free(set);
+                return false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < args->nr_dirty; i++) {
+        struct elem_bucket *bucket = args->dirty[i];
+        size_t n = 0;
+
+        for (size_t j = 0; j < bucket->nr; j++) {
+            if (!is_gone(args, set, bucket->elems[j]))
+                bucket->elems[n++] = bucket->elems[j];
+        }
+
+        bucket->nr = n;
+        bucket->dirty = false;
+        if (n == 0) {
+            /* this frees the bucket */
+            pchash_table_delete(bucket->owner, bucket->key);
+        }
+    }
+
+    if (set)
+        pchash_table_free(set);
+    return true;
+}
+
+void
+pcdoc_index_add_descendants(purc_document_t doc,
+        pcdoc_element_t ancestor, bool self)
+{
+    if (doc->id_index == NULL)
+        return;
+
+    struct index_travel_args args = { };
+    args.skip = self ? NULL : ancestor;
+
+    struct pcdoc_travel_info info = { PCDOC_NODE_ELEMENT, 0, &args };
+    if (doc->ops->travel(doc, ancestor,
+                (pcdoc_node_cb)add_element_cb, &info)) {
+        /* drop the indexes; they will be rebuilt by the next query */
+        pcdoc_index_destroy(doc);
+    }
+}
+
+void
+pcdoc_index_add_element(purc_document_t doc, pcdoc_element_t elem)
+{
+    if (doc->id_index && index_add_element(doc, elem))
+        pcdoc_index_destroy(doc);
+}
+
+static void
+finish_removal(purc_document_t doc, struct index_travel_args *args, bool ok)
+{
+    /* compact_buckets() clears the dirty flags and frees empty buckets */
+    if (!ok || !compact_buckets(args))
+        pcdoc_index_destroy(doc);
+
+    free(args->dirty);
+    free(args->gone);
+}
+
+void
+pcdoc_index_remove_descendants(purc_document_t doc,
+        pcdoc_element_t ancestor, bool self)
+{
+    if (doc->id_index == NULL)
+        return;
+
+    struct index_travel_args args = { };
+    args.skip = self ? NULL : ancestor;
+
+    struct pcdoc_travel_info info = { PCDOC_NODE_ELEMENT, 0, &args };
+    int r = doc->ops->travel(doc, ancestor,
+            (pcdoc_node_cb)remove_element_cb, &info);
+    finish_removal(doc, &args, r == 0);
+}
+
+void
+pcdoc_index_remove_element(purc_document_t doc, pcdoc_element_t elem)
+{
+    if (doc->id_index == NULL)
+        return;
+
+    struct index_travel_args args = { };
+    int r = remove_element_cb(doc, elem, &args);
+    finish_removal(doc, &args, r == 0);
+}
+
+void
+pcdoc_index_destroy(purc_document_t doc)
+{
+    if (doc->id_index) {
+        pchash_table_free(doc->id_index);
+        doc->id_index = NULL;
+    }
+
+    if (doc->class_index) {
+        pchash_table_free(doc->class_index);
+        doc->class_index = NULL;
+    }
+}
+
+static bool
+is_descendant_or_self(purc_document_t doc, pcdoc_element_t root,
+        pcdoc_element_t ancestor, pcdoc_element_t elem)
+{
+    while (elem != ancestor) {
+        if (elem == root)
+            return false;
+
+        pcdoc_node node = { };
+        node.type = PCDOC_NODE_ELEMENT;
+        node.elem = elem;
+        elem = doc->ops->get_parent(doc, node);
+        if (elem == NULL)
+            return false;
+    }
+
+    return true;
+}
+
+static int
+travel_bucket(purc_document_t doc, pcdoc_element_t ancestor,
+        struct elem_bucket *bucket, pcdoc_element_cb cb, void *ctxt,
+        size_t *n)
+{
+    pcdoc_element_t root;
+    root = doc->ops->special_elem(doc, PCDOC_SPECIAL_ELEM_ROOT);
+
+    /* copy the elements; the callback may change the document */
+    pcdoc_element_t *elems = malloc(sizeof(*elems) * bucket->nr);
+    if (elems == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    size_t nr = 0;
+    for (size_t i = 0; i < bucket->nr; i++) {
+        if (ancestor == root ||
+                is_descendant_or_self(doc, root, ancestor, bucket->elems[i]))
+            elems[nr++] = bucket->elems[i];
+    }
+
+    int r = 0;
+    if (nr > 1 && doc->ops->sort_elements(doc, elems, nr)) {
+        r = -1;
+        goto done;
+    }
+
+    for (size_t i = 0; i < nr; i++) {
+        if (cb(doc, elems[i], ctxt)) {
+            r = -1;
+            break;
+        }
+
+        if (n)
+            (*n)++;
+    }
+
+done:
+    free(elems);
+    return r;
+}
+
+struct match_args {
+    const char         *key;
+    pcdoc_element_cb    cb;
+    void               *ctxt;
+    size_t              nr;
+};
+
+static int
+match_id_cb(purc_document_t doc, pcdoc_element_t elem, void *ctxt)
+{
+    struct match_args *args = ctxt;
+    const char *s;
+    size_t len;
+
+    s = pcdoc_element_id(doc, elem, &len);
+    if (s && s[len] == '\0' && strcmp(s, args->key) == 0) {
+        if (args->cb(doc, elem, args->ctxt))
+            return -1;
+        args->nr++;
+    }
+
+    return 0;
+}
+
+static int
+match_class_cb(purc_document_t doc, pcdoc_element_t elem, void *ctxt)
+{
+    struct match_args *args = ctxt;
+    bool found = false;
+
+    pcdoc_element_has_class(doc, elem, args->key, &found);
+    if (found) {
+        if (args->cb(doc, elem, args->ctxt))
+            return -1;
+        args->nr++;
+    }
+
+    return 0;
+}
+
+static int
+travel_by_key(purc_document_t doc, pcdoc_element_t ancestor, bool by_id,
+        const char *key, pcdoc_element_cb cb, void *ctxt, size_t *n)
+{
+    if (n)
+        *n = 0;
+
+    if (doc->ops->travel == NULL)
+        return 0;
+
+    if (ancestor == NULL)
+        ancestor = doc->ops->special_elem(doc, PCDOC_SPECIAL_ELEM_ROOT);
+
+    if (doc->ops->sort_elements && (doc->id_index || index_build(doc))) {
+        struct elem_bucket *bucket;
+        bucket = bucket_get(by_id ? doc->id_index : doc->class_index,
+                key, strlen(key), false);
+        if (bucket == NULL)
+            return 0;
+
+        return travel_bucket(doc, ancestor, bucket, cb, ctxt, n);
+    }
+
+    /* fall back to traveling the whole subtree */
+    struct match_args args = { key, cb, ctxt, 0 };
+    struct pcdoc_travel_info info = { PCDOC_NODE_ELEMENT, 0, &args };
+    int r = doc->ops->travel(doc, ancestor,
+            (pcdoc_node_cb)(by_id ? match_id_cb : match_class_cb), &info);
+    if (n)
+        *n = args.nr;
+    return r;
+}
+
+int
+pcdoc_travel_descendant_elements_by_id(purc_document_t doc,
+        pcdoc_element_t ancestor, const char *id,
+        pcdoc_element_cb cb, void *ctxt, size_t *n)
+{
+    return travel_by_key(doc, ancestor, true, id, cb, ctxt, n);
+}
+
+int
+pcdoc_travel_descendant_elements_by_class(purc_document_t doc,
+        pcdoc_element_t ancestor, const char *klass,
+        pcdoc_element_cb cb, void *ctxt, size_t *n)
+{
+    return travel_by_key(doc, ancestor, false, klass, cb, ctxt, n);
+}
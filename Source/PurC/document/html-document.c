@@ -30,6 +30,8 @@
 
 #include "private/document.h"
 #include "private/debug.h"
+#include "private/dom.h"
+#include "private/hashtable.h"
 
 static purc_document_t create(const char *content, size_t length)
 {
@@ -75,6 +77,7 @@ static purc_document_t create(const char *content, size_t length)
 static void destroy(purc_document_t doc)
 {
     assert(doc->impl);
+    pcdoc_index_destroy(doc);
     pchtml_html_document_destroy(doc->impl);
     free(doc);
 }
@@ -158,10 +161,12 @@ static pcdoc_element_t operate_element(purc_document_t doc,
     UNUSED_PARAM(self_close);
 
     if (op == PCDOC_OP_ERASE) {
+        pcdoc_index_remove_descendants(doc, elem, true);
         dom_erase_element(pcdom_interface_element(elem));
         return NULL;
     }
     else if (op == PCDOC_OP_CLEAR) {
+        pcdoc_index_remove_descendants(doc, elem, false);
         dom_clear_element(pcdom_interface_element(elem));
         return elem;
     }
@@ -171,6 +176,9 @@ static pcdoc_element_t operate_element(purc_document_t doc,
         return NULL;
     }
 
+    if (op == PCDOC_OP_DISPLACE)
+        pcdoc_index_remove_descendants(doc, elem, false);
+
     pcdom_element_t *dom_elem = pcdom_interface_element(elem);
     pcdom_document_t *dom_doc = pcdom_interface_document(doc->impl);
     pcdom_element_t *new_elem;
@@ -196,6 +204,9 @@ static pcdoc_text_node_t new_text_content(purc_document_t doc,
         return NULL;
     }
 
+    if (op == PCDOC_OP_DISPLACE)
+        pcdoc_index_remove_descendants(doc, elem, false);
+
     pcdom_document_t *dom_doc = pcdom_interface_document(doc->impl);
     pcdom_element_t *dom_elem = pcdom_interface_element(elem);
     pcdom_text_t *text_node;
@@ -298,8 +309,8 @@ dom_insert_subtree_before_element(pcdom_element_t *element,
         pcdom_node_t *div;
         div = subtree->first_child;
 
-        while (div->last_child) {
-            pcdom_node_t *child = div->last_child;
+        while (div->first_child) {
+            pcdom_node_t *child = div->first_child;
             pcdom_node_remove(child);
             pcdom_node_insert_before(to, child);
         }
@@ -319,8 +330,8 @@ dom_insert_subtree_after_element(pcdom_element_t *element,
         pcdom_node_t *div;
         div = subtree->first_child;
 
-        while (div->first_child) {
-            pcdom_node_t *child = div->first_child;
+        while (div->last_child) {
+            pcdom_node_t *child = div->last_child;
             pcdom_node_remove(child);
             pcdom_node_insert_after(to, child);
         }
@@ -385,6 +396,15 @@ static pcdoc_node new_content(purc_document_t doc,
             content, length ? length : strlen(content));
 
     if (subtree) {
+        if (op == PCDOC_OP_DISPLACE)
+            pcdoc_index_remove_descendants(doc, elem, false);
+
+        /* the new elements are the descendants of the wrapping `div` */
+        if (subtree->first_child &&
+                subtree->first_child->type == PCDOM_NODE_TYPE_ELEMENT)
+            pcdoc_index_add_descendants(doc,
+                    (pcdoc_element_t)subtree->first_child, false);
+
         dom_subtree_ops[op](dom_elem, subtree);
     }
     else {
@@ -425,24 +445,35 @@ static int set_attribute(purc_document_t doc,
             pcdoc_element_t elem, pcdoc_operation op,
             const char *name, const char *val, size_t len)
 {
-    UNUSED_PARAM(doc);
-
     pcdom_element_t *dom_elem = pcdom_interface_element(elem);
+    int retv = -1;
+
+    if (op != PCDOC_OP_ERASE && op != PCDOC_OP_CLEAR &&
+            op != PCDOC_OP_DISPLACE) {
+        purc_set_error(PURC_ERROR_INVALID_VALUE);
+        return retv;
+    }
+
+    /* the element is indexed by the identifier and the class names */
+    bool indexed = (strcasecmp(name, "id") == 0 ||
+            strcasecmp(name, "class") == 0);
+    if (indexed)
+        pcdoc_index_remove_element(doc, elem);
+
     if (op == PCDOC_OP_ERASE) {
-        return dom_remove_element_attr(dom_elem, name);
+        retv = dom_remove_element_attr(dom_elem, name);
     }
     else if (op == PCDOC_OP_CLEAR) {
-        return dom_set_element_attribute(dom_elem, name, "", 0);
-    }
-    else if (op == PCDOC_OP_DISPLACE) {
-        return dom_set_element_attribute(dom_elem, name,
-                val, len ? len : strlen(val));
+        retv = dom_set_element_attribute(dom_elem, name, "", 0);
     }
     else {
-        purc_set_error(PURC_ERROR_INVALID_VALUE);
+        retv = dom_set_element_attribute(dom_elem, name,
+                val, len ? len : strlen(val));
     }
 
-    return -1;
+    if (indexed)
+        pcdoc_index_add_element(doc, elem);
+    return retv;
 }
 
 static pcdoc_element_t special_elem(purc_document_t doc,
@@ -621,6 +652,29 @@ static int get_text(purc_document_t doc, pcdoc_text_node_t text_node,
     return 0;
 }
 
+static int
+travel_children(purc_document_t doc, pcdom_node_t *dom_node,
+            pcdoc_node_cb cb, struct pcdoc_travel_info *info)
+{
+    pcdom_node_t *child = dom_node->first_child;
+    for (; child; child = child->next) {
+        if (node_type(child->type) == info->type) {
+            int r = cb(doc, child, info->ctxt);
+            if (r)
+                return -1;
+            info->nr++;
+        }
+
+        if (child->type == PCDOM_NODE_TYPE_ELEMENT && child->first_child) {
+            int r = travel_children(doc, child, cb, info);
+            if (r)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
 static int
 travel(purc_document_t doc, pcdoc_element_t ancestor,
             pcdoc_node_cb cb, struct pcdoc_travel_info *info)
@@ -632,27 +686,174 @@ travel(purc_document_t doc, pcdoc_element_t ancestor,
         info->nr++;
     }
 
-    pcdom_node_t *dom_node = pcdom_interface_node(ancestor);
+    return travel_children(doc, pcdom_interface_node(ancestor), cb, info);
+}
 
-    pcdom_node_t *child = dom_node->first_child;
+struct elem_path {
+    pcdoc_element_t elem;
+    size_t          depth;
+    size_t         *indexes;
+};
+
+/* Returns the index of the node among its siblings plus one. */
+static size_t
+sibling_index(struct pchash_table *cache, pcdom_node_t *dom_node)
+{
+    struct pchash_entry *e = pchash_table_lookup_entry(cache, dom_node);
+    if (e)
+        return (size_t)(uintptr_t)pchash_entry_v(e);
+
+    /* cache the indexes of all siblings in one pass */
+    size_t idx = 0, found = 0;
+    pcdom_node_t *child = dom_node->parent->first_child;
     for (; child; child = child->next) {
-        if (node_type(child->type) == info->type) {
-            int r = cb(doc, child, info->ctxt);
-            if (r)
-                return -1;
-            info->nr++;
+        idx++;
+        if (pchash_table_insert(cache, child, (void *)(uintptr_t)idx))
+            return 0;
+        if (child == dom_node)
+            found = idx;
+    }
+
+    return found;
+}
+
+static int
+compare_paths(const void *v1, const void *v2)
+{
+    const struct elem_path *p1 = v1;
+    const struct elem_path *p2 = v2;
+
+    size_t depth = (p1->depth < p2->depth) ? p1->depth : p2->depth;
+    for (size_t i = 0; i < depth; i++) {
+        if (p1->indexes[i] != p2->indexes[i])
+            return (p1->indexes[i] < p2->indexes[i]) ? -1 : 1;
+    }
+
+    /* an ancestor goes before its descendants */
+    if (p1->depth == p2->depth)
+        return 0;
+    return (p1->depth < p2->depth) ? -1 : 1;
+}
+
+static int sort_elements(purc_document_t doc,
+        pcdoc_element_t *elems, size_t nr)
+{
+    UNUSED_PARAM(doc);
+
+    int retv = -1;
+    struct elem_path *paths = calloc(nr, sizeof(*paths));
+    struct pchash_table *cache = pchash_kptr_table_new(nr * 4, NULL);
+    if (paths == NULL || cache == NULL)
+        goto done;
+
+    for (size_t i = 0; i < nr; i++) {
+        pcdom_node_t *dom_node = pcdom_interface_node(elems[i]);
+
+        size_t depth = 0;
+        for (pcdom_node_t *n = dom_node; n->parent; n = n->parent)
+            depth++;
+
+        paths[i].elem = elems[i];
+        paths[i].depth = depth;
+        paths[i].indexes = malloc(sizeof(size_t) * (depth ? depth : 1));
+        if (paths[i].indexes == NULL)
+            goto done;
+
+        for (pcdom_node_t *n = dom_node; n->parent; n = n->parent) {
+            size_t idx = sibling_index(cache, n);
+            if (idx == 0)
+                goto done;
+            paths[i].indexes[--depth] = idx;
         }
+    }
 
-        if (child->type == PCDOM_NODE_TYPE_ELEMENT) {
-            pcdoc_element_t elem = (pcdoc_element_t)child;
-            if (child->first_child) {
-                int r = travel(doc, elem, cb, info);
-                if (r)
-                    return -1;
+    qsort(paths, nr, sizeof(*paths), compare_paths);
+    for (size_t i = 0; i < nr; i++)
+        elems[i] = paths[i].elem;
+    retv = 0;
+
+done:
+    if (retv)
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    if (paths) {
+        for (size_t i = 0; i < nr; i++)
+            free(paths[i].indexes);
+        free(paths);
+    }
+    if (cache)
+        pchash_table_free(cache);
+    return retv;
+}
+
+static const char *get_tag_name(purc_document_t doc,
+        pcdoc_element_t elem, size_t *len)
+{
+    UNUSED_PARAM(doc);
+
+    pcdom_element_t *dom_elem = pcdom_interface_element(elem);
+    return (const char *)pcdom_element_local_name(dom_elem, len);
+}
+
+static pcdoc_element_t sibling_element(purc_document_t doc,
+        pcdoc_element_t elem, bool next)
+{
+    UNUSED_PARAM(doc);
+
+    pcdom_node_t *dom_node = pcdom_interface_node(elem);
+    do {
+        dom_node = next ? dom_node->next : dom_node->prev;
+    } while (dom_node && dom_node->type != PCDOM_NODE_TYPE_ELEMENT);
+
+    return (pcdoc_element_t)dom_node;
+}
+
+static uintptr_t tag_name_atom(purc_document_t doc,
+        const char *name, size_t len)
+{
+    pcdom_document_t *dom_doc = pcdom_interface_document(doc->impl);
+    return pchtml_tag_id_by_name(dom_doc->tags,
+            (const unsigned char *)name, len);
+}
+
+static uintptr_t get_tag_atom(purc_document_t doc, pcdoc_element_t elem)
+{
+    UNUSED_PARAM(doc);
+    return pcdom_interface_node(elem)->local_name;
+}
+
+static int unwrap_element(purc_document_t doc, pcdoc_element_t elem,
+        bool displace)
+{
+    pcdom_node_t *dom_node = pcdom_interface_node(elem);
+    pcdom_node_t *parent = dom_node->parent;
+    pcdom_node_t *child;
+
+    if (parent == NULL) {
+        purc_set_error(PURC_ERROR_INVALID_VALUE);
+        return -1;
+    }
+
+    if (displace) {
+        child = parent->first_child;
+        while (child) {
+            pcdom_node_t *next = child->next;
+            if (child != dom_node) {
+                if (child->type == PCDOM_NODE_TYPE_ELEMENT)
+                    pcdoc_index_remove_descendants(doc,
+                            (pcdoc_element_t)child, true);
+                pcdom_node_destroy_deep(child);
             }
+            child = next;
         }
     }
 
+    while ((child = dom_node->first_child)) {
+        pcdom_node_remove(child);
+        pcdom_node_insert_before(dom_node, child);
+    }
+
+    pcdoc_index_remove_element(doc, elem);
+    pcdom_node_destroy(dom_node);
     return 0;
 }
 
@@ -687,5 +888,11 @@ struct purc_document_ops _pcdoc_html_ops = {
     .serialize = serialize,
     .elem_coll_select = NULL,
     .elem_coll_filter = NULL,
+    .sort_elements = sort_elements,
+    .get_tag_name = get_tag_name,
+    .sibling_element = sibling_element,
+    .tag_name_atom = tag_name_atom,
+    .get_tag_atom = get_tag_atom,
+    .unwrap_element = unwrap_element,
 };
 
@@ -1930,9 +1930,9 @@ shuffle_getter(purc_variant_t root, size_t nr_args, purc_variant_t *argv,
         ssize_t sz = purc_variant_array_get_size(argv[0]);
 
         if (sz > 1) {
-            struct pcutils_array_list *al = variant_array_get_data(argv[0]);
-            struct pcutils_array_list_node *p;
-            array_list_for_each(al, p) {
+            variant_arr_t data = variant_array_get_data(argv[0]);
+            purc_variant_t *vals = data->vals + data->head;
+            for (size_t idx = 0; idx < data->nr; idx++) {
 
                 size_t new_idx;
                 if (sz < RAND_MAX) {
@@ -1943,8 +1943,11 @@ shuffle_getter(purc_variant_t root, size_t nr_args, purc_variant_t *argv,
                     new_idx = new_idx * sz / RAND_MAX;
                 }
 
-                if (new_idx != p->idx)
-                    pcutils_array_list_swap(al, p->idx, new_idx);
+                if (new_idx != idx) {
+                    purc_variant_t tmp = vals[idx];
+                    vals[idx] = vals[new_idx];
+                    vals[new_idx] = tmp;
+                }
             }
         }
     }
@@ -491,47 +491,12 @@ struct visit_args {
     const char               *css;
 };
 
-static bool
-match_by_class(purc_document_t doc, pcdoc_element_t element,
-        struct visit_args *args)
-{
-    bool found = false;
-    pcdoc_element_has_class(doc, element, args->css + 1, &found);
-    return found;
-}
-
-static bool
-match_by_id(purc_document_t doc, pcdoc_element_t element,
-        struct visit_args *args)
-{
-    const char *s;
-    size_t len;
-    s = pcdoc_element_id(doc, element, &len);
-
-    if (s && s[len]=='\0' &&
-            strncmp(s, args->css + 1, len)==0 &&
-            args->css[1+len]=='\0')
-    {
-        return true;
-    }
-
-    return false;
-}
-
 static int
 visit_element(purc_document_t doc, pcdoc_element_t element, void *ud)
 {
+    UNUSED_PARAM(doc);
     struct visit_args *args = (struct visit_args*)ud;
 
-    if (args->css[0] == '.') {
-        if (!match_by_class(doc, element, args))
-            return 0;
-    }
-    else if (args->css[0] == '#') {
-        if (!match_by_id(doc, element, args))
-            return 0;
-    }
-
     if (!add_element(args->elements, element))
         return -1;
 
@@ -542,17 +507,16 @@ purc_variant_t
 pcdvobjs_query_elements(purc_document_t doc, pcdoc_element_t root,
         const char *css)
 {
-    if (strcmp(css, "*") != 0) {
-        if (css[0] != '.' && css[0] != '#') {
-            pcinst_set_error(PURC_ERROR_ARGUMENT_MISSED);
-            return PURC_VARIANT_INVALID;
-        }
-        if (css[1] == '\0') {
-            pcinst_set_error(PURC_ERROR_ARGUMENT_MISSED);
-            return PURC_VARIANT_INVALID;
-        }
+    if (css[0] == '\0') {
+        pcinst_set_error(PURC_ERROR_ARGUMENT_MISSED);
+        return PURC_VARIANT_INVALID;
     }
 
+    /* the compiled selector is cached by the document */
+    pcdoc_selector_t sel = pcdoc_document_get_selector(doc, css);
+    if (sel == NULL)
+        return PURC_VARIANT_INVALID;
+
     purc_variant_t elements = make_elements();
     if (elements == PURC_VARIANT_INVALID)
         return PURC_VARIANT_INVALID;
@@ -574,8 +538,7 @@ pcdvobjs_query_elements(purc_document_t doc, pcdoc_element_t root,
     args.elements = (struct pcdvobjs_elements*)entity;
     args.css      = css;
 
-    int r = pcdoc_travel_descendant_elements(doc, root,
-            visit_element, &args, NULL);
+    int r = pcdoc_selector_travel(doc, sel, root, visit_element, &args, NULL);
     if (r) {
         purc_variant_unref(elements);
         return PURC_VARIANT_INVALID;
@@ -277,23 +277,6 @@ enum tokenizer_state {
     LAST_STATE = TKZ_STATE_EJSON_CJSONEE_FINISHED,
 };
 
-#define print_uc_list(uc_list, tag)                                         \
-    do {                                                                    \
-        PC_DEBUG( "begin print %s list\n|", tag);                           \
-        struct list_head *p, *n;                                            \
-        list_for_each_safe(p, n, uc_list) {                                 \
-            struct tkz_uc *puc = list_entry(p, struct tkz_uc, list);        \
-            PC_DEBUG( "%c", puc->character);                                \
-        }                                                                   \
-        PC_DEBUG( "|\nend print %s list\n", tag);                           \
-    } while(0)
-
-#define PRINT_CONSUMED_LIST(wrap)    \
-        print_uc_list(&wrap->consumed_list, "consumed")
-
-#define PRINT_RECONSUM_LIST(wrap)    \
-        print_uc_list(&wrap->reconsume_list, "reconsume")
-
 struct pcejson {
     int state;
     int return_state;
@@ -371,6 +354,11 @@ void pcejson_destroy(struct pcejson *parser)
     }
 }
 
+void pcejson_give_back(struct pcejson *parser)
+{
+    tkz_reader_give_back(parser->tkz_reader);
+}
+
 void pcejson_reset(struct pcejson *parser, uint32_t depth, uint32_t flags)
 {
     parser->state = 0;
@@ -41,6 +41,7 @@
 
 #define NR_CONSUMED_LIST_LIMIT   10
 #define MIN_BUFFER_CAPACITY      32
+#define READER_BUFFER_SIZE       4096
 
 #if HAVE(GLIB)
 #define    PCHVML_ALLOC(sz)   g_slice_alloc0(sz)
@@ -52,36 +53,35 @@
 
 struct tkz_reader {
     purc_rwstream_t rws;
-    struct list_head reconsume_list;
-    struct list_head consumed_list;
+
+    /* the raw bytes read from rws in bulk but not decoded yet */
+    uint8_t *here;
+    uint8_t *stop;
+    uint8_t buf[READER_BUFFER_SIZE];
+
+    /* ring of the last consumed characters, `consumed_first` is the oldest */
+    struct tkz_uc consumed_ring[NR_CONSUMED_LIST_LIMIT];
+    size_t consumed_first;
     size_t nr_consumed_list;
 
+    /* the characters to reconsume; the last one is the next to return */
+    struct tkz_uc reconsume_stack[NR_CONSUMED_LIST_LIMIT];
+    size_t nr_reconsume_list;
+
     struct tkz_uc curr_uc;
     int line;
     int column;
     int consumed;
 };
 
-struct tkz_uc *tkz_uc_new(void)
-{
-    return PCHVML_ALLOC(sizeof(struct tkz_uc));
-}
-
-void tkz_uc_destroy(struct tkz_uc *uc)
-{
-    if (uc) {
-        PCHVML_FREE(uc);
-    }
-}
-
 struct tkz_reader *tkz_reader_new(void)
 {
     struct tkz_reader *reader = PCHVML_ALLOC(sizeof(struct tkz_reader));
     if (!reader) {
         return NULL;
     }
-    INIT_LIST_HEAD(&reader->reconsume_list);
-    INIT_LIST_HEAD(&reader->consumed_list);
+    reader->here = reader->buf;
+    reader->stop = reader->buf;
     reader->line = 1;
     reader->column = 0;
     reader->consumed = 0;
@@ -91,18 +91,115 @@ struct tkz_reader *tkz_reader_new(void)
 void tkz_reader_set_rwstream(struct tkz_reader *reader,
         purc_rwstream_t rws)
 {
+    if (reader->rws != rws) {
+        /* the bytes read ahead belong to the previous stream */
+        reader->here = reader->buf;
+        reader->stop = reader->buf;
+    }
     reader->rws = rws;
 }
 
+/*
+ * Moves the undecoded bytes to the head of the buffer and reads as many
+ * bytes as possible from the stream. Returns the number of bytes read,
+ * 0 on EOF, or -1 on error.
+ */
+static ssize_t
+tkz_reader_fill_buffer(struct tkz_reader *reader)
+{
+    size_t left = reader->stop - reader->here;
+    if (left && reader->here != reader->buf) {
+        memmove(reader->buf, reader->here, left);
+    }
+    reader->here = reader->buf;
+    reader->stop = reader->buf + left;
+
+    ssize_t nr = purc_rwstream_read(reader->rws, reader->stop,
+            sizeof(reader->buf) - left);
+    if (nr > 0) {
+        reader->stop += nr;
+    }
+    return nr;
+}
+
+/*
+ * Decodes the next character from the buffered bytes, with the same
+ * results as purc_rwstream_read_utf8_char().
+ */
+static uint32_t
+tkz_reader_decode_char(struct tkz_reader *reader)
+{
+    if (reader->here == reader->stop) {
+        ssize_t nr = tkz_reader_fill_buffer(reader);
+        if (nr <= 0) {
+            return nr < 0 ? TKZ_INVALID_CHARACTER : TKZ_END_OF_FILE;
+        }
+    }
+
+    uint8_t c = *reader->here;
+    if (c < 0x80) {
+        reader->here++;
+        return c;
+    }
+
+    if (c > 0xFD) {
+        reader->here++;
+        pcinst_set_error(PCRWSTREAM_ERROR_IO);
+        return TKZ_INVALID_CHARACTER;
+    }
+
+    size_t ch_len = 1;
+    while (c & (0x80 >> ch_len))
+        ch_len++;
+
+    if (ch_len < 2) {
+        reader->here++;
+        pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+        return TKZ_INVALID_CHARACTER;
+    }
+
+    /* a short read may split the character */
+    while ((size_t)(reader->stop - reader->here) < ch_len) {
+        if (tkz_reader_fill_buffer(reader) <= 0)
+            break;
+    }
+
+    const uint8_t *p = reader->here + 1;
+    for (size_t i = 1; i < ch_len; i++, p++) {
+        if (p == reader->stop || (*p & 0xC0) != 0x80) {
+            reader->here = (uint8_t *)p;
+            pcinst_set_error(PCRWSTREAM_ERROR_IO);
+            return TKZ_INVALID_CHARACTER;
+        }
+    }
+
+    const uint8_t *utf8 = reader->here;
+    reader->here += ch_len;
+
+    // FIXME
+    if (ch_len > 3) {
+        pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+        return TKZ_INVALID_CHARACTER;
+    }
+
+    size_t nr_chars;
+    if (!pcutils_string_check_utf8_len((const char *)utf8, ch_len,
+                &nr_chars, NULL)) {
+        pcinst_set_error(PURC_ERROR_BAD_ENCODING);
+        return TKZ_INVALID_CHARACTER;
+    }
+
+    uint32_t uc = c & ((1 << (8 - ch_len)) - 1);
+    for (size_t i = 1; i < ch_len; i++) {
+        uc = (uc << 6) | (utf8[i] & 0x3F);
+    }
+    return uc;
+}
+
 static struct tkz_uc*
 tkz_reader_read_from_rwstream(struct tkz_reader *reader)
 {
-    char c[8] = {0};
-    uint32_t uc = 0;
-    int nr_c = purc_rwstream_read_utf8_char(reader->rws, c, &uc);
-    if (nr_c < 0) {
-        uc = TKZ_INVALID_CHARACTER;
-    }
+    uint32_t uc = tkz_reader_decode_char(reader);
     reader->column++;
     reader->consumed++;
 
@@ -120,52 +217,26 @@ tkz_reader_read_from_rwstream(struct tkz_reader *reader)
 static struct tkz_uc*
 tkz_reader_read_from_reconsume_list(struct tkz_reader *reader)
 {
-    struct tkz_uc *puc = list_entry(reader->reconsume_list.next,
-            struct tkz_uc, list);
-    reader->curr_uc = *puc;
-    list_del_init(&puc->list);
-    tkz_uc_destroy(puc);
+    reader->nr_reconsume_list--;
+    reader->curr_uc = reader->reconsume_stack[reader->nr_reconsume_list];
     return &reader->curr_uc;
 }
 
-#define print_uc_list(uc_list, tag)                                         \
-    do {                                                                    \
-        PC_DEBUG("begin print %s list\n|", tag);                            \
-        struct list_head *p, *n;                                            \
-        list_for_each_safe(p, n, uc_list) {                                 \
-            struct tkz_uc *puc = list_entry(p, struct tkz_uc, list);        \
-            PC_DEBUG("%c", puc->character);                                 \
-        }                                                                   \
-        PC_DEBUG("|\nend print %s list\n", tag);                            \
-    } while(0)
-
-#define PRINT_CONSUMED_LIST(reader)    \
-        print_uc_list(&reader->consumed_list, "consumed")
-
-#define PRINT_RECONSUM_LIST(reader)    \
-        print_uc_list(&reader->reconsume_list, "reconsume")
-
-static bool
+static void
 tkz_reader_add_consumed(struct tkz_reader *reader, struct tkz_uc *uc)
 {
-    struct tkz_uc *p = tkz_uc_new();
-    if (!p) {
-        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
-        return false;
+    size_t idx;
+    if (reader->nr_consumed_list < NR_CONSUMED_LIST_LIMIT) {
+        idx = (reader->consumed_first + reader->nr_consumed_list)
+            % NR_CONSUMED_LIST_LIMIT;
+        reader->nr_consumed_list++;
     }
-
-    *p = *uc;
-    list_add_tail(&p->list, &reader->consumed_list);
-    reader->nr_consumed_list++;
-
-    if (reader->nr_consumed_list > NR_CONSUMED_LIST_LIMIT) {
-        struct tkz_uc *first = list_first_entry(
-                &reader->consumed_list, struct tkz_uc, list);
-        list_del_init(&first->list);
-        tkz_uc_destroy(first);
-        reader->nr_consumed_list--;
+    else {
+        /* overwrite the oldest one */
+        idx = reader->consumed_first;
+        reader->consumed_first = (idx + 1) % NR_CONSUMED_LIST_LIMIT;
     }
-    return true;
+    reader->consumed_ring[idx] = *uc;
 }
 
 bool tkz_reader_reconsume_last_char(struct tkz_reader *reader)
@@ -174,45 +245,49 @@ bool tkz_reader_reconsume_last_char(struct tkz_reader *reader)
         return true;
     }
 
-    struct tkz_uc *last = list_last_entry(
-            &reader->consumed_list, struct tkz_uc, list);
-    list_del_init(&last->list);
     reader->nr_consumed_list--;
-
-    list_add(&last->list, &reader->reconsume_list);
+    size_t idx = (reader->consumed_first + reader->nr_consumed_list)
+        % NR_CONSUMED_LIST_LIMIT;
+
+    /* the reconsume stack never holds more than the consumed ring */
+    PC_ASSERT(reader->nr_reconsume_list < NR_CONSUMED_LIST_LIMIT);
+    reader->reconsume_stack[reader->nr_reconsume_list] =
+        reader->consumed_ring[idx];
+    reader->nr_reconsume_list++;
     return true;
 }
 
 struct tkz_uc *tkz_reader_next_char(struct tkz_reader *reader)
 {
     struct tkz_uc *ret = NULL;
-    if (list_empty(&reader->reconsume_list)) {
+    if (reader->nr_reconsume_list == 0) {
         ret = tkz_reader_read_from_rwstream(reader);
     }
     else {
         ret = tkz_reader_read_from_reconsume_list(reader);
     }
 
-    if (tkz_reader_add_consumed(reader, ret)) {
-        return ret;
+    tkz_reader_add_consumed(reader, ret);
+    return ret;
+}
+
+void tkz_reader_give_back(struct tkz_reader *reader)
+{
+    size_t left = reader->stop - reader->here;
+    if (reader->rws && left) {
+        int err = purc_get_last_error();
+        if (purc_rwstream_seek(reader->rws, -(off_t)left, SEEK_CUR) == -1) {
+            /* not seekable; the bytes are lost for the caller */
+            purc_set_error(err);
+        }
     }
-    return NULL;
+    reader->here = reader->buf;
+    reader->stop = reader->buf;
 }
 
 void tkz_reader_destroy(struct tkz_reader *reader)
 {
     if (reader) {
-        struct list_head *p, *n;
-        list_for_each_safe(p, n, &reader->reconsume_list) {
-            struct tkz_uc *puc = list_entry(p, struct tkz_uc, list);
-            list_del_init(&puc->list);
-            tkz_uc_destroy(puc);
-        }
-        list_for_each_safe(p, n, &reader->consumed_list) {
-            struct tkz_uc *puc = list_entry(p, struct tkz_uc, list);
-            list_del_init(&puc->list);
-            tkz_uc_destroy(puc);
-        }
         PCHVML_FREE(reader);
     }
 }
@@ -34,7 +34,7 @@
 struct pcexec_exe_formula_inst {
     struct purc_exec_inst       super;
 
-    struct exe_formula_param        param;
+    struct exe_formula_param       *param;
 
     purc_variant_t              curr;
 };
@@ -43,32 +43,38 @@ struct pcexec_exe_formula_inst {
 static inline void
 reset(struct pcexec_exe_formula_inst *exe_formula_inst)
 {
-    struct exe_formula_param *param = &exe_formula_inst->param;
-    exe_formula_param_reset(param);
+    if (exe_formula_inst->param) {
+        pcexecutor_release_rule(exe_formula_inst->param);
+        exe_formula_inst->param = NULL;
+    }
     pcexecutor_inst_reset(&exe_formula_inst->super);
     PCEXE_CLR_VAR(exe_formula_inst->curr);
 }
 
+static const struct pcexec_rule_parser rule_parser = {
+    sizeof(struct exe_formula_param),
+    (pcexec_parse_rule_f)exe_formula_parse,
+    (pcexec_reset_param_f)exe_formula_param_reset,
+};
+
 static inline bool
 parse_rule(struct pcexec_exe_formula_inst *exe_formula_inst,
         const char* rule)
 {
     purc_exec_inst_t inst = &exe_formula_inst->super;
 
-    struct exe_formula_param param = {0};
-    int r = exe_formula_parse(rule, strlen(rule), &param);
     if (inst->err_msg) {
         free(inst->err_msg);
         inst->err_msg = NULL;
     }
 
-    if (r) {
-        inst->err_msg = param.err_msg;
-        param.err_msg = NULL;
+    struct exe_formula_param *param;
+    param = pcexecutor_get_rule(&rule_parser, rule, &inst->err_msg);
+    if (!param)
         return false;
-    }
 
-    exe_formula_param_reset(&exe_formula_inst->param);
+    if (exe_formula_inst->param)
+        pcexecutor_release_rule(exe_formula_inst->param);
     exe_formula_inst->param = param;
 
     return true;
@@ -77,7 +83,7 @@ parse_rule(struct pcexec_exe_formula_inst *exe_formula_inst,
 static inline bool
 iterate(struct pcexec_exe_formula_inst *exe_formula_inst)
 {
-    struct exe_formula_param *param = &exe_formula_inst->param;
+    struct exe_formula_param *param = exe_formula_inst->param;
     struct formula_rule *rule = &param->rule;
     purc_variant_t curr = exe_formula_inst->curr;
     purc_variant_t k = purc_variant_make_string_static("X", false);
@@ -116,7 +122,7 @@ static inline bool
 check_curr(struct pcexec_exe_formula_inst *exe_formula_inst)
 {
     purc_exec_inst_t inst = &exe_formula_inst->super;
-    struct exe_formula_param *param = &exe_formula_inst->param;
+    struct exe_formula_param *param = exe_formula_inst->param;
     struct formula_rule *rule = &param->rule;
     struct number_comparing_logical_expression *ncle = rule->ncle;
     purc_variant_t curr = exe_formula_inst->curr;
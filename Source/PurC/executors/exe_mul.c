@@ -34,7 +34,7 @@
 struct pcexec_exe_mul_inst {
     struct purc_exec_inst       super;
 
-    struct exe_mul_param        param;
+    struct exe_mul_param       *param;
 
     double                      curr;
 };
@@ -43,31 +43,37 @@ struct pcexec_exe_mul_inst {
 static inline void
 reset(struct pcexec_exe_mul_inst *exe_mul_inst)
 {
-    struct exe_mul_param *param = &exe_mul_inst->param;
-    exe_mul_param_reset(param);
+    if (exe_mul_inst->param) {
+        pcexecutor_release_rule(exe_mul_inst->param);
+        exe_mul_inst->param = NULL;
+    }
     pcexecutor_inst_reset(&exe_mul_inst->super);
 }
 
+static const struct pcexec_rule_parser rule_parser = {
+    sizeof(struct exe_mul_param),
+    (pcexec_parse_rule_f)exe_mul_parse,
+    (pcexec_reset_param_f)exe_mul_param_reset,
+};
+
 static inline bool
 parse_rule(struct pcexec_exe_mul_inst *exe_mul_inst,
         const char* rule)
 {
     purc_exec_inst_t inst = &exe_mul_inst->super;
 
-    struct exe_mul_param param = {0};
-    int r = exe_mul_parse(rule, strlen(rule), &param);
     if (inst->err_msg) {
         free(inst->err_msg);
         inst->err_msg = NULL;
     }
 
-    if (r) {
-        inst->err_msg = param.err_msg;
-        param.err_msg = NULL;
+    struct exe_mul_param *param;
+    param = pcexecutor_get_rule(&rule_parser, rule, &inst->err_msg);
+    if (!param)
         return false;
-    }
 
-    exe_mul_param_reset(&exe_mul_inst->param);
+    if (exe_mul_inst->param)
+        pcexecutor_release_rule(exe_mul_inst->param);
     exe_mul_inst->param = param;
 
     return true;
@@ -77,7 +83,7 @@ static inline bool
 check_curr(struct pcexec_exe_mul_inst *exe_mul_inst, const double curr)
 {
     purc_exec_inst_t inst = &exe_mul_inst->super;
-    struct exe_mul_param *param = &exe_mul_inst->param;
+    struct exe_mul_param *param = exe_mul_inst->param;
     struct mul_rule *rule = &param->rule;
     struct number_comparing_logical_expression *ncle = rule->ncle;
 
@@ -128,7 +134,7 @@ fetch_next(struct pcexec_exe_mul_inst *exe_mul_inst)
 {
     purc_exec_inst_t inst = &exe_mul_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct exe_mul_param *param = &exe_mul_inst->param;
+    struct exe_mul_param *param = exe_mul_inst->param;
     struct mul_rule *rule = &param->rule;
     double curr = exe_mul_inst->curr;
     if (!isnan(rule->nexp)) {
@@ -39,7 +39,7 @@
 struct pcexec_exe_range_inst {
     struct purc_exec_inst       super;
 
-    struct exe_range_param        param;
+    struct exe_range_param       *param;
 
     purc_variant_t              result_set;
 };
@@ -48,8 +48,10 @@ struct pcexec_exe_range_inst {
 static inline void
 reset(struct pcexec_exe_range_inst *exe_range_inst)
 {
-    struct exe_range_param *param = &exe_range_inst->param;
-    exe_range_param_reset(param);
+    if (exe_range_inst->param) {
+        pcexecutor_release_rule(exe_range_inst->param);
+        exe_range_inst->param = NULL;
+    }
     pcexecutor_inst_reset(&exe_range_inst->super);
     PCEXE_CLR_VAR(exe_range_inst->result_set);
 }
@@ -160,26 +162,30 @@ prepare_result_set(struct pcexec_exe_range_inst *exe_range_inst)
     return ok;
 }
 
+static const struct pcexec_rule_parser rule_parser = {
+    sizeof(struct exe_range_param),
+    (pcexec_parse_rule_f)exe_range_parse,
+    (pcexec_reset_param_f)exe_range_param_reset,
+};
+
 static inline bool
 parse_rule(struct pcexec_exe_range_inst *exe_range_inst,
         const char* rule)
 {
     purc_exec_inst_t inst = &exe_range_inst->super;
 
-    struct exe_range_param param = {0};
-    int r = exe_range_parse(rule, strlen(rule), &param);
     if (inst->err_msg) {
         free(inst->err_msg);
         inst->err_msg = NULL;
     }
 
-    if (r) {
-        inst->err_msg = param.err_msg;
-        param.err_msg = NULL;
+    struct exe_range_param *param;
+    param = pcexecutor_get_rule(&rule_parser, rule, &inst->err_msg);
+    if (!param)
         return false;
-    }
 
-    exe_range_param_reset(&exe_range_inst->param);
+    if (exe_range_inst->param)
+        pcexecutor_release_rule(exe_range_inst->param);
     exe_range_inst->param = param;
 
     return prepare_result_set(exe_range_inst);
@@ -190,7 +196,7 @@ check_curr(struct pcexec_exe_range_inst *exe_range_inst)
 {
     purc_exec_inst_t inst = &exe_range_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct exe_range_param *param = &exe_range_inst->param;
+    struct exe_range_param *param = exe_range_inst->param;
     struct range_rule *rule = &param->rule;
 
     int curr = (int)it->curr;
@@ -240,7 +246,7 @@ fetch_begin(struct pcexec_exe_range_inst *exe_range_inst)
 {
     purc_exec_inst_t inst = &exe_range_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct exe_range_param *param = &exe_range_inst->param;
+    struct exe_range_param *param = exe_range_inst->param;
     struct range_rule *rule = &param->rule;
     it->curr = rule->from;
     if (check_curr(exe_range_inst)) {
@@ -254,7 +260,7 @@ fetch_next(struct pcexec_exe_range_inst *exe_range_inst)
 {
     purc_exec_inst_t inst = &exe_range_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct exe_range_param *param = &exe_range_inst->param;
+    struct exe_range_param *param = exe_range_inst->param;
     struct range_rule *rule = &param->rule;
     int advance = 1;
     if (isfinite(rule->advance))
@@ -307,11 +313,6 @@ exe_range_create(enum purc_exec_type type,
     inst->type        = type;
     inst->asc_desc    = asc_desc;
 
-    int debug_flex, debug_bison;
-    pcexecutor_get_debug(&debug_flex, &debug_bison);
-    exe_range_inst->param.debug_flex  = debug_flex;
-    exe_range_inst->param.debug_bison = debug_bison;
-
     enum purc_variant_type vt = purc_variant_get_type(input);
     if (vt == PURC_VARIANT_TYPE_ARRAY ||
         vt == PURC_VARIANT_TYPE_SET)
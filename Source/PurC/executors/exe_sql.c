@@ -31,52 +31,164 @@
 
 struct pcexec_exe_sql_inst {
     struct purc_exec_inst       super;
+
+    struct exe_sql_param       *param;
+
+    purc_variant_t              result_set;
+};
+
+// clear internal data except `input`
+static inline void
+reset(struct pcexec_exe_sql_inst *exe_sql_inst)
+{
+    if (exe_sql_inst->param) {
+        pcexecutor_release_rule(exe_sql_inst->param);
+        exe_sql_inst->param = NULL;
+    }
+    pcexecutor_inst_reset(&exe_sql_inst->super);
+    PCEXE_CLR_VAR(exe_sql_inst->result_set);
+}
+
+// the query plan is compiled along with the rule, thus cached with it
+static int
+exe_sql_parse_and_plan(const char *input, size_t len,
+        struct exe_sql_param *param)
+{
+    if (exe_sql_parse(input, len, param))
+        return -1;
+
+    if (sql_query_compile(param->query, &param->err_msg)) {
+        pcinst_set_error(PCEXECUTOR_ERROR_BAD_SYNTAX);
+        return -1;
+    }
+
+    return 0;
+}
+
+static const struct pcexec_rule_parser rule_parser = {
+    sizeof(struct exe_sql_param),
+    (pcexec_parse_rule_f)exe_sql_parse_and_plan,
+    (pcexec_reset_param_f)exe_sql_param_reset,
 };
 
+static inline bool
+parse_rule(struct pcexec_exe_sql_inst *exe_sql_inst, const char* rule)
+{
+    purc_exec_inst_t inst = &exe_sql_inst->super;
+
+    if (inst->err_msg) {
+        free(inst->err_msg);
+        inst->err_msg = NULL;
+    }
+
+    struct exe_sql_param *param;
+    param = pcexecutor_get_rule(&rule_parser, rule, &inst->err_msg);
+    if (!param)
+        return false;
+
+    if (exe_sql_inst->param)
+        pcexecutor_release_rule(exe_sql_inst->param);
+    exe_sql_inst->param = param;
+
+    purc_variant_t result_set;
+    result_set = sql_query_execute(param->query, inst->input);
+    if (result_set == PURC_VARIANT_INVALID)
+        return false;
+
+    PCEXE_CLR_VAR(exe_sql_inst->result_set);
+    exe_sql_inst->result_set = result_set;
+    return true;
+}
+
+static inline bool
+check_curr(struct pcexec_exe_sql_inst *exe_sql_inst)
+{
+    purc_exec_inst_t inst = &exe_sql_inst->super;
+    purc_exec_iter_t it = &inst->it;
+
+    size_t nr = purc_variant_array_get_size(exe_sql_inst->result_set);
+    if (it->curr >= nr) {
+        pcinst_set_error(PCEXECUTOR_ERROR_NOT_EXISTS);
+        return false;
+    }
+
+    purc_variant_t v = purc_variant_array_get(exe_sql_inst->result_set,
+            it->curr);
+    PCEXE_CLR_VAR(inst->value);
+    inst->value = purc_variant_ref(v);
+    return true;
+}
+
+static inline void
+destroy(struct pcexec_exe_sql_inst *exe_sql_inst)
+{
+    purc_exec_inst_t inst = &exe_sql_inst->super;
+
+    reset(exe_sql_inst);
+
+    PCEXE_CLR_VAR(inst->input);
+    PCEXE_CLR_VAR(inst->value);
+
+    free(exe_sql_inst);
+}
+
 // 创建一个执行器实例
 static purc_exec_inst_t
 exe_sql_create(enum purc_exec_type type,
         purc_variant_t input, bool asc_desc)
 {
-    if (!purc_variant_is_object(input))
-        return NULL;
-
-    struct pcexec_exe_sql_inst *inst;
-    inst = calloc(1, sizeof(*inst));
-    if (!inst) {
+    struct pcexec_exe_sql_inst *exe_sql_inst;
+    exe_sql_inst = calloc(1, sizeof(*exe_sql_inst));
+    if (!exe_sql_inst) {
         pcinst_set_error(PCEXECUTOR_ERROR_OOM);
         return NULL;
     }
 
-    inst->super.type        = type;
-    inst->super.input       = input;
-    inst->super.asc_desc    = asc_desc;
+    purc_exec_inst_t inst = &exe_sql_inst->super;
 
-    purc_variant_ref(input);
+    inst->type        = type;
+    inst->asc_desc    = asc_desc;
 
-    return &inst->super;
+    enum purc_variant_type vt = purc_variant_get_type(input);
+    if (vt == PURC_VARIANT_TYPE_OBJECT ||
+        vt == PURC_VARIANT_TYPE_ARRAY ||
+        vt == PURC_VARIANT_TYPE_SET)
+    {
+        inst->input = input;
+        purc_variant_ref(input);
+        return inst;
+    }
+
+    destroy(exe_sql_inst);
+    return NULL;
 }
 
-static inline bool
-exe_sql_parse_rule(purc_exec_inst_t inst, const char* rule)
+static inline purc_exec_iter_t
+it_begin(struct pcexec_exe_sql_inst *exe_sql_inst, const char *rule)
 {
-    // parse and fill the internal fields from rule
-    // for example, generating the `selected_keys` which contains all
-    // selected keys.
-
-    // clear previously-selected-keys
-    if (inst->selected_keys) {
-        purc_variant_unref(inst->selected_keys);
-        inst->selected_keys = PURC_VARIANT_INVALID;
-    }
+    purc_exec_iter_t it = &exe_sql_inst->super.it;
+
+    if (!parse_rule(exe_sql_inst, rule))
+        return NULL;
+
+    it->curr = 0;
+    return check_curr(exe_sql_inst) ? it : NULL;
+}
 
-    // TODO: parse rule and eval to selected_keys
+static inline purc_exec_iter_t
+it_next(struct pcexec_exe_sql_inst *exe_sql_inst, const char *rule)
+{
+    purc_exec_iter_t it = &exe_sql_inst->super.it;
+    size_t curr = it->curr;
 
-    UNUSED_PARAM(inst);
-    UNUSED_PARAM(rule);
+    // the query runs again against the new rule
+    if (rule) {
+        if (!parse_rule(exe_sql_inst, rule))
+            return NULL;
+    }
 
-    pcinst_set_error(PCEXECUTOR_ERROR_NOT_IMPLEMENTED);
-    return false;
+    it->curr = curr + 1;
+    return check_curr(exe_sql_inst) ? it : NULL;
 }
 
 // 用于执行选择
@@ -88,48 +200,17 @@ exe_sql_choose(purc_exec_inst_t inst, const char* rule)
         return PURC_VARIANT_INVALID;
     }
 
-    if (!exe_sql_parse_rule(inst, rule))
-        return PURC_VARIANT_INVALID;
+    struct pcexec_exe_sql_inst *exe_sql_inst;
+    exe_sql_inst = (struct pcexec_exe_sql_inst*)inst;
 
-    size_t sz = purc_variant_array_get_size(inst->selected_keys);
-
-    purc_variant_t vals = purc_variant_make_array(0, PURC_VARIANT_INVALID);
-    if (vals == PURC_VARIANT_INVALID) {
-        return vals;
-    }
-
-    bool ok = true;
-
-    for (size_t i=0; i<sz; ++i) {
-        purc_variant_t k;
-        k = purc_variant_array_get(inst->selected_keys, i);
-        purc_variant_t v;
-        v = purc_variant_object_get(inst->input, k);
-        if (v==PURC_VARIANT_INVALID)
-            continue;
-        ok = purc_variant_array_append(vals, v);
-        if (!ok)
-            break;
-    }
-
-    PC_ASSERT(0); // Not tested yet!!!
-
-    if (ok) {
-        size_t n;
-        purc_variant_array_size(vals, &n);
-        if (n == 1) {
-            purc_variant_t v = purc_variant_array_get(vals, 0);
-            purc_variant_ref(v);
-            purc_variant_unref(vals);
-            vals = v;
-        }
-    }
+    if (!parse_rule(exe_sql_inst, rule))
+        return PURC_VARIANT_INVALID;
 
-    if (ok)
-        return vals;
+    purc_variant_t vals = exe_sql_inst->result_set;
+    if (purc_variant_array_get_size(vals) == 1)
+        vals = purc_variant_array_get(vals, 0);
 
-    purc_variant_unref(vals);
-    return PURC_VARIANT_INVALID;
+    return purc_variant_ref(vals);
 }
 
 // 获得用于迭代的初始迭代子
@@ -141,17 +222,17 @@ exe_sql_it_begin(purc_exec_inst_t inst, const char* rule)
         return NULL;
     }
 
-    inst->it.curr = 0;
-    if (!exe_sql_parse_rule(inst, rule))
-        return NULL;
-
-    size_t sz = purc_variant_array_get_size(inst->selected_keys);
-    if (sz<=0) {
-        pcinst_set_error(PCEXECUTOR_ERROR_NO_KEYS_SELECTED);
+    if (inst->type != PURC_EXEC_TYPE_ITERATE) {
+        pcinst_set_error(PCEXECUTOR_ERROR_NOT_ALLOWED);
         return NULL;
     }
 
-    return &inst->it;
+    PC_ASSERT(inst->input != PURC_VARIANT_INVALID);
+
+    struct pcexec_exe_sql_inst *exe_sql_inst;
+    exe_sql_inst = (struct pcexec_exe_sql_inst*)inst;
+
+    return it_begin(exe_sql_inst, rule);
 }
 
 // 根据迭代子获得对应的变体值
@@ -164,15 +245,10 @@ exe_sql_it_value(purc_exec_inst_t inst, purc_exec_iter_t it)
     }
 
     PC_ASSERT(&inst->it == it);
-    PC_ASSERT(inst->selected_keys != PURC_VARIANT_INVALID);
     PC_ASSERT(inst->input != PURC_VARIANT_INVALID);
+    PC_ASSERT(inst->value != PURC_VARIANT_INVALID);
 
-    purc_variant_t k;
-    k = purc_variant_array_get(inst->selected_keys, it->curr);
-    purc_variant_t v;
-    v = purc_variant_object_get(inst->input, k);
-
-    return v;
+    return inst->value;
 }
 
 // 获得下一个迭代子
@@ -187,30 +263,16 @@ exe_sql_it_next(purc_exec_inst_t inst, purc_exec_iter_t it, const char* rule)
     }
 
     PC_ASSERT(&inst->it == it);
+    PC_ASSERT(inst->input != PURC_VARIANT_INVALID);
 
-    if (rule) {
-        // clear previously-selected-keys
-        if (inst->selected_keys) {
-            purc_variant_unref(inst->selected_keys);
-            inst->selected_keys = PURC_VARIANT_INVALID;
-        }
-
-        if (!exe_sql_parse_rule(inst, rule))
-            return NULL;
-    }
-
-    ++it->curr;
-
-    size_t sz = purc_variant_array_get_size(inst->selected_keys);
-    if (it->curr >= sz) {
-        it->curr = sz;
-        return NULL;
-    }
+    struct pcexec_exe_sql_inst *exe_sql_inst;
+    exe_sql_inst = (struct pcexec_exe_sql_inst*)inst;
 
-    return it;
+    return it_next(exe_sql_inst, rule);
 }
 
 // 用于执行规约
+// the result rows are always returned in an array
 static purc_variant_t
 exe_sql_reduce(purc_exec_inst_t inst, const char* rule)
 {
@@ -219,37 +281,13 @@ exe_sql_reduce(purc_exec_inst_t inst, const char* rule)
         return PURC_VARIANT_INVALID;
     }
 
-    if (!exe_sql_parse_rule(inst, rule))
-        return PURC_VARIANT_INVALID;
+    struct pcexec_exe_sql_inst *exe_sql_inst;
+    exe_sql_inst = (struct pcexec_exe_sql_inst*)inst;
 
-    size_t sz = purc_variant_array_get_size(inst->selected_keys);
-
-    purc_variant_t objs;
-    objs = purc_variant_make_object(0,
-                PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
-    if (objs == PURC_VARIANT_INVALID) {
-        return objs;
-    }
-
-    bool ok = false;
-
-    for (size_t i=0; i<sz; ++i) {
-        purc_variant_t k;
-        k = purc_variant_array_get(inst->selected_keys, i);
-        purc_variant_t v;
-        v = purc_variant_object_get(inst->input, k);
-        if (v==PURC_VARIANT_INVALID)
-            continue;
-        ok = purc_variant_object_set(objs, k, v);
-        if (!ok)
-            break;
-    }
-
-    if (ok)
-        return objs;
+    if (!parse_rule(exe_sql_inst, rule))
+        return PURC_VARIANT_INVALID;
 
-    purc_variant_unref(objs);
-    return PURC_VARIANT_INVALID;
+    return purc_variant_ref(exe_sql_inst->result_set);
 }
 
 // 销毁一个执行器实例
@@ -261,18 +299,10 @@ exe_sql_destroy(purc_exec_inst_t inst)
         return false;
     }
 
-    struct pcexec_exe_sql_inst *exe_sql_inst = (struct pcexec_exe_sql_inst*)inst;
+    struct pcexec_exe_sql_inst *exe_sql_inst;
+    exe_sql_inst = (struct pcexec_exe_sql_inst*)inst;
 
-    if (exe_sql_inst->super.input) {
-        purc_variant_unref(exe_sql_inst->super.input);
-        exe_sql_inst->super.input = PURC_VARIANT_INVALID;
-    }
-    if (exe_sql_inst->super.selected_keys) {
-        purc_variant_unref(exe_sql_inst->super.selected_keys);
-        exe_sql_inst->super.selected_keys = PURC_VARIANT_INVALID;
-    }
-
-    free(exe_sql_inst);
+    destroy(exe_sql_inst);
     return true;
 }
 
@@ -291,4 +321,3 @@ int pcexec_exe_sql_register(void)
     bool ok = purc_register_executor("SQL", &exe_sql_ops);
     return ok ? 0 : -1;
 }
-
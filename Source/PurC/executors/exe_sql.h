@@ -29,11 +29,172 @@
 #include "config.h"
 
 #include "purc-macros.h"
+#include "purc-variant.h"
+
+#include "pcexe-helper.h"
+
+enum sql_expr_type {
+    SQL_EXPR_NUMBER,
+    SQL_EXPR_STRING,
+    SQL_EXPR_COLUMN,        // name or name.field
+    SQL_EXPR_STAR,          // `*`: all members of the record
+    SQL_EXPR_SELF,          // `&`: the record itself
+    SQL_EXPR_META,          // `@name`
+    SQL_EXPR_CALL,          // name(exp) or name(*)
+
+    SQL_EXPR_LIKE,
+    SQL_EXPR_IN,
+    SQL_EXPR_AND,
+    SQL_EXPR_OR,
+    SQL_EXPR_NOT,
+
+    SQL_EXPR_EQ,
+    SQL_EXPR_NE,
+    SQL_EXPR_LT,
+    SQL_EXPR_LE,
+    SQL_EXPR_GT,
+    SQL_EXPR_GE,
+
+    SQL_EXPR_ADD,
+    SQL_EXPR_SUB,
+    SQL_EXPR_MUL,
+    SQL_EXPR_DIV,
+    SQL_EXPR_NEG,
+};
+
+struct sql_expr {
+    enum sql_expr_type          type;
+
+    double                      d;      // NUMBER
+    char                       *name;   // STRING, COLUMN, META and CALL
+    char                       *field;  // COLUMN: the member of `name`
+
+    struct sql_expr            *left;   // the operands; the argument of CALL
+    struct sql_expr            *right;  // IN: the list of the candidates
+    struct sql_expr            *next;   // the next one in a list
+
+    // filled by sql_query_compile()
+    int                         idx;    // COLUMN: column; CALL: aggregate
+    struct string_pattern_expression *pattern;  // LIKE: the compiled one
+};
+
+struct sql_select_item {
+    struct sql_expr            *exp;
+    char                       *alias;
+    struct sql_select_item     *next;
+};
+
+struct sql_order_item {
+    struct sql_expr            *col;
+    bool                        desc;
+    struct sql_order_item      *next;
+};
+
+enum sql_travel_type {
+    SQL_TRAVEL_NONE,
+    SQL_TRAVEL_SIBLINGS,
+    SQL_TRAVEL_DEPTH,
+    SQL_TRAVEL_BREADTH,
+    SQL_TRAVEL_LEAVES,
+};
+
+struct sql_plan;
+
+struct sql_select {
+    struct sql_select_item     *items;
+    struct sql_expr            *from;       // NULL: the input itself
+    struct sql_expr            *where;
+    struct sql_expr            *group_by;
+    struct sql_order_item      *order_by;
+    long                        limit;      // negative: no limit
+    enum sql_travel_type        travel;
+
+    struct sql_plan            *plan;
+};
+
+// a SELECT if `select` is not NULL, or the UNION of `left` and `right`
+struct sql_query {
+    struct sql_select          *select;
+    struct sql_query           *left;
+    struct sql_query           *right;
+};
+
+struct exe_sql_param {
+    char *err_msg;
+    int debug_flex;
+    int debug_bison;
+
+    struct sql_query          *query;
+    unsigned int               rule_valid:1;
+};
 
 PCA_EXTERN_C_BEGIN
 
 int pcexec_exe_sql_register(void);
 
+struct sql_expr *
+sql_expr_create(enum sql_expr_type type);
+
+struct sql_expr *
+sql_expr_create_op(enum sql_expr_type type,
+        struct sql_expr *left, struct sql_expr *right);
+
+void
+sql_expr_destroy(struct sql_expr *exp);
+
+void
+sql_select_item_destroy(struct sql_select_item *item);
+
+void
+sql_order_item_destroy(struct sql_order_item *item);
+
+struct sql_select *
+sql_select_create(void);
+
+void
+sql_select_destroy(struct sql_select *select);
+
+struct sql_query *
+sql_query_create(struct sql_select *select,
+        struct sql_query *left, struct sql_query *right);
+
+void
+sql_query_destroy(struct sql_query *query);
+
+/*
+ * Compile the query plans of all the SELECT statements in @query.
+ * Returns 0 on success; otherwise, returns -1 and the reason in @err_msg.
+ */
+int
+sql_query_compile(struct sql_query *query, char **err_msg);
+
+/*
+ * Run the compiled @query against the records in @input, which can be
+ * an array, a set, or an object. Returns the result rows in an array.
+ */
+purc_variant_t
+sql_query_execute(struct sql_query *query, purc_variant_t input);
+
+int exe_sql_parse(const char *input, size_t len,
+        struct exe_sql_param *param);
+
+static inline void
+exe_sql_param_reset(struct exe_sql_param *param)
+{
+    if (!param)
+        return;
+
+    if (param->err_msg) {
+        free(param->err_msg);
+        param->err_msg = NULL;
+    }
+
+    if (param->query) {
+        sql_query_destroy(param->query);
+        param->query = NULL;
+    }
+}
+
 PCA_EXTERN_C_END
 
 #endif // PURC_EXECUTOR_SQL_H
@@ -0,0 +1,1752 @@
+/*
+ * @file exe_sql_engine.c
+ * @date 2022/09/20
+ * @brief The query planner and the executing engine of SQL executor.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+#include "exe_sql.h"
+
+#include "purc-errors.h"
+#include "private/debug.h"
+#include "private/errors.h"
+#include "private/hashtable.h"
+#include "private/variant.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/*
+ * A query is executed in batches of records: the columns referred by the
+ * query are extracted from a batch at first, then the WHERE clause narrows
+ * the selection vector of the batch, and the selected records are either
+ * aggregated into the groups or projected into the result rows.
+ */
+#define SQL_BATCH_SIZE          256
+
+enum sql_value_type {
+    SQL_VALUE_NULL,
+    SQL_VALUE_NUMBER,
+    SQL_VALUE_STRING,
+    SQL_VALUE_OTHER,
+};
+
+/* a value never owns the memory; strings are borrowed from the records */
+struct sql_value {
+    enum sql_value_type         type;
+    double                      d;
+    const char                 *s;
+    purc_variant_t              v;      // the variant if there is one
+};
+
+struct sql_column {
+    const char                 *name;
+    const char                 *field;
+};
+
+enum sql_agg_type {
+    SQL_AGG_COUNT,
+    SQL_AGG_SUM,
+    SQL_AGG_AVG,
+    SQL_AGG_MIN,
+    SQL_AGG_MAX,
+};
+
+struct sql_agg {
+    enum sql_agg_type           type;
+    struct sql_expr            *arg;    // NULL for `*`
+};
+
+struct sql_agg_state {
+    enum sql_agg_type           type;
+    size_t                      count;
+    double                      sum;
+    struct sql_value            min;
+    struct sql_value            max;
+};
+
+struct sql_plan {
+    size_t                      nr_cols;
+    struct sql_column          *cols;
+
+    size_t                      nr_aggs;
+    struct sql_agg             *aggs;
+
+    // the columns of GROUP BY
+    size_t                      nr_keys;
+    int                        *keys;
+
+    // the resolved expressions of ORDER BY
+    size_t                      nr_orders;
+    struct sql_expr           **orders;
+    bool                       *descs;
+
+    // the output keys of the select items
+    size_t                      nr_items;
+    purc_variant_t             *names;
+
+    bool                        grouped;
+    bool                        whole_record;
+};
+
+struct sql_row_ctx {
+    const struct sql_value     *cols;
+    size_t                      stride;
+    purc_variant_t              record;
+    const struct sql_agg_state *aggs;
+};
+
+struct sql_batch {
+    size_t                      nr;
+    purc_variant_t              records[SQL_BATCH_SIZE];
+    struct sql_value           *cols;   // column-major
+};
+
+struct sql_group {
+    const struct sql_plan      *plan;
+    unsigned long               hash;
+
+    purc_variant_t              record; // the first record of the group
+    const struct sql_value     *cols;
+    size_t                      stride;
+    struct sql_agg_state       *aggs;
+};
+
+struct sql_out {
+    purc_variant_t              row;
+    size_t                      seq;
+    struct sql_value            keys[];
+};
+
+struct sql_exec {
+    const struct sql_select    *select;
+    const struct sql_plan      *plan;
+
+    purc_variant_t              result;
+
+    // the collected rows for ORDER BY; a heap of `limit` ones for LIMIT
+    struct sql_out            **outs;
+    size_t                      nr_outs;
+    size_t                      sz_outs;
+    size_t                      seq;
+    size_t                      nr_rows;
+};
+
+struct sql_expr *
+sql_expr_create(enum sql_expr_type type)
+{
+    struct sql_expr *exp = calloc(1, sizeof(*exp));
+    if (exp) {
+        exp->type = type;
+        exp->idx = -1;
+    }
+    return exp;
+}
+
+struct sql_expr *
+sql_expr_create_op(enum sql_expr_type type,
+        struct sql_expr *left, struct sql_expr *right)
+{
+    struct sql_expr *exp = sql_expr_create(type);
+    if (!exp) {
+        sql_expr_destroy(left);
+        sql_expr_destroy(right);
+        return NULL;
+    }
+
+    exp->left = left;
+    exp->right = right;
+    return exp;
+}
+
+void
+sql_expr_destroy(struct sql_expr *exp)
+{
+    while (exp) {
+        struct sql_expr *next = exp->next;
+
+        sql_expr_destroy(exp->left);
+        sql_expr_destroy(exp->right);
+        free(exp->name);
+        free(exp->field);
+        if (exp->pattern) {
+            string_pattern_expression_reset(exp->pattern);
+            free(exp->pattern);
+        }
+        free(exp);
+
+        exp = next;
+    }
+}
+
+void
+sql_select_item_destroy(struct sql_select_item *item)
+{
+    while (item) {
+        struct sql_select_item *next = item->next;
+        sql_expr_destroy(item->exp);
+        free(item->alias);
+        free(item);
+        item = next;
+    }
+}
+
+void
+sql_order_item_destroy(struct sql_order_item *item)
+{
+    while (item) {
+        struct sql_order_item *next = item->next;
+        sql_expr_destroy(item->col);
+        free(item);
+        item = next;
+    }
+}
+
+static void
+plan_destroy(struct sql_plan *plan)
+{
+    if (!plan)
+        return;
+
+    for (size_t i = 0; i < plan->nr_items; i++) {
+        PCEXE_CLR_VAR(plan->names[i]);
+    }
+
+    free(plan->names);
+    free(plan->orders);
+    free(plan->descs);
+    free(plan->keys);
+    free(plan->aggs);
+    free(plan->cols);
+    free(plan);
+}
+
+struct sql_select *
+sql_select_create(void)
+{
+    struct sql_select *select = calloc(1, sizeof(*select));
+    if (select)
+        select->limit = -1;
+    return select;
+}
+
+void
+sql_select_destroy(struct sql_select *select)
+{
+    if (!select)
+        return;
+
+    plan_destroy(select->plan);
+    sql_select_item_destroy(select->items);
+    sql_expr_destroy(select->from);
+    sql_expr_destroy(select->where);
+    sql_expr_destroy(select->group_by);
+    sql_order_item_destroy(select->order_by);
+    free(select);
+}
+
+struct sql_query *
+sql_query_create(struct sql_select *select,
+        struct sql_query *left, struct sql_query *right)
+{
+    struct sql_query *query = calloc(1, sizeof(*query));
+    if (!query) {
+        sql_select_destroy(select);
+        sql_query_destroy(left);
+        sql_query_destroy(right);
+        return NULL;
+    }
+
+    query->select = select;
+    query->left = left;
+    query->right = right;
+    return query;
+}
+
+void
+sql_query_destroy(struct sql_query *query)
+{
+    if (!query)
+        return;
+
+    sql_select_destroy(query->select);
+    sql_query_destroy(query->left);
+    sql_query_destroy(query->right);
+    free(query);
+}
+
+/* the query planner */
+
+#define PLAN_ERROR(_err_msg, ...) do {                          \
+    if (asprintf(_err_msg, __VA_ARGS__) < 0)                    \
+        *(_err_msg) = NULL;                                     \
+} while (0)
+
+static int
+plan_add_column(struct sql_plan *plan, struct sql_expr *col)
+{
+    for (size_t i = 0; i < plan->nr_cols; i++) {
+        struct sql_column *c = plan->cols + i;
+        if (strcmp(c->name, col->name))
+            continue;
+        if ((c->field == NULL && col->field == NULL) ||
+                (c->field && col->field && strcmp(c->field, col->field) == 0))
+            return (int)i;
+    }
+
+    struct sql_column *cols;
+    cols = realloc(plan->cols, sizeof(*cols) * (plan->nr_cols + 1));
+    if (!cols)
+        return -1;
+
+    plan->cols = cols;
+    cols[plan->nr_cols].name = col->name;
+    cols[plan->nr_cols].field = col->field;
+    return (int)plan->nr_cols++;
+}
+
+static int
+plan_add_aggregate(struct sql_plan *plan, struct sql_expr *call,
+        char **err_msg)
+{
+    static const struct {
+        const char         *name;
+        enum sql_agg_type   type;
+    } funcs[] = {
+        { "count",  SQL_AGG_COUNT },
+        { "sum",    SQL_AGG_SUM },
+        { "avg",    SQL_AGG_AVG },
+        { "min",    SQL_AGG_MIN },
+        { "max",    SQL_AGG_MAX },
+    };
+
+    size_t i;
+    for (i = 0; i < PCA_TABLESIZE(funcs); i++) {
+        if (strcasecmp(call->name, funcs[i].name) == 0)
+            break;
+    }
+
+    if (i == PCA_TABLESIZE(funcs)) {
+        PLAN_ERROR(err_msg, "unknown function: %s", call->name);
+        return -1;
+    }
+
+    struct sql_expr *arg = call->left;
+    if (arg->type == SQL_EXPR_STAR) {
+        if (funcs[i].type != SQL_AGG_COUNT) {
+            PLAN_ERROR(err_msg, "`*' is only allowed for COUNT: %s",
+                    call->name);
+            return -1;
+        }
+        arg = NULL;
+    }
+
+    struct sql_agg *aggs;
+    aggs = realloc(plan->aggs, sizeof(*aggs) * (plan->nr_aggs + 1));
+    if (!aggs)
+        return -1;
+
+    plan->aggs = aggs;
+    aggs[plan->nr_aggs].type = funcs[i].type;
+    aggs[plan->nr_aggs].arg = arg;
+    return (int)plan->nr_aggs++;
+}
+
+static int
+plan_expr(struct sql_plan *plan, struct sql_expr *exp, bool allow_agg,
+        char **err_msg)
+{
+    switch (exp->type) {
+    case SQL_EXPR_NUMBER:
+    case SQL_EXPR_STRING:
+    case SQL_EXPR_SELF:
+        return 0;
+
+    case SQL_EXPR_STAR:
+        PLAN_ERROR(err_msg, "`*' is not allowed in an expression");
+        return -1;
+
+    case SQL_EXPR_META:
+        PLAN_ERROR(err_msg, "`@%s' is not available for records", exp->name);
+        return -1;
+
+    case SQL_EXPR_COLUMN:
+        exp->idx = plan_add_column(plan, exp);
+        return exp->idx < 0 ? -1 : 0;
+
+    case SQL_EXPR_CALL:
+        if (!allow_agg) {
+            PLAN_ERROR(err_msg, "aggregate function not allowed here: %s",
+                    exp->name);
+            return -1;
+        }
+
+        if ((exp->idx = plan_add_aggregate(plan, exp, err_msg)) < 0)
+            return -1;
+        plan->grouped = true;
+
+        if (exp->left->type == SQL_EXPR_STAR)
+            return 0;
+        return plan_expr(plan, exp->left, false, err_msg);
+
+    case SQL_EXPR_LIKE:
+        if (exp->right->type != SQL_EXPR_STRING) {
+            PLAN_ERROR(err_msg, "LIKE expects a string literal");
+            return -1;
+        }
+
+        exp->pattern = calloc(1, sizeof(*exp->pattern));
+        if (!exp->pattern)
+            return -1;
+        exp->pattern->type = STRING_PATTERN_WILDCARD;
+        exp->pattern->wildcard.wildcard = strdup(exp->right->name);
+        if (!exp->pattern->wildcard.wildcard)
+            return -1;
+        return plan_expr(plan, exp->left, allow_agg, err_msg);
+
+    case SQL_EXPR_IN:
+        if (plan_expr(plan, exp->left, allow_agg, err_msg))
+            return -1;
+        for (struct sql_expr *p = exp->right; p; p = p->next) {
+            if (plan_expr(plan, p, allow_agg, err_msg))
+                return -1;
+        }
+        return 0;
+
+    default:
+        if (exp->left && plan_expr(plan, exp->left, allow_agg, err_msg))
+            return -1;
+        if (exp->right && plan_expr(plan, exp->right, allow_agg, err_msg))
+            return -1;
+        return 0;
+    }
+}
+
+static purc_variant_t
+item_name(struct sql_select_item *item, size_t idx)
+{
+    struct sql_expr *exp = item->exp;
+    const char *name = item->alias;
+    char buf[32];
+
+    if (name == NULL) {
+        switch (exp->type) {
+        case SQL_EXPR_COLUMN:
+            name = exp->field ? exp->field : exp->name;
+            break;
+        case SQL_EXPR_CALL:
+            name = exp->name;
+            break;
+        default:
+            snprintf(buf, sizeof(buf), "expr%zu", idx + 1);
+            name = buf;
+            break;
+        }
+    }
+
+    return purc_variant_make_string(name, false);
+}
+
+static int
+plan_select(struct sql_select *select, char **err_msg)
+{
+    if (select->travel != SQL_TRAVEL_NONE) {
+        PLAN_ERROR(err_msg, "TRAVEL IN is not available for records");
+        return -1;
+    }
+
+    struct sql_plan *plan = calloc(1, sizeof(*plan));
+    if (!plan)
+        return -1;
+    select->plan = plan;
+
+    size_t nr = 0;
+    for (struct sql_select_item *p = select->items; p; p = p->next)
+        nr++;
+
+    plan->names = calloc(nr, sizeof(*plan->names));
+    if (!plan->names)
+        return -1;
+    plan->nr_items = nr;
+
+    size_t i = 0;
+    for (struct sql_select_item *p = select->items; p; p = p->next, i++) {
+        if (p->exp->type == SQL_EXPR_STAR && p->alias == NULL)
+            continue;
+
+        if (p->exp->type != SQL_EXPR_STAR &&
+                plan_expr(plan, p->exp, true, err_msg))
+            return -1;
+
+        plan->names[i] = item_name(p, i);
+        if (!plan->names[i])
+            return -1;
+    }
+
+    plan->whole_record = (nr == 1 && select->items->alias == NULL &&
+            (select->items->exp->type == SQL_EXPR_STAR ||
+             select->items->exp->type == SQL_EXPR_SELF));
+
+    if (select->where && plan_expr(plan, select->where, false, err_msg))
+        return -1;
+
+    for (struct sql_expr *p = select->group_by; p; p = p->next)
+        plan->nr_keys++;
+
+    if (plan->nr_keys) {
+        plan->keys = calloc(plan->nr_keys, sizeof(*plan->keys));
+        if (!plan->keys)
+            return -1;
+
+        i = 0;
+        for (struct sql_expr *p = select->group_by; p; p = p->next, i++) {
+            if (plan_expr(plan, p, false, err_msg))
+                return -1;
+            plan->keys[i] = p->idx;
+        }
+        plan->grouped = true;
+    }
+
+    for (struct sql_order_item *p = select->order_by; p; p = p->next)
+        plan->nr_orders++;
+
+    if (plan->nr_orders) {
+        plan->orders = calloc(plan->nr_orders, sizeof(*plan->orders));
+        plan->descs = calloc(plan->nr_orders, sizeof(*plan->descs));
+        if (!plan->orders || !plan->descs)
+            return -1;
+
+        i = 0;
+        for (struct sql_order_item *p = select->order_by; p; p = p->next, i++) {
+            plan->descs[i] = p->desc;
+
+            // a selected column or an alias goes first
+            size_t n = 0;
+            for (struct sql_select_item *s = select->items; s; s = s->next, n++) {
+                if (p->col->field == NULL && plan->names[n] &&
+                        strcmp(purc_variant_get_string_const(plan->names[n]),
+                            p->col->name) == 0) {
+                    plan->orders[i] = s->exp;
+                    break;
+                }
+            }
+
+            if (plan->orders[i] == NULL) {
+                if (plan_expr(plan, p->col, false, err_msg))
+                    return -1;
+                plan->orders[i] = p->col;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int
+sql_query_compile(struct sql_query *query, char **err_msg)
+{
+    if (query->select) {
+        if (query->select->plan)
+            return 0;
+
+        if (plan_select(query->select, err_msg)) {
+            plan_destroy(query->select->plan);
+            query->select->plan = NULL;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (sql_query_compile(query->left, err_msg))
+        return -1;
+    return sql_query_compile(query->right, err_msg);
+}
+
+/* the values */
+
+static void
+value_from_variant(struct sql_value *val, purc_variant_t v)
+{
+    val->v = v;
+    val->s = NULL;
+    val->d = 0;
+
+    switch (v ? purc_variant_get_type(v) : PURC_VARIANT_TYPE_UNDEFINED) {
+    case PURC_VARIANT_TYPE_UNDEFINED:
+    case PURC_VARIANT_TYPE_NULL:
+        val->type = SQL_VALUE_NULL;
+        break;
+
+    case PURC_VARIANT_TYPE_BOOLEAN:
+    case PURC_VARIANT_TYPE_NUMBER:
+    case PURC_VARIANT_TYPE_LONGINT:
+    case PURC_VARIANT_TYPE_ULONGINT:
+    case PURC_VARIANT_TYPE_LONGDOUBLE:
+        val->type = SQL_VALUE_NUMBER;
+        val->d = purc_variant_numberify(v);
+        break;
+
+    case PURC_VARIANT_TYPE_STRING:
+    case PURC_VARIANT_TYPE_ATOMSTRING:
+        val->type = SQL_VALUE_STRING;
+        val->s = purc_variant_get_string_const(v);
+        break;
+
+    default:
+        val->type = SQL_VALUE_OTHER;
+        break;
+    }
+}
+
+static inline void
+value_set_number(struct sql_value *val, double d)
+{
+    val->type = SQL_VALUE_NUMBER;
+    val->d = d;
+    val->s = NULL;
+    val->v = PURC_VARIANT_INVALID;
+}
+
+static inline void
+value_set_null(struct sql_value *val)
+{
+    val->type = SQL_VALUE_NULL;
+    val->v = PURC_VARIANT_INVALID;
+}
+
+static double
+value_to_number(const struct sql_value *val)
+{
+    switch (val->type) {
+    case SQL_VALUE_NUMBER:
+        return val->d;
+    case SQL_VALUE_STRING:
+        return strtod(val->s, NULL);
+    case SQL_VALUE_OTHER:
+        return purc_variant_numberify(val->v);
+    default:
+        return NAN;
+    }
+}
+
+static bool
+string_to_number(const char *s, double *d)
+{
+    char *end;
+    *d = strtod(s, &end);
+    return end != s && *end == '\0';
+}
+
+/*
+ * A total order for sorting and MIN()/MAX(): NULLs go first, then numbers,
+ * strings, and others; the values of different types never compare equal.
+ */
+static int
+value_compare(const struct sql_value *a, const struct sql_value *b)
+{
+    if (a->type != b->type)
+        return (int)a->type - (int)b->type;
+
+    switch (a->type) {
+    case SQL_VALUE_NUMBER:
+        return (a->d > b->d) - (a->d < b->d);
+    case SQL_VALUE_STRING:
+        return strcmp(a->s, b->s);
+    case SQL_VALUE_OTHER:
+        return purc_variant_compare_ex(a->v, b->v, PCVARIANT_COMPARE_OPT_AUTO);
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Compares the operands of a predicate: a number and a numeric string are
+ * compared as numbers. This is not transitive across types, so it must not
+ * be used for sorting.
+ */
+static int
+value_compare_operands(const struct sql_value *a, const struct sql_value *b)
+{
+    double d;
+
+    if (a->type == SQL_VALUE_NUMBER && b->type == SQL_VALUE_STRING &&
+            string_to_number(b->s, &d))
+        return (a->d > d) - (a->d < d);
+    if (a->type == SQL_VALUE_STRING && b->type == SQL_VALUE_NUMBER &&
+            string_to_number(a->s, &d))
+        return (d > b->d) - (d < b->d);
+
+    return value_compare(a, b);
+}
+
+static bool
+value_equal(const struct sql_value *a, const struct sql_value *b)
+{
+    if (a->type != b->type)
+        return false;
+
+    switch (a->type) {
+    case SQL_VALUE_NUMBER:
+        return a->d == b->d || (isnan(a->d) && isnan(b->d));
+    case SQL_VALUE_STRING:
+        return strcmp(a->s, b->s) == 0;
+    case SQL_VALUE_OTHER:
+        return purc_variant_is_equal_to(a->v, b->v);
+    default:
+        return true;
+    }
+}
+
+static unsigned long
+value_hash(const struct sql_value *val)
+{
+    switch (val->type) {
+    case SQL_VALUE_NUMBER: {
+        double d = val->d;
+        uint64_t u;
+
+        if (d == 0)
+            d = 0;      // -0.0 equals to 0.0
+        else if (isnan(d))
+            d = NAN;
+        memcpy(&u, &d, sizeof(u));
+        return (unsigned long)(u ^ (u >> 29));
+    }
+    case SQL_VALUE_STRING:
+        return pchash_perllike_str_hash(val->s);
+    case SQL_VALUE_OTHER:
+        return 0x5bd1e995;
+    default:
+        return 0;
+    }
+}
+
+static purc_variant_t
+value_to_variant(const struct sql_value *val)
+{
+    if (val->v)
+        return purc_variant_ref(val->v);
+
+    switch (val->type) {
+    case SQL_VALUE_NUMBER:
+        return purc_variant_make_number(val->d);
+    case SQL_VALUE_STRING:
+        return purc_variant_make_string(val->s, false);
+    default:
+        return purc_variant_make_null();
+    }
+}
+
+/* the evaluation of the expressions */
+
+static bool
+test_row(const struct sql_expr *exp, const struct sql_row_ctx *ctx);
+
+static void
+eval_row(const struct sql_expr *exp, const struct sql_row_ctx *ctx,
+        struct sql_value *val)
+{
+    struct sql_value l, r;
+
+    switch (exp->type) {
+    case SQL_EXPR_NUMBER:
+        value_set_number(val, exp->d);
+        break;
+
+    case SQL_EXPR_STRING:
+        val->type = SQL_VALUE_STRING;
+        val->s = exp->name;
+        val->v = PURC_VARIANT_INVALID;
+        break;
+
+    case SQL_EXPR_COLUMN:
+        *val = ctx->cols[exp->idx * ctx->stride];
+        break;
+
+    case SQL_EXPR_SELF:
+    case SQL_EXPR_STAR:
+        value_from_variant(val, ctx->record);
+        break;
+
+    case SQL_EXPR_CALL: {
+        if (ctx->aggs == NULL) {
+            value_set_null(val);
+            break;
+        }
+
+        const struct sql_agg_state *st = ctx->aggs + exp->idx;
+        switch (st->type) {
+        case SQL_AGG_COUNT:
+            value_set_number(val, st->count);
+            break;
+        case SQL_AGG_SUM:
+            if (st->count)
+                value_set_number(val, st->sum);
+            else
+                value_set_null(val);
+            break;
+        case SQL_AGG_AVG:
+            if (st->count)
+                value_set_number(val, st->sum / st->count);
+            else
+                value_set_null(val);
+            break;
+        case SQL_AGG_MIN:
+            *val = st->min;
+            break;
+        case SQL_AGG_MAX:
+            *val = st->max;
+            break;
+        }
+        break;
+    }
+
+    case SQL_EXPR_ADD:
+    case SQL_EXPR_SUB:
+    case SQL_EXPR_MUL:
+    case SQL_EXPR_DIV: {
+        eval_row(exp->left, ctx, &l);
+        eval_row(exp->right, ctx, &r);
+        if (l.type == SQL_VALUE_NULL || r.type == SQL_VALUE_NULL) {
+            value_set_null(val);
+            break;
+        }
+
+        double a = value_to_number(&l);
+        double b = value_to_number(&r);
+        if (exp->type == SQL_EXPR_ADD)
+            value_set_number(val, a + b);
+        else if (exp->type == SQL_EXPR_SUB)
+            value_set_number(val, a - b);
+        else if (exp->type == SQL_EXPR_MUL)
+            value_set_number(val, a * b);
+        else
+            value_set_number(val, a / b);
+        break;
+    }
+
+    case SQL_EXPR_NEG:
+        eval_row(exp->left, ctx, &l);
+        if (l.type == SQL_VALUE_NULL)
+            value_set_null(val);
+        else
+            value_set_number(val, -value_to_number(&l));
+        break;
+
+    default:
+        value_set_number(val, test_row(exp, ctx) ? 1 : 0);
+        break;
+    }
+}
+
+static bool
+value_is_true(const struct sql_value *val)
+{
+    switch (val->type) {
+    case SQL_VALUE_NUMBER:
+        return val->d != 0 && !isnan(val->d);
+    case SQL_VALUE_STRING:
+        return val->s[0] != '\0';
+    case SQL_VALUE_OTHER:
+        return purc_variant_booleanize(val->v);
+    default:
+        return false;
+    }
+}
+
+static inline bool
+compare_matches(enum sql_expr_type op, int c)
+{
+    switch (op) {
+    case SQL_EXPR_EQ:
+        return c == 0;
+    case SQL_EXPR_NE:
+        return c != 0;
+    case SQL_EXPR_LT:
+        return c < 0;
+    case SQL_EXPR_LE:
+        return c <= 0;
+    case SQL_EXPR_GT:
+        return c > 0;
+    default:
+        return c >= 0;
+    }
+}
+
+static bool
+like_row(const struct sql_expr *exp, const struct sql_row_ctx *ctx)
+{
+    struct sql_value l;
+    purc_variant_t v;
+    bool matched = false;
+
+    eval_row(exp->left, ctx, &l);
+    if (l.type == SQL_VALUE_NULL)
+        return false;
+
+    v = value_to_variant(&l);
+    if (v == PURC_VARIANT_INVALID)
+        return false;
+
+    if (string_pattern_expression_eval(exp->pattern, v, &matched))
+        matched = false;
+    purc_variant_unref(v);
+    return matched;
+}
+
+static bool
+test_row(const struct sql_expr *exp, const struct sql_row_ctx *ctx)
+{
+    struct sql_value l, r;
+
+    switch (exp->type) {
+    case SQL_EXPR_AND:
+        return test_row(exp->left, ctx) && test_row(exp->right, ctx);
+
+    case SQL_EXPR_OR:
+        return test_row(exp->left, ctx) || test_row(exp->right, ctx);
+
+    case SQL_EXPR_NOT:
+        return !test_row(exp->left, ctx);
+
+    case SQL_EXPR_EQ:
+    case SQL_EXPR_NE:
+    case SQL_EXPR_LT:
+    case SQL_EXPR_LE:
+    case SQL_EXPR_GT:
+    case SQL_EXPR_GE:
+        eval_row(exp->left, ctx, &l);
+        eval_row(exp->right, ctx, &r);
+        if (l.type == SQL_VALUE_NULL || r.type == SQL_VALUE_NULL)
+            return false;
+        return compare_matches(exp->type, value_compare_operands(&l, &r));
+
+    case SQL_EXPR_IN:
+        eval_row(exp->left, ctx, &l);
+        if (l.type == SQL_VALUE_NULL)
+            return false;
+        for (const struct sql_expr *p = exp->right; p; p = p->next) {
+            eval_row(p, ctx, &r);
+            if (r.type != SQL_VALUE_NULL &&
+                    value_compare_operands(&l, &r) == 0)
+                return true;
+        }
+        return false;
+
+    case SQL_EXPR_LIKE:
+        return like_row(exp, ctx);
+
+    default:
+        eval_row(exp, ctx, &l);
+        return value_is_true(&l);
+    }
+}
+
+/* the predicate evaluation over a batch */
+
+static inline void
+batch_row_ctx(const struct sql_batch *batch, size_t r,
+        struct sql_row_ctx *ctx)
+{
+    ctx->cols = batch->cols + r;
+    ctx->stride = SQL_BATCH_SIZE;
+    ctx->record = batch->records[r];
+    ctx->aggs = NULL;
+}
+
+/* keep the ones in @sel but not in the sorted subset @sub */
+static size_t
+sel_subtract(uint16_t *sel, size_t n, const uint16_t *sub, size_t nr_sub,
+        uint16_t *out)
+{
+    size_t i, j = 0, k = 0;
+
+    for (i = 0; i < n; i++) {
+        if (j < nr_sub && sub[j] == sel[i]) {
+            j++;
+            continue;
+        }
+        out[k++] = sel[i];
+    }
+    return k;
+}
+
+static size_t
+filter_batch(const struct sql_expr *exp, const struct sql_batch *batch,
+        uint16_t *sel, size_t n)
+{
+    struct sql_row_ctx ctx;
+    size_t i, k = 0;
+
+    switch (exp->type) {
+    case SQL_EXPR_AND:
+        n = filter_batch(exp->left, batch, sel, n);
+        return filter_batch(exp->right, batch, sel, n);
+
+    case SQL_EXPR_OR: {
+        uint16_t left[SQL_BATCH_SIZE], rest[SQL_BATCH_SIZE];
+        size_t nr_left, nr_rest;
+
+        memcpy(left, sel, sizeof(*sel) * n);
+        nr_left = filter_batch(exp->left, batch, left, n);
+        nr_rest = sel_subtract(sel, n, left, nr_left, rest);
+        nr_rest = filter_batch(exp->right, batch, rest, nr_rest);
+
+        // merge both in the order of the records
+        size_t a = 0, b = 0;
+        while (a < nr_left || b < nr_rest) {
+            if (b == nr_rest || (a < nr_left && left[a] < rest[b]))
+                sel[k++] = left[a++];
+            else
+                sel[k++] = rest[b++];
+        }
+        return k;
+    }
+
+    case SQL_EXPR_NOT: {
+        uint16_t matched[SQL_BATCH_SIZE];
+        size_t nr_matched;
+
+        memcpy(matched, sel, sizeof(*sel) * n);
+        nr_matched = filter_batch(exp->left, batch, matched, n);
+        return sel_subtract(sel, n, matched, nr_matched, sel);
+    }
+
+    case SQL_EXPR_EQ:
+    case SQL_EXPR_NE:
+    case SQL_EXPR_LT:
+    case SQL_EXPR_LE:
+    case SQL_EXPR_GT:
+    case SQL_EXPR_GE:
+        // the common case: compare a column with a number
+        if (exp->left->type == SQL_EXPR_COLUMN &&
+                exp->right->type == SQL_EXPR_NUMBER) {
+            const struct sql_value *col;
+            col = batch->cols + exp->left->idx * SQL_BATCH_SIZE;
+            struct sql_value num;
+            value_set_number(&num, exp->right->d);
+
+            for (i = 0; i < n; i++) {
+                const struct sql_value *v = col + sel[i];
+                int c;
+                if (v->type == SQL_VALUE_NUMBER)
+                    c = (v->d > num.d) - (v->d < num.d);
+                else if (v->type == SQL_VALUE_NULL)
+                    continue;
+                else
+                    c = value_compare_operands(v, &num);
+                if (compare_matches(exp->type, c))
+                    sel[k++] = sel[i];
+            }
+            return k;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    for (i = 0; i < n; i++) {
+        batch_row_ctx(batch, sel[i], &ctx);
+        if (test_row(exp, &ctx))
+            sel[k++] = sel[i];
+    }
+    return k;
+}
+
+/* the extraction of the columns */
+
+static purc_variant_t
+get_member(purc_variant_t v, const char *name, bool *missing)
+{
+    if (v == PURC_VARIANT_INVALID || !purc_variant_is_object(v))
+        return PURC_VARIANT_INVALID;
+
+    v = purc_variant_object_get_by_ckey(v, name);
+    if (v == PURC_VARIANT_INVALID)
+        *missing = true;
+    return v;
+}
+
+static void
+extract_columns(const struct sql_plan *plan, struct sql_batch *batch)
+{
+    bool missing = false;
+
+    for (size_t c = 0; c < plan->nr_cols; c++) {
+        const struct sql_column *col = plan->cols + c;
+        struct sql_value *vals = batch->cols + c * SQL_BATCH_SIZE;
+
+        for (size_t r = 0; r < batch->nr; r++) {
+            purc_variant_t v;
+            v = get_member(batch->records[r], col->name, &missing);
+            if (col->field)
+                v = get_member(v, col->field, &missing);
+            value_from_variant(vals + r, v);
+        }
+    }
+
+    // a missing member is a NULL
+    if (missing)
+        purc_clr_error();
+}
+
+/* the hash aggregation */
+
+static unsigned long
+group_hash(const void *k)
+{
+    return ((const struct sql_group *)k)->hash;
+}
+
+static int
+group_equal(const void *k1, const void *k2)
+{
+    const struct sql_group *g1 = k1;
+    const struct sql_group *g2 = k2;
+    const struct sql_plan *plan = g1->plan;
+
+    for (size_t i = 0; i < plan->nr_keys; i++) {
+        int c = plan->keys[i];
+        if (!value_equal(g1->cols + c * g1->stride, g2->cols + c * g2->stride))
+            return 0;
+    }
+    return 1;
+}
+
+static struct sql_group *
+group_new(const struct sql_plan *plan, const struct sql_batch *batch,
+        size_t r, unsigned long hash)
+{
+    struct sql_group *group;
+    group = calloc(1, sizeof(*group) +
+            sizeof(struct sql_value) * plan->nr_cols +
+            sizeof(struct sql_agg_state) * plan->nr_aggs);
+    if (!group)
+        return NULL;
+
+    struct sql_value *cols = (struct sql_value *)(group + 1);
+    group->plan = plan;
+    group->hash = hash;
+    group->stride = 1;
+    group->cols = cols;
+    group->aggs = (struct sql_agg_state *)(cols + plan->nr_cols);
+
+    if (batch) {
+        group->record = batch->records[r];
+        for (size_t c = 0; c < plan->nr_cols; c++)
+            cols[c] = batch->cols[c * SQL_BATCH_SIZE + r];
+    }
+    else {
+        for (size_t c = 0; c < plan->nr_cols; c++)
+            value_set_null(cols + c);
+    }
+
+    for (size_t i = 0; i < plan->nr_aggs; i++) {
+        group->aggs[i].type = plan->aggs[i].type;
+        value_set_null(&group->aggs[i].min);
+        value_set_null(&group->aggs[i].max);
+    }
+
+    return group;
+}
+
+struct sql_groups {
+    struct pchash_table        *index;
+    struct sql_group          **groups;
+    size_t                      nr;
+    size_t                      sz;
+};
+
+static int
+groups_append(struct sql_groups *groups, struct sql_group *group)
+{
+    if (groups->nr == groups->sz) {
+        size_t sz = groups->sz ? groups->sz * 2 : 16;
+        struct sql_group **p = realloc(groups->groups, sizeof(*p) * sz);
+        if (!p)
+            return -1;
+        groups->groups = p;
+        groups->sz = sz;
+    }
+
+    groups->groups[groups->nr++] = group;
+    return 0;
+}
+
+static void
+groups_release(struct sql_groups *groups)
+{
+    if (groups->index)
+        pchash_table_free(groups->index);
+    for (size_t i = 0; i < groups->nr; i++)
+        free(groups->groups[i]);
+    free(groups->groups);
+}
+
+static void
+aggregate(const struct sql_agg *agg, struct sql_agg_state *st,
+        const struct sql_row_ctx *ctx)
+{
+    struct sql_value val;
+
+    if (agg->arg == NULL) {
+        st->count++;
+        return;
+    }
+
+    eval_row(agg->arg, ctx, &val);
+    if (val.type == SQL_VALUE_NULL)
+        return;
+
+    switch (agg->type) {
+    case SQL_AGG_COUNT:
+        st->count++;
+        break;
+
+    case SQL_AGG_SUM:
+    case SQL_AGG_AVG: {
+        double d = value_to_number(&val);
+        if (!isnan(d)) {
+            st->sum += d;
+            st->count++;
+        }
+        break;
+    }
+
+    case SQL_AGG_MIN:
+        if (st->min.type == SQL_VALUE_NULL || value_compare(&val, &st->min) < 0)
+            st->min = val;
+        st->count++;
+        break;
+
+    case SQL_AGG_MAX:
+        if (st->max.type == SQL_VALUE_NULL || value_compare(&val, &st->max) > 0)
+            st->max = val;
+        st->count++;
+        break;
+    }
+}
+
+static int
+aggregate_batch(const struct sql_plan *plan, struct sql_groups *groups,
+        const struct sql_batch *batch, const uint16_t *sel, size_t n)
+{
+    struct sql_group *owners[SQL_BATCH_SIZE];
+    struct sql_row_ctx ctx;
+    size_t i;
+
+    if (plan->nr_keys == 0) {
+        for (i = 0; i < n; i++)
+            owners[i] = groups->groups[0];
+    }
+    else for (i = 0; i < n; i++) {
+        struct sql_group probe = {
+            .plan = plan,
+            .cols = batch->cols + sel[i],
+            .stride = SQL_BATCH_SIZE,
+        };
+
+        unsigned long hash = 0;
+        for (size_t k = 0; k < plan->nr_keys; k++) {
+            hash = hash * 31 +
+                value_hash(probe.cols + plan->keys[k] * SQL_BATCH_SIZE);
+        }
+        probe.hash = hash;
+
+        struct pchash_entry *e;
+        e = pchash_table_lookup_entry_w_hash(groups->index, &probe, hash);
+        if (e) {
+            owners[i] = pchash_entry_v(e);
+            continue;
+        }
+
+        struct sql_group *group = group_new(plan, batch, sel[i], hash);
+        if (!group)
+            return -1;
+        if (groups_append(groups, group)) {
+            free(group);
+            return -1;
+        }
+        if (pchash_table_insert_w_hash(groups->index, group, group, hash, 0))
+            return -1;
+        owners[i] = group;
+    }
+
+    // one aggregate after another over the batch
+    for (size_t a = 0; a < plan->nr_aggs; a++) {
+        for (i = 0; i < n; i++) {
+            batch_row_ctx(batch, sel[i], &ctx);
+            aggregate(plan->aggs + a, owners[i]->aggs + a, &ctx);
+        }
+    }
+
+    return 0;
+}
+
+/* the projection, ORDER BY and LIMIT */
+
+static purc_variant_t
+project(const struct sql_select *select, const struct sql_row_ctx *ctx)
+{
+    const struct sql_plan *plan = select->plan;
+
+    if (plan->whole_record)
+        return purc_variant_ref(ctx->record);
+
+    purc_variant_t row = purc_variant_make_object_0();
+    if (row == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    size_t i = 0;
+    for (struct sql_select_item *p = select->items; p; p = p->next, i++) {
+        if (plan->names[i] == PURC_VARIANT_INVALID) {
+            // `*` without alias: all the members of the record
+            if (!ctx->record || !purc_variant_is_object(ctx->record))
+                continue;
+
+            purc_variant_t k, v;
+            bool ok = true;
+            foreach_key_value_in_variant_object(ctx->record, k, v)
+                if (!purc_variant_object_set(row, k, v)) {
+                    ok = false;
+                    break;
+                }
+            end_foreach;
+            if (!ok)
+                goto failed;
+            continue;
+        }
+
+        struct sql_value val;
+        eval_row(p->exp, ctx, &val);
+
+        purc_variant_t v = value_to_variant(&val);
+        if (v == PURC_VARIANT_INVALID)
+            goto failed;
+
+        bool ok = purc_variant_object_set(row, plan->names[i], v);
+        purc_variant_unref(v);
+        if (!ok)
+            goto failed;
+    }
+
+    return row;
+
+failed:
+    purc_variant_unref(row);
+    return PURC_VARIANT_INVALID;
+}
+
+static int
+out_compare(const struct sql_plan *plan,
+        const struct sql_out *a, const struct sql_out *b)
+{
+    for (size_t i = 0; i < plan->nr_orders; i++) {
+        int c = value_compare(a->keys + i, b->keys + i);
+        if (c)
+            return plan->descs[i] ? -c : c;
+    }
+
+    return (a->seq > b->seq) - (a->seq < b->seq);
+}
+
+/* the heap keeps the last row in the order on the top */
+static void
+heap_sift_down(const struct sql_plan *plan, struct sql_out **heap,
+        size_t nr, size_t i)
+{
+    for (;;) {
+        size_t largest = i;
+        size_t l = i * 2 + 1, r = l + 1;
+
+        if (l < nr && out_compare(plan, heap[l], heap[largest]) > 0)
+            largest = l;
+        if (r < nr && out_compare(plan, heap[r], heap[largest]) > 0)
+            largest = r;
+        if (largest == i)
+            break;
+
+        struct sql_out *tmp = heap[i];
+        heap[i] = heap[largest];
+        heap[largest] = tmp;
+        i = largest;
+    }
+}
+
+static void
+heap_sift_up(const struct sql_plan *plan, struct sql_out **heap, size_t i)
+{
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (out_compare(plan, heap[i], heap[parent]) <= 0)
+            break;
+
+        struct sql_out *tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+static void
+heap_sort(const struct sql_plan *plan, struct sql_out **heap, size_t nr)
+{
+    for (size_t i = nr / 2; i > 0; i--)
+        heap_sift_down(plan, heap, nr, i - 1);
+
+    while (nr > 1) {
+        struct sql_out *tmp = heap[0];
+        heap[0] = heap[nr - 1];
+        heap[nr - 1] = tmp;
+        heap_sift_down(plan, heap, --nr, 0);
+    }
+}
+
+static inline bool
+exec_done(const struct sql_exec *exec)
+{
+    // without ORDER BY, the first `limit` rows are the result
+    return exec->plan->nr_orders == 0 && exec->select->limit >= 0 &&
+        exec->nr_rows >= (size_t)exec->select->limit;
+}
+
+static int
+emit(struct sql_exec *exec, const struct sql_row_ctx *ctx)
+{
+    const struct sql_plan *plan = exec->plan;
+    long limit = exec->select->limit;
+
+    if (plan->nr_orders == 0) {
+        if (exec_done(exec))
+            return 0;
+
+        purc_variant_t row = project(exec->select, ctx);
+        if (row == PURC_VARIANT_INVALID)
+            return -1;
+
+        bool ok = purc_variant_array_append(exec->result, row);
+        purc_variant_unref(row);
+        exec->nr_rows++;
+        return ok ? 0 : -1;
+    }
+
+    if (limit == 0)
+        return 0;
+
+    struct sql_out *out;
+    out = malloc(sizeof(*out) + sizeof(struct sql_value) * plan->nr_orders);
+    if (!out)
+        return -1;
+
+    // evaluate the sort keys before the projection to drop rows early
+    out->seq = exec->seq++;
+    for (size_t i = 0; i < plan->nr_orders; i++)
+        eval_row(plan->orders[i], ctx, out->keys + i);
+
+    bool full = limit > 0 && exec->nr_outs == (size_t)limit;
+    if (full && out_compare(plan, out, exec->outs[0]) >= 0) {
+        free(out);
+        return 0;
+    }
+
+    out->row = project(exec->select, ctx);
+    if (out->row == PURC_VARIANT_INVALID) {
+        free(out);
+        return -1;
+    }
+
+    if (full) {
+        purc_variant_unref(exec->outs[0]->row);
+        free(exec->outs[0]);
+        exec->outs[0] = out;
+        heap_sift_down(plan, exec->outs, exec->nr_outs, 0);
+        return 0;
+    }
+
+    if (exec->nr_outs == exec->sz_outs) {
+        size_t sz = exec->sz_outs ? exec->sz_outs * 2 : 64;
+        struct sql_out **p = realloc(exec->outs, sizeof(*p) * sz);
+        if (!p) {
+            purc_variant_unref(out->row);
+            free(out);
+            return -1;
+        }
+        exec->outs = p;
+        exec->sz_outs = sz;
+    }
+
+    exec->outs[exec->nr_outs++] = out;
+    if (limit > 0)
+        heap_sift_up(plan, exec->outs, exec->nr_outs - 1);
+    return 0;
+}
+
+static int
+flush_outs(struct sql_exec *exec)
+{
+    heap_sort(exec->plan, exec->outs, exec->nr_outs);
+
+    for (size_t i = 0; i < exec->nr_outs; i++) {
+        if (!purc_variant_array_append(exec->result, exec->outs[i]->row))
+            return -1;
+    }
+    return 0;
+}
+
+/* the execution of a SELECT */
+
+static purc_variant_t
+resolve_source(const struct sql_select *select, purc_variant_t input)
+{
+    struct sql_expr *from = select->from;
+    bool missing = false;
+
+    if (from == NULL)
+        return input;
+
+    purc_variant_t v = get_member(input, from->name, &missing);
+    if (from->field)
+        v = get_member(v, from->field, &missing);
+    if (missing)
+        purc_clr_error();
+    return v;
+}
+
+static int
+scan(struct sql_exec *exec, purc_variant_t source, struct sql_groups *groups)
+{
+    const struct sql_plan *plan = exec->plan;
+    const struct sql_select *select = exec->select;
+    struct sql_batch batch;
+    uint16_t sel[SQL_BATCH_SIZE];
+    size_t nr_records;
+    int ret = 0;
+
+    switch (source ? purc_variant_get_type(source) : PURC_VARIANT_TYPE_NULL) {
+    case PURC_VARIANT_TYPE_ARRAY:
+        nr_records = purc_variant_array_get_size(source);
+        break;
+    case PURC_VARIANT_TYPE_SET:
+        nr_records = purc_variant_set_get_size(source);
+        break;
+    case PURC_VARIANT_TYPE_OBJECT:
+        nr_records = 1;
+        break;
+    default:
+        nr_records = 0;
+        break;
+    }
+
+    batch.cols = NULL;
+    if (plan->nr_cols) {
+        batch.cols = malloc(sizeof(*batch.cols) *
+                plan->nr_cols * SQL_BATCH_SIZE);
+        if (!batch.cols)
+            return -1;
+    }
+
+    for (size_t base = 0; base < nr_records && !exec_done(exec);
+            base += SQL_BATCH_SIZE) {
+        batch.nr = nr_records - base;
+        if (batch.nr > SQL_BATCH_SIZE)
+            batch.nr = SQL_BATCH_SIZE;
+
+        for (size_t r = 0; r < batch.nr; r++) {
+            if (purc_variant_is_array(source))
+                batch.records[r] = purc_variant_array_get(source, base + r);
+            else if (purc_variant_is_set(source))
+                batch.records[r] = purc_variant_set_get_by_index(source,
+                        base + r);
+            else
+                batch.records[r] = source;
+        }
+
+        extract_columns(plan, &batch);
+
+        size_t n = batch.nr;
+        for (size_t r = 0; r < n; r++)
+            sel[r] = (uint16_t)r;
+        if (select->where)
+            n = filter_batch(select->where, &batch, sel, n);
+
+        if (plan->grouped) {
+            if ((ret = aggregate_batch(plan, groups, &batch, sel, n)))
+                break;
+            continue;
+        }
+
+        struct sql_row_ctx ctx;
+        for (size_t i = 0; i < n && ret == 0; i++) {
+            batch_row_ctx(&batch, sel[i], &ctx);
+            ret = emit(exec, &ctx);
+        }
+        if (ret)
+            break;
+    }
+
+    free(batch.cols);
+    return ret;
+}
+
+static purc_variant_t
+select_execute(const struct sql_select *select, purc_variant_t input)
+{
+    const struct sql_plan *plan = select->plan;
+    struct sql_groups groups = { 0 };
+    struct sql_exec exec = { 0 };
+    int ret = -1;
+
+    PC_ASSERT(plan);
+
+    exec.select = select;
+    exec.plan = plan;
+    exec.result = purc_variant_make_array_0();
+    if (exec.result == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    if (plan->grouped) {
+        groups.index = pchash_table_new(64, NULL, group_hash, group_equal);
+        if (!groups.index)
+            goto done;
+
+        // aggregates without GROUP BY always yield one row
+        if (plan->nr_keys == 0) {
+            struct sql_group *group = group_new(plan, NULL, 0, 0);
+            if (!group)
+                goto done;
+            if (groups_append(&groups, group)) {
+                free(group);
+                goto done;
+            }
+        }
+    }
+
+    if (scan(&exec, resolve_source(select, input), &groups))
+        goto done;
+
+    for (size_t i = 0; i < groups.nr; i++) {
+        struct sql_group *group = groups.groups[i];
+        struct sql_row_ctx ctx = {
+            .cols = group->cols,
+            .stride = 1,
+            .record = group->record,
+            .aggs = group->aggs,
+        };
+
+        if (emit(&exec, &ctx))
+            goto done;
+    }
+
+    ret = flush_outs(&exec);
+
+done:
+    for (size_t i = 0; i < exec.nr_outs; i++) {
+        purc_variant_unref(exec.outs[i]->row);
+        free(exec.outs[i]);
+    }
+    free(exec.outs);
+    groups_release(&groups);
+
+    if (ret) {
+        purc_variant_unref(exec.result);
+        pcinst_set_error(PCEXECUTOR_ERROR_OOM);
+        return PURC_VARIANT_INVALID;
+    }
+
+    return exec.result;
+}
+
+/* the rows are told apart by their stringified texts for UNION */
+static void
+free_row_text(struct pchash_entry *e)
+{
+    free(pchash_entry_k(e));
+}
+
+static bool
+union_append(purc_variant_t result, struct pchash_table *seen,
+        purc_variant_t rows)
+{
+    size_t nr = purc_variant_array_get_size(rows);
+
+    for (size_t i = 0; i < nr; i++) {
+        purc_variant_t row = purc_variant_array_get(rows, i);
+        char *text = NULL;
+
+        if (purc_variant_stringify_alloc(&text, row) < 0 || text == NULL)
+            return false;
+
+        if (pchash_table_lookup_entry(seen, text)) {
+            free(text);
+            continue;
+        }
+
+        if (pchash_table_insert(seen, text, NULL)) {
+            free(text);
+            return false;
+        }
+
+        if (!purc_variant_array_append(result, row))
+            return false;
+    }
+
+    return true;
+}
+
+purc_variant_t
+sql_query_execute(struct sql_query *query, purc_variant_t input)
+{
+    if (query->select)
+        return select_execute(query->select, input);
+
+    purc_variant_t left = PURC_VARIANT_INVALID;
+    purc_variant_t right = PURC_VARIANT_INVALID;
+    purc_variant_t result = PURC_VARIANT_INVALID;
+    struct pchash_table *seen = NULL;
+
+    left = sql_query_execute(query->left, input);
+    if (left == PURC_VARIANT_INVALID)
+        goto done;
+    right = sql_query_execute(query->right, input);
+    if (right == PURC_VARIANT_INVALID)
+        goto done;
+
+    seen = pchash_kstr_table_new(64, free_row_text);
+    result = purc_variant_make_array_0();
+    if (!seen || result == PURC_VARIANT_INVALID ||
+            !union_append(result, seen, left) ||
+            !union_append(result, seen, right)) {
+        PCEXE_CLR_VAR(result);
+        pcinst_set_error(PCEXECUTOR_ERROR_OOM);
+    }
+
+done:
+    if (seen)
+        pchash_table_free(seen);
+    PCEXE_CLR_VAR(left);
+    PCEXE_CLR_VAR(right);
+    return result;
+}
+
@@ -34,7 +34,7 @@
 struct pcexec_exe_sub_inst {
     struct purc_exec_inst       super;
 
-    struct exe_sub_param        param;
+    struct exe_sub_param       *param;
 
     double                      curr;
 };
@@ -43,31 +43,37 @@ struct pcexec_exe_sub_inst {
 static inline void
 reset(struct pcexec_exe_sub_inst *exe_sub_inst)
 {
-    struct exe_sub_param *param = &exe_sub_inst->param;
-    exe_sub_param_reset(param);
+    if (exe_sub_inst->param) {
+        pcexecutor_release_rule(exe_sub_inst->param);
+        exe_sub_inst->param = NULL;
+    }
     pcexecutor_inst_reset(&exe_sub_inst->super);
 }
 
+static const struct pcexec_rule_parser rule_parser = {
+    sizeof(struct exe_sub_param),
+    (pcexec_parse_rule_f)exe_sub_parse,
+    (pcexec_reset_param_f)exe_sub_param_reset,
+};
+
 static inline bool
 parse_rule(struct pcexec_exe_sub_inst *exe_sub_inst,
         const char* rule)
 {
     purc_exec_inst_t inst = &exe_sub_inst->super;
 
-    struct exe_sub_param param = {0};
-    int r = exe_sub_parse(rule, strlen(rule), &param);
     if (inst->err_msg) {
         free(inst->err_msg);
         inst->err_msg = NULL;
     }
 
-    if (r) {
-        inst->err_msg = param.err_msg;
-        param.err_msg = NULL;
+    struct exe_sub_param *param;
+    param = pcexecutor_get_rule(&rule_parser, rule, &inst->err_msg);
+    if (!param)
         return false;
-    }
 
-    exe_sub_param_reset(&exe_sub_inst->param);
+    if (exe_sub_inst->param)
+        pcexecutor_release_rule(exe_sub_inst->param);
     exe_sub_inst->param = param;
 
     return true;
@@ -77,7 +83,7 @@ static inline bool
 check_curr(struct pcexec_exe_sub_inst *exe_sub_inst, const double curr)
 {
     purc_exec_inst_t inst = &exe_sub_inst->super;
-    struct exe_sub_param *param = &exe_sub_inst->param;
+    struct exe_sub_param *param = exe_sub_inst->param;
     struct sub_rule *rule = &param->rule;
     struct number_comparing_logical_expression *ncle = rule->ncle;
 
@@ -128,7 +134,7 @@ fetch_next(struct pcexec_exe_sub_inst *exe_sub_inst)
 {
     purc_exec_inst_t inst = &exe_sub_inst->super;
     purc_exec_iter_t it = &inst->it;
-    struct exe_sub_param *param = &exe_sub_inst->param;
+    struct exe_sub_param *param = exe_sub_inst->param;
     struct sub_rule *rule = &param->rule;
     double curr = exe_sub_inst->curr;
     if (!isnan(rule->nexp)) {
@@ -26,6 +26,7 @@
 #include "private/debug.h"
 #include "private/errors.h"
 #include "private/instance.h"
+#include "private/hashtable.h"
 #include "keywords.h"
 
 #include "purc-utils.h"
@@ -147,6 +148,146 @@ static void _init_registers_once(void)
     _do_registers();
 }
 
+struct cached_rule {
+    /* in the LRU list of the instance */
+    struct list_head                    ln;
+
+    const struct pcexec_rule_parser    *parser;
+    char                               *rule;
+    int                                 refc;
+    /* removed from the cache but still in use */
+    bool                                orphan;
+
+    /* the parameter follows, aligned for any type of its members */
+    union {
+        void       *p;
+        double      d;
+        int64_t     i;
+    } param[];
+};
+
+#define CACHED_RULE_OF(param)   \
+    ((struct cached_rule *)((char *)(param) - offsetof(struct cached_rule, param)))
+
+static unsigned long rule_hash(const void *k)
+{
+    const struct cached_rule *cr = k;
+    unsigned long h = pchash_perllike_str_hash(cr->rule);
+
+    return h ^ ((uintptr_t)cr->parser >> 4);
+}
+
+static int rule_equal(const void *k1, const void *k2)
+{
+    const struct cached_rule *cr1 = k1;
+    const struct cached_rule *cr2 = k2;
+
+    return cr1->parser == cr2->parser && strcmp(cr1->rule, cr2->rule) == 0;
+}
+
+static void free_cached_rule(struct cached_rule *cr)
+{
+    cr->parser->reset(cr->param);
+    free(cr->rule);
+    free(cr);
+}
+
+/* remove a rule from the cache; free it if it is not in use */
+static void
+uncache_rule(struct pcexecutor_heap *heap, struct cached_rule *cr)
+{
+    struct pchash_entry *e = pchash_table_lookup_entry(heap->rule_index, cr);
+    if (e)
+        pchash_table_delete_entry(heap->rule_index, e);
+    list_del(&cr->ln);
+    heap->nr_rules--;
+
+    if (cr->refc == 0)
+        free_cached_rule(cr);
+    else
+        cr->orphan = true;
+}
+
+/* evict the least recently used rules which are not in use */
+static void evict_rules(struct pcexecutor_heap *heap)
+{
+    struct cached_rule *cr, *tmp;
+
+    list_for_each_entry_reverse_safe(cr, tmp, &heap->rules, ln) {
+        if (heap->nr_rules <= PCEXEC_MAX_CACHED_RULES)
+            break;
+        if (cr->refc == 0)
+            uncache_rule(heap, cr);
+    }
+}
+
+void *
+pcexecutor_get_rule(const struct pcexec_rule_parser *parser,
+        const char *rule, char **err_msg)
+{
+    struct pcexecutor_heap *heap = pcinst_current()->executor_heap;
+    struct cached_rule *cr;
+
+    if (err_msg)
+        *err_msg = NULL;
+
+    if (heap) {
+        struct cached_rule probe = { .parser = parser, .rule = (char *)rule };
+        struct pchash_entry *e;
+        e = pchash_table_lookup_entry(heap->rule_index, &probe);
+        if (e) {
+            cr = pchash_entry_v(e);
+            list_move(&cr->ln, &heap->rules);
+            cr->refc++;
+            heap->nr_rule_hits++;
+            return cr->param;
+        }
+
+        heap->nr_rule_misses++;
+    }
+
+    cr = calloc(1, sizeof(*cr) + parser->sz_param);
+    if (cr == NULL || (cr->rule = strdup(rule)) == NULL) {
+        free(cr);
+        pcinst_set_error(PCEXECUTOR_ERROR_OOM);
+        return NULL;
+    }
+
+    cr->parser = parser;
+    if (parser->parse(rule, strlen(rule), cr->param)) {
+        /* the parameter starts with the error message */
+        char **msg = (char **)cr->param;
+        if (err_msg) {
+            *err_msg = *msg;
+            *msg = NULL;
+        }
+        free_cached_rule(cr);
+        return NULL;
+    }
+
+    cr->refc = 1;
+    if (heap == NULL || pchash_table_insert(heap->rule_index, cr, cr)) {
+        /* not cached; freed once released */
+        cr->orphan = true;
+        return cr->param;
+    }
+
+    list_add(&cr->ln, &heap->rules);
+    heap->nr_rules++;
+    evict_rules(heap);
+    return cr->param;
+}
+
+void
+pcexecutor_release_rule(void *param)
+{
+    struct cached_rule *cr = CACHED_RULE_OF(param);
+
+    PC_ASSERT(cr->refc > 0);
+    if (--cr->refc == 0 && cr->orphan)
+        free_cached_rule(cr);
+}
+
 static int _init_instance(struct pcinst *inst,
         const purc_instance_extra_info* extra_info)
 {
@@ -180,15 +321,32 @@ static int _init_instance(struct pcinst *inst,
     inst->executor_heap->debug_flex = 0;
     inst->executor_heap->debug_bison = 0;
 
+    list_head_init(&inst->executor_heap->rules);
+    inst->executor_heap->rule_index = pchash_table_new(
+            PCEXEC_MAX_CACHED_RULES, NULL, rule_hash, rule_equal);
+    if (!inst->executor_heap->rule_index) {
+        free(inst->executor_heap);
+        inst->executor_heap = NULL;
+        pcinst_set_error(PCEXECUTOR_ERROR_OOM);
+        return -1;
+    }
+
     PC_ASSERT(purc_get_last_error() == 0);
     return 0;
 }
 
 static void _cleanup_instance(struct pcinst *inst)
 {
-    if (!inst->executor_heap)
+    struct pcexecutor_heap *heap = inst->executor_heap;
+    if (!heap)
         return;
 
+    struct cached_rule *cr, *tmp;
+    list_for_each_entry_safe(cr, tmp, &heap->rules, ln) {
+        uncache_rule(heap, cr);
+    }
+    pchash_table_free(heap->rule_index);
+
     free(inst->executor_heap);
     inst->executor_heap = NULL;
 }
@@ -222,6 +380,20 @@ void pcexecutor_get_debug(int *debug_flex, int *debug_bison)
         *debug_bison = heap->debug_bison;
 }
 
+void pcexecutor_get_rule_cache_stats(size_t *nr_rules, size_t *nr_hits,
+        size_t *nr_misses)
+{
+    struct pcexecutor_heap *heap;
+    heap = pcinst_current()->executor_heap;
+
+    if (nr_rules)
+        *nr_rules  = heap->nr_rules;
+    if (nr_hits)
+        *nr_hits   = heap->nr_rule_hits;
+    if (nr_misses)
+        *nr_misses = heap->nr_rule_misses;
+}
+
 int pcexecutor_register(pcexec_ops_t ops)
 {
     if (!ops || !ops->atom) {
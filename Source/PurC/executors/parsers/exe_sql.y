@@ -30,12 +30,6 @@
 }
 
 %code requires {
-    struct exe_sql_param {
-        char *err_msg;
-        int debug_flex;
-        int debug_bison;
-    };
-
     struct exe_sql_token {
         const char      *text;
         size_t           leng;
@@ -47,9 +41,6 @@
     #define YY_TYPEDEF_YY_SCANNER_T
     typedef void* yyscan_t;
     #endif
-
-    int exe_sql_parse(const char *input, size_t len,
-            struct exe_sql_param *param);
 }
 
 %code provides {
@@ -65,22 +56,134 @@
         const char *errsg
     );
 
-    #define SET_ARGS(_r, _a) do {              \
-        _r = strndup(_a.text, _a.leng);        \
-        if (!_r)                               \
-            YYABORT;                           \
+    #define SET_QUERY(_query) do {                          \
+        if (param) {                                        \
+            param->query = _query;                          \
+        } else {                                            \
+            sql_query_destroy(_query);                      \
+        }                                                   \
+    } while (0)
+
+    // sql_expr_create_op() destroys the operands on failure
+    #define EXP_OP(_r, _type, _a, _b) do {                  \
+        _r = sql_expr_create_op(_type, _a, _b);             \
+        if (!_r)                                            \
+            YYABORT;                                        \
+    } while (0)
+
+    #define EXP_NEW(_r, _type) do {                         \
+        _r = sql_expr_create(_type);                        \
+        if (!_r)                                            \
+            YYABORT;                                        \
+    } while (0)
+
+    #define EXP_NUMBER(_r, _s) do {                         \
+        double d;                                           \
+        STRTOD(d, _s);                                      \
+        EXP_NEW(_r, SQL_EXPR_NUMBER);                       \
+        _r->d = d;                                          \
+    } while (0)
+
+    #define EXP_NAMED(_r, _type, _s) do {                   \
+        EXP_NEW(_r, _type);                                 \
+        _r->name = strndup(_s.text, _s.leng);               \
+        if (!_r->name) {                                    \
+            sql_expr_destroy(_r);                           \
+            YYABORT;                                        \
+        }                                                   \
+    } while (0)
+
+    #define EXP_FIELD(_r, _s) do {                          \
+        _r->field = strndup(_s.text, _s.leng);              \
+        if (!_r->field) {                                   \
+            sql_expr_destroy(_r);                           \
+            YYABORT;                                        \
+        }                                                   \
+    } while (0)
+
+    #define EXP_STRING(_r, _slist) do {                     \
+        char *s = pcexe_strlist_to_str(&_slist);            \
+        pcexe_strlist_reset(&_slist);                       \
+        if (!s)                                             \
+            YYABORT;                                        \
+        _r = sql_expr_create(SQL_EXPR_STRING);              \
+        if (!_r) {                                          \
+            free(s);                                        \
+            YYABORT;                                        \
+        }                                                   \
+        _r->name = s;                                       \
     } while (0)
 
-    #define APPEND_ARGS(_r, _a, _b) do {       \
-        size_t len = strlen(_a);               \
-        size_t n   = len + _b.leng;            \
-        char *s = (char*)realloc(_a, n+1);     \
-        if (!s) {                              \
-            free(_r);                          \
-            YYABORT;                           \
-        }                                      \
-        memcpy(s+len, _b.text, _b.leng);       \
-        _r = s;                                \
+    #define EXP_CALL(_r, _s, _arg) do {                     \
+        _r = sql_expr_create(SQL_EXPR_CALL);                \
+        if (_r)                                             \
+            _r->name = strndup(_s.text, _s.leng);           \
+        if (!_r || !_r->name) {                             \
+            sql_expr_destroy(_r);                           \
+            sql_expr_destroy(_arg);                         \
+            YYABORT;                                        \
+        }                                                   \
+        _r->left = _arg;                                    \
+    } while (0)
+
+    #define LIST_APPEND(_type, _list, _one) do {            \
+        _type *p = _list;                                   \
+        while (p->next)                                     \
+            p = p->next;                                    \
+        p->next = _one;                                     \
+    } while (0)
+
+    #define ITEM_NEW(_r, _exp) do {                         \
+        _r = calloc(1, sizeof(*_r));                        \
+        if (!_r) {                                          \
+            sql_expr_destroy(_exp);                         \
+            YYABORT;                                        \
+        }                                                   \
+        _r->exp = _exp;                                     \
+    } while (0)
+
+    #define ITEM_SET_ALIAS(_r, _s) do {                     \
+        _r->alias = strndup(_s.text, _s.leng);              \
+        if (!_r->alias) {                                   \
+            sql_select_item_destroy(_r);                    \
+            YYABORT;                                        \
+        }                                                   \
+    } while (0)
+
+    #define ORDER_NEW(_r, _col, _desc) do {                 \
+        _r = calloc(1, sizeof(*_r));                        \
+        if (!_r) {                                          \
+            sql_expr_destroy(_col);                         \
+            YYABORT;                                        \
+        }                                                   \
+        _r->col = _col;                                     \
+        _r->desc = _desc;                                   \
+    } while (0)
+
+    #define SELECT_NEW(_r, _items, _from, _where, _group,   \
+            _order, _limit, _travel) do {                   \
+        _r = sql_select_create();                           \
+        if (!_r) {                                          \
+            sql_select_item_destroy(_items);                \
+            sql_expr_destroy(_from);                        \
+            sql_expr_destroy(_where);                       \
+            sql_expr_destroy(_group);                       \
+            sql_order_item_destroy(_order);                 \
+            YYABORT;                                        \
+        }                                                   \
+        _r->items    = _items;                              \
+        _r->from     = _from;                               \
+        _r->where    = _where;                              \
+        _r->group_by = _group;                              \
+        _r->order_by = _order;                              \
+        _r->limit    = _limit;                              \
+        _r->travel   = _travel;                             \
+    } while (0)
+
+    #define QUERY_NEW(_r, _select, _left, _right) do {      \
+        _r = sql_query_create(_select, _left, _right);      \
+        if (!_r)                                            \
+            YYABORT;                                        \
     } while (0)
 }
 
@@ -102,27 +205,48 @@
 %union { struct exe_sql_token token; }
 %union { char *str; }
 %union { char c; }
-
-    /* %destructor { free($$); } <str> */ // destructor for `str`
-
-%token SQL SELECT WHERE GROUP BY ORDER TRAVEL IN LIKE UNION AS ASC DESC
+%union { struct pcexe_strlist slist; }
+%union { struct sql_expr *exp; }
+%union { struct sql_select_item *items; }
+%union { struct sql_order_item *orders; }
+%union { struct sql_select *select; }
+%union { struct sql_query *query; }
+%union { long limit; }
+%union { enum sql_travel_type travel; }
+
+%destructor { pcexe_strlist_reset(&$$); } <slist>
+%destructor { sql_expr_destroy($$); } <exp>
+%destructor { sql_select_item_destroy($$); } <items>
+%destructor { sql_order_item_destroy($$); } <orders>
+%destructor { sql_select_destroy($$); } <select>
+%destructor { sql_query_destroy($$); } <query>
+
+%token SQL SELECT FROM WHERE GROUP BY ORDER LIMIT TRAVEL IN LIKE UNION AS
+%token ASC DESC
 %token SIBLINGS DEPTH BREADTH LEAVES
 %token NOT GE LE NE AT
-%token <c> CHR UNI
-%token <token> STR INTERIOR
+%token <c> CHR
+%token <token> STR UNI INTERIOR
 %token <token> INTEGER NUMBER ID
 
 %left UNION
-%left IN LIKE
-%left AND OR
-%right '=' '<' '>' GE LE NE
+%left OR
+%left AND
+%precedence NEG
+%nonassoc '=' '<' '>' GE LE NE IN LIKE
 %left '-' '+'
 %left '*' '/'
 %precedence UMINUS
-%precedence NEG
 
- /* %nterm <str>   args */ // non-terminal `input` use `str` to store
-                           // token value as well
+%nterm <query>  sql_rule union_clause
+%nterm <select> select_clause
+%nterm <items>  select_list select_item
+%nterm <exp>    from_clause where_clause group_by_clause
+%nterm <exp>    var var_list exp exp_list
+%nterm <orders> order_by_clause order_list order_item
+%nterm <limit>  limit_clause
+%nterm <travel> travel_in_clause
+%nterm <slist>  str
 
 %% /* The grammar follows. */
 
@@ -131,107 +255,128 @@ input:
 ;
 
 rule:
-  sql_rule
+  sql_rule   { SET_QUERY($1); }
 ;
 
 sql_rule:
-  SQL ':' union_clause
+  SQL ':' union_clause   { $$ = $3; }
 ;
 
 select_clause:
-  SELECT select_list where_clause group_by_clause order_by_clause travel_in_clause
+  SELECT select_list from_clause where_clause group_by_clause order_by_clause limit_clause travel_in_clause
+    { SELECT_NEW($$, $2, $3, $4, $5, $6, $7, $8); }
 ;
 
 union_clause:
-  select_clause
-| '(' union_clause ')'
-| union_clause UNION union_clause
+  select_clause                    { QUERY_NEW($$, $1, NULL, NULL); }
+| '(' union_clause ')'             { $$ = $2; }
+| union_clause UNION union_clause  { QUERY_NEW($$, NULL, $1, $3); }
 ;
 
 select_list:
-  select_item
-| select_list ',' select_item
+  select_item                  { $$ = $1; }
+| select_list ',' select_item  { LIST_APPEND(struct sql_select_item, $1, $3); $$ = $1; }
 ;
 
 select_item:
-  exp
-| exp AS ID
+  exp          { ITEM_NEW($$, $1); }
+| exp AS ID    { ITEM_NEW($$, $1); ITEM_SET_ALIAS($$, $3); }
 ;
 
 var:
-  ID
-| ID '.' ID
+  ID           { EXP_NAMED($$, SQL_EXPR_COLUMN, $1); }
+| ID '.' ID    { EXP_NAMED($$, SQL_EXPR_COLUMN, $1); EXP_FIELD($$, $3); }
 ;
 
 var_list:
-  var
-| var_list ',' var
+  var                { $$ = $1; }
+| var_list ',' var   { LIST_APPEND(struct sql_expr, $1, $3); $$ = $1; }
+;
+
+from_clause:
+  %empty       { $$ = NULL; }
+| FROM var     { $$ = $2; }
 ;
 
 where_clause:
-  %empty
-| WHERE exp
+  %empty       { $$ = NULL; }
+| WHERE exp    { $$ = $2; }
 ;
 
 group_by_clause:
-  %empty
-| GROUP BY var_list
+  %empty             { $$ = NULL; }
+| GROUP BY var_list  { $$ = $3; }
 ;
 
 order_by_clause:
-  %empty
-| ORDER BY var_list
-| ORDER BY var_list ASC
-| ORDER BY var_list DESC
+  %empty               { $$ = NULL; }
+| ORDER BY order_list  { $$ = $3; }
+;
+
+order_list:
+  order_item                 { $$ = $1; }
+| order_list ',' order_item  { LIST_APPEND(struct sql_order_item, $1, $3); $$ = $1; }
+;
+
+order_item:
+  var        { ORDER_NEW($$, $1, false); }
+| var ASC    { ORDER_NEW($$, $1, false); }
+| var DESC   { ORDER_NEW($$, $1, true); }
+;
+
+limit_clause:
+  %empty         { $$ = -1; }
+| LIMIT INTEGER  { STRTOL($$, $2); }
 ;
 
 travel_in_clause:
-  %empty
-| TRAVEL IN SIBLINGS
-| TRAVEL IN DEPTH
-| TRAVEL IN BREADTH
-| TRAVEL IN LEAVES
+  %empty              { $$ = SQL_TRAVEL_NONE; }
+| TRAVEL IN SIBLINGS  { $$ = SQL_TRAVEL_SIBLINGS; }
+| TRAVEL IN DEPTH     { $$ = SQL_TRAVEL_DEPTH; }
+| TRAVEL IN BREADTH   { $$ = SQL_TRAVEL_BREADTH; }
+| TRAVEL IN LEAVES    { $$ = SQL_TRAVEL_LEAVES; }
 ;
 
 exp:
-  INTEGER
-| NUMBER
-| var
-| '*'
-| '&'
-| '"' str '"'
-| AT ID
-| exp LIKE exp
-| exp IN '(' exp_list ')'
-| exp AND exp
-| exp OR exp
-| NOT exp %prec NEG
-| exp '=' exp
-| exp NE exp
-| exp LE exp
-| exp GE exp
-| exp '>' exp
-| exp '<' exp
-| exp '+' exp
-| exp '-' exp
-| exp '*' exp
-| exp '/' exp
-| '-' exp %prec UMINUS
-| '(' exp ')'
+  INTEGER              { EXP_NUMBER($$, $1); }
+| NUMBER               { EXP_NUMBER($$, $1); }
+| var                  { $$ = $1; }
+| ID '(' exp ')'       { EXP_CALL($$, $1, $3); }
+| '*'                  { EXP_NEW($$, SQL_EXPR_STAR); }
+| '&'                  { EXP_NEW($$, SQL_EXPR_SELF); }
+| '"' str '"'          { EXP_STRING($$, $2); }
+| AT ID                { EXP_NAMED($$, SQL_EXPR_META, $2); }
+| exp LIKE exp         { EXP_OP($$, SQL_EXPR_LIKE, $1, $3); }
+| exp IN '(' exp_list ')'  { EXP_OP($$, SQL_EXPR_IN, $1, $4); }
+| exp AND exp          { EXP_OP($$, SQL_EXPR_AND, $1, $3); }
+| exp OR exp           { EXP_OP($$, SQL_EXPR_OR, $1, $3); }
+| NOT exp %prec NEG    { EXP_OP($$, SQL_EXPR_NOT, $2, NULL); }
+| exp '=' exp          { EXP_OP($$, SQL_EXPR_EQ, $1, $3); }
+| exp NE exp           { EXP_OP($$, SQL_EXPR_NE, $1, $3); }
+| exp LE exp           { EXP_OP($$, SQL_EXPR_LE, $1, $3); }
+| exp GE exp           { EXP_OP($$, SQL_EXPR_GE, $1, $3); }
+| exp '>' exp          { EXP_OP($$, SQL_EXPR_GT, $1, $3); }
+| exp '<' exp          { EXP_OP($$, SQL_EXPR_LT, $1, $3); }
+| exp '+' exp          { EXP_OP($$, SQL_EXPR_ADD, $1, $3); }
+| exp '-' exp          { EXP_OP($$, SQL_EXPR_SUB, $1, $3); }
+| exp '*' exp          { EXP_OP($$, SQL_EXPR_MUL, $1, $3); }
+| exp '/' exp          { EXP_OP($$, SQL_EXPR_DIV, $1, $3); }
+| '-' exp %prec UMINUS { EXP_OP($$, SQL_EXPR_NEG, $2, NULL); }
+| '(' exp ')'          { $$ = $2; }
 ;
 
 exp_list:
-  exp
-| exp ',' exp
+  exp                  { $$ = $1; }
+| exp_list ',' exp     { LIST_APPEND(struct sql_expr, $1, $3); $$ = $1; }
 ;
 
 str:
-  STR
-| CHR
-| UNI
-| str STR
-| str CHR
-| str UNI
+  STR      { STRLIST_INIT_STR($$, $1); }
+| CHR      { STRLIST_INIT_CHR($$, $1); }
+| UNI      { STRLIST_INIT_UNI($$, $1); }
+| str STR  { STRLIST_APPEND_STR($1, $2); $$ = $1; }
+| str CHR  { STRLIST_APPEND_CHR($1, $2); $$ = $1; }
+| str UNI  { STRLIST_APPEND_UNI($1, $2); $$ = $1; }
 ;
 
 %%
@@ -272,6 +417,15 @@ int exe_sql_parse(const char *input, size_t len,
     yy_scan_bytes(input ? input : "", input ? len : 0, arg);
     int ret =yyparse(arg, param);
     yylex_destroy(arg);
+    if (ret) {
+        if (!param || param->err_msg==NULL) {
+            purc_set_error(PCEXECUTOR_ERROR_OOM);
+        } else {
+            purc_set_error(PCEXECUTOR_ERROR_BAD_SYNTAX);
+        }
+    } else if (param) {
+        param->rule_valid = 1;
+    }
     return ret ? -1 : 0;
 }
 
@@ -28,16 +28,43 @@
 
 #include <wtf/URL.h>
 #include <wtf/RunLoop.h>
+#include <wtf/WorkerPool.h>
+#include <wtf/HashMap.h>
+#include <wtf/ListHashSet.h>
+#include <wtf/Lock.h>
+#include <wtf/Vector.h>
+#include <wtf/text/StringHash.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <stdlib.h>
 
+#include <memory>
+
+/* idle workers exit after this long and are respawned on demand */
+#define LOCAL_WORKER_IDLE_TIMEOUT       10_s
+
+/* a cached file is valid as long as its mtime and size are unchanged */
+struct local_cache_entry {
+    time_t mtime;
+    off_t size;
+    Vector<uint8_t> data;
+};
+
 struct pcfetcher_local {
     struct pcfetcher base;
     char* base_uri;
+
+    RefPtr<WorkerPool> workers;
+
+    /* LRU cache of the file contents, bounded by `cache_quota` in bytes */
+    Lock cache_lock;
+    HashMap<String, std::unique_ptr<local_cache_entry>> cache;
+    ListHashSet<String> cache_lru;
+    size_t cache_size;
 };
 
 struct mime_type {
@@ -55,6 +82,10 @@ struct mime_type  mime_types[] = {
 static const char* get_mime(const char* name)
 {
     const char* ext = strrchr(name, '.');
+    if (ext == NULL) {
+        return mime_types[0].mime;
+    }
+
     size_t sz = sizeof(mime_types) / sizeof(struct mime_type);
     for (size_t i = 1; i < sz; i++) {
         if (strcmp(ext, mime_types[i].ext) == 0) {
@@ -66,8 +97,7 @@ static const char* get_mime(const char* name)
 
 struct pcfetcher* pcfetcher_local_init(size_t max_conns, size_t cache_quota)
 {
-    struct pcfetcher_local* local = (struct pcfetcher_local*)malloc(
-            sizeof(struct pcfetcher_local));
+    struct pcfetcher_local* local = new (std::nothrow) pcfetcher_local();
     if (local == NULL) {
         return NULL;
     }
@@ -87,6 +117,12 @@ struct pcfetcher* pcfetcher_local_init(size_t max_conns, size_t cache_quota)
     fetcher->check_response = pcfetcher_local_check_response;
 
     local->base_uri = NULL;
+    local->cache_size = 0;
+
+    /* the worker threads are only spawned when there are requests */
+    unsigned nr_workers = max_conns ? (unsigned)max_conns : 1;
+    local->workers = WorkerPool::create("PcFetcherLocal"_s, nr_workers,
+            LOCAL_WORKER_IDLE_TIMEOUT);
 
     return fetcher;
 }
@@ -98,10 +134,14 @@ int pcfetcher_local_term(struct pcfetcher* fetcher)
     }
 
     struct pcfetcher_local* local = (struct pcfetcher_local*)fetcher;
+
+    /* waits for the pending requests before the cache goes away */
+    local->workers = nullptr;
+
     if (local->base_uri) {
         free(local->base_uri);
     }
-    free(local);
+    delete local;
     return 0;
 }
 
@@ -162,6 +202,157 @@ const char* pcfetcher_cookie_loccal_remove(struct pcfetcher* fetcher,
     return NULL;
 }
 
+static void cache_evict(struct pcfetcher_local* local, size_t sz_needed)
+{
+    size_t quota = local->base.cache_quota;
+    while (!local->cache_lru.isEmpty() &&
+            local->cache_size + sz_needed > quota) {
+        String path = local->cache_lru.takeFirst();
+        auto entry = local->cache.take(path);
+        if (entry) {
+            local->cache_size -= entry->data.size();
+        }
+    }
+}
+
+static purc_rwstream_t cache_lookup(struct pcfetcher_local* local,
+        const String& path, const struct stat* st)
+{
+    auto locker = holdLock(local->cache_lock);
+    auto it = local->cache.find(path);
+    if (it == local->cache.end()) {
+        return NULL;
+    }
+
+    local_cache_entry* entry = it->value.get();
+    if (entry->mtime != st->st_mtime || entry->size != st->st_size) {
+        local->cache_size -= entry->data.size();
+        local->cache.remove(it);
+        local->cache_lru.remove(path);
+        return NULL;
+    }
+
+    local->cache_lru.appendOrMoveToLast(path);
+
+    purc_rwstream_t rws = purc_rwstream_new_buffer(entry->data.size(), 0);
+    if (rws) {
+        purc_rwstream_write(rws, entry->data.data(), entry->data.size());
+        purc_rwstream_seek(rws, 0, SEEK_SET);
+    }
+    return rws;
+}
+
+static void cache_store(struct pcfetcher_local* local, const String& path,
+        const struct stat* st, const uint8_t* data, size_t sz)
+{
+    auto entry = std::make_unique<local_cache_entry>();
+    entry->mtime = st->st_mtime;
+    entry->size = st->st_size;
+    entry->data.append(data, sz);
+
+    auto locker = holdLock(local->cache_lock);
+    auto old = local->cache.take(path);
+    if (old) {
+        local->cache_size -= old->data.size();
+        local->cache_lru.remove(path);
+    }
+
+    /* the keys are shared by the workers; they are only touched under
+       the lock, so never keep the caller's string in the cache */
+    String key = path.isolatedCopy();
+    cache_evict(local, sz);
+    local->cache_size += sz;
+    local->cache.add(key, WTFMove(entry));
+    local->cache_lru.add(key);
+}
+
+/*
+ * Loads the whole file into a buffer stream when it fits in the cache;
+ * otherwise, the file is streamed directly as before.
+ */
+static purc_rwstream_t load_file(struct pcfetcher_local* local,
+        const char* file, struct pcfetcher_resp_header *resp_header)
+{
+    resp_header->ret_code = 404;
+    resp_header->sz_resp = 0;
+    resp_header->mime_type = NULL;
+
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return NULL;
+    }
+
+    String path = String::fromUTF8(file);
+    size_t sz = st.st_size;
+    purc_rwstream_t rws = cache_lookup(local, path, &st);
+    if (rws == NULL && sz > local->base.cache_quota) {
+        FILE* fp = fdopen(fd, "r");
+        if (fp) {
+            fd = -1;
+            rws = purc_rwstream_new_from_fp(fp);
+        }
+    }
+    else if (rws == NULL) {
+        uint8_t* buf = (uint8_t*)malloc(sz + 1);
+        size_t nr_read = 0;
+        while (buf && nr_read < sz) {
+            ssize_t n = read(fd, buf + nr_read, sz - nr_read);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            nr_read += n;
+        }
+
+        if (buf && nr_read == sz) {
+            rws = purc_rwstream_new_buffer(sz, 0);
+            if (rws) {
+                purc_rwstream_write(rws, buf, sz);
+                purc_rwstream_seek(rws, 0, SEEK_SET);
+                cache_store(local, path, &st, buf, sz);
+            }
+        }
+        free(buf);
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    if (rws) {
+        resp_header->ret_code = 200;
+        resp_header->sz_resp = sz;
+        resp_header->mime_type = strdup(get_mime(file));
+    }
+    return rws;
+}
+
+static bool resolve_path(struct pcfetcher_local* local, const char* url,
+        CString& path)
+{
+    String uri;
+    if (local->base_uri &&
+            strncmp(url, local->base_uri, strlen(local->base_uri)) != 0) {
+        uri.append(local->base_uri);
+    }
+    uri.append(url);
+    PurCWTF::URL wurl(URL(), uri);
+    if (!wurl.isLocalFile()) {
+        return false;
+    }
+
+    path = wurl.path().utf8();
+    return true;
+}
+
 purc_variant_t pcfetcher_local_request_async(
         struct pcfetcher* fetcher,
         const char* url,
@@ -171,53 +362,49 @@ purc_variant_t pcfetcher_local_request_async(
         pcfetcher_response_handler handler,
         void* ctxt)
 {
-    UNUSED_PARAM(fetcher);
-    UNUSED_PARAM(url);
     UNUSED_PARAM(method);
     UNUSED_PARAM(params);
     UNUSED_PARAM(timeout);
-    UNUSED_PARAM(handler);
-    UNUSED_PARAM(ctxt);
 
     if (!fetcher || !url || !handler) {
         return PURC_VARIANT_INVALID;
     }
 
     struct pcfetcher_callback_info *info = pcfetcher_create_callback_info();
-    info->rws = pcfetcher_local_request_sync(fetcher, url, method,
-            params, timeout, &info->header);
+    if (info == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return PURC_VARIANT_INVALID;
+    }
+
     info->handler = handler;
     info->ctxt = ctxt;
     info->req_id = purc_variant_make_native(info, NULL);
+    info->header.ret_code = 404;
 
-    if (!info->rws) {
-        info->header.ret_code = 404;
-    }
+    struct pcfetcher_local* local = (struct pcfetcher_local*)fetcher;
+    CString path;
+    bool is_local = resolve_path(local, url, path);
 
+    /* the file is read by a worker, and the handler is called on the
+       run loop of the requester */
     RunLoop *runloop = &RunLoop::current();
-#ifdef NDEBUG
-    runloop->dispatch([info] {
-#else
-    // random
-    double tm = randomNumber() * 10;
-    runloop->dispatchAfter(Seconds(tm), [info] {
-#endif
-                if (!info->cancelled) {
-                    info->handler(info->req_id, info->ctxt, &info->header,
-                            info->rws);
-                    info->rws = NULL;
-                }
-                pcfetcher_destroy_callback_info(info);
-            });
+    local->workers->postTask([local, info, runloop, is_local,
+            path = WTFMove(path)] {
+        if (is_local && !info->cancelled) {
+            info->rws = load_file(local, path.data(), &info->header);
+        }
 
-    return info->req_id;
-}
+        runloop->dispatch([info] {
+            if (!info->cancelled) {
+                info->handler(info->req_id, info->ctxt, &info->header,
+                        info->rws);
+                info->rws = NULL;
+            }
+            pcfetcher_destroy_callback_info(info);
+        });
+    });
 
-off_t filesize(const char* filename)
-{
-    struct stat statbuf;
-    stat(filename,&statbuf);
-    return statbuf.st_size;
+    return info->req_id;
 }
 
 purc_rwstream_t pcfetcher_local_request_sync(
@@ -228,60 +415,45 @@ purc_rwstream_t pcfetcher_local_request_sync(
         uint32_t timeout,
         struct pcfetcher_resp_header *resp_header)
 {
-    UNUSED_PARAM(fetcher);
-    UNUSED_PARAM(url);
     UNUSED_PARAM(method);
     UNUSED_PARAM(params);
     UNUSED_PARAM(timeout);
-    UNUSED_PARAM(resp_header);
 
-    if (!fetcher || !url) {
+    if (!fetcher || !url || !resp_header) {
         return NULL;
     }
+
     struct pcfetcher_local* local = (struct pcfetcher_local*)fetcher;
-    String uri;
-    if (local->base_uri &&
-            strncmp(url, local->base_uri, strlen(local->base_uri)) != 0) {
-        uri.append(local->base_uri);
-    }
-    uri.append(url);
-    PurCWTF::URL wurl(URL(), uri);
-    if (!wurl.isLocalFile()) {
+    CString path;
+    if (!resolve_path(local, url, path)) {
         resp_header->ret_code = 404;
         resp_header->sz_resp = 0;
         resp_header->mime_type = NULL;
         return NULL;
     }
 
-    const StringView path = wurl.path();
-    const CString& cpath = path.utf8();
-
-    const char* file = cpath.data();
-
-    purc_rwstream_t rws = purc_rwstream_new_from_file(file, "r");
-    if (rws && resp_header) {
-        resp_header->ret_code = 200;
-        resp_header->sz_resp = filesize(file);
-        resp_header->mime_type = strdup(get_mime(file));
-        return rws;
-    }
-
-    return NULL;
+    return load_file(local, path.data(), resp_header);
 }
 
 void pcfetcher_local_cancel_async(struct pcfetcher* fetcher,
         purc_variant_t request)
 {
     UNUSED_PARAM(fetcher);
-    UNUSED_PARAM(request);
 
-#ifndef NDEBUG
+    /* called on the requester's run loop, the same one which delivers the
+       response; so the response of a cancelled request is always dropped */
     struct pcfetcher_callback_info *info = (struct pcfetcher_callback_info *)
         purc_variant_native_get_entity(request);
+    if (info == NULL || info->cancelled) {
+        return;
+    }
+
+    /* the worker may still be filling `info->header` */
+    struct pcfetcher_resp_header header = { };
+    header.ret_code = RESP_CODE_USER_CANCEL;
+
     info->cancelled = true;
-    info->header.ret_code = RESP_CODE_USER_CANCEL;
-    info->handler(info->req_id, info->ctxt, &info->header, NULL);
-#endif
+    info->handler(info->req_id, info->ctxt, &header, NULL);
 }
 
 int pcfetcher_local_check_response(struct pcfetcher* fetcher,
@@ -1542,6 +1542,9 @@ again:
         case 2:
             in = rs->tail;
             break;
+        case 3:
+            /* all the streams are exhausted */
+            return 0;
         default:
             purc_set_error(PURC_ERROR_OVERFLOW);
             return -1;
@@ -1550,8 +1553,6 @@ again:
     ssize_t n = purc_rwstream_read(in, buf, count);
     if (n == 0) {
         rs->idx += 1;
-        if (rs->idx == 3)
-            return count;
         goto again;
     }
 
@@ -199,6 +199,11 @@ pcutils_array_list_sort(struct pcutils_array_list *al,
         void *ud, int (*cmp)(struct pcutils_array_list_node *l,
                 struct pcutils_array_list_node *r, void *ud));
 
+/* moves the node at order[i] to the index i; returns -1 on OOM */
+int
+pcutils_array_list_reorder(struct pcutils_array_list *al,
+        const size_t *order);
+
 PCA_EXTERN_C_END
 
 #endif // PURC_PRIVATE_ARRAY_LIST_H
@@ -106,8 +106,35 @@ struct purc_document_ops {
     int (*elem_coll_filter)(purc_document_t doc,
             pcdoc_elem_coll_t dst_coll,
             pcdoc_elem_coll_t src_coll, const char *selector);
+
+    // nullable; sorts the elements in document order.
+    int (*sort_elements)(purc_document_t doc,
+            pcdoc_element_t *elems, size_t nr);
+
+    // nullable; the CSS selectors are only supported if both
+    // `get_tag_name` and `sibling_element` are not null.
+    // returns the local name of the element in lower case.
+    const char *(*get_tag_name)(purc_document_t doc,
+            pcdoc_element_t elem, size_t *len);
+    pcdoc_element_t (*sibling_element)(purc_document_t doc,
+            pcdoc_element_t elem, bool next);
+
+    // nullable; the atoms of the tag names (0 for unknown tag name).
+    uintptr_t (*tag_name_atom)(purc_document_t doc,
+            const char *name, size_t len);
+    uintptr_t (*get_tag_atom)(purc_document_t doc, pcdoc_element_t elem);
+
+    // nullable; replaces the element by its children. If `displace` is
+    // true, the other children of its parent are erased first.
+    int (*unwrap_element)(purc_document_t doc, pcdoc_element_t elem,
+            bool displace);
 };
 
+struct pchash_table;
+struct pcdoc_selector;
+typedef struct pcdoc_selector pcdoc_selector;
+typedef struct pcdoc_selector *pcdoc_selector_t;
+
 struct purc_document {
     purc_document_type type;
     pcrdr_msg_data_type def_text_type;
@@ -121,6 +148,15 @@ struct purc_document {
     struct purc_document_ops *ops;
 
     void *impl;
+
+    /* The indexes of elements by identifier and by class name. They are
+       built by the first query, and maintained by the operations on
+       the document since then. */
+    struct pchash_table *id_index;
+    struct pchash_table *class_index;
+
+    /* The compiled CSS selectors; the keys are the selector strings. */
+    struct pchash_table *selectors;
 };
 
 struct pcdoc_elem_coll {
@@ -140,6 +176,47 @@ extern struct purc_document_ops _pcdoc_void_ops WTF_INTERNAL;
 extern struct purc_document_ops _pcdoc_plain_ops WTF_INTERNAL;
 extern struct purc_document_ops _pcdoc_html_ops WTF_INTERNAL;
 
+/* Add the ancestor (if @self is true) and its descendant elements to
+   the indexes; call it after the elements are inserted. */
+void pcdoc_index_add_descendants(purc_document_t doc,
+        pcdoc_element_t ancestor, bool self) WTF_INTERNAL;
+
+/* Remove the ancestor (if @self is true) and its descendant elements from
+   the indexes; call it before the elements are destroyed or changed. */
+void pcdoc_index_remove_descendants(purc_document_t doc,
+        pcdoc_element_t ancestor, bool self) WTF_INTERNAL;
+
+/* Add or remove a single element; used when its identifier or
+   class names change. */
+void pcdoc_index_add_element(purc_document_t doc,
+        pcdoc_element_t elem) WTF_INTERNAL;
+void pcdoc_index_remove_element(purc_document_t doc,
+        pcdoc_element_t elem) WTF_INTERNAL;
+
+void pcdoc_index_destroy(purc_document_t doc) WTF_INTERNAL;
+
+/* Compile a group of CSS Level 3 selectors for the document; returns NULL
+   and sets the error PURC_ERROR_INVALID_VALUE for a bad selector. */
+pcdoc_selector_t pcdoc_selector_new(purc_document_t doc,
+        const char *selector) WTF_INTERNAL;
+void pcdoc_selector_delete(pcdoc_selector_t sel) WTF_INTERNAL;
+
+/* Get the compiled selector from the cache of the document, compile it
+   if it is not cached. The selector is owned by the document. */
+pcdoc_selector_t pcdoc_document_get_selector(purc_document_t doc,
+        const char *selector) WTF_INTERNAL;
+void pcdoc_document_clear_selectors(purc_document_t doc) WTF_INTERNAL;
+
+/* Check whether the element matches the selector. */
+bool pcdoc_selector_match(purc_document_t doc, pcdoc_selector_t sel,
+        pcdoc_element_t elem) WTF_INTERNAL;
+
+/* Call @cb on the elements in the subtree of @ancestor (including itself)
+   which match the selector, in document order. */
+int pcdoc_selector_travel(purc_document_t doc, pcdoc_selector_t sel,
+        pcdoc_element_t ancestor, pcdoc_element_cb cb, void *ctxt,
+        size_t *n) WTF_INTERNAL;
+
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
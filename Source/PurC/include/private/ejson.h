@@ -62,6 +62,12 @@ void pcejson_reset (struct pcejson* parser, uint32_t depth, uint32_t flags);
 int pcejson_parse (struct pcvcm_node** vcm_tree, struct pcejson** parser,
                    purc_rwstream_t rwstream, uint32_t depth);
 
+/*
+ * Give the bytes read ahead but not parsed back to the stream, if the
+ * stream is seekable.
+ */
+void pcejson_give_back (struct pcejson* parser);
+
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
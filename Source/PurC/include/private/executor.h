@@ -32,6 +32,7 @@
 #include "purc-executor.h"
 
 #include "private/map.h"
+#include "private/list.h"
 
 PCA_EXTERN_C_BEGIN
 
@@ -98,9 +99,37 @@ int pcexec_register_ops(pcexec_ops_t ops);
 int pcexec_get_by_rule(const char *rule, pcexec_ops_t ops);
 
 
+/* the max number of the parsed rules cached by an instance */
+#define PCEXEC_MAX_CACHED_RULES     64
+
+struct pchash_table;
+
 struct pcexecutor_heap {
     unsigned int       debug_flex:1;
     unsigned int       debug_bison:1;
+
+    /* the cached rules, the most recently used first */
+    struct list_head        rules;
+    struct pchash_table    *rule_index;
+    size_t                  nr_rules;
+
+    size_t                  nr_rule_hits;
+    size_t                  nr_rule_misses;
+};
+
+typedef int  (*pcexec_parse_rule_f)(const char *input, size_t len,
+        void *param);
+typedef void (*pcexec_reset_param_f)(void *param);
+
+/*
+ * The parser of the rules of a built-in executor. The structure of the
+ * parameter must start with `char *err_msg`, which is set by the parser
+ * on failure.
+ */
+struct pcexec_rule_parser {
+    size_t                  sz_param;
+    pcexec_parse_rule_f     parse;
+    pcexec_reset_param_f    reset;
 };
 
 // 用于迭代的迭代器
@@ -130,6 +159,10 @@ struct pcinst;
 void pcexecutor_set_debug(int debug_flex, int debug_bison);
 void pcexecutor_get_debug(int *debug_flex, int *debug_bison);
 
+/* the number of the cached rules, and the hits and misses of the cache */
+void pcexecutor_get_rule_cache_stats(size_t *nr_rules, size_t *nr_hits,
+        size_t *nr_misses);
+
 void pcexecutor_inst_reset(struct purc_exec_inst *inst);
 
 
@@ -140,6 +173,22 @@ int pcexecutor_get_by_rule(const char *rule, pcexec_ops_t ops);
 purc_atom_t
 pcexecutor_get_rule_name(const char *rule);
 
+/*
+ * Get the parameter parsed from @rule by @parser. The parameter is cached
+ * by the current instance and shared by all the users of the same rule,
+ * so it must not be changed except the scratch space used for evaluation;
+ * release it by calling pcexecutor_release_rule().
+ *
+ * Returns NULL on failure; the error message of the parser is returned
+ * in @err_msg (nullable) then, which should be freed by the caller.
+ */
+void *
+pcexecutor_get_rule(const struct pcexec_rule_parser *parser,
+        const char *rule, char **err_msg);
+
+void
+pcexecutor_release_rule(void *param);
+
 
 PCA_EXTERN_C_END
 
@@ -109,6 +109,14 @@ struct pchash_table {
      * Numbers of entries.
      */
     int count;
+    /**
+     * Numbers of slots freed by deletions (tombstones).
+     */
+    int nr_freed;
+    /**
+     * The size given when the table was created; never shrink below it.
+     */
+    int min_size;
 
     /**
      * The first entry.
@@ -61,6 +61,16 @@ struct pcmodule {
     module_cleanup_instance_f  cleanup_instance;
 };
 
+/* the number of the move buffers of other instances cached by an instance */
+#define PCINST_NR_CACHED_MBS    16
+
+struct pcinst_move_buffer;
+
+struct pcinst_cached_mb {
+    purc_atom_t                 atom;
+    struct pcinst_move_buffer  *mb;
+};
+
 struct pcinst {
     int                     errcode;
     purc_atom_t             error_except;
@@ -103,6 +113,10 @@ struct pcinst {
     struct pcintr_heap     *intr_heap;
     purc_runloop_t          running_loop;
 
+    /* the move buffer of this instance and the cached ones of others */
+    struct pcinst_move_buffer  *move_buffer;
+    struct pcinst_cached_mb     cached_mbs[PCINST_NR_CACHED_MBS];
+
     /* FIXME: enable the fields ONLY when NDEBUG is undefined */
     struct pcdebug_backtrace  *bt;
 };
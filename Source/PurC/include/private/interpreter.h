@@ -65,6 +65,7 @@
 #define MSG_SUB_TYPE_DISPLACED        "displaced"
 #define MSG_SUB_TYPE_EXITED           "exited"
 #define MSG_SUB_TYPE_PAGE_CLOSED      "pageClosed"
+#define MSG_SUB_TYPE_DOM_ERROR        "domError"
 
 struct pcintr_heap;
 typedef struct pcintr_heap pcintr_heap;
@@ -111,6 +112,10 @@ struct pcintr_heap {
 
     struct list_head      routines;     // struct pcintr_routine
 
+    // run queues of the scheduler, linked by the coroutines
+    struct list_head      ready_queue;  // in CO_STATE_READY
+    struct list_head      event_queue;  // having messages or tasks to handle
+
     int64_t               next_coroutine_id;
     purc_atom_t           move_buff;
     pcintr_timer_t        *event_timer; // 10ms
@@ -118,6 +123,14 @@ struct pcintr_heap {
     purc_cond_handler    cond_handler;
     unsigned int         keep_alive:1;
     double               timestamp;
+
+    // bumped whenever a variable manager changes, so that the variable
+    // caches of the stack frames can tell their entries are stale.
+    unsigned int         vars_generation;
+
+    // the DOM operations queued for the renderer in this scheduler pass
+    struct list_head      dom_reqs;
+    size_t                nr_dom_reqs;
 };
 
 struct pcintr_stack_frame;
@@ -132,6 +145,9 @@ struct pcintr_stack_frame_pseudo;
 typedef struct pcintr_stack_frame_pseudo pcintr_stack_frame_pseudo;
 typedef struct pcintr_stack_frame_pseudo *pcintr_stack_frame_pseudo_t;
 
+struct pchash_table;
+struct pcregex;
+
 struct pcintr_observer;
 typedef void (*pcintr_on_revoke_observer)(struct pcintr_observer *observer,
         void *data);
@@ -208,6 +224,9 @@ struct pcintr_stack {
     struct list_head              dynamic_observers;
     struct list_head              native_observers;
 
+    // key: (observer list, message type)  val: the observers of the type
+    struct pchash_table          *observer_index;
+
     // async request ids (array)
     purc_variant_t                async_request_ids;
 
@@ -260,6 +279,8 @@ struct pcintr_coroutine {
     uint64_t                    target_dom_handle;
 
     struct rb_node              node;     /* heap::coroutines */
+    struct list_head            ln_ready; /* heap::ready_queue */
+    struct list_head            ln_event; /* heap::event_queue */
 
     struct list_head            children; /* struct pcintr_coroutine_child */
 
@@ -349,6 +370,18 @@ enum pcintr_stack_frame_next_step {
     NEXT_STEP_SELECT_CHILD,
 };
 
+#define PCINTR_NR_VAR_CACHE_ENTRIES     8
+
+// a named variable resolved for a stack frame, valid while the frame stays
+// at the same scope and position and no variable manager has changed.
+struct pcintr_var_cache_entry {
+    purc_atom_t             name;       // 0 if the entry is empty
+    unsigned int            generation;
+    pcvdom_element_t        scope;
+    pcvdom_element_t        pos;
+    purc_variant_t          value;      // not referenced; INVALID if not found
+};
+
 enum pcintr_stack_frame_type {
     STACK_FRAME_TYPE_NORMAL,
     STACK_FRAME_TYPE_PSEUDO,
@@ -396,6 +429,9 @@ struct pcintr_stack_frame {
     purc_variant_t     error_templates;
 
     unsigned int       silently:1;
+
+    // the named variables resolved for this frame, indexed by the atom.
+    struct pcintr_var_cache_entry var_cache[PCINTR_NR_VAR_CACHE_ENTRIES];
 };
 
 struct pcintr_stack_frame_normal {
@@ -427,6 +463,10 @@ struct pcintr_observer {
     // the sub type of the message observed (cloned from the `for` attribute; nullable).
     char* sub_type;
 
+    // the compiled sub type; NULL if the sub type is a literal or invalid.
+    struct pcregex *sub_type_regex;
+    unsigned int    sub_type_is_literal:1;
+
     pcvdom_element_t scope;
     pcdoc_element_t  edom_element;
 
@@ -436,6 +476,9 @@ struct pcintr_observer {
     // the arraylist containing this struct pointer
     struct list_head* list;
 
+    // the node in the bucket of the observer index
+    struct list_head  bucket_node;
+
     // callback when revoke observer
     pcintr_on_revoke_observer on_revoke;
     void *on_revoke_data;
@@ -456,6 +499,21 @@ pcintr_coroutine_t pcintr_get_coroutine(void);
 // NOTE: null if current thread not initialized with purc_init
 purc_runloop_t pcintr_get_runloop(void);
 
+// Suspend the idle function (the scheduler) of the runloop until
+// pcintr_runloop_wakeup_idle() is called or `timeout_ms` (negative for
+// infinite) elapses; return false if a wake-up is already pending.
+bool pcintr_runloop_suspend_idle(purc_runloop_t runloop, long timeout_ms);
+// NOTE: thread-safe
+void pcintr_runloop_wakeup_idle(purc_runloop_t runloop);
+// Wake up the scheduler of the current instance
+void pcintr_wakeup_scheduler(void);
+// Put the coroutine on the event queue of the scheduler and wake it up
+void pcintr_coroutine_set_event_pending(pcintr_coroutine_t co);
+// Find the coroutine of the current instance by its identifier
+pcintr_coroutine_t pcintr_coroutine_get_by_id(purc_atom_t id);
+// Wake up the idle function when the fd becomes readable
+uintptr_t pcintr_runloop_add_wakeup_fd(purc_runloop_t runloop, int fd);
+
 void pcintr_check_after_execution(void);
 void pcintr_set_current_co_with_location(pcintr_coroutine_t co,
         const char *file, int line, const char *func);
@@ -548,13 +606,19 @@ pcintr_get_scope_variable(purc_coroutine_t cor, pcvdom_element_t elem,
 purc_variant_t
 pcintr_find_named_var(pcintr_stack_t stack, const char* name);
 
+// same as pcintr_find_named_var(), for a name already interned as an atom
+// in ATOM_BUCKET_VARNAME; the result is cached by the bottom frame.
+purc_variant_t
+pcintr_find_named_var_by_atom(pcintr_stack_t stack, const char* name,
+        purc_atom_t atom);
+
 purc_variant_t
 pcintr_get_symbolized_var (pcintr_stack_t stack, unsigned int number,
         char symbol);
 
 purc_variant_t
 pcintr_find_anchor_symbolized_var(pcintr_stack_t stack, const char *anchor,
-        char symbol);
+        size_t anchor_len, char symbol);
 
 int
 pcintr_unbind_named_var(pcintr_stack_t stack, const char *name);
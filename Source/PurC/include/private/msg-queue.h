@@ -29,7 +29,12 @@
 
 #include "config.h"
 
+#ifdef __cplusplus
+#include <atomic>
+using std::atomic_uint;
+#else
 #include <stdatomic.h>
+#endif
 
 #include "private/list.h"
 #include "purc-pcrdr.h"
@@ -44,6 +49,8 @@ struct pcinst_msg_hdr {
     struct list_head        ln;
 };
 
+struct pchash_table;
+
 struct pcinst_msg_queue {
     struct purc_rwlock  lock;
     struct list_head    req_msgs;
@@ -51,8 +58,18 @@ struct pcinst_msg_queue {
     struct list_head    event_msgs;
     struct list_head    void_msgs;
 
+    /* the queued events indexed by target, element, and event name */
+    struct pchash_table *event_index;
+    /* the queued events indexed by request id, element, and event name */
+    struct pchash_table *event_req_index;
+
     uint64_t            state;
     size_t              nr_msgs;
+
+    /* the number of events overlaid on the queued ones */
+    size_t              nr_reduced_events;
+    /* the number of events ignored for the queued ones */
+    size_t              nr_dropped_events;
 };
 
 /* Make sure the size of `struct list_head` is two times of sizeof(void *) */
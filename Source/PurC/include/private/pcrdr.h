@@ -60,6 +60,9 @@ struct renderer_capabilities {
        0 for not supported, -1 for unlimited */
     long int    plainWindow;
 
+    /* the version of the binary message format if supported, else 0 */
+    long int    binaryMessage;
+
     /* the session handle */
     uint64_t    session_handle;
     /* the default workspace handle */
@@ -76,6 +79,38 @@ pcrdr_parse_renderer_capabilities(const char *data) WTF_INTERNAL;
 void pcrdr_release_renderer_capabilities(
         struct renderer_capabilities *rdr_caps) WTF_INTERNAL;
 
+/*
+ * The receive pool of the packets of a connection; see pcrdr/packet.c.
+ * A packet is referred to by the pointer to its contents, and it is
+ * referenced by the messages parsed from it in place.
+ */
+struct pcrdr_packet_pool;
+
+struct pcrdr_packet_pool *pcrdr_packet_pool_new(void);
+void pcrdr_packet_pool_delete(struct pcrdr_packet_pool *pool);
+
+/* get a packet buffer which can hold at least sz bytes */
+char *pcrdr_packet_get(struct pcrdr_packet_pool *pool, size_t sz);
+char *pcrdr_packet_ref(char *packet);
+void pcrdr_packet_unref(char *packet);
+
+/*
+ * Release the reference of the packet held by a message; the strings
+ * parsed in place keep the packet alive until they are released.
+ */
+void pcrdr_message_detach_packet(pcrdr_msg *msg) WTF_INTERNAL;
+
+/* the number of packet buffers allocated by the pool so far */
+size_t pcrdr_packet_pool_allocated(struct pcrdr_packet_pool *pool);
+
+/*
+ * Parse a text packet got from pcrdr_packet_get() in place:
+ * the string fields of the message refer to the packet, and the message
+ * holds a reference of the packet until it is released.
+ */
+int pcrdr_parse_packet_in_place(char *packet, size_t sz_packet,
+        pcrdr_msg **msg);
+
 static inline purc_atom_t
 pcrdr_check_operation(const char *op)
 {
@@ -43,7 +43,6 @@
 
 struct tkz_reader;
 struct tkz_uc {
-    struct list_head list;
     uint32_t character;
     int line;
     int column;
@@ -241,7 +240,16 @@ is_context_variable(uint32_t c)
     return false;
 }
 
-// tokenizer reader
+/*
+ * tokenizer reader
+ *
+ * The reader reads the stream in blocks of up to 4KB ahead of the
+ * characters decoded. When the tokenizer stops before the end of the
+ * stream, call tkz_reader_give_back() to seek the stream back to the
+ * stop point. This only works for a seekable stream; with a stream not
+ * seekable (e.g., one created by purc_rwstream_new_for_read()), the bytes
+ * read ahead are consumed and lost for the caller.
+ */
 struct tkz_reader *tkz_reader_new(void);
 
 void tkz_reader_set_rwstream(struct tkz_reader *reader, purc_rwstream_t rws);
@@ -250,6 +258,9 @@ struct tkz_uc *tkz_reader_next_char(struct tkz_reader *reader);
 
 bool tkz_reader_reconsume_last_char(struct tkz_reader *reader);
 
+/* seeks the stream back over the bytes read ahead but not decoded yet */
+void tkz_reader_give_back(struct tkz_reader *reader);
+
 void tkz_reader_destroy(struct tkz_reader *reader);
 
 
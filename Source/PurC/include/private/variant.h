@@ -40,6 +40,8 @@ PCA_EXTERN_C_BEGIN
 #define PCVARIANT_FLAG_NOFREE          PCVARIANT_FLAG_CONSTANT
 #define PCVARIANT_FLAG_EXTRA_SIZE      (0x01 << 1)  // when use extra space
 #define PCVARIANT_FLAG_STRING_STATIC   (0x01 << 2)  // make_string_static
+#define PCVARIANT_FLAG_IN_TRANSIT      (0x01 << 3)  // handed over directly
+#define PCVARIANT_FLAG_STRING_PACKET   (0x01 << 4)  // static string in a packet
 
 #define PVT(t)          (PURC_VARIANT_TYPE##t)
 #define IS_CONTAINER(t) (t == PURC_VARIANT_TYPE_OBJECT || \
@@ -222,6 +224,13 @@ purc_variant *pcvariant_alloc(void) WTF_INTERNAL;
 purc_variant *pcvariant_alloc_0(void) WTF_INTERNAL;
 void pcvariant_free(purc_variant *v) WTF_INTERNAL;
 
+// make a static string referring to the contents of a pooled packet; the
+// variant holds a reference to the packet (see pcrdr/packet.c) until it is
+// released, and `extra_data` stores the packet instead of the characters.
+purc_variant_t
+pcvariant_make_string_in_packet(char *packet, const char *str_utf8,
+        bool check_encoding) WTF_INTERNAL;
+
 struct pcinst;
 
 struct pcvar_rev_update_edge {
@@ -230,7 +239,8 @@ struct pcvar_rev_update_edge {
         // where to locate in parent
         struct set_node             *set_me;
         struct obj_node             *obj_me;
-        struct arr_node             *arr_me;
+        // the members of an array have no fixed address: the array itself
+        purc_variant_t               arr_me;
     };
 };
 
@@ -238,10 +248,10 @@ struct pcvar_rev_update_edge {
 typedef struct variant_set      *variant_set_t;
 
 struct set_node {
-    struct rb_node                       rbnode;
     struct pcutils_array_list_node       alnode;
     purc_variant_t   val;  // actual variant-element
-    char             md5[33];
+    uint64_t         hash; // see pcvariant_hash_by_set
+    size_t           sorted_idx; // position in variant_set::sorted
 };
 
 struct variant_set {
@@ -249,10 +259,23 @@ struct variant_set {
     const char            **keynames;
     size_t                  nr_keynames;
     bool                    caseless;
-    struct rb_root          elems;  // multiple-variant-elements stored in set
     struct pcutils_array_list al;    // struct set_node
 
-    // key: arr_node/obj_node/set_node
+    // open-addressing hash index with linear probing, keyed by hash;
+    // sz_index is zero or a power of 2
+    struct set_node       **index;
+    size_t                  sz_index;
+
+    // elements sorted by the unique keys unless unsorted is set, in which
+    // case they are sorted on the next ordered access. The removed ones
+    // leave holes (NULL) in sorted[0, nr_sorted) until the next ordered
+    // access; the buffer always has room for all elements.
+    struct set_node       **sorted;
+    size_t                  nr_sorted;
+    size_t                  sz_sorted;
+    bool                    unsorted;
+
+    // key: arr/obj_node/set_node
     // val: parent
     pcutils_map                     *rev_update_chain;
 };
@@ -261,16 +284,29 @@ struct variant_set {
 typedef struct variant_obj      *variant_obj_t;
 
 struct obj_node {
-    struct rb_node   node;
     purc_variant_t   key;
     purc_variant_t   val;
+    uint32_t         hash; // hash of the key string
+    size_t           idx;  // position in variant_obj::nodes
 };
 
 struct variant_obj {
-    struct rb_root          kvs;  // struct obj_node*
+    // the members; sorted by the key unless unsorted is set, in which
+    // case they are sorted on the next ordered access. The removed ones
+    // leave holes (NULL) in nodes[0, nr_slots) until the next ordered
+    // access; size is the number of the members.
+    struct obj_node       **nodes;
     size_t                  size;
+    size_t                  nr_slots;
+    size_t                  sz_nodes;
+    bool                    unsorted;
 
-    // key: arr_node/obj_node/set_node
+    // open-addressing hash index with linear probing, keyed by hash;
+    // only built for objects with more than a few members
+    struct obj_node       **index;
+    size_t                  sz_index;
+
+    // key: arr/obj_node/set_node
     // val: parent
     pcutils_map                     *rev_update_chain;
 };
@@ -278,15 +314,15 @@ struct variant_obj {
 // internal struct used by variant-arr
 typedef struct variant_arr      *variant_arr_t;
 
-struct arr_node {
-    struct pcutils_array_list_node       node;
-    purc_variant_t   val;
-};
-
 struct variant_arr {
-    struct pcutils_array_list     al;  // struct arr_node*
-
-    // key: arr_node/obj_node/set_node
+    // the members are stored contiguously in vals[head, head + nr);
+    // the room kept before head makes prepending as cheap as appending
+    purc_variant_t         *vals;
+    size_t                  head;
+    size_t                  nr;
+    size_t                  sz_vals;
+
+    // key: arr/obj_node/set_node
     // val: parent
     pcutils_map                     *rev_update_chain;
 };
@@ -300,6 +336,30 @@ int pcvariant_array_sort(purc_variant_t value, void *ud,
 int pcvariant_set_sort(purc_variant_t value, void *ud,
         int (*cmp)(purc_variant_t l, purc_variant_t r, void *ud));
 
+/* A key to sort the members of an array or a set by. */
+struct pcvariant_sort_key {
+    /* the property of the object members; NULL for the members themselves */
+    const char             *name;
+    /* one of PCVARIANT_COMPARE_OPT_AUTO, _NUMBER, _CASE, and _CASELESS.
+       With _AUTO, the values are compared as numbers only if all the
+       values of the key are numbers, and as strings otherwise; unlike
+       purc_variant_compare_ex(), which decides by the type of the left
+       operand in each comparison, this gives one consistent order for
+       the containers mixing numbers and other values. */
+    purc_vrtcmp_opt_t       opt;
+    bool                    desc;
+};
+
+/*
+ * Sort the members by the keys extracted once per member, instead of
+ * comparing the variants directly. The sort is stable, and it runs in
+ * multiple threads for large containers.
+ */
+int pcvariant_array_sort_by_keys(purc_variant_t value,
+        const struct pcvariant_sort_key *keys, size_t nr_keys);
+int pcvariant_set_sort_by_keys(purc_variant_t value,
+        const struct pcvariant_sort_key *keys, size_t nr_keys);
+
 int pcvariant_diff(purc_variant_t l, purc_variant_t r);
 int pcvariant_diff_ex(purc_variant_t l, purc_variant_t r,
         enum purc_variant_compare_opt opt);
@@ -428,14 +488,22 @@ pcvariant_md5(char *md5, purc_variant_t val)
     pcvariant_md5_ex(md5, val, salt, caseless, serialize_flags);
 }
 
-// md5 shall be at least 33 bytes long
-void
-pcvariant_md5_by_set(char *md5, purc_variant_t val,
-        purc_variant_t set) WTF_INTERNAL;
+// the hash of the unique keys of val, consistent with the member equality
+uint64_t
+pcvariant_hash_by_set(purc_variant_t val, purc_variant_t set) WTF_INTERNAL;
+
+// the elements of set sorted by the unique keys; nr receives the count
+struct set_node **
+pcvar_set_get_sorted(purc_variant_t set, size_t *nr) WTF_INTERNAL;
 
-int
-pcvariant_diff_by_set(const char *md5l, purc_variant_t l,
-        const char *md5r, purc_variant_t r, purc_variant_t set);
+// the members of obj sorted by the key; nr receives the count
+struct obj_node **
+pcvar_obj_get_sorted(purc_variant_t obj, size_t *nr) WTF_INTERNAL;
+
+// the slots of obj as they are, including the holes (NULL) left by the
+// removed members; nr receives the number of the slots
+struct obj_node **
+pcvar_obj_get_slots(purc_variant_t obj, size_t *nr) WTF_INTERNAL;
 
 PCA_EXTERN_C_END
 
@@ -450,109 +518,101 @@ PCA_EXTERN_C_END
 
 // purc_variant_t _arr;
 #define variant_array_get_data(_arr)        \
-    &(((variant_arr_t)_arr->sz_ptr[1])->al)
-
-// purc_variant_t _arr;
-// struct arr_node *_p;
-#define foreach_in_variant_array(_arr, _p)                               \
-    array_list_for_each_entry(variant_array_get_data(_arr),              \
-            _p, node)
-
-// purc_variant_t _arr;
-// struct arr_node *_p, *_n;
-#define foreach_in_variant_array_safe(_arr, _p, _n)                      \
-    array_list_for_each_entry_safe(variant_array_get_data(_arr),         \
-            _p, _n, node)
-
-// purc_variant_t _arr;
-// struct arr_node *_p;
-#define foreach_in_variant_array_reverse(_arr, _p)                       \
-    array_list_for_each_entry_reverse(variant_array_get_data(_arr),      \
-            _p, node)
+    ((variant_arr_t)_arr->sz_ptr[1])
 
 // purc_variant_t _arr;
-// struct arr_node *_p, *_n;
-#define foreach_in_variant_array_reverse_safe(_arr, _p, _n)              \
-    array_list_for_each_entry_reverse_safe(variant_array_get_data(_arr), \
-            _p, _n, node)
+// size_t _idx;
+#define variant_array_member(_arr, _idx)                                \
+    (variant_array_get_data(_arr)->vals[                                \
+            variant_array_get_data(_arr)->head + (_idx)])
 
+// purc_variant_t _arr, _val;
+// size_t _idx;
 #define foreach_value_in_variant_array(_arr, _val, _idx)              \
     do {                                                              \
-        struct arr_node *_p;                                          \
-        foreach_in_variant_array(_arr, _p) {                          \
-            _val = _p->val;                                           \
-            _idx = _p->node.idx;                                      \
+        variant_arr_t _d = variant_array_get_data(_arr);              \
+        size_t _i;                                                    \
+        for (_i = 0;                                                  \
+            _i < _d->nr &&                                            \
+            ({ _val = _d->vals[_d->head + _i]; _idx = _i; 1; });      \
+            _i++)                                                     \
+        {                                                             \
      /* } */                                                          \
  /* } while (0) */
 
-#define foreach_value_in_variant_array_safe(_arr, _val, _idx)      \
-    do {                                                           \
-        struct arr_node *_p, *_n;                                  \
-        foreach_in_variant_array_safe(_arr, _p, _n) {              \
-            _val = _p->val;                                        \
-            _idx = _p->node.idx;                                   \
-     /* } */                                                       \
+// the current member can be removed in the body
+#define foreach_value_in_variant_array_safe(_arr, _val, _idx)         \
+    do {                                                              \
+        variant_arr_t _d = variant_array_get_data(_arr);              \
+        size_t _i, _nr;                                               \
+        for (_i = 0;                                                  \
+            _i < _d->nr &&                                            \
+            ({ _nr = _d->nr; _val = _d->vals[_d->head + _i];          \
+               _idx = _i; 1; });                                      \
+            _i += (_d->nr < _nr) ? 0 : 1)                             \
+        {                                                             \
+     /* } */                                                          \
  /* } while (0) */
 
 #define foreach_value_in_variant_array_reverse(_arr, _val, _idx)      \
     do {                                                              \
-        struct arr_node *_p;                                          \
-        foreach_in_variant_array_reverse(_arr, _p) {                  \
-            _val = _p->val;                                           \
-            _idx = _p->node.idx;                                      \
+        variant_arr_t _d = variant_array_get_data(_arr);              \
+        size_t _i;                                                    \
+        for (_i = _d->nr;                                             \
+            _i > 0 && _i <= _d->nr &&                                 \
+            ({ _val = _d->vals[_d->head + _i - 1]; _idx = _i - 1; 1; }); \
+            _i--)                                                     \
+        {                                                             \
      /* } */                                                          \
  /* } while (0) */
 
-#define foreach_value_in_variant_array_reverse_safe(_arr, _val, _idx)   \
-    do {                                                                \
-        struct arr_node *_p, *_n;                                       \
-        foreach_in_variant_array_reverse_safe(_arr, _p, _n) {           \
-            _val = _p->val;                                             \
-            _idx = _p->node.idx;                                        \
-     /* } */                                                            \
- /* } while (0) */
+// removing the current member does not move the ones before it
+#define foreach_value_in_variant_array_reverse_safe(_arr, _val, _idx) \
+    foreach_value_in_variant_array_reverse(_arr, _val, _idx)
 
 #define foreach_value_in_variant_object(_obj, _val)                 \
     do {                                                            \
-        variant_obj_t _data;                                        \
-        _data = (variant_obj_t)_obj->sz_ptr[1];                     \
-        struct rb_root *_root = &_data->kvs;                        \
-        struct rb_node *_p = pcutils_rbtree_first(_root);           \
-        for (; _p; _p = pcutils_rbtree_next(_p))                    \
+        struct obj_node **_nodes;                                   \
+        size_t _nr, _i;                                             \
+        for (_i = 0;                                                \
+            ({_nodes = pcvar_obj_get_sorted(_obj, &_nr); _i < _nr;}); \
+            _i++)                                                   \
         {                                                           \
-            struct obj_node *_node;                                 \
-            _node = container_of(_p, struct obj_node, node);        \
+            struct obj_node *_node = _nodes[_i];                    \
             _val = _node->val;                                      \
      /* } */                                                        \
  /* } while (0) */
 
 #define foreach_key_value_in_variant_object(_obj, _key, _val)       \
     do {                                                            \
-        variant_obj_t _data;                                        \
-        _data = (variant_obj_t)_obj->sz_ptr[1];                     \
-        struct rb_root *_root = &_data->kvs;                        \
-        struct rb_node *_p = pcutils_rbtree_first(_root);           \
-        for (; _p; _p = pcutils_rbtree_next(_p))                    \
+        struct obj_node **_nodes;                                   \
+        size_t _nr, _i;                                             \
+        for (_i = 0;                                                \
+            ({_nodes = pcvar_obj_get_sorted(_obj, &_nr); _i < _nr;}); \
+            _i++)                                                   \
         {                                                           \
-            struct obj_node *_node;                                 \
-            _node = container_of(_p, struct obj_node, node);        \
+            struct obj_node *_node = _nodes[_i];                    \
             _key = _node->key;                                      \
             _val = _node->val;                                      \
      /* } */                                                        \
  /* } while (0) */
 
+// the loop body may remove the current member; only the members at the
+// start of the loop are visited
 #define foreach_in_variant_object_safe_x(_obj, _key, _val)          \
     do {                                                            \
-        variant_obj_t _data;                                        \
-        _data = (variant_obj_t)_obj->sz_ptr[1];                     \
-        struct rb_root *_root = &_data->kvs;                        \
-        struct rb_node *_p, *_next;                                 \
-        for (_p = pcutils_rbtree_first(_root);                      \
-            ({_next = _p ? pcutils_rbtree_next(_p) : NULL; _p;});   \
-            _p = _next)                                             \
+        struct obj_node **_nodes;                                   \
+        struct obj_node *_node, *_next;                             \
+        size_t _nr, _i, _left;                                      \
+        _nodes = pcvar_obj_get_sorted(_obj, &_left);                \
+        _next = _left ? _nodes[0] : NULL;                           \
+        for (; ({_node = _next; _next = NULL;                       \
+                 _nodes = pcvar_obj_get_slots(_obj, &_nr);          \
+                 for (_i = _node ? _node->idx + 1 : _nr;            \
+                     _i < _nr && !(_next = _nodes[_i]); _i++);      \
+                 _node && _left > 0;});                             \
+            _left--)                                                \
         {                                                           \
-            struct obj_node *_node;                                 \
-            _node = container_of(_p, struct obj_node, node);        \
             _key = _node->key;                                      \
             _val = _node->val;                                      \
      /* } */                                                        \
@@ -628,71 +688,30 @@ PCA_EXTERN_C_END
      /* } */                                                                  \
   /* } while (0) */
 
+// It is unsafe to remove the member in the loop body
 #define foreach_value_in_variant_set_order(_set, _val)                  \
     do {                                                                \
-        variant_set_t _data;                                            \
-        struct rb_node *_first;                                         \
-        _data = (variant_set_t)_set->sz_ptr[1];                         \
-        _first = pcutils_rbtree_first(&_data->elems);                   \
-        if (!_first)                                                    \
-            break;                                                      \
-        struct rb_node *_p;                                             \
-        pcutils_rbtree_for_each(_first, _p)                             \
+        struct set_node **_nodes;                                       \
+        size_t _nr, _i;                                                 \
+        for (_i = 0;                                                    \
+            ({_nodes = pcvar_set_get_sorted(_set, &_nr); _i < _nr;});   \
+            _i++)                                                       \
         {                                                               \
-            struct set_node *_sn;                                       \
-            _sn = container_of(_p, struct set_node, rbnode);            \
-            _val = _sn->val;                                            \
+            _val = _nodes[_i]->val;                                     \
      /* } */                                                            \
   /* } while (0) */
 
 #define foreach_value_in_variant_set_order_reverse(_set, _val)          \
     do {                                                                \
-        variant_set_t _data;                                            \
-        struct rb_node *_first;                                         \
-        _data = (variant_set_t)_set->sz_ptr[1];                         \
-        _first = pcutils_rbtree_last(&_data->elems);                    \
-        if (!_first)                                                    \
-            break;                                                      \
-        struct rb_node *_p;                                             \
-        pcutils_rbtree_for_each_reverse(_first, _p)                     \
+        struct set_node **_nodes;                                       \
+        size_t _nr, _i;                                                 \
+        _nodes = pcvar_set_get_sorted(_set, &_nr);                      \
+        for (_i = _nr;                                                  \
+            ({_nodes = pcvar_set_get_sorted(_set, &_nr);                \
+              _i > 0 && _i <= _nr;});                                   \
+            )                                                           \
         {                                                               \
-            struct set_node *_sn;                                       \
-            _sn = container_of(_p, struct set_node, rbnode);            \
-            _val = _sn->val;                                            \
-     /* } */                                                            \
-  /* } while (0) */
-
-#define foreach_value_in_variant_set_order_safe(_set, _val)             \
-    do {                                                                \
-        variant_set_t _data;                                            \
-        struct rb_node *_first;                                         \
-        _data = (variant_set_t)_set->sz_ptr[1];                         \
-        _first = pcutils_rbtree_first(&_data->elems);                   \
-        if (!_first)                                                    \
-            break;                                                      \
-        struct rb_node *_p, *_n;                                        \
-        pcutils_rbtree_for_each_safe(_first, _p, _n)                    \
-        {                                                               \
-            struct set_node *_sn;                                       \
-            _sn = container_of(_p, struct set_node, rbnode);            \
-            _val = _sn->val;                                            \
-     /* } */                                                            \
-  /* } while (0) */
-
-#define foreach_value_in_variant_set_order_reverse_safe(_set, _val)     \
-    do {                                                                \
-        variant_set_t _data;                                            \
-        struct rb_node *_last;                                          \
-        _data = (variant_set_t)_set->sz_ptr[1];                         \
-        _last = pcutils_rbtree_last(&_data->elems);                     \
-        if (!_last)                                                     \
-            break;                                                      \
-        struct rb_node *_p, *_n;                                        \
-        pcutils_rbtree_for_each_reverse_safe(_last, _p, _n)             \
-        {                                                               \
-            struct set_node *_sn;                                       \
-            _sn = container_of(_p, struct set_node, rbnode);            \
-            _val = _sn->val;                                            \
+            _val = _nodes[--_i]->val;                                   \
      /* } */                                                            \
   /* } while (0) */
 
@@ -66,12 +66,18 @@ enum pcvcm_node_type {
 #define PCVCM_EV_PROPERTY_VCM_EV          "vcm_ev"
 #define PCVCM_EV_PROPERTY_LAST_VALUE      "last_value"
 
+struct pcvcm_prog;
+
 struct pcvcm_node {
     struct pctree_node tree_node;
     enum pcvcm_node_type type;
     uint32_t extra;
     uintptr_t attach;
     bool is_closed;
+    /* the number of times this tree was evaluated by the tree walker */
+    uint8_t nr_evals;
+    /* the linear program compiled from this tree, if any */
+    struct pcvcm_prog *prog;
     union {
         bool        b;
         double      d;
@@ -79,6 +85,8 @@ struct pcvcm_node {
         uint64_t    u64;
         long double ld;
         uintptr_t   sz_ptr[2];
+        /* the interned literal name of a GET_VARIABLE node, or 0 */
+        purc_atom_t atom;
     };
 };
 
@@ -188,6 +196,9 @@ void pcvcm_stack_destroy(struct pcvcm_stack *stack);
 
 typedef purc_variant_t(*cb_find_var) (void *ctxt, const char *name);
 
+/* intern the literal variable names in the tree as atoms */
+void pcvcm_intern_variable_names(struct pcvcm_node *tree);
+
 purc_variant_t pcvcm_eval_ex(struct pcvcm_node *tree, cb_find_var find_var,
         void *ctxt, bool silently);
 
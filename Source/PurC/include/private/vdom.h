@@ -310,6 +310,23 @@ pcvdom_util_node_serialize(struct pcvdom_node *node,
 int
 pcvdom_util_fprintf(const char *buf, size_t len, void *ctxt);
 
+/*
+ * The binary image of a document and its VCM trees, used by the HVML
+ * loader to cache the parsed documents on disk. The image records the MD5
+ * digest of the source; loading fails if the digest or the image format
+ * does not match, and the caller should parse the source instead.
+ */
+#define PCVDOM_IMAGE_VERSION    1
+
+int
+pcvdom_document_write_image(struct pcvdom_document *doc,
+        const unsigned char *md5, purc_rwstream_t out);
+
+// md5 can be NULL to skip checking the digest
+struct pcvdom_document*
+pcvdom_document_from_image(const void *image, size_t sz,
+        const unsigned char *md5);
+
 purc_variant_t
 pcvdom_tokenwised_eval_attr(enum pchvml_attr_operator op,
         purc_variant_t l, purc_variant_t r);
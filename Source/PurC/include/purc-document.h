@@ -571,6 +571,48 @@ PCA_EXPORT int
 pcdoc_travel_descendant_elements(purc_document_t doc,
         pcdoc_element_t ancestor, pcdoc_element_cb cb, void *ctxt, size_t *n);
 
+/**
+ * Travel the descendant elements in the subtree which have the specified
+ * identifier, in document order. The elements are looked up in an index
+ * of the document which is built by the first call.
+ *
+ * @param doc: the pointer to the doc.
+ * @param ancestor (nullable): the ancestor of the subtree.
+ *      @NULL for the root element of the document.
+ * @param id: the identifier.
+ * @param cb: the callback for the element travelled.
+ * @param ctxt: the context data will be passed to the callback.
+ * @param n: the buffer to returned the number of elements travelled.
+ *
+ * Returns: 0 for all matched elements travlled, otherwise the traverse
+ * was broken by the callback or an error occurred.
+ */
+PCA_EXPORT int
+pcdoc_travel_descendant_elements_by_id(purc_document_t doc,
+        pcdoc_element_t ancestor, const char *id,
+        pcdoc_element_cb cb, void *ctxt, size_t *n);
+
+/**
+ * Travel the descendant elements in the subtree which have the specified
+ * class name, in document order. The elements are looked up in an index
+ * of the document which is built by the first call.
+ *
+ * @param doc: the pointer to the doc.
+ * @param ancestor (nullable): the ancestor of the subtree.
+ *      @NULL for the root element of the document.
+ * @param klass: the class name.
+ * @param cb: the callback for the element travelled.
+ * @param ctxt: the context data will be passed to the callback.
+ * @param n: the buffer to returned the number of elements travelled.
+ *
+ * Returns: 0 for all matched elements travlled, otherwise the traverse
+ * was broken by the callback or an error occurred.
+ */
+PCA_EXPORT int
+pcdoc_travel_descendant_elements_by_class(purc_document_t doc,
+        pcdoc_element_t ancestor, const char *klass,
+        pcdoc_element_cb cb, void *ctxt, size_t *n);
+
 typedef int (*pcdoc_text_node_cb)(purc_document_t doc,
         pcdoc_text_node_t text_node, void *ctxt);
 
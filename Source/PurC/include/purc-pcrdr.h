@@ -721,6 +721,9 @@ struct pcrdr_msg
      * The type of the value depends on `dataType` field.
      */
     purc_variant_t  data;
+
+    /* the packet referred by the variants; internal use only */
+    char           *__packet;
 };
 
 /**
@@ -747,6 +750,17 @@ pcrdr_try_operation_atom(const char *op);
 const char *
 pcrdr_operation_from_atom(purc_atom_t atom, unsigned int *id);
 
+/**
+ * Get the operation from its identifier.
+ *
+ * @param id: The identifier of the operation (one of PCRDR_K_OPERATION_*).
+ *
+ * Returns: The pointer to the operation, NULL for invalid identifier.
+ * Since: 0.1.0
+ */
+const char *
+pcrdr_operation_from_id(unsigned int id);
+
 /**
  * Make a void message.
  *
@@ -886,6 +900,67 @@ PCA_EXPORT size_t
 pcrdr_serialize_message_to_buffer(const pcrdr_msg *msg,
         void *buff, size_t sz);
 
+/** The version of the binary encoding of the messages */
+#define PCRDR_BINARY_MSG_VERSION        1
+
+/** The first byte of a binary packet; it never starts a text packet */
+#define PCRDR_BINARY_MSG_MAGIC          0xB7
+
+/** The size of the fixed-layout header of a binary packet */
+#define PCRDR_BINARY_MSG_HEADER_SIZE    40
+
+/**
+ * Check whether a packet is encoded in the binary format.
+ *
+ * @param packet: the pointer to the packet buffer.
+ * @param sz_packet: the size of the packet.
+ *
+ * Returns: @true if the packet is a binary one, otherwise @false.
+ *
+ * Since: 0.2.0
+ */
+static inline bool
+pcrdr_is_binary_packet(const void *packet, size_t sz_packet)
+{
+    return sz_packet >= PCRDR_BINARY_MSG_HEADER_SIZE &&
+        ((const unsigned char *)packet)[0] == PCRDR_BINARY_MSG_MAGIC;
+}
+
+/**
+ * Parse a binary packet and make a corresponding message.
+ *
+ * @param packet: the pointer to the packet buffer.
+ * @param sz_packet: the size of the packet.
+ * @param msg: The pointer to a pointer to return the parsed message structure.
+ *
+ * Returns: -1 for error; zero means everything is ok.
+ *
+ * Since: 0.2.0
+ */
+PCA_EXPORT int
+pcrdr_parse_binary_packet(const void *packet, size_t sz_packet,
+        pcrdr_msg **msg);
+
+/**
+ * Serialize a message in the binary format.
+ *
+ * @param msg: the pointer to the message to serialize.
+ * @param fn: the callback to write bytes.
+ * @param ctxt: the context will be passed to fn.
+ *
+ * The binary format uses a fixed-layout header, codes the operation
+ * and the element handle as integers, and prefixes the strings and the data
+ * with their lengths. Use it only if the renderer declared the capability
+ * `binaryMessage`.
+ *
+ * Returns: -1 for error; zero means everything is ok.
+ *
+ * Since: 0.2.0
+ */
+PCA_EXPORT int
+pcrdr_serialize_message_binary(const pcrdr_msg *msg,
+        pcrdr_cb_write fn, void *ctxt);
+
 /**
  * Compare two messages.
  *
@@ -1208,6 +1283,23 @@ PCA_EXPORT int
 pcrdr_purcmc_send_text_packet(pcrdr_conn* conn,
         const char *text, size_t txt_len);
 
+/**
+ * Send a binary packet to the PurCMC server.
+ *
+ * @param conn: the pointer to the renderer connection.
+ * @param data: the pointer to the data to send.
+ * @param data_len: the length to send.
+ *
+ * Sends a binary packet to the PurCMC server.
+ *
+ * Returns: -1 for error; zero means everything is ok.
+ *
+ * Since: 0.2.0
+ */
+PCA_EXPORT int
+pcrdr_purcmc_send_binary_packet(pcrdr_conn* conn,
+        const void *data, size_t data_len);
+
 /**@}*/
 
 /**
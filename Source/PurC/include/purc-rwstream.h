@@ -165,6 +165,8 @@ typedef ssize_t (*pcrws_cb_read)(void *ctxt, void *buf, size_t count);
  * that is, the new purc_rwstream_t is read-only and not seekable.
  *
  * @param ctxt: the buffer
+ * @param fn: the callback to read; it returns the number of bytes read,
+ *      0 at the end of the data, or -1 on error.
  *
  * @return A purc_rwstream_t on success, @NULL on failure and the error code
  *         is set to indicate the error. The error code:
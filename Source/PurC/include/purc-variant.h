@@ -1599,6 +1599,10 @@ purc_variant_load_from_json_file(const char* file);
  *
  * @param stream: the stream of purc_rwstream_t type
  *
+ * The stream is read in blocks. If the stream is seekable, it is left
+ * right after the last character parsed; otherwise, up to one block of
+ * the following bytes may have been consumed as well.
+ *
  * Returns: A purc_variant_t on success, or PURC_VARIANT_INVALID on failure.
  *
  * Since: 0.0.1
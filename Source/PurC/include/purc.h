@@ -353,6 +353,16 @@ purc_get_runner_variable(const char *name);
 struct pcvdom_document;
 typedef struct pcvdom_document* purc_vdom_t;
 
+/*
+ * The directory to keep the binary images of the parsed HVML programs.
+ * If this environment variable is set, the vDOM of a program loaded from
+ * a string or a file is stored in the directory, and is rebuilt from
+ * the image instead of parsing the program again next time, as long as
+ * the contents of the program do not change. The images are created
+ * readable and writable by the current user only.
+ */
+#define PURC_ENVV_VDOM_CACHE_DIR    "PURC_VDOM_CACHE_DIR"
+
 /**
  * purc_load_hvml_from_string:
  *
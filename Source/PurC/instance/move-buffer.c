@@ -32,6 +32,8 @@
 #if HAVE(STDATOMIC_H)
 
 #include "private/instance.h"
+#include "private/interpreter.h"
+#include "private/pcrdr.h"
 #include "private/list.h"
 #include "private/sorted-array.h"
 #include "private/utils.h"
@@ -39,6 +41,8 @@
 #include "private/debug.h"
 
 #include <stdatomic.h>
+#include <stddef.h>
+#include <sched.h>
 #include <assert.h>
 
 #if HAVE(GLIB)
@@ -49,19 +53,52 @@
 
 // #define PRINT_DEBUG
 
+/* the link of a message in the inbox of a move buffer */
+struct mpsc_node {
+    _Atomic(struct mpsc_node *) next;
+};
+
+/*
+ * The messages moved to an instance are pushed to the inbox of its move
+ * buffer, which is an intrusive multiple-producer single-consumer queue
+ * (by Dmitry Vyukov), without any lock. Only the owner instance pops the
+ * messages from the inbox, and links them in `msgs` for the retrieving
+ * and taking-away functions.
+ */
 struct pcinst_move_buffer {
-    struct purc_rwlock  lock;
+    /* the inbox: producers exchange `head`; the owner pops from `tail` */
+    _Atomic(struct mpsc_node *) head;
+    struct mpsc_node           *tail;
+    struct mpsc_node            stub;
+
+    /* the messages popped from the inbox; accessed by the owner only */
     struct list_head    msgs;
+    size_t              nr_drained;
+
+    /* the number of messages in the inbox and `msgs` */
+    atomic_size_t       nr_msgs;
+
+    /* referenced by the map and the lookup caches of the instances */
+    atomic_uint         refc;
+    atomic_bool         closed;
+    atomic_uint         nr_wakers;
+
+    purc_atom_t         atom;
+
+    /* the runloop of the owner; woken up when a message is moved in */
+    purc_runloop_t      runloop;
 
     unsigned int        flags;
     size_t              max_nr_msgs;
-    size_t              nr_msgs;
 };
 
 /* the header of the struct pcrdr_msg */
 struct pcrdr_msg_hdr {
     atomic_uint             owner;
-    struct list_head        ln;
+    union {
+        struct list_head    ln;
+        struct mpsc_node    node;
+    };
 };
 
 /* Make sure the size of `struct list_head` is two times of sizeof(void *) */
@@ -71,11 +108,166 @@ _COMPILE_TIME_ASSERT(onwer_atom,
         sizeof(atomic_uint) == sizeof(purc_atom_t));
 _COMPILE_TIME_ASSERT(list_head,
         sizeof(struct list_head) == (sizeof(void *) * 2));
+_COMPILE_TIME_ASSERT(mpsc_node,
+        sizeof(struct mpsc_node) <= sizeof(struct list_head));
 #undef _COMPILE_TIME_ASSERT
 
 static struct purc_rwlock      mb_lock;
 static struct sorted_array    *mb_atom2buff_map;
 
+static void mpsc_push(struct pcinst_move_buffer *mb, struct mpsc_node *node)
+{
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    struct mpsc_node *prev = atomic_exchange_explicit(&mb->head, node,
+            memory_order_acq_rel);
+    atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+/* returns NULL if the inbox is empty or a producer is in the middle of
+   pushing; in the latter case, the producer will wake up the owner later. */
+static struct mpsc_node *mpsc_pop(struct pcinst_move_buffer *mb)
+{
+    struct mpsc_node *tail = mb->tail;
+    struct mpsc_node *next = atomic_load_explicit(&tail->next,
+            memory_order_acquire);
+
+    if (tail == &mb->stub) {
+        if (next == NULL)
+            return NULL;
+        mb->tail = next;
+        tail = next;
+        next = atomic_load_explicit(&next->next, memory_order_acquire);
+    }
+
+    if (next) {
+        mb->tail = next;
+        return tail;
+    }
+
+    if (tail != atomic_load_explicit(&mb->head, memory_order_acquire))
+        return NULL;
+
+    mpsc_push(mb, &mb->stub);
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+    if (next) {
+        mb->tail = next;
+        return tail;
+    }
+
+    return NULL;
+}
+
+/* moves the messages in the inbox to `msgs`; called by the owner only */
+static size_t drain_inbox(struct pcinst_move_buffer *mb)
+{
+    struct mpsc_node *node;
+
+    while ((node = mpsc_pop(mb))) {
+        struct pcrdr_msg_hdr *hdr;
+        hdr = (struct pcrdr_msg_hdr *)
+            ((char *)node - offsetof(struct pcrdr_msg_hdr, node));
+        list_add_tail(&hdr->ln, &mb->msgs);
+        mb->nr_drained++;
+    }
+
+    return mb->nr_drained;
+}
+
+static void pcinst_grind_message(pcrdr_msg *msg);
+
+static size_t grind_messages(struct pcinst_move_buffer *mb)
+{
+    struct list_head *p, *n;
+    size_t nr = 0;
+
+    drain_inbox(mb);
+
+    list_for_each_safe(p, n, &mb->msgs) {
+        struct pcrdr_msg_hdr *hdr;
+
+        hdr = list_entry(p, struct pcrdr_msg_hdr, ln);
+        list_del(p);
+        pcinst_grind_message((pcrdr_msg *)hdr);
+        nr++;
+    }
+
+    mb->nr_drained = 0;
+    atomic_fetch_sub(&mb->nr_msgs, nr);
+    return nr;
+}
+
+/*
+ * Wakes up the owner of a move buffer. The runloop of the owner may be
+ * gone once the buffer is destroyed, so the destroyer waits for the
+ * wakers which did not see the buffer closed.
+ */
+static void wake_up_owner(struct pcinst_move_buffer *mb)
+{
+    atomic_fetch_add(&mb->nr_wakers, 1);
+    if (!atomic_load(&mb->closed))
+        pcintr_runloop_wakeup_idle(mb->runloop);
+    atomic_fetch_sub(&mb->nr_wakers, 1);
+}
+
+static struct pcinst_move_buffer *mb_ref(struct pcinst_move_buffer *mb)
+{
+    atomic_fetch_add(&mb->refc, 1);
+    return mb;
+}
+
+static void mb_unref(struct pcinst_move_buffer *mb)
+{
+    if (atomic_fetch_sub(&mb->refc, 1) == 1) {
+        /* grind the messages pushed after the buffer was destroyed */
+        grind_messages(mb);
+        free(mb);
+    }
+}
+
+/*
+ * Finds the move buffer of the specified instance. The move buffers of
+ * other instances are cached by the current instance, so the global lock
+ * is only taken for the first move to an instance.
+ * The caller should hold the returned reference until the message is pushed.
+ */
+static struct pcinst_move_buffer *
+find_move_buffer(struct pcinst *inst, purc_atom_t atom)
+{
+    struct pcinst_cached_mb *cached;
+    struct pcinst_move_buffer *mb = NULL;
+
+    cached = inst->cached_mbs + (atom % PCINST_NR_CACHED_MBS);
+    if (cached->atom == atom && cached->mb) {
+        if (!atomic_load(&cached->mb->closed))
+            return cached->mb;
+    }
+
+    purc_rwlock_reader_lock(&mb_lock);
+    if (pcutils_sorted_array_find(mb_atom2buff_map,
+                (void *)(uintptr_t)atom, (void **)&mb))
+        mb_ref(mb);
+    else
+        mb = NULL;
+    purc_rwlock_reader_unlock(&mb_lock);
+
+    if (cached->mb)
+        mb_unref(cached->mb);
+    cached->atom = atom;
+    cached->mb = mb;
+    return mb;
+}
+
+static void mvbuf_cleanup_instance(struct pcinst *inst)
+{
+    for (size_t i = 0; i < PCINST_NR_CACHED_MBS; i++) {
+        if (inst->cached_mbs[i].mb) {
+            mb_unref(inst->cached_mbs[i].mb);
+            inst->cached_mbs[i].mb = NULL;
+        }
+        inst->cached_mbs[i].atom = 0;
+    }
+}
+
 static void mvbuf_cleanup_once(void)
 {
     if (mb_lock.native_impl) {
@@ -163,6 +355,9 @@ pcinst_put_message(pcrdr_msg *msg)
         PC_DEBUG("Freeing message in %s: %p\n", __func__, msg);
 #endif                        /* }*/
 
+        if (msg->__packet)
+            pcrdr_message_detach_packet(msg);
+
         for (int i = 0; i < PCRDR_NR_MSG_VARIANTS; i++) {
             if (msg->variants[i])
                 purc_variant_unref(msg->variants[i]);
@@ -203,32 +398,33 @@ purc_inst_create_move_buffer(unsigned int flags, size_t max_msgs)
         goto done;
     }
 
-    purc_rwlock_init(&mb->lock);
-    if (mb->lock.native_impl == NULL) {
-        errcode = PURC_ERROR_BAD_SYSTEM_CALL;
-        goto done;
-    }
-
     if (pcutils_sorted_array_add(mb_atom2buff_map,
                 (void *)(uintptr_t)atom, mb) < 0) {
         errcode = PURC_ERROR_OUT_OF_MEMORY;
         goto done;
     }
 
+    atomic_init(&mb->stub.next, NULL);
+    atomic_init(&mb->head, &mb->stub);
+    mb->tail = &mb->stub;
+    list_head_init(&mb->msgs);
+    mb->nr_drained = 0;
+    atomic_init(&mb->nr_msgs, 0);
+    atomic_init(&mb->refc, 1);
+    atomic_init(&mb->closed, false);
+    atomic_init(&mb->nr_wakers, 0);
+
+    mb->atom = atom;
+    mb->runloop = purc_runloop_get_current();
     mb->flags = flags;
-    mb->nr_msgs = 0;
     mb->max_nr_msgs = (max_msgs > 0) ? max_msgs : NR_DEF_MAX_MSGS;
-    list_head_init(&mb->msgs);
+    inst->move_buffer = mb;
 
 done:
     purc_rwlock_writer_unlock(&mb_lock);
 
     if (errcode) {
         if (mb) {
-            if (mb->lock.native_impl) {
-                purc_rwlock_clear(&mb->lock);
-            }
-
             free(mb);
         }
 
@@ -253,9 +449,13 @@ pcinst_grind_message(pcrdr_msg *msg)
         PC_DEBUG("Freeing message in %s: %p\n", __func__, msg);
 #endif                        /* }*/
 
+        if (msg->__packet)
+            pcrdr_message_detach_packet(msg);
+
+        /* take the variants over, then release them */
         for (int i = 0; i < PCRDR_NR_MSG_VARIANTS; i++) {
             if (msg->variants[i])
-                purc_variant_unref(msg->variants[i]);
+                purc_variant_unref(pcvariant_move_heap_out(msg->variants[i]));
         }
 
 #if HAVE(GLIB)
@@ -290,27 +490,16 @@ purc_inst_destroy_move_buffer(void)
         goto done;
     }
 
-    struct list_head *p, *n;
-    purc_rwlock_writer_lock(&mb->lock);
-    pcvariant_use_move_heap();
-    list_for_each_safe(p, n, &mb->msgs) {
-
-        struct pcrdr_msg_hdr *hdr;
-
-        hdr = list_entry(p, struct pcrdr_msg_hdr, ln);
+    pcutils_sorted_array_remove(mb_atom2buff_map, (void *)(uintptr_t)atom);
+    inst->move_buffer = NULL;
 
-        list_del(p);
-        mb->nr_msgs--;
+    /* the instances which cached the buffer will find it closed */
+    atomic_store(&mb->closed, true);
+    while (atomic_load(&mb->nr_wakers) > 0)
+        sched_yield();
 
-        pcinst_grind_message((pcrdr_msg *)hdr);
-        nr++;
-    }
-    pcvariant_use_norm_heap();
-    purc_rwlock_writer_unlock(&mb->lock);
-
-    pcutils_sorted_array_remove(mb_atom2buff_map, (void *)(uintptr_t)atom);
-    purc_rwlock_clear(&mb->lock);
-    free(mb);
+    nr = grind_messages(mb);
+    mb_unref(mb);
 
 done:
     purc_rwlock_writer_unlock(&mb_lock);
@@ -330,9 +519,21 @@ do_move_message(struct pcinst* inst, pcrdr_msg *msg)
 
     if (atomic_compare_exchange_strong(&hdr->owner, &inst->endpoint_atom, 0)) {
 
+        /* the packet belongs to a connection of the current instance */
+        if (msg->__packet)
+            pcrdr_message_detach_packet(msg);
+
         for (int i = 0; i < PCRDR_NR_MSG_VARIANTS; i++) {
-            if (msg->variants[i])
-                msg->variants[i] = pcvariant_move_heap_in(msg->variants[i]);
+            if (msg->variants[i]) {
+                purc_variant_t v = pcvariant_move_heap_in(msg->variants[i]);
+                if (v == PURC_VARIANT_INVALID) {
+                    /* the variant is left untouched in our heap */
+                    PC_ERROR("Failed to move variant %d of message %p\n",
+                            i, msg);
+                    purc_variant_unref(msg->variants[i]);
+                }
+                msg->variants[i] = v;
+            }
         }
     }
     else {
@@ -358,6 +559,17 @@ do_take_message(struct pcinst* inst, pcrdr_msg *msg)
     }
 }
 
+/* reserves a room in the move buffer for a message */
+static bool reserve_room(struct pcinst_move_buffer *mb)
+{
+    if (atomic_fetch_add(&mb->nr_msgs, 1) >= mb->max_nr_msgs) {
+        atomic_fetch_sub(&mb->nr_msgs, 1);
+        return false;
+    }
+
+    return true;
+}
+
 size_t
 purc_inst_move_message(purc_atom_t inst_to, pcrdr_msg *msg)
 {
@@ -375,37 +587,34 @@ purc_inst_move_message(purc_atom_t inst_to, pcrdr_msg *msg)
         return 0;
     }
 
-    purc_rwlock_reader_lock(&mb_lock);
-
     if (inst_to != (purc_atom_t)PURC_EVENT_TARGET_BROADCAST) {
-        if (!pcutils_sorted_array_find(mb_atom2buff_map,
-                    (void *)(uintptr_t)inst_to, (void **)&mb)) {
+        if ((mb = find_move_buffer(inst, inst_to)) == NULL) {
             errcode = PURC_ERROR_NOT_EXISTS;
             goto done;
         }
 
-        if (mb->nr_msgs >= mb->max_nr_msgs) {
+        if (!reserve_room(mb)) {
             errcode = PURC_ERROR_TOO_SMALL_BUFF;
             goto done;
         }
 
         do_move_message(inst, msg);
 
-        purc_rwlock_writer_lock(&mb->lock);
         struct pcrdr_msg_hdr *hdr = (struct pcrdr_msg_hdr *)msg;
-        list_add_tail(&hdr->ln, &mb->msgs);
-        mb->nr_msgs++;
-        purc_rwlock_writer_unlock(&mb->lock);
+        mpsc_push(mb, &hdr->node);
 
+        wake_up_owner(mb);
         nr++;
     }
     else {
+        purc_rwlock_reader_lock(&mb_lock);
+
         size_t count = pcutils_sorted_array_count(mb_atom2buff_map);
 
         for (size_t i = 0; i < count; i++) {
             pcutils_sorted_array_get(mb_atom2buff_map, i, (void **)&mb);
             if (mb->flags & PCINST_MOVE_BUFFER_BROADCAST &&
-                    mb->nr_msgs < mb->max_nr_msgs) {
+                    reserve_room(mb)) {
 
                 pcrdr_msg *my_msg;
 
@@ -423,21 +632,23 @@ purc_inst_move_message(purc_atom_t inst_to, pcrdr_msg *msg)
                         pcrdr_release_message(my_msg);
                     }
                     else {
+                        atomic_fetch_sub(&mb->nr_msgs, 1);
                         PC_ERROR("failed to clone message to broadcast: %p\n",
                                 msg);
                         break;
                     }
                 }
 
-                purc_rwlock_writer_lock(&mb->lock);
                 struct pcrdr_msg_hdr *hdr = (struct pcrdr_msg_hdr *)my_msg;
-                list_add_tail(&hdr->ln, &mb->msgs);
-                mb->nr_msgs++;
-                purc_rwlock_writer_unlock(&mb->lock);
+                mpsc_push(mb, &hdr->node);
+
+                wake_up_owner(mb);
                 nr++;
             }
         }
 
+        purc_rwlock_reader_unlock(&mb_lock);
+
         // FIXME:
         if (msg) {
             pcrdr_release_message(msg);
@@ -445,8 +656,6 @@ purc_inst_move_message(purc_atom_t inst_to, pcrdr_msg *msg)
     }
 
 done:
-    purc_rwlock_reader_unlock(&mb_lock);
-
     if (errcode) {
         purc_set_error(errcode);
     }
@@ -463,28 +672,14 @@ purc_inst_holding_messages_count(size_t *nr)
         return PURC_ERROR_NO_INSTANCE;
     }
 
-    int errcode = 0;
-    struct pcinst_move_buffer *mb;
-
-    purc_rwlock_reader_lock(&mb_lock);
-
-    if (!pcutils_sorted_array_find(mb_atom2buff_map,
-                (void *)(uintptr_t)inst->endpoint_atom, (void **)&mb)) {
-        errcode = PURC_ERROR_NOT_EXISTS;
-        goto done;
-    }
-
-    /* no need to lock the buffer */
-    *nr = mb->nr_msgs;
-
-done:
-    purc_rwlock_reader_unlock(&mb_lock);
-
-    if (errcode) {
-        purc_set_error(errcode);
+    struct pcinst_move_buffer *mb = inst->move_buffer;
+    if (mb == NULL) {
+        purc_set_error(PURC_ERROR_NOT_EXISTS);
+        return PURC_ERROR_NOT_EXISTS;
     }
 
-    return errcode;
+    *nr = drain_inbox(mb);
+    return 0;
 }
 
 const pcrdr_msg *
@@ -494,20 +689,14 @@ purc_inst_retrieve_message(size_t index)
     if (inst == NULL)
         return NULL;
 
-    int errcode = 0;
     const pcrdr_msg *msg = NULL;
-    struct pcinst_move_buffer *mb;
-
-    purc_rwlock_reader_lock(&mb_lock);
-
-    if (!pcutils_sorted_array_find(mb_atom2buff_map,
-                (void *)(uintptr_t)inst->endpoint_atom, (void **)&mb)) {
-        errcode = PURC_ERROR_NOT_EXISTS;
-        goto done;
+    struct pcinst_move_buffer *mb = inst->move_buffer;
+    if (mb == NULL) {
+        purc_set_error(PURC_ERROR_NOT_EXISTS);
+        return NULL;
     }
 
-    purc_rwlock_reader_lock(&mb->lock);
-    if (index < mb->nr_msgs) {
+    if (index < drain_inbox(mb)) {
         struct list_head *p;
         struct pcrdr_msg_hdr *hdr;
         size_t i = 0;
@@ -522,14 +711,6 @@ purc_inst_retrieve_message(size_t index)
             i++;
         }
     }
-    purc_rwlock_reader_unlock(&mb->lock);
-
-done:
-    purc_rwlock_reader_unlock(&mb_lock);
-
-    if (errcode) {
-        purc_set_error(errcode);
-    }
 
     return msg;
 }
@@ -543,20 +724,14 @@ purc_inst_take_away_message(size_t index)
         return NULL;
     }
 
-    int errcode = 0;
     pcrdr_msg *msg = NULL;
-    struct pcinst_move_buffer *mb;
-
-    purc_rwlock_reader_lock(&mb_lock);
-
-    if (!pcutils_sorted_array_find(mb_atom2buff_map,
-                (void *)(uintptr_t)inst->endpoint_atom, (void **)&mb)) {
-        errcode = PURC_ERROR_NOT_EXISTS;
-        goto done;
+    struct pcinst_move_buffer *mb = inst->move_buffer;
+    if (mb == NULL) {
+        purc_set_error(PURC_ERROR_NOT_EXISTS);
+        return NULL;
     }
 
-    purc_rwlock_writer_lock(&mb->lock);
-    if (index < mb->nr_msgs) {
+    if (index < drain_inbox(mb)) {
         struct list_head *p, *n;
         struct pcrdr_msg_hdr *hdr;
         size_t i = 0;
@@ -567,7 +742,8 @@ purc_inst_take_away_message(size_t index)
                 msg = (pcrdr_msg *)hdr;
                 list_del(p);
                 hdr->ln.next = hdr->ln.prev = NULL; /* mark as not linked */
-                mb->nr_msgs--;
+                mb->nr_drained--;
+                atomic_fetch_sub(&mb->nr_msgs, 1);
                 break;
             }
 
@@ -575,23 +751,23 @@ purc_inst_take_away_message(size_t index)
         }
     }
     else {
-        errcode = PURC_ERROR_NOT_EXISTS;
+        purc_set_error(PURC_ERROR_NOT_EXISTS);
     }
-    purc_rwlock_writer_unlock(&mb->lock);
 
     if (msg)
         do_take_message(inst, msg);
 
-done:
-    purc_rwlock_reader_unlock(&mb_lock);
-
-    if (errcode) {
-        purc_set_error(errcode);
-    }
-
     return msg;
 }
 
+static int mvbuf_init_instance(struct pcinst *curr_inst,
+        const purc_instance_extra_info* extra_info)
+{
+    UNUSED_PARAM(curr_inst);
+    UNUSED_PARAM(extra_info);
+    return 0;
+}
+
 #else   /* HAVE(STDATOMIC_H) */
 
 #if HAVE(GLIB)
@@ -604,6 +780,19 @@ static int mvbuf_init_once(void)
     return 0;
 }
 
+static int mvbuf_init_instance(struct pcinst *curr_inst,
+        const purc_instance_extra_info* extra_info)
+{
+    UNUSED_PARAM(curr_inst);
+    UNUSED_PARAM(extra_info);
+    return 0;
+}
+
+static void mvbuf_cleanup_instance(struct pcinst *curr_inst)
+{
+    UNUSED_PARAM(curr_inst);
+}
+
 int
 purc_inst_create_move_buffer(unsigned int flags, size_t max_msgs)
 {
@@ -632,6 +821,9 @@ pcinst_get_message(void)
 void
 pcinst_put_message(pcrdr_msg *msg)
 {
+    if (msg->__packet)
+        pcrdr_message_detach_packet(msg);
+
 #if HAVE(GLIB)
     g_slice_free1(sizeof(pcrdr_msg), (gpointer)msg);
 #else
@@ -674,10 +866,11 @@ purc_inst_take_away_message(size_t index)
 #endif  /* !HAVE(STDATOMIC_H) */
 
 struct pcmodule _module_mvbuf = {
-    .id              = PURC_HAVE_VARIANT,
-    .module_inited   = 0,
+    .id                 = PURC_HAVE_VARIANT,
+    .module_inited      = 0,
 
-    .init_once       = mvbuf_init_once,
-    .init_instance   = NULL,
+    .init_once          = mvbuf_init_once,
+    .init_instance      = mvbuf_init_instance,
+    .cleanup_instance   = mvbuf_cleanup_instance,
 };
 
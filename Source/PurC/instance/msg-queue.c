@@ -27,21 +27,266 @@
 
 #include "private/errors.h"
 #include "private/instance.h"
+#include "private/interpreter.h"
 #include "private/utils.h"
 #include "private/variant.h"
+#include "private/hashtable.h"
 #include "private/msg-queue.h"
 
 #if HAVE(GLIB)
     #include <gmodule.h>
 #endif
 
+bool
+is_event_match(pcrdr_msg *left, pcrdr_msg *right)
+{
+    if ((left->target == right->target) &&
+            (left->targetValue == right->targetValue) &&
+            (purc_variant_is_equal_to(left->eventName, right->eventName)) &&
+            (purc_variant_is_equal_to(left->elementValue, right->elementValue))
+            ) {
+        return true;
+    }
+    return false;
+}
+
+/* the queued events having the same key, in the order of the queue */
+struct event_slot {
+    pcrdr_msg     **msgs;
+    size_t          first;
+    size_t          nr;
+    size_t          sz;
+};
+
+#define SLOT_FIRST(slot)        ((slot)->msgs[(slot)->first])
+#define SLOT_MIN_SIZE           4
+
+static unsigned long
+hash_variant(unsigned long h, purc_variant_t v)
+{
+    if (v == PURC_VARIANT_INVALID)
+        return h * 31;
+
+    /* the values of different types are never equal */
+    h = h * 31 + v->type;
+    switch (v->type) {
+    case PURC_VARIANT_TYPE_STRING:
+    case PURC_VARIANT_TYPE_ATOMSTRING:
+        h = h * 31 + pchash_perllike_str_hash(purc_variant_get_string_const(v));
+        break;
+
+    case PURC_VARIANT_TYPE_LONGINT:
+    case PURC_VARIANT_TYPE_ULONGINT:
+        h = h * 31 + (unsigned long)v->u64;
+        break;
+
+    default:
+        /* leave the others to purc_variant_is_equal_to() */
+        break;
+    }
+
+    return h;
+}
+
+static unsigned long
+event_hash(const void *k)
+{
+    const pcrdr_msg *msg = SLOT_FIRST((const struct event_slot *)k);
+    unsigned long h = msg->target * 31 + (unsigned long)msg->targetValue;
+
+    h = hash_variant(h, msg->elementValue);
+    return hash_variant(h, msg->eventName);
+}
+
+static int
+event_equal(const void *k1, const void *k2)
+{
+    return is_event_match(SLOT_FIRST((const struct event_slot *)k1),
+            SLOT_FIRST((const struct event_slot *)k2));
+}
+
+static unsigned long
+event_req_hash(const void *k)
+{
+    const pcrdr_msg *msg = SLOT_FIRST((const struct event_slot *)k);
+    unsigned long h = hash_variant(0, msg->requestId);
+
+    h = hash_variant(h, msg->elementValue);
+    return hash_variant(h, msg->eventName);
+}
+
+static int
+event_req_equal(const void *k1, const void *k2)
+{
+    const pcrdr_msg *left = SLOT_FIRST((const struct event_slot *)k1);
+    const pcrdr_msg *right = SLOT_FIRST((const struct event_slot *)k2);
+
+    return purc_variant_is_equal_to(left->requestId, right->requestId) &&
+        purc_variant_is_equal_to(left->elementValue, right->elementValue) &&
+        purc_variant_is_equal_to(left->eventName, right->eventName);
+}
+
+static void
+free_slot(struct pchash_entry *e)
+{
+    struct event_slot *slot = pchash_entry_v(e);
+    free(slot->msgs);
+    free(slot);
+}
+
+static int
+slot_push(struct event_slot *slot, pcrdr_msg *msg, bool tail)
+{
+    if (tail && slot->first + slot->nr == slot->sz && slot->first > 0) {
+        memmove(slot->msgs, slot->msgs + slot->first,
+                sizeof(pcrdr_msg *) * slot->nr);
+        slot->first = 0;
+    }
+    else if (!tail && slot->first == 0 && slot->nr < slot->sz) {
+        memmove(slot->msgs + 1, slot->msgs, sizeof(pcrdr_msg *) * slot->nr);
+        slot->first = 1;
+    }
+
+    if (slot->nr == slot->sz) {
+        size_t sz = slot->sz ? slot->sz * 2 : SLOT_MIN_SIZE;
+        pcrdr_msg **msgs = malloc(sizeof(pcrdr_msg *) * sz);
+        if (msgs == NULL)
+            return -1;
+
+        /* leave a room at the head for prepending */
+        size_t first = tail ? 0 : 1;
+        if (slot->nr)
+            memcpy(msgs + first, slot->msgs + slot->first,
+                    sizeof(pcrdr_msg *) * slot->nr);
+        free(slot->msgs);
+        slot->msgs = msgs;
+        slot->first = first;
+        slot->sz = sz;
+    }
+
+    if (tail) {
+        slot->msgs[slot->first + slot->nr] = msg;
+    }
+    else {
+        slot->first--;
+        slot->msgs[slot->first] = msg;
+    }
+    slot->nr++;
+    return 0;
+}
+
+static void
+slot_remove(struct event_slot *slot, pcrdr_msg *msg)
+{
+    if (SLOT_FIRST(slot) == msg) {
+        slot->first++;
+    }
+    else {
+        size_t i;
+        for (i = slot->first + 1; i < slot->first + slot->nr; i++) {
+            if (slot->msgs[i] == msg)
+                break;
+        }
+
+        if (i == slot->first + slot->nr)
+            return;
+
+        memmove(slot->msgs + i, slot->msgs + i + 1,
+                sizeof(pcrdr_msg *) * (slot->first + slot->nr - i - 1));
+    }
+
+    slot->nr--;
+}
+
+static struct pchash_entry *
+lookup_slot(struct pchash_table *index, const pcrdr_msg *msg)
+{
+    const pcrdr_msg *msgs[1] = { msg };
+    struct event_slot probe = { (pcrdr_msg **)msgs, 0, 1, 1 };
+
+    return pchash_table_lookup_entry(index, &probe);
+}
+
+static int
+index_event(struct pchash_table *index, pcrdr_msg *msg, bool tail)
+{
+    struct pchash_entry *e = lookup_slot(index, msg);
+    if (e)
+        return slot_push(pchash_entry_v(e), msg, tail);
+
+    struct event_slot *slot = calloc(1, sizeof(*slot));
+    if (slot == NULL)
+        return -1;
+
+    if (slot_push(slot, msg, true) ||
+            pchash_table_insert(index, slot, slot)) {
+        free(slot->msgs);
+        free(slot);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void
+unindex_event(struct pchash_table *index, pcrdr_msg *msg)
+{
+    struct pchash_entry *e = lookup_slot(index, msg);
+    if (e == NULL)
+        return;
+
+    struct event_slot *slot = pchash_entry_v(e);
+    slot_remove(slot, msg);
+    if (slot->nr == 0)
+        pchash_table_delete_entry(index, e);
+}
+
+/* returns the first queued event having the same key as the message */
+static pcrdr_msg *
+find_event(struct pchash_table *index, const pcrdr_msg *msg)
+{
+    struct pchash_entry *e = lookup_slot(index, msg);
+    return e ? SLOT_FIRST((struct event_slot *)pchash_entry_v(e)) : NULL;
+}
+
+static void
+add_event(struct pcinst_msg_queue *queue, pcrdr_msg *msg, bool tail)
+{
+    struct pcinst_msg_hdr *hdr = (struct pcinst_msg_hdr *)msg;
+
+    if (tail) {
+        list_add_tail(&hdr->ln, &queue->event_msgs);
+    }
+    else {
+        list_add(&hdr->ln, &queue->event_msgs);
+    }
+
+    /* a failure of indexing only stops the event from being reduced */
+    index_event(queue->event_index, msg, tail);
+    index_event(queue->event_req_index, msg, tail);
+
+    queue->state |= MSG_QS_EVENT;
+    queue->nr_msgs++;
+}
+
+static void
+remove_event(struct pcinst_msg_queue *queue, pcrdr_msg *msg)
+{
+    struct pcinst_msg_hdr *hdr = (struct pcinst_msg_hdr *)msg;
+
+    list_del(&hdr->ln);
+    unindex_event(queue->event_index, msg);
+    unindex_event(queue->event_req_index, msg);
+    queue->nr_msgs--;
+}
+
 struct pcinst_msg_queue *
 pcinst_msg_queue_create(void)
 {
     int errcode = 0;
     struct pcinst_msg_queue *queue = NULL;
 
-    if ((queue = malloc(sizeof(*queue))) == NULL) {
+    if ((queue = calloc(1, sizeof(*queue))) == NULL) {
         errcode = PURC_ERROR_OUT_OF_MEMORY;
         goto done;
     }
@@ -52,8 +297,19 @@ pcinst_msg_queue_create(void)
         goto done;
     }
 
+    queue->event_index = pchash_table_new(HASHTABLE_DEFAULT_SIZE, free_slot,
+            event_hash, event_equal);
+    queue->event_req_index = pchash_table_new(HASHTABLE_DEFAULT_SIZE,
+            free_slot, event_req_hash, event_req_equal);
+    if (queue->event_index == NULL || queue->event_req_index == NULL) {
+        errcode = PURC_ERROR_OUT_OF_MEMORY;
+        goto done;
+    }
+
     queue->state = 0;
     queue->nr_msgs = 0;
+    queue->nr_reduced_events = 0;
+    queue->nr_dropped_events = 0;
     list_head_init(&queue->req_msgs);
     list_head_init(&queue->res_msgs);
     list_head_init(&queue->event_msgs);
@@ -67,6 +323,14 @@ done:
                 purc_rwlock_clear(&queue->lock);
             }
 
+            if (queue->event_index) {
+                pchash_table_free(queue->event_index);
+            }
+
+            if (queue->event_req_index) {
+                pchash_table_free(queue->event_req_index);
+            }
+
             free(queue);
         }
 
@@ -106,59 +370,40 @@ pcinst_msg_queue_destroy(struct pcinst_msg_queue *queue)
     purc_rwlock_writer_unlock(&queue->lock);
 
     purc_rwlock_clear(&queue->lock);
+    pchash_table_free(queue->event_index);
+    pchash_table_free(queue->event_req_index);
     free(queue);
 
     return nr;
 }
 
-bool
-is_event_match(pcrdr_msg *left, pcrdr_msg *right)
-{
-    if ((left->target == right->target) &&
-            (left->targetValue == right->targetValue) &&
-            (purc_variant_is_equal_to(left->eventName, right->eventName)) &&
-            (purc_variant_is_equal_to(left->elementValue, right->elementValue))
-            ) {
-        return true;
-    }
-    return false;
-}
-
 int
 reduce_event(struct pcinst_msg_queue *queue, pcrdr_msg *msg, bool tail)
 {
-    struct pcinst_msg_hdr *hdr;
-    struct list_head *p, *n;
-    list_for_each_safe(p, n, &queue->event_msgs) {
-        hdr = list_entry(p, struct pcinst_msg_hdr, ln);
-        pcrdr_msg *orig = (pcrdr_msg*) hdr;
-        if (is_event_match(orig, msg)) {
-            if (msg->reduceOpt == PCRDR_MSG_EVENT_REDUCE_OPT_IGNORE) {
-                return 0;
-            }
-            // OVERLAY : data
-            if (orig->data) {
-                purc_variant_unref(orig->data);
-                orig->data = PURC_VARIANT_INVALID;
-            }
-            if (msg->data) {
-                orig->data = msg->data;
-                purc_variant_ref(orig->data);
-            }
-            return 0;
-        }
+    pcrdr_msg *orig = find_event(queue->event_index, msg);
+    if (orig == NULL) {
+        add_event(queue, msg, tail);
+        return 0;
     }
 
-    hdr = (struct pcinst_msg_hdr *)msg;
-    if (tail) {
-        list_add_tail(&hdr->ln, &queue->event_msgs);
+    if (msg->reduceOpt == PCRDR_MSG_EVENT_REDUCE_OPT_IGNORE) {
+        queue->nr_dropped_events++;
     }
     else {
-        list_add(&hdr->ln, &queue->event_msgs);
+        // OVERLAY : data
+        if (orig->data) {
+            purc_variant_unref(orig->data);
+            orig->data = PURC_VARIANT_INVALID;
+        }
+        if (msg->data) {
+            orig->data = msg->data;
+            purc_variant_ref(orig->data);
+        }
+        queue->nr_reduced_events++;
     }
-    queue->state |= MSG_QS_EVENT;
-    queue->nr_msgs++;
 
+    /* the queue takes the ownership of the message */
+    pcrdr_release_message(msg);
     return 0;
 }
 
@@ -189,11 +434,8 @@ pcinst_msg_queue_append(struct pcinst_msg_queue *queue, pcrdr_msg *msg)
         break;
 
     case PCRDR_MSG_TYPE_EVENT:
-        queue->state |= MSG_QS_EVENT;
         if (msg->reduceOpt == PCRDR_MSG_EVENT_REDUCE_OPT_KEEP) {
-            list_add_tail(&hdr->ln, &queue->event_msgs);
-            queue->state |= MSG_QS_EVENT;
-            queue->nr_msgs++;
+            add_event(queue, msg, true);
         }
         else {
             reduce_event(queue, msg, true);
@@ -238,11 +480,8 @@ pcinst_msg_queue_prepend(struct pcinst_msg_queue *queue, pcrdr_msg *msg)
         break;
 
     case PCRDR_MSG_TYPE_EVENT:
-        queue->state |= MSG_QS_EVENT;
         if (msg->reduceOpt == PCRDR_MSG_EVENT_REDUCE_OPT_KEEP) {
-            list_add(&hdr->ln, &queue->event_msgs);
-            queue->state |= MSG_QS_EVENT;
-            queue->nr_msgs++;
+            add_event(queue, msg, false);
         }
         else {
             reduce_event(queue, msg, false);
@@ -269,6 +508,11 @@ get_msg(struct pcinst_msg_queue *queue, struct list_head *msgs)
     struct pcinst_msg_hdr *hdr = list_first_entry(msgs,
             struct pcinst_msg_hdr, ln);
     pcrdr_msg *msg = (pcrdr_msg *)hdr;
+    if (msgs == &queue->event_msgs) {
+        remove_event(queue, msg);
+        return msg;
+    }
+
     list_del(&hdr->ln);
     queue->nr_msgs--;
     if (list_empty(msgs)) {
@@ -320,22 +564,16 @@ pcinst_msg_queue_get_event_by_element(struct pcinst_msg_queue *queue,
         purc_variant_t request_id, purc_variant_t element_value,
         purc_variant_t event_name)
 {
-    pcrdr_msg *msg = NULL;
+    pcrdr_msg probe = { 0 };
+    probe.requestId = request_id;
+    probe.elementValue = element_value;
+    probe.eventName = event_name;
+
     purc_rwlock_writer_lock(&queue->lock);
 
-    struct list_head *msgs = &queue->event_msgs;
-    struct list_head *p, *n;
-    list_for_each_safe(p, n, msgs) {
-        struct pcinst_msg_hdr *hdr;
-        hdr = list_entry(p, struct pcinst_msg_hdr, ln);
-        pcrdr_msg *m = (pcrdr_msg*) hdr;
-        if (purc_variant_is_equal_to(m->requestId, request_id) &&
-                purc_variant_is_equal_to(m->elementValue, element_value) &&
-                purc_variant_is_equal_to(m->eventName, event_name)) {
-            msg = m;
-            list_del(&hdr->ln);
-            break;
-        }
+    pcrdr_msg *msg = find_event(queue->event_req_index, &probe);
+    if (msg) {
+        remove_event(queue, msg);
     }
 
     purc_rwlock_writer_unlock(&queue->lock);
@@ -358,20 +596,18 @@ purc_inst_post_event(purc_atom_t inst_to, pcrdr_msg *msg)
         if (!heap) {
             return 0;
         }
-        struct rb_root *coroutines = &heap->coroutines;
-        struct rb_node *p, *n;
-        struct rb_node *first = pcutils_rbtree_first(coroutines);
-
         if (PURC_EVENT_TARGET_BROADCAST != msg->targetValue) {
-            pcutils_rbtree_for_each_safe(first, p, n) {
-                pcintr_coroutine_t co = container_of(p, struct pcintr_coroutine,
-                        node);
-                if (co->cid == msg->targetValue) {
-                    return pcinst_msg_queue_append(co->mq, msg);
-                }
+            pcintr_coroutine_t co = pcintr_coroutine_get_by_id(
+                    (purc_atom_t)msg->targetValue);
+            if (co) {
+                pcintr_coroutine_set_event_pending(co);
+                return pcinst_msg_queue_append(co->mq, msg);
             }
         }
         else {
+            struct rb_root *coroutines = &heap->coroutines;
+            struct rb_node *p, *n;
+            struct rb_node *first = pcutils_rbtree_first(coroutines);
             pcutils_rbtree_for_each_safe(first, p, n) {
                 pcintr_coroutine_t co = container_of(p, struct pcintr_coroutine,
                         node);
@@ -379,6 +615,7 @@ purc_inst_post_event(purc_atom_t inst_to, pcrdr_msg *msg)
                 pcrdr_msg *my_msg = pcrdr_clone_message(msg);
                 my_msg->targetValue = co->cid;
                 pcinst_msg_queue_append(co->mq, my_msg);
+                pcintr_coroutine_set_event_pending(co);
             }
             pcrdr_release_message(msg);
         }
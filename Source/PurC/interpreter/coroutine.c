@@ -146,13 +146,10 @@ pcintr_get_scoped_variables(purc_coroutine_t cor, struct pcvdom_node *node)
         return cor->variables;
     }
 
-    struct rb_node *p;
-    struct rb_node *first = pcutils_rbtree_first(&stack->scoped_variables);
-    pcutils_rbtree_for_each(first, p) {
-        pcvarmgr_t mgr = container_of(p, struct pcvarmgr, node);
-        if (mgr->vdom_node == node)
-            return mgr;
-    }
+    struct rb_node *p = pcutils_rbtree_find(&stack->scoped_variables, node,
+            cmp_f);
+    if (p)
+        return container_of(p, struct pcvarmgr, node);
 
     return NULL;
 }
@@ -212,20 +209,28 @@ purc_coroutine_identifier(purc_coroutine_t cor)
     return cor->cid;
 }
 
+int
+pcintr_coroutine_cmp_by_cid(struct rb_node *node, void *ud)
+{
+    purc_atom_t atom = *(purc_atom_t*)ud;
+    pcintr_coroutine_t co;
+    co = container_of(node, struct pcintr_coroutine, node);
+    return (atom > co->cid) - (atom < co->cid);
+}
+
 static
 pcintr_coroutine_t
 get_coroutine_by_id(struct pcinst *inst, purc_atom_t id)
 {
     struct pcintr_heap *heap = inst->intr_heap;
-    struct rb_root *coroutines = &heap->coroutines;
-    struct rb_node *p, *n;
-    struct rb_node *first = pcutils_rbtree_first(coroutines);
-    pcutils_rbtree_for_each_safe(first, p, n) {
-        pcintr_coroutine_t co = container_of(p, struct pcintr_coroutine,
-                node);
-        if (co->cid == id) {
-            return co;
-        }
+    if (!heap) {
+        return NULL;
+    }
+
+    struct rb_node *node = pcutils_rbtree_find(&heap->coroutines, &id,
+            pcintr_coroutine_cmp_by_cid);
+    if (node) {
+        return container_of(node, struct pcintr_coroutine, node);
     }
     return NULL;
 }
@@ -52,6 +52,9 @@ struct ctxt_for_update {
     pcintr_attribute_op           with_eval;
 
     purc_variant_t                literal;
+
+    /* the expansion of the template in `with` */
+    struct pcintr_template_expansion *expansion;
 };
 
 static void
@@ -65,6 +68,7 @@ ctxt_for_update_destroy(struct ctxt_for_update *ctxt)
         PURC_VARIANT_SAFE_CLEAR(ctxt->from_result);
         PURC_VARIANT_SAFE_CLEAR(ctxt->with);
         PURC_VARIANT_SAFE_CLEAR(ctxt->literal);
+        pcintr_template_expansion_release(ctxt->expansion);
         free(ctxt);
     }
 }
@@ -102,7 +106,14 @@ get_source_by_with(pcintr_coroutine_t co, struct pcintr_stack_frame *frame,
         return with;
     }
     else if (purc_variant_is_native(with)) {
-        return pcintr_template_expansion(with);
+        struct ctxt_for_update *ctxt;
+        ctxt = (struct ctxt_for_update*)frame->ctxt;
+        pcintr_template_expansion_release(ctxt->expansion);
+        ctxt->expansion = pcintr_template_expand(with);
+        if (!ctxt->expansion)
+            return PURC_VARIANT_INVALID;
+        purc_variant_t v = pcintr_template_expansion_content(ctxt->expansion);
+        return purc_variant_ref(v);
     }
     else {
         purc_variant_ref(with);
@@ -358,9 +369,17 @@ static pcdoc_operation convert_operation(const char *to)
 static int
 update_target_child(pcintr_stack_t stack, pcdoc_element_t target,
         const char *to, purc_variant_t src,
+        struct pcintr_template_expansion *expansion,
         pcintr_attribute_op with_eval)
 {
-    UNUSED_PARAM(stack);
+    /* build the content of the template without the HTML parser */
+    if (expansion) {
+        pcdoc_operation op = convert_operation(to);
+        if (op != PCDOC_OP_UNKNOWN && pcintr_template_expansion_insert(
+                    stack->doc, target, op, expansion) == 0)
+            return 0;
+    }
+
     char *t = NULL;
     const char *s = "undefined";
     if (purc_variant_is_undefined(src)) {
@@ -496,6 +515,7 @@ update_target_attr(pcintr_stack_t stack, pcdoc_element_t target,
 static int
 update_target(pcintr_stack_t stack, pcdoc_element_t target,
         purc_variant_t at, purc_variant_t to, purc_variant_t src,
+        struct pcintr_template_expansion *expansion,
         pcintr_attribute_op with_eval)
 {
     const char *s_to = "displace";
@@ -512,7 +532,8 @@ update_target(pcintr_stack_t stack, pcdoc_element_t target,
     }
 
     if (!s_at) {
-        return update_target_child(stack, target, s_to, src, with_eval);
+        return update_target_child(stack, target, s_to, src, expansion,
+                with_eval);
     }
     if (strcmp(s_at, "textContent") == 0) {
         return update_target_content(stack, target, s_to, src, with_eval);
@@ -532,7 +553,7 @@ update_target(pcintr_stack_t stack, pcdoc_element_t target,
 static int
 update_elements(pcintr_stack_t stack,
         purc_variant_t elems, purc_variant_t at, purc_variant_t to,
-        purc_variant_t src,
+        purc_variant_t src, struct pcintr_template_expansion *expansion,
         pcintr_attribute_op with_eval)
 {
     PC_ASSERT(purc_variant_is_native(elems));
@@ -542,7 +563,8 @@ update_elements(pcintr_stack_t stack,
         target = pcdvobjs_get_element_from_elements(elems, idx++);
         if (!target)
             break;
-        int r = update_target(stack, target, at, to, src, with_eval);
+        int r = update_target(stack, target, at, to, src, expansion,
+                with_eval);
         if (r)
             return -1;
     }
@@ -569,7 +591,8 @@ process(pcintr_coroutine_t co, struct pcintr_stack_frame *frame,
     if (type == PURC_VARIANT_TYPE_NATIVE) {
         // const char *s = purc_variant_get_string_const(src);
         // PC_ASSERT(to != PURC_VARIANT_INVALID);
-        return update_elements(&co->stack, on, at, to, src, with_eval);
+        return update_elements(&co->stack, on, at, to, src,
+                ctxt->expansion, with_eval);
     }
     if (type == PURC_VARIANT_TYPE_OBJECT) {
         return update_object(&co->stack, on, at, to, src, with_eval);
@@ -590,7 +613,8 @@ process(pcintr_coroutine_t co, struct pcintr_stack_frame *frame,
         elem = pcdvobjs_get_element_from_elements(elems, 0);
         int r = 0;
         if (elem) {
-            r = update_elements(&co->stack, elems, at, to, src, with_eval);
+            r = update_elements(&co->stack, elems, at, to, src,
+                    ctxt->expansion, with_eval);
         }
         purc_variant_unref(elems);
         return r ? -1 : 0;
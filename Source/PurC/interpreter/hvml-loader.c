@@ -31,6 +31,10 @@
 #include "../hvml/hvml-gen.h"
 
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 purc_vdom_t
 purc_load_hvml_from_rwstream(purc_rwstream_t stm)
@@ -97,6 +101,9 @@ end:
 static size_t total_orig_size;
 static pcutils_map* md5_vdom_map;
 
+/* the directory to store the images of vDOMs; NULL if not enabled */
+static const char *image_dir;
+
 struct vdom_entry {
     time_t expire;
     size_t length;
@@ -157,6 +164,10 @@ int pcintr_init_loader_once(void)
     if (atexit(cleanup_loader_once))
         goto failed;
 
+    image_dir = getenv(PURC_ENVV_VDOM_CACHE_DIR);
+    if (image_dir && image_dir[0] == '\0')
+        image_dir = NULL;
+
     return 0;
 
 failed:
@@ -213,6 +224,91 @@ static purc_vdom_t find_vdom_in_cache(unsigned char *md5)
     return vdom;
 }
 
+static void
+get_image_path(char *path, size_t sz, const unsigned char *md5)
+{
+    char hex[MD5_DIGEST_SIZE * 2 + 1];
+
+    pcutils_bin2hex(md5, MD5_DIGEST_SIZE, hex, false);
+    snprintf(path, sz, "%s/%s.vdom", image_dir, hex);
+}
+
+/*
+ * Rebuild the vDOM from the image stored for the source. Returns NULL
+ * if there is no image or the image is stale; the caller should parse
+ * the source instead.
+ */
+static purc_vdom_t load_vdom_image(const unsigned char *md5)
+{
+    char path[PATH_MAX];
+    purc_vdom_t vdom = NULL;
+
+    if (image_dir == NULL)
+        return NULL;
+
+    get_image_path(path, sizeof(path), md5);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *image = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (image != MAP_FAILED) {
+            vdom = pcvdom_document_from_image(image, st.st_size, md5);
+            if (vdom == NULL)
+                purc_clr_error();
+            munmap(image, st.st_size);
+        }
+    }
+
+    close(fd);
+    return vdom;
+}
+
+static void save_vdom_image(const unsigned char *md5, purc_vdom_t vdom)
+{
+    char path[PATH_MAX], tmp[PATH_MAX + 16];
+
+    if (image_dir == NULL)
+        return;
+
+    /* write to a unique temporary file first; other runners and processes
+       may be loading or saving the same image. The image keeps the mode
+       given by mkstemp(), so it is readable by the current user only. */
+    get_image_path(path, sizeof(path), md5);
+    snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+
+    int fd = mkstemp(tmp);
+    if (fd < 0)
+        return;
+
+    FILE *fp = fdopen(fd, "w");
+    if (fp == NULL) {
+        close(fd);
+        unlink(tmp);
+        return;
+    }
+
+    purc_rwstream_t out = purc_rwstream_new_from_fp(fp);
+    if (out == NULL) {
+        purc_clr_error();
+        fclose(fp);
+        unlink(tmp);
+        return;
+    }
+
+    int r = pcvdom_document_write_image(vdom, md5, out);
+    if (r == 0 && fflush(fp))
+        r = -1;
+    purc_rwstream_destroy(out);
+
+    if (r || rename(tmp, path)) {
+        purc_clr_error();
+        unlink(tmp);
+    }
+}
+
 purc_vdom_t
 purc_load_hvml_from_string(const char* string)
 {
@@ -228,7 +324,10 @@ purc_load_hvml_from_string(const char* string)
     pcutils_md5digest(string, md5);
 
     vdom = find_vdom_in_cache(md5);
-    if (vdom == NULL) {
+    if (vdom == NULL && (vdom = load_vdom_image(md5))) {
+        cache_vdom(md5, 0, length, vdom);
+    }
+    else if (vdom == NULL) {
         purc_rwstream_t in;
         in = purc_rwstream_new_from_mem((void*)string, length);
         if (!in) {
@@ -236,6 +335,7 @@ purc_load_hvml_from_string(const char* string)
         }
 
         if ((vdom = purc_load_hvml_from_rwstream(in))) {
+            save_vdom_image(md5, vdom);
             cache_vdom(md5, 0, length, vdom);
         }
 
@@ -259,7 +359,10 @@ purc_load_hvml_from_file(const char* file)
     }
 
     vdom = find_vdom_in_cache(md5);
-    if (vdom == NULL) {
+    if (vdom == NULL && (vdom = load_vdom_image(md5))) {
+        cache_vdom(md5, 0, length, vdom);
+    }
+    else if (vdom == NULL) {
         purc_rwstream_t in;
         in = purc_rwstream_new_from_file(file, "r");
         if (!in) {
@@ -267,6 +370,7 @@ purc_load_hvml_from_file(const char* file)
         }
 
         if ((vdom = purc_load_hvml_from_rwstream(in))) {
+            save_vdom_image(md5, vdom);
             cache_vdom(md5, 0, length, vdom);
         }
         purc_rwstream_destroy(in);
@@ -48,9 +48,15 @@
 
 #define PLINE()   PLOG(">%s:%d:%s\n", __FILE__, __LINE__, __func__)
 
+struct pcintr_template_plan;
+
 struct pcvdom_template {
     struct pcvcm_node            *vcm;
     bool                          to_free;
+
+    /* the plan to build the content in eDOM; compiled on demand */
+    struct pcintr_template_plan  *plan;
+    bool                          no_plan;
 };
 
 struct pcintr_observer_task {
@@ -91,9 +97,20 @@ PCA_EXTERN_C_BEGIN
 void
 pcintr_destroy_observer_list(struct list_head *observer_list);
 
+void
+pcintr_destroy_observer_index(pcintr_stack_t stack);
+
 struct list_head *
 pcintr_get_observer_list(pcintr_stack_t stack, purc_variant_t observed);
 
+/*
+ * Returns the list of the observers of the message type which may observe
+ * the variant, linked by `bucket_node`, or NULL if there is none.
+ */
+struct list_head *
+pcintr_get_observers_of_type(pcintr_stack_t stack, purc_variant_t observed,
+        purc_atom_t type_atom);
+
 bool
 pcintr_is_observer_match(struct pcintr_observer *observer,
         purc_variant_t observed, purc_atom_t type_atom, const char *sub_type);
@@ -333,6 +350,14 @@ pcintr_rdr_send_dom_req_simple_raw(pcintr_stack_t stack, pcdoc_operation op,
         pcdoc_element_t element, const char *property,
         pcrdr_msg_data_type data_type, const char *data, size_t len);
 
+/* send the queued DOM operations to the renderer without waiting;
+ * return the number of requests sent. */
+size_t
+pcintr_rdr_flush_dom_reqs(struct pcinst *inst);
+
+void
+pcintr_rdr_discard_dom_reqs(struct pcintr_heap *heap);
+
 
 #define pcintr_rdr_dom_append_content(stack, element, content)          \
     pcintr_rdr_send_dom_req_simple_raw(stack, PCDOC_OP_APPEND,          \
@@ -395,8 +420,33 @@ pcintr_bind_template(purc_variant_t templates,
 purc_variant_t
 pcintr_template_expansion(purc_variant_t val);
 
-pcintr_coroutine_t
-pcintr_coroutine_get_by_id(purc_atom_t id);
+struct pcvdom_template *
+pcintr_template_entity(purc_variant_t val);
+
+void
+pcintr_template_plan_destroy(struct pcintr_template_plan *plan);
+
+struct pcintr_template_expansion;
+
+/* Evaluates the template; the expansion keeps the evaluated values of
+ * the expressions if the template can be built in eDOM directly. */
+struct pcintr_template_expansion *
+pcintr_template_expand(purc_variant_t val);
+
+/* the expanded content; the same as pcintr_template_expansion() returns */
+purc_variant_t
+pcintr_template_expansion_content(struct pcintr_template_expansion *exp);
+
+/* Builds the content of the expansion in eDOM without the HTML parser.
+ * Returns -1 if the content should be inserted as text; the document is
+ * left untouched in this case. */
+int
+pcintr_template_expansion_insert(purc_document_t doc,
+        pcdoc_element_t elem, pcdoc_operation op,
+        struct pcintr_template_expansion *exp);
+
+void
+pcintr_template_expansion_release(struct pcintr_template_expansion *exp);
 
 
 void
@@ -437,6 +487,15 @@ void pcintr_coroutine_set_state_with_location(pcintr_coroutine_t co,
     pcintr_coroutine_set_state_with_location(co, state,\
             __FILE__, __LINE__, __func__)
 
+// keep the coroutine on the right run queues after its state changed
+void
+pcintr_coroutine_update_run_queues(pcintr_coroutine_t co);
+
+// the comparator of the coroutines in pcintr_heap::coroutines by the
+// identifier; `ud` points to a purc_atom_t
+int
+pcintr_coroutine_cmp_by_cid(struct rb_node *node, void *ud);
+
 int
 pcintr_coroutine_clear_tasks(pcintr_coroutine_t co);
 
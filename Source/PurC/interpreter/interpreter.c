@@ -323,6 +323,7 @@ stack_release(pcintr_stack_t stack)
     pcintr_destroy_observer_list(&stack->common_observers);
     pcintr_destroy_observer_list(&stack->dynamic_observers);
     pcintr_destroy_observer_list(&stack->native_observers);
+    pcintr_destroy_observer_index(stack);
 
     if (stack->doc) {
         purc_document_unref(stack->doc);
@@ -454,6 +455,8 @@ static void
 coroutine_destroy(pcintr_coroutine_t co)
 {
     if (co) {
+        list_del_init(&co->ln_ready);
+        list_del_init(&co->ln_event);
         coroutine_release(co);
         free(co);
     }
@@ -500,6 +503,7 @@ static void _cleanup_instance(struct pcinst* inst)
         heap->event_timer = NULL;
     }
 
+    pcintr_rdr_discard_dom_reqs(heap);
     free(heap);
     inst->intr_heap = NULL;
 }
@@ -538,6 +542,9 @@ static int _init_instance(struct pcinst* inst,
     heap->owner     = inst;
 
     heap->coroutines = RB_ROOT;
+    INIT_LIST_HEAD(&heap->ready_queue);
+    INIT_LIST_HEAD(&heap->event_queue);
+    INIT_LIST_HEAD(&heap->dom_reqs);
     heap->running_coroutine = NULL;
     heap->next_coroutine_id = 1;
 
@@ -1784,15 +1791,6 @@ static int set_coroutine_id(pcintr_coroutine_t coroutine)
     return 0;
 }
 
-static int
-cmp_by_atom(struct rb_node *node, void *ud)
-{
-    purc_atom_t *atom = (purc_atom_t*)ud;
-    pcintr_coroutine_t co;
-    co = container_of(node, struct pcintr_coroutine, node);
-    return (*atom) - co->cid;
-}
-
 static pcintr_coroutine_t
 coroutine_create(purc_vdom_t vdom, pcintr_coroutine_t parent,
         pcrdr_page_type page_type, void *user_data)
@@ -1810,6 +1808,10 @@ coroutine_create(purc_vdom_t vdom, pcintr_coroutine_t parent,
         goto fail;
     }
 
+    co->owner = heap;
+    INIT_LIST_HEAD(&co->ln_ready);
+    INIT_LIST_HEAD(&co->ln_event);
+
     if (set_coroutine_id(co)) {
         goto fail_co;
     }
@@ -1838,13 +1840,12 @@ coroutine_create(purc_vdom_t vdom, pcintr_coroutine_t parent,
 
     stack = &co->stack;
     stack->co = co;
-    co->owner = heap;
     co->user_data = user_data;
     co->loaded_vars = RB_ROOT;
 
     int r;
     r = pcutils_rbtree_insert_only(coroutines, &co->cid,
-            cmp_by_atom, &co->node);
+            pcintr_coroutine_cmp_by_cid, &co->node);
     PC_ASSERT(r == 0);
 
     stack_init(stack);
@@ -1883,6 +1884,8 @@ fail_variables:
     pcinst_msg_queue_destroy(co->mq);
 
 fail_co:
+    list_del_init(&co->ln_ready);
+    list_del_init(&co->ln_event);
     free(co);
 
 fail:
@@ -1911,7 +1914,7 @@ purc_schedule_vdom(purc_vdom_t vdom,
     pcintr_coroutine_t parent = NULL;
     if (curator) {
         struct rb_node* node = pcutils_rbtree_find(&intr->coroutines,
-                &curator, cmp_by_atom);
+                &curator, pcintr_coroutine_cmp_by_cid);
         if (node) {
             parent = container_of(node, struct pcintr_coroutine, node);
         }
@@ -2032,6 +2035,12 @@ purc_run(purc_cond_handler handler)
     heap->keep_alive = 0;
     heap->cond_handler = handler;
 
+    /* the scheduler sleeps when idle; wake it up for renderer events */
+    struct pcrdr_conn *conn = purc_get_conn_to_renderer();
+    if (conn && pcrdr_conn_protocol(conn) == PURC_RDRPROT_PURCMC) {
+        pcintr_runloop_add_wakeup_fd(runloop, pcrdr_conn_socket_fd(conn));
+    }
+
     purc_runloop_set_idle_func(runloop, pcintr_schedule, inst);
     purc_runloop_run();
 
@@ -2428,6 +2437,10 @@ template_cleaner(struct pcvdom_template *tpl)
     if (!tpl)
         return;
 
+    pcintr_template_plan_destroy(tpl->plan);
+    tpl->plan = NULL;
+    tpl->no_plan = false;
+
     if (tpl->vcm && tpl->to_free) {
         pcvcm_node_destroy(tpl->vcm);
     }
@@ -2537,6 +2550,15 @@ pcintr_template_set(purc_variant_t val, struct pcvcm_node *vcm,
     return 0;
 }
 
+struct pcvdom_template *
+pcintr_template_entity(purc_variant_t val)
+{
+    if (check_template_variant(val))
+        return NULL;
+
+    return (struct pcvdom_template*)purc_variant_native_get_entity(val);
+}
+
 void
 pcintr_template_walk(purc_variant_t val, void *ctxt,
         pcintr_template_walk_cb cb)
@@ -3233,6 +3255,7 @@ pcintr_coroutine_set_state_with_location(pcintr_coroutine_t co,
     UNUSED_PARAM(line);
     UNUSED_PARAM(func);
     co->state = state;
+    pcintr_coroutine_update_run_queues(co);
 }
 
 pcdoc_element_t
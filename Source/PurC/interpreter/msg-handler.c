@@ -189,12 +189,16 @@ process_coroutine_event(pcintr_coroutine_t co, pcrdr_msg *msg)
     purc_variant_t observed = msg->elementValue;
 
     bool handle = false;
-    struct list_head* list = pcintr_get_observer_list(stack, observed);
-    struct pcintr_observer *p, *n;
-    list_for_each_entry_safe(p, n, list, node) {
-        if (pcintr_is_observer_match(p, observed, msg_type_atom, sub_type_s)) {
-            handle = true;
-            add_task(co, p, msg->data, msg->sourceURI, msg->eventName);
+    struct list_head* list = pcintr_get_observers_of_type(stack, observed,
+            msg_type_atom);
+    if (list) {
+        struct pcintr_observer *p, *n;
+        list_for_each_entry_safe(p, n, list, bucket_node) {
+            if (pcintr_is_observer_match(p, observed, msg_type_atom,
+                        sub_type_s)) {
+                handle = true;
+                add_task(co, p, msg->data, msg->sourceURI, msg->eventName);
+            }
         }
     }
 
@@ -282,9 +286,14 @@ is_observer_event_handler_match(struct pcintr_event_handler *handler,
     }
 
     purc_variant_t observed = msg->elementValue;
-    struct list_head* list = pcintr_get_observer_list(&co->stack, observed);
+    struct list_head* list = pcintr_get_observers_of_type(&co->stack, observed,
+            msg_type_atom);
+    if (list == NULL) {
+        goto out;
+    }
+
     struct pcintr_observer *p, *n;
-    list_for_each_entry_safe(p, n, list, node) {
+    list_for_each_entry_safe(p, n, list, bucket_node) {
         if (pcintr_is_observer_match(p, observed, msg_type_atom, sub_type_s)) {
             match = true;
             break;
@@ -504,20 +513,18 @@ dispatch_move_buffer_event(struct pcinst *inst, const pcrdr_msg *msg)
     pcintr_update_timestamp(inst);
 
     // add msg to coroutine message queue
-    struct rb_root *coroutines = &heap->coroutines;
-    struct rb_node *p, *n;
-    struct rb_node *first = pcutils_rbtree_first(coroutines);
-
     if (PURC_EVENT_TARGET_BROADCAST != msg_clone->targetValue) {
-        pcutils_rbtree_for_each_safe(first, p, n) {
-            pcintr_coroutine_t co = container_of(p, struct pcintr_coroutine,
-                    node);
-            if (co->cid == msg->targetValue) {
-                return pcinst_msg_queue_append(co->mq, msg_clone);
-            }
+        pcintr_coroutine_t co = pcintr_coroutine_get_by_id(
+                (purc_atom_t)msg->targetValue);
+        if (co) {
+            pcintr_coroutine_set_event_pending(co);
+            return pcinst_msg_queue_append(co->mq, msg_clone);
         }
     }
     else {
+        struct rb_root *coroutines = &heap->coroutines;
+        struct rb_node *p, *n;
+        struct rb_node *first = pcutils_rbtree_first(coroutines);
         pcutils_rbtree_for_each_safe(first, p, n) {
             pcintr_coroutine_t co = container_of(p, struct pcintr_coroutine,
                     node);
@@ -525,6 +532,7 @@ dispatch_move_buffer_event(struct pcinst *inst, const pcrdr_msg *msg)
             pcrdr_msg *my_msg = pcrdr_clone_message(msg_clone);
             my_msg->targetValue = co->cid;
             pcinst_msg_queue_append(co->mq, my_msg);
+            pcintr_coroutine_set_event_pending(co);
         }
         pcrdr_release_message(msg_clone);
     }
@@ -30,9 +30,124 @@
 #include "private/msg-queue.h"
 #include "private/interpreter.h"
 #include "private/regex.h"
+#include "private/hashtable.h"
 
 #define BUILTIN_VAR_CRTN        PURC_PREDEF_VARNAME_CRTN
 
+#define OBSERVER_INDEX_INIT_SIZE    16
+
+/* the characters which make a sub type a regular expression */
+#define SUB_TYPE_META_CHARS     "\\^$.|?*+()[]{}"
+
+/*
+ * The observers of a stack are indexed by the list they are in and the type
+ * of the message observed, so an event is matched against the observers
+ * of its type only; the observed value is still compared one by one since
+ * the comparison is by value or by the `match_observe` hook of a native.
+ */
+struct observer_key {
+    struct list_head           *list;
+    purc_atom_t                 msg_type_atom;
+};
+
+struct observer_bucket {
+    struct observer_key         key;
+
+    // struct pcintr_observer, linked by bucket_node, in registration order
+    struct list_head            observers;
+};
+
+static unsigned long
+observer_key_hash(const void *k)
+{
+    const struct observer_key *key = k;
+    return (unsigned long)(((uintptr_t)key->list >> 4) ^
+            ((unsigned long)key->msg_type_atom * 2654435761UL));
+}
+
+static int
+observer_key_equal(const void *k1, const void *k2)
+{
+    const struct observer_key *key1 = k1;
+    const struct observer_key *key2 = k2;
+    return key1->list == key2->list &&
+        key1->msg_type_atom == key2->msg_type_atom;
+}
+
+static void
+observer_bucket_free(struct pchash_entry *e)
+{
+    free(pchash_entry_v(e));
+}
+
+static struct observer_bucket *
+observer_bucket_get(pcintr_stack_t stack, struct list_head *list,
+        purc_atom_t msg_type_atom, bool create)
+{
+    if (stack->observer_index == NULL) {
+        if (!create)
+            return NULL;
+
+        stack->observer_index = pchash_table_new(OBSERVER_INDEX_INIT_SIZE,
+                observer_bucket_free, observer_key_hash, observer_key_equal);
+        if (stack->observer_index == NULL)
+            return NULL;
+    }
+
+    struct observer_key key = { list, msg_type_atom };
+    struct pchash_entry *e = pchash_table_lookup_entry(stack->observer_index,
+            &key);
+    if (e)
+        return pchash_entry_v(e);
+
+    if (!create)
+        return NULL;
+
+    struct observer_bucket *bucket = calloc(1, sizeof(*bucket));
+    if (bucket == NULL)
+        return NULL;
+
+    bucket->key = key;
+    INIT_LIST_HEAD(&bucket->observers);
+    if (pchash_table_insert(stack->observer_index, &bucket->key, bucket)) {
+        free(bucket);
+        return NULL;
+    }
+    return bucket;
+}
+
+static void
+unindex_observer(struct pcintr_observer *observer)
+{
+    pcintr_stack_t stack = observer->stack;
+    list_del(&observer->bucket_node);
+
+    struct observer_bucket *bucket = observer_bucket_get(stack,
+            observer->list, observer->msg_type_atom, false);
+    if (bucket && list_empty(&bucket->observers)) {
+        pchash_table_delete(stack->observer_index, &bucket->key);
+    }
+}
+
+/*
+ * A sub type without any meta character is matched as a literal; others
+ * are compiled once here instead of on every event. An invalid pattern
+ * leaves both unset and matches nothing, as before.
+ */
+static void
+compile_sub_type(struct pcintr_observer *observer)
+{
+    if (strpbrk(observer->sub_type, SUB_TYPE_META_CHARS) == NULL) {
+        observer->sub_type_is_literal = 1;
+        return;
+    }
+
+    observer->sub_type_regex = pcregex_new(observer->sub_type);
+    if (observer->sub_type_regex == NULL) {
+        purc_clr_error();
+    }
+}
+
 static void
 release_observer(struct pcintr_observer *observer)
 {
@@ -40,6 +155,7 @@ release_observer(struct pcintr_observer *observer)
         return;
 
     list_del(&observer->node);
+    unindex_observer(observer);
 
     if (observer->on_revoke) {
         observer->on_revoke(observer, observer->on_revoke_data);
@@ -61,6 +177,10 @@ release_observer(struct pcintr_observer *observer)
         PURC_VARIANT_SAFE_CLEAR(observer->observed);
     }
 
+    if (observer->sub_type_regex) {
+        pcregex_destroy(observer->sub_type_regex);
+        observer->sub_type_regex = NULL;
+    }
     free(observer->sub_type);
     observer->sub_type = NULL;
 }
@@ -78,10 +198,11 @@ free_observer(struct pcintr_observer *observer)
 
 static void
 add_observer_into_list(pcintr_stack_t stack, struct list_head *list,
-        struct pcintr_observer* observer)
+        struct observer_bucket *bucket, struct pcintr_observer* observer)
 {
     observer->list = list;
     list_add_tail(&observer->node, list);
+    list_add_tail(&observer->bucket_node, &bucket->observers);
 
     // TODO:
     PC_ASSERT(stack);
@@ -106,19 +227,42 @@ bool is_variant_match_observe(purc_variant_t observed, purc_variant_t val)
     return false;
 }
 
-
+static bool
+is_sub_type_match(struct pcintr_observer *observer, const char *sub_type)
+{
+    if (observer->sub_type == sub_type) {
+        return true;
+    }
+    if (!observer->sub_type || !sub_type) {
+        return false;
+    }
+    if (observer->sub_type_is_literal) {
+        return strstr(sub_type, observer->sub_type) != NULL;
+    }
+    if (observer->sub_type_regex) {
+        return pcregex_match_ex(observer->sub_type_regex, sub_type, 0, NULL);
+    }
+    return false;
+}
 
 void
 pcintr_destroy_observer_list(struct list_head *observer_list)
 {
     struct pcintr_observer *p, *n;
     list_for_each_entry_reverse_safe(p, n, observer_list, node) {
-        list_del(&p->node);
-        list_del(&p->node);
         free_observer(p);
     }
 }
 
+void
+pcintr_destroy_observer_index(pcintr_stack_t stack)
+{
+    if (stack->observer_index) {
+        pchash_table_free(stack->observer_index);
+        stack->observer_index = NULL;
+    }
+}
+
 struct list_head *
 pcintr_get_observer_list(pcintr_stack_t stack, purc_variant_t observed)
 {
@@ -152,23 +296,27 @@ pcintr_get_observer_list(pcintr_stack_t stack, purc_variant_t observed)
     return list;
 }
 
+struct list_head *
+pcintr_get_observers_of_type(pcintr_stack_t stack, purc_variant_t observed,
+        purc_atom_t type_atom)
+{
+    struct list_head *list = pcintr_get_observer_list(stack, observed);
+    struct observer_bucket *bucket = observer_bucket_get(stack, list,
+            type_atom, false);
+    return bucket ? &bucket->observers : NULL;
+}
+
 bool
 pcintr_is_observer_match(struct pcintr_observer *observer,
         purc_variant_t observed, purc_atom_t type_atom, const char *sub_type)
 {
-    if ((is_variant_match_observe(observer->observed, observed)) &&
-                (observer->msg_type_atom == type_atom)) {
-        if (observer->sub_type == sub_type ||
-                pcregex_is_match(observer->sub_type, sub_type)) {
-            return true;
-        }
-    }
-    return false;
+    return observer->msg_type_atom == type_atom &&
+        is_variant_match_observe(observer->observed, observed) &&
+        is_sub_type_match(observer, sub_type);
 }
 
 
 
-
 struct pcintr_observer*
 pcintr_register_observer(pcintr_stack_t stack,
         purc_variant_t observed,
@@ -201,6 +349,14 @@ pcintr_register_observer(pcintr_stack_t stack,
         return NULL;
     }
 
+    struct observer_bucket *bucket = observer_bucket_get(stack, list,
+            msg_type_atom, true);
+    if (!bucket) {
+        free(observer);
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
     observer->stack = stack;
     observer->observed = observed;
     purc_variant_ref(observed);
@@ -209,9 +365,12 @@ pcintr_register_observer(pcintr_stack_t stack,
     observer->pos = pos;
     observer->msg_type_atom = msg_type_atom;
     observer->sub_type = sub_type ? strdup(sub_type) : NULL;
+    if (observer->sub_type) {
+        compile_sub_type(observer);
+    }
     observer->on_revoke = on_revoke;
     observer->on_revoke_data = on_revoke_data;
-    add_observer_into_list(stack, list, observer);
+    add_observer_into_list(stack, list, bucket, observer);
 
     // observe idle
     purc_variant_t hvml = pcintr_get_coroutine_variable(stack->co,
@@ -249,9 +408,13 @@ void
 pcintr_revoke_observer_ex(pcintr_stack_t stack, purc_variant_t observed,
         purc_atom_t msg_type_atom, const char *sub_type)
 {
-    struct list_head* list = pcintr_get_observer_list(stack, observed);
+    struct list_head* list = pcintr_get_observers_of_type(stack, observed,
+            msg_type_atom);
+    if (list == NULL)
+        return;
+
     struct pcintr_observer *p, *n;
-    list_for_each_entry_safe(p, n, list, node) {
+    list_for_each_entry_safe(p, n, list, bucket_node) {
         if (pcintr_is_observer_match(p, observed, msg_type_atom, sub_type)) {
             pcintr_revoke_observer(p);
             break;
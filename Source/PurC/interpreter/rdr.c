@@ -45,6 +45,11 @@
 #define BUFF_MAX                1024 * 1024 * 4
 #define LEN_BUFF_LONGLONGINT    128
 
+/* flush the DOM operations early if too many queued in one pass */
+#define MAX_QUEUED_DOM_REQS     256
+
+#define TEXT_CONTENT_PROP       "textContent"
+
 static bool
 object_set(purc_variant_t object, const char *key, const char *value)
 {
@@ -74,6 +79,12 @@ pcrdr_msg *pcintr_rdr_send_request_and_wait_response(struct pcrdr_conn *conn,
         purc_variant_t data)
 {
     pcrdr_msg *response_msg = NULL;
+
+    /* keep the order of the requests */
+    struct pcinst *inst = pcinst_current();
+    if (inst && inst->intr_heap && inst->intr_heap->nr_dom_reqs)
+        pcintr_rdr_flush_dom_reqs(inst);
+
     pcrdr_msg *msg = pcrdr_make_request_message(
             target,                             /* target */
             target_value,                       /* target_value */
@@ -978,18 +989,361 @@ failed:
     return ret;
 }
 
+/*
+ * The DOM operations made by the coroutines are not sent to the renderer
+ * one by one with a round trip for each. They are queued in the heap,
+ * coalesced, and sent in a burst at the end of the scheduler pass (or
+ * before any request waiting for a response) without waiting for the
+ * responses; a failed operation is reported to the coroutine by
+ * a `rdrState:domError` event.
+ */
+struct pcintr_dom_req {
+    struct list_head        ln;
+
+    purc_atom_t             cid;
+    uint64_t                dom_handle;
+
+    pcdoc_operation         op;
+    pcdoc_element_t         element;
+    char                   *property;
+
+    pcrdr_msg_data_type     data_type;
+
+    /* the data given as a variant, or the raw text if `text` is not NULL */
+    purc_variant_t          data;
+    char                   *text;
+    size_t                  len;
+    size_t                  sz;
+};
+
+/* the context of the response handler */
+struct dom_req_ctxt {
+    purc_atom_t             cid;
+    pcdoc_operation         op;
+};
+
+static void
+dom_req_delete(struct pcintr_heap *heap, struct pcintr_dom_req *req)
+{
+    list_del(&req->ln);
+    heap->nr_dom_reqs--;
+
+    if (req->data)
+        purc_variant_unref(req->data);
+    free(req->text);
+    free(req->property);
+    free(req);
+}
+
+static bool
+is_same_property(const char *a, const char *b)
+{
+    if (a == NULL || b == NULL)
+        return a == b;
+    return strcmp(a, b) == 0;
+}
+
+/* whether the operation changes the contents of the element */
+static bool
+is_content_op(struct pcintr_dom_req *req)
+{
+    if (req->property && strcmp(req->property, TEXT_CONTENT_PROP))
+        return false;
+
+    switch (req->op) {
+    case PCDOC_OP_APPEND:
+    case PCDOC_OP_PREPEND:
+    case PCDOC_OP_DISPLACE:
+    case PCDOC_OP_UPDATE:
+    case PCDOC_OP_CLEAR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool
+append_text(struct pcintr_dom_req *req, const char *text, size_t len)
+{
+    if (req->len + len + 1 > req->sz) {
+        /* grow geometrically for the merged appending */
+        size_t sz = req->sz * 2;
+        if (sz < req->len + len + 1)
+            sz = req->len + len + 1;
+        char *p = realloc(req->text, sz);
+        if (p == NULL) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return false;
+        }
+        req->text = p;
+        req->sz = sz;
+    }
+
+    memcpy(req->text + req->len, text, len);
+    req->len += len;
+    req->text[req->len] = '\0';
+    return true;
+}
+
+/* drop the queued operations made useless by the new one */
+static void
+coalesce_dom_reqs(struct pcintr_heap *heap, struct pcintr_dom_req *req)
+{
+    struct pcintr_dom_req *p, *n;
+
+    if (req->property && req->op != PCDOC_OP_APPEND &&
+            req->op != PCDOC_OP_PREPEND) {
+        /* the property will be overwritten */
+        list_for_each_entry_reverse_safe(p, n, &heap->dom_reqs, ln) {
+            if (p->cid == req->cid && p->element == req->element &&
+                    is_same_property(p->property, req->property))
+                dom_req_delete(heap, p);
+        }
+    }
+    else if (req->property == NULL && (req->op == PCDOC_OP_DISPLACE ||
+                req->op == PCDOC_OP_UPDATE || req->op == PCDOC_OP_CLEAR ||
+                req->op == PCDOC_OP_ERASE)) {
+        /* the contents (or the element) will be replaced; only the
+         * operations at the tail are dropped, because the later ones
+         * may refer to the new descendants */
+        while (!list_empty(&heap->dom_reqs)) {
+            p = list_last_entry(&heap->dom_reqs, struct pcintr_dom_req, ln);
+            if (p->cid != req->cid || p->element != req->element)
+                break;
+
+            if (is_content_op(p) || (req->op == PCDOC_OP_ERASE &&
+                        p->property != NULL))
+                dom_req_delete(heap, p);
+            else
+                break;
+        }
+    }
+}
+
+static bool
+queue_dom_req(pcintr_stack_t stack, pcdoc_operation op,
+        pcdoc_element_t element, const char *property,
+        pcrdr_msg_data_type data_type, purc_variant_t data,
+        const char *text, size_t len)
+{
+    struct pcinst *inst = pcinst_current();
+    struct pcintr_heap *heap = inst->intr_heap;
+    pcintr_coroutine_t co = stack->co;
+
+    /* merge the successive appending to the same target */
+    if (text && op == PCDOC_OP_APPEND && !list_empty(&heap->dom_reqs)) {
+        struct pcintr_dom_req *last;
+        last = list_last_entry(&heap->dom_reqs, struct pcintr_dom_req, ln);
+        if (last->cid == co->cid && last->element == element &&
+                last->op == op && last->text &&
+                last->data_type == data_type &&
+                is_same_property(last->property, property))
+            return append_text(last, text, len);
+    }
+
+    struct pcintr_dom_req *req = calloc(1, sizeof(*req));
+    if (req == NULL)
+        goto failed;
+
+    req->cid = co->cid;
+    req->dom_handle = co->target_dom_handle;
+    req->op = op;
+    req->element = element;
+    req->data_type = data_type;
+    if (property && (req->property = strdup(property)) == NULL)
+        goto failed;
+
+    if (text) {
+        if (!append_text(req, text, len))
+            goto failed;
+    }
+    else if (data) {
+        req->data = purc_variant_ref(data);
+    }
+
+    coalesce_dom_reqs(heap, req);
+    list_add_tail(&req->ln, &heap->dom_reqs);
+    heap->nr_dom_reqs++;
+
+    if (heap->nr_dom_reqs >= MAX_QUEUED_DOM_REQS)
+        pcintr_rdr_flush_dom_reqs(inst);
+    return true;
+
+failed:
+    if (req) {
+        free(req->text);
+        free(req->property);
+        free(req);
+    }
+    purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+    return false;
+}
+
+static void
+post_dom_error(struct dom_req_ctxt *ctxt, int ret_code)
+{
+    pcintr_coroutine_t co = pcintr_coroutine_get_by_id(ctxt->cid);
+    if (co == NULL)
+        return;
+
+    purc_variant_t data = purc_variant_make_object_0();
+    if (data == PURC_VARIANT_INVALID)
+        return;
+
+    purc_variant_t v = purc_variant_make_string_static(rdr_ops[ctxt->op],
+            false);
+    if (v) {
+        purc_variant_object_set_by_static_ckey(data, "operation", v);
+        purc_variant_unref(v);
+    }
+
+    v = purc_variant_make_longint(ret_code);
+    if (v) {
+        purc_variant_object_set_by_static_ckey(data, "retCode", v);
+        purc_variant_unref(v);
+    }
+
+    purc_variant_t hvml = pcintr_get_coroutine_variable(co,
+            PURC_PREDEF_VARNAME_CRTN);
+    pcintr_coroutine_post_event(co->cid,
+            PCRDR_MSG_EVENT_REDUCE_OPT_OVERLAY,
+            hvml, MSG_TYPE_RDR_STATE, MSG_SUB_TYPE_DOM_ERROR,
+            data, PURC_VARIANT_INVALID);
+    purc_variant_unref(data);
+}
+
+static int
+dom_req_response_handler(pcrdr_conn *conn, const char *request_id,
+        int state, void *context, const pcrdr_msg *response_msg)
+{
+    struct dom_req_ctxt *ctxt = context;
+
+    UNUSED_PARAM(conn);
+    UNUSED_PARAM(request_id);
+
+    if (state == PCRDR_RESPONSE_RESULT) {
+        if (response_msg->retCode != PCRDR_SC_OK)
+            post_dom_error(ctxt, response_msg->retCode);
+    }
+    else if (state == PCRDR_RESPONSE_TIMEOUT) {
+        post_dom_error(ctxt, PCRDR_SC_CALLEE_TIMEOUT);
+    }
+
+    free(ctxt);
+    return 0;
+}
+
+static int
+send_dom_req(struct pcrdr_conn *conn, struct pcintr_dom_req *req)
+{
+    const char *operation = rdr_ops[req->op];
+    if (req->property && req->op == PCDOC_OP_DISPLACE) {
+        // VW: use 'update' operation when displace property
+        operation = PCRDR_OPERATION_UPDATE;
+    }
+
+    char elem[LEN_BUFF_LONGLONGINT];
+    snprintf(elem, sizeof(elem),
+            "%llx", (unsigned long long int)(uint64_t)req->element);
+
+    purc_variant_t data = PURC_VARIANT_INVALID;
+    if (req->text) {
+        if (req->data_type == PCRDR_MSG_DATA_TYPE_JSON)
+            data = purc_variant_make_from_json_string(req->text, req->len);
+        else
+            data = purc_variant_make_string_ex(req->text, req->len, false);
+        if (data == PURC_VARIANT_INVALID)
+            return -1;
+    }
+    else if (req->data) {
+        data = req->data;
+        req->data = PURC_VARIANT_INVALID;
+    }
+
+    pcrdr_msg *msg = pcrdr_make_request_message(PCRDR_MSG_TARGET_DOM,
+            req->dom_handle, operation, NULL, NULL,
+            PCRDR_MSG_ELEMENT_TYPE_HANDLE, elem, req->property,
+            PCRDR_MSG_DATA_TYPE_VOID, NULL, 0);
+    if (msg == NULL) {
+        if (data)
+            purc_variant_unref(data);
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    msg->dataType = req->data_type;
+    msg->data = data;
+
+    int ret = -1;
+    struct dom_req_ctxt *ctxt = malloc(sizeof(*ctxt));
+    if (ctxt) {
+        ctxt->cid = req->cid;
+        ctxt->op = req->op;
+        ret = pcrdr_send_request(conn, msg, PCRDR_TIME_DEF_EXPECTED,
+                ctxt, dom_req_response_handler);
+        if (ret < 0)
+            free(ctxt);
+    }
+
+    pcrdr_release_message(msg);
+    return ret;
+}
+
+size_t
+pcintr_rdr_flush_dom_reqs(struct pcinst *inst)
+{
+    struct pcintr_heap *heap = inst->intr_heap;
+    size_t n = 0;
+
+    while (!list_empty(&heap->dom_reqs)) {
+        struct pcintr_dom_req *req;
+        req = list_first_entry(&heap->dom_reqs, struct pcintr_dom_req, ln);
+
+        /* the page may have been closed since then */
+        pcintr_coroutine_t co = pcintr_coroutine_get_by_id(req->cid);
+        if (inst->conn_to_rdr && co &&
+                co->target_dom_handle == req->dom_handle &&
+                send_dom_req(inst->conn_to_rdr, req) == 0)
+            n++;
+
+        dom_req_delete(heap, req);
+    }
+
+    return n;
+}
+
+void
+pcintr_rdr_discard_dom_reqs(struct pcintr_heap *heap)
+{
+    while (!list_empty(&heap->dom_reqs)) {
+        dom_req_delete(heap, list_first_entry(&heap->dom_reqs,
+                    struct pcintr_dom_req, ln));
+    }
+}
+
+static bool
+can_send_dom_req(pcintr_stack_t stack)
+{
+    return stack && stack->co->target_page_handle != 0 &&
+        stack->co->stage == CO_STAGE_OBSERVING &&
+        pcinst_current()->conn_to_rdr != NULL;
+}
+
 bool
 pcintr_rdr_send_dom_req_simple(pcintr_stack_t stack, pcdoc_operation op,
         pcdoc_element_t element, const char *property,
         pcrdr_msg_data_type data_type, purc_variant_t data)
 {
-    pcrdr_msg *response_msg = pcintr_rdr_send_dom_req(stack, op,
-            element, property, data_type, data);
-    if (response_msg != NULL) {
-        pcrdr_release_message(response_msg);
-        return true;
+    if (!can_send_dom_req(stack)) {
+        return false;
     }
-    return false;
+
+    bool ret = queue_dom_req(stack, op, element, property, data_type,
+            data, NULL, 0);
+    /* the request owns the data as the synchronous one does */
+    if (data)
+        purc_variant_unref(data);
+    return ret;
 }
 
 bool
@@ -998,6 +1352,10 @@ pcintr_rdr_send_dom_req_simple_raw(pcintr_stack_t stack,
         const char *property, pcrdr_msg_data_type data_type,
         const char *data, size_t len)
 {
+    if (!can_send_dom_req(stack)) {
+        return false;
+    }
+
     if (data && len == 0) {
         len = strlen(data);
     }
@@ -1006,13 +1364,7 @@ pcintr_rdr_send_dom_req_simple_raw(pcintr_stack_t stack,
         data = " ";
         len = 1;
     }
-    pcrdr_msg *response_msg = pcintr_rdr_send_dom_req_raw(stack, op,
-            element, property, data_type, data, len);
 
-    if (response_msg != NULL) {
-        pcrdr_release_message(response_msg);
-        return true;
-    }
-    return false;
+    return queue_dom_req(stack, op, element, property, data_type,
+            PURC_VARIANT_INVALID, data, len);
 }
-
@@ -100,6 +100,51 @@ void purc_runloop_set_idle_func(purc_runloop_t runloop, purc_runloop_func func,
     }
 }
 
+bool pcintr_runloop_suspend_idle(purc_runloop_t runloop, long timeout_ms)
+{
+    if (!runloop) {
+        return false;
+    }
+
+    PurCWTF::Seconds timeout = timeout_ms < 0 ? PurCWTF::Seconds(-1) :
+        PurCWTF::Seconds::fromMilliseconds(timeout_ms);
+    return ((RunLoop*)runloop)->suspendIdleCallback(timeout);
+}
+
+void pcintr_runloop_wakeup_idle(purc_runloop_t runloop)
+{
+    if (runloop) {
+        ((RunLoop*)runloop)->wakeUpIdleCallback();
+    }
+}
+
+void pcintr_wakeup_scheduler(void)
+{
+    /* not pcintr_get_runloop(): there is no current coroutine in the
+       callbacks of timers or fetchers */
+    struct pcinst *inst = pcinst_current();
+    if (inst) {
+        pcintr_runloop_wakeup_idle(inst->running_loop);
+    }
+}
+
+uintptr_t pcintr_runloop_add_wakeup_fd(purc_runloop_t runloop, int fd)
+{
+    if (!runloop || fd < 0) {
+        return 0;
+    }
+
+    RunLoop *runLoop = (RunLoop*)runloop;
+    return runLoop->addFdMonitor(fd,
+            (GIOCondition)(G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP | G_IO_NVAL),
+            [runLoop] (gint fd, GIOCondition condition) -> gboolean {
+            UNUSED_PARAM(fd);
+            runLoop->wakeUpIdleCallback();
+            // stop monitoring a broken fd; it would keep firing
+            return (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL)) == 0;
+        });
+}
+
 static purc_runloop_io_event
 to_runloop_io_event(GIOCondition condition)
 {
@@ -29,6 +29,7 @@
 #include "purc.h"
 #include "private/runners.h"
 #include "private/instance.h"
+#include "private/interpreter.h"
 #include "private/sorted-array.h"
 #include "private/ports.h"
 
@@ -629,8 +630,8 @@ void pcrun_instmgr_handle_message(void *ctxt)
         return;
     }
     else if (n == 0) {
-        // sleep 1ms to take a breath
-        pcutils_usleep(1000);
+        // sleep until a message is moved in
+        pcintr_runloop_suspend_idle(purc_runloop_get_current(), -1);
         return;
     }
 
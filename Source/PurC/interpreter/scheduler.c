@@ -41,9 +41,14 @@
 
 #include <sys/time.h>
 
-#define SCHEDULE_SLEEP          10000           // usec
 #define IDLE_EVENT_TIMEOUT      100             // ms
 
+/* the maximal number of consecutive steps of a coroutine in one pass */
+#define SCHEDULE_STEP_BUDGET    8
+
+/* the maximal number of messages from the renderer dispatched in one pass */
+#define MAX_DISPATCHED_RDR_MSGS 64
+
 #define BUILTIN_VAR_CRTN        PURC_PREDEF_VARNAME_CRTN
 
 #define YIELD_EVENT_HANDLER     "_yield_event_handler"
@@ -272,31 +277,78 @@ execute_one_step_for_ready_co(struct pcinst *inst, pcintr_coroutine_t co)
     pcintr_set_current_co(NULL);
 }
 
-// execute one step for all ready coroutines of the inst
+void
+pcintr_coroutine_update_run_queues(pcintr_coroutine_t co)
+{
+    struct pcintr_heap *heap = co->owner;
+    if (!heap) {
+        return;
+    }
+
+    if (co->state == CO_STATE_READY) {
+        if (list_empty(&co->ln_ready)) {
+            list_add_tail(&co->ln_ready, &heap->ready_queue);
+        }
+    }
+    else if (!list_empty(&co->ln_ready)) {
+        list_del_init(&co->ln_ready);
+    }
+
+    // a message deferred in the previous state may be handled now
+    pcintr_coroutine_set_event_pending(co);
+}
+
+void
+pcintr_coroutine_set_event_pending(pcintr_coroutine_t co)
+{
+    struct pcintr_heap *heap = co->owner;
+    if (!heap) {
+        return;
+    }
+
+    if (list_empty(&co->ln_event)) {
+        list_add_tail(&co->ln_event, &heap->event_queue);
+    }
+    if (heap->owner) {
+        pcintr_runloop_wakeup_idle(heap->owner->running_loop);
+    }
+}
+
+// execute steps for the ready coroutines of the inst, at most
+// SCHEDULE_STEP_BUDGET steps for each one;
 // return whether busy
 static bool
 execute_one_step(struct pcinst *inst)
 {
     struct pcintr_heap *heap = inst->intr_heap;
-    struct rb_root *coroutines = &heap->coroutines;
-    struct rb_node *p, *n;
-    struct rb_node *first = pcutils_rbtree_first(coroutines);
     bool busy = false;
-    pcutils_rbtree_for_each_safe(first, p, n) {
-        pcintr_coroutine_t co = container_of(p, struct pcintr_coroutine,
-                node);
-        if (co->state != CO_STATE_READY) {
-            continue;
+
+    // the coroutines becoming ready in this pass will run in the next one
+    LIST_HEAD(ready);
+    list_splice_init(&heap->ready_queue, &ready);
+
+    while (!list_empty(&ready)) {
+        pcintr_coroutine_t co = list_first_entry(&ready,
+                struct pcintr_coroutine, ln_ready);
+        list_del_init(&co->ln_ready);
+
+        int nr_steps = 0;
+        while (co->state == CO_STATE_READY &&
+                nr_steps < SCHEDULE_STEP_BUDGET) {
+            execute_one_step_for_ready_co(inst, co);
+            nr_steps++;
         }
 
-        execute_one_step_for_ready_co(inst, co);
-        busy = true;
+        if (nr_steps) {
+            busy = true;
+        }
     }
     return busy;
 }
 
 
-void
+// return whether there are more messages moved to the instance
+bool
 check_and_dispatch_event_from_conn()
 {
     struct pcrdr_conn *conn =  purc_get_conn_to_renderer();
@@ -306,14 +358,23 @@ check_and_dispatch_event_from_conn()
         if (!handle) {
             pcrdr_conn_set_event_handler(conn, pcintr_conn_event_handler);
         }
-        pcrdr_wait_and_dispatch_message(conn, 0);
+        // the responses to the DOM operations sent in a burst
+        // arrive in a burst
+        int n = 0;
+        while (n < MAX_DISPATCHED_RDR_MSGS &&
+                pcrdr_wait_and_dispatch_message(conn, 0) == 0) {
+            n++;
+        }
         purc_clr_error();
     }
+
+    size_t n = 0;
+    return purc_inst_holding_messages_count(&n) == 0 && n > 0;
 }
 
 /* return whether busy */
-bool
-handle_coroutine_event(pcintr_coroutine_t co)
+static bool
+handle_one_coroutine_event(pcintr_coroutine_t co)
 {
     bool busy = false;
     int handle_ret = PURC_ERROR_INCOMPLETED;
@@ -412,29 +473,51 @@ out:
     return busy;
 }
 
+/* return whether busy */
+bool
+handle_coroutine_event(pcintr_coroutine_t co)
+{
+    // Examine every message queued before this pass once, so that an
+    // idle pass means all of them were deferred by the handlers and only
+    // a new message or a state change can make the coroutine busy again.
+    size_t nr_msgs = pcinst_msg_queue_count(co->mq);
+    size_t i = 0;
+    bool busy;
+
+    do {
+        busy = handle_one_coroutine_event(co);
+    } while (!busy && ++i < nr_msgs);
+
+    return busy;
+}
+
 static bool
 dispatch_event(struct pcinst *inst)
 {
-    UNUSED_PARAM(inst);
-
-    bool is_busy = false;
-    check_and_dispatch_event_from_conn();
+    bool is_busy = check_and_dispatch_event_from_conn();
 
-    bool co_is_busy = false;
+    // the coroutines having something to handle since the last pass
     struct pcintr_heap *heap = inst->intr_heap;
-    struct rb_root *coroutines = &heap->coroutines;
-    struct rb_node *p, *n;
-    struct rb_node *first = pcutils_rbtree_first(coroutines);
-    pcutils_rbtree_for_each_safe(first, p, n) {
-        pcintr_coroutine_t co;
-        co = container_of(p, struct pcintr_coroutine, node);
-        co_is_busy = handle_coroutine_event(co);
+    LIST_HEAD(pending);
+    list_splice_init(&heap->event_queue, &pending);
+
+    while (!list_empty(&pending)) {
+        pcintr_coroutine_t co = list_first_entry(&pending,
+                struct pcintr_coroutine, ln_event);
+        list_del_init(&co->ln_event);
+
+        bool co_is_busy = handle_coroutine_event(co);
 
         if (co->stack.exited && co->stack.last_msg_read) {
             pcintr_run_exiting_co(co);
+            // the curator or the parent may have something to do now
+            is_busy = true;
+            continue;
         }
 
         if (co_is_busy) {
+            // visit it again in the next pass
+            pcintr_coroutine_set_event_pending(co);
             is_busy = true;
         }
     }
@@ -442,18 +525,42 @@ dispatch_event(struct pcinst *inst)
     return is_busy;
 }
 
+static bool
+is_idle_observed(struct pcinst *inst)
+{
+    struct pcintr_heap *heap = inst->intr_heap;
+    struct rb_node *p;
+    struct rb_node *first = pcutils_rbtree_first(&heap->coroutines);
+    pcutils_rbtree_for_each(first, p) {
+        pcintr_coroutine_t co = container_of(p, struct pcintr_coroutine,
+                node);
+        if (co->stack.observe_idle) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * The scheduler is the idle function of the runloop. When nothing is ready
+ * it suspends itself instead of polling; it will be woken up by a coroutine
+ * becoming ready, an event posted to a coroutine, a message moved to the
+ * instance, the connection to the renderer becoming readable, or any work
+ * dispatched to the runloop (timers, fetcher responses).
+ */
 void
 pcintr_schedule(void *ctxt)
 {
     static int i = 0;
     struct pcinst *inst = (struct pcinst *)ctxt;
+    long timeout_ms = -1;
     if (!inst) {
-        goto out_sleep;
+        goto out_suspend;
     }
 
     struct pcintr_heap *heap = inst->intr_heap;
     if (!heap) {
-        goto out_sleep;
+        goto out_suspend;
     }
 
 
@@ -464,8 +571,12 @@ pcintr_schedule(void *ctxt)
     // 2. dispatch event for observing / stopped coroutines
     bool event_is_busy = dispatch_event(inst);
 
-    // 3. its busy, goto next scheduler without sleep
-    if (step_is_busy || event_is_busy) {
+    // 3. send the DOM operations made in this pass to the renderer;
+    // their responses will be dispatched in the next pass
+    bool rdr_is_busy = pcintr_rdr_flush_dom_reqs(inst) > 0;
+
+    // 4. its busy, goto next scheduler without sleep
+    if (step_is_busy || event_is_busy || rdr_is_busy) {
         pcintr_update_timestamp(inst);
         goto out;
     }
@@ -475,10 +586,18 @@ pcintr_schedule(void *ctxt)
     if (now - IDLE_EVENT_TIMEOUT > heap->timestamp) {
         broadcast_idle_event(inst);
         pcintr_update_timestamp(inst);
+        goto out;
+    }
+
+    // 6. sleep until woken up, or until the next idle event is due
+    if (is_idle_observed(inst)) {
+        timeout_ms = (long)(heap->timestamp + IDLE_EVENT_TIMEOUT - now);
+        if (timeout_ms < 0)
+            timeout_ms = 0;
     }
 
-out_sleep:
-    pcutils_usleep(SCHEDULE_SLEEP);
+out_suspend:
+    pcintr_runloop_suspend_idle(purc_runloop_get_current(), timeout_ms);
 
 out:
     i++;
@@ -0,0 +1,1210 @@
+/*
+ * @file template.c
+ * @author Vincent Wei
+ * @date 2022/09/26
+ * @brief The structured expansion of the markup templates.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A template of markup like `<li class="$?.cls">$?.name</li>` is a
+ * concatenated string in VCM: the literal fragments of the markup and the
+ * expressions between them. Instead of evaluating the template to a string
+ * and handing the string to the HTML parser, we tokenize the literal
+ * fragments once, and compile the template to a plan: a flat list of the
+ * operations to create the elements, set the attributes and the text
+ * contents, in which the expressions are the slots of the attribute values
+ * and the text contents.
+ *
+ * Only the markup which the HTML tree builder would take literally can be
+ * compiled: well-nested elements without implied end tags, and the
+ * elements which need no special parsing rules. The other templates are
+ * still expanded to text and parsed as before. A text content which
+ * contains character references or markup after the evaluation is also
+ * parsed, so a slot can still generate raw HTML.
+ */
+
+#include "config.h"
+
+#include "purc.h"
+#include "internal.h"
+
+#include "private/debug.h"
+#include "private/document.h"
+#include "private/errors.h"
+#include "private/instance.h"
+#include "private/vcm.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TPL_MAX_NAME_LEN        64
+#define TPL_MAX_DEPTH           128
+
+enum tpl_op_type {
+    TPL_OP_OPEN,        // the start tag of an element
+    TPL_OP_ATTR,        // an attribute of the element just opened
+    TPL_OP_TEXT,        // a text content
+    TPL_OP_CLOSE,       // the end tag of the current element
+};
+
+struct tpl_piece {
+    int                 slot;       // the index of the slot; -1 for literal
+    const char         *text;       // the literal text in the vcm node
+    size_t              len;
+};
+
+struct tpl_op {
+    enum tpl_op_type    type;
+    char               *name;       // OPEN: tag name; ATTR: attribute name
+    bool                void_elem;  // OPEN: an element without end tag
+    bool                raw;        // TEXT: having character references
+    char                quote;      // ATTR: the quotation mark or 0
+
+    size_t              first;      // the first piece of the value or text
+    size_t              nr;         // the number of the pieces
+};
+
+struct pcintr_template_plan {
+    struct tpl_op      *ops;
+    size_t              nr_ops;
+
+    struct tpl_piece   *pieces;
+    size_t              nr_pieces;
+
+    /* the literals and the slots of the template in order */
+    struct tpl_piece   *segs;
+    size_t              nr_segs;
+
+    /* the indices of the operations creating the top-level nodes */
+    size_t             *tops;
+    size_t              nr_tops;
+
+    struct pcvcm_node **slots;
+    size_t              nr_slots;
+
+    size_t              max_depth;
+};
+
+struct tpl_value {
+    purc_variant_t      v;
+    const char         *s;
+    size_t              len;
+    char               *buf;        // the stringified value if not a string
+};
+
+struct pcintr_template_expansion {
+    purc_variant_t                  tpl;
+    struct pcintr_template_plan    *plan;
+    purc_variant_t                  content;
+
+    struct tpl_value               *vals;
+    size_t                          nr_vals;
+};
+
+static const char *void_elements[] = {
+    "area", "base", "br", "col", "embed", "hr", "img", "input",
+    "link", "meta", "param", "source", "track", "wbr",
+    NULL
+};
+
+/* the elements which the HTML tree builder handles in special ways */
+static const char *special_elements[] = {
+    "applet", "body", "caption", "col", "colgroup", "frame", "frameset",
+    "head", "html", "iframe", "image", "listing", "marquee", "math",
+    "noembed", "noframes", "noscript", "object", "optgroup", "option",
+    "plaintext", "pre", "script", "select", "style", "svg", "table",
+    "tbody", "td", "template", "textarea", "tfoot", "th", "thead",
+    "title", "tr", "xmp",
+    NULL
+};
+
+/* the elements which close an open `p` element implicitly */
+static const char *p_closers[] = {
+    "address", "article", "aside", "blockquote", "center", "dd",
+    "details", "dialog", "dir", "div", "dl", "dt", "fieldset",
+    "figcaption", "figure", "footer", "form", "h1", "h2", "h3", "h4",
+    "h5", "h6", "header", "hgroup", "hr", "li", "main", "menu", "nav",
+    "ol", "p", "section", "summary", "ul",
+    NULL
+};
+
+/* the elements which close an open element with the same name */
+static const char *self_closers[] = {
+    "a", "button", "form", "nobr",
+    NULL
+};
+
+static bool
+in_list(const char *name, const char **list)
+{
+    for (; *list; list++) {
+        if (strcmp(name, *list) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+static inline bool
+is_heading(const char *name)
+{
+    return name[0] == 'h' && name[1] >= '1' && name[1] <= '6' &&
+        name[2] == '\0';
+}
+
+static inline bool
+is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\f' || c == '\r';
+}
+
+static inline bool
+has_any_of(const char *s, size_t len, const char *chars)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] && strchr(chars, s[i]))
+            return true;
+    }
+
+    return false;
+}
+
+void
+pcintr_template_plan_destroy(struct pcintr_template_plan *plan)
+{
+    if (plan == NULL)
+        return;
+
+    for (size_t i = 0; i < plan->nr_ops; i++)
+        free(plan->ops[i].name);
+
+    free(plan->ops);
+    free(plan->pieces);
+    free(plan->segs);
+    free(plan->tops);
+    free(plan->slots);
+    free(plan);
+}
+
+enum tpl_state {
+    TS_DATA,
+    TS_TAG_OPEN,
+    TS_TAG_NAME,
+    TS_END_TAG_OPEN,
+    TS_END_TAG_NAME,
+    TS_AFTER_END_TAG_NAME,
+    TS_BEFORE_ATTR_NAME,
+    TS_ATTR_NAME,
+    TS_AFTER_ATTR_NAME,
+    TS_BEFORE_ATTR_VALUE,
+    TS_ATTR_VALUE_DQ,
+    TS_ATTR_VALUE_SQ,
+    TS_ATTR_VALUE_UNQ,
+    TS_AFTER_ATTR_VALUE_QUOTED,
+    TS_SELF_CLOSING,
+};
+
+struct tpl_compiler {
+    struct pcintr_template_plan    *plan;
+    size_t                          sz_ops;
+    size_t                          sz_pieces;
+    size_t                          sz_tops;
+
+    enum tpl_state                  state;
+    char                            name[TPL_MAX_NAME_LEN];
+    size_t                          len_name;
+
+    /* the OPEN operations of the open elements */
+    size_t                          open[TPL_MAX_DEPTH];
+    size_t                          depth;
+
+    size_t                          tag;    // the OPEN op of the current tag
+    long                            text;   // the current TEXT op or -1
+    long                            attr;   // the current ATTR op or -1
+};
+
+static void *
+grow(void *array, size_t *sz, size_t nr, size_t unit)
+{
+    if (nr < *sz)
+        return array;
+
+    size_t new_sz = *sz ? *sz * 2 : 16;
+    void *p = realloc(array, new_sz * unit);
+    if (p)
+        *sz = new_sz;
+    return p;
+}
+
+static long
+push_op(struct tpl_compiler *c, enum tpl_op_type type, const char *name)
+{
+    struct pcintr_template_plan *plan = c->plan;
+    struct tpl_op *ops;
+
+    ops = grow(plan->ops, &c->sz_ops, plan->nr_ops, sizeof(*ops));
+    if (ops == NULL)
+        return -1;
+    plan->ops = ops;
+
+    struct tpl_op *op = ops + plan->nr_ops;
+    memset(op, 0, sizeof(*op));
+    op->type = type;
+    op->first = plan->nr_pieces;
+    if (name && (op->name = strdup(name)) == NULL)
+        return -1;
+
+    return (long)plan->nr_ops++;
+}
+
+static int
+push_piece(struct tpl_compiler *c, int slot, const char *text, size_t len)
+{
+    struct pcintr_template_plan *plan = c->plan;
+    struct tpl_piece *pieces;
+
+    pieces = grow(plan->pieces, &c->sz_pieces, plan->nr_pieces,
+            sizeof(*pieces));
+    if (pieces == NULL)
+        return -1;
+    plan->pieces = pieces;
+
+    pieces[plan->nr_pieces].slot = slot;
+    pieces[plan->nr_pieces].text = text;
+    pieces[plan->nr_pieces].len = len;
+    plan->nr_pieces++;
+    return 0;
+}
+
+static int
+push_top(struct tpl_compiler *c, size_t op)
+{
+    struct pcintr_template_plan *plan = c->plan;
+    size_t *tops;
+
+    if (c->depth > 0)
+        return 0;
+
+    tops = grow(plan->tops, &c->sz_tops, plan->nr_tops, sizeof(*tops));
+    if (tops == NULL)
+        return -1;
+    plan->tops = tops;
+
+    tops[plan->nr_tops++] = op;
+    return 0;
+}
+
+static int
+text_piece(struct tpl_compiler *c, int slot, const char *text, size_t len,
+        bool raw)
+{
+    if (c->text < 0) {
+        c->text = push_op(c, TPL_OP_TEXT, NULL);
+        if (c->text < 0 || push_top(c, c->text))
+            return -1;
+    }
+
+    if (push_piece(c, slot, text, len))
+        return -1;
+
+    struct tpl_op *op = c->plan->ops + c->text;
+    op->nr++;
+    op->raw = op->raw || raw;
+    return 0;
+}
+
+static int
+attr_piece(struct tpl_compiler *c, int slot, const char *text, size_t len)
+{
+    if (push_piece(c, slot, text, len))
+        return -1;
+
+    c->plan->ops[c->attr].nr++;
+    return 0;
+}
+
+static int
+append_name(struct tpl_compiler *c, char ch)
+{
+    if (ch == '\0' || c->len_name + 1 >= sizeof(c->name))
+        return -1;
+
+    if (ch >= 'A' && ch <= 'Z')
+        ch += 'a' - 'A';
+    c->name[c->len_name++] = ch;
+    c->name[c->len_name] = '\0';
+    return 0;
+}
+
+/* checks whether the tree builder would close any open element */
+static int
+check_nesting(struct tpl_compiler *c, const char *name)
+{
+    const struct tpl_op *ops = c->plan->ops;
+
+    if (in_list(name, special_elements))
+        return -1;
+
+    bool p_closer = in_list(name, p_closers);
+    bool self_closer = in_list(name, self_closers);
+    bool li = strcmp(name, "li") == 0;
+    bool dd_dt = strcmp(name, "dd") == 0 || strcmp(name, "dt") == 0;
+    bool in_list_item = li || dd_dt;
+
+    if (c->depth > 0 && is_heading(name) &&
+            is_heading(ops[c->open[c->depth - 1]].name))
+        return -1;
+
+    for (size_t i = c->depth; i > 0; i--) {
+        const char *open = ops[c->open[i - 1]].name;
+
+        if (p_closer && strcmp(open, "p") == 0)
+            return -1;
+        if (self_closer && strcmp(open, name) == 0)
+            return -1;
+
+        if (in_list_item) {
+            if (li && (strcmp(open, "ul") == 0 || strcmp(open, "ol") == 0 ||
+                        strcmp(open, "menu") == 0))
+                in_list_item = false;
+            else if (dd_dt && strcmp(open, "dl") == 0)
+                in_list_item = false;
+            else if (li && strcmp(open, "li") == 0)
+                return -1;
+            else if (dd_dt && (strcmp(open, "dd") == 0 ||
+                        strcmp(open, "dt") == 0))
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int
+start_tag(struct tpl_compiler *c)
+{
+    if (check_nesting(c, c->name))
+        return -1;
+
+    long op = push_op(c, TPL_OP_OPEN, c->name);
+    if (op < 0 || push_top(c, op))
+        return -1;
+
+    c->plan->ops[op].void_elem = in_list(c->name, void_elements);
+    c->tag = op;
+    return 0;
+}
+
+static int
+emit_tag(struct tpl_compiler *c, bool self_closing)
+{
+    const struct tpl_op *op = c->plan->ops + c->tag;
+
+    if (self_closing && !op->void_elem)
+        return -1;
+
+    if (!op->void_elem) {
+        if (c->depth >= TPL_MAX_DEPTH)
+            return -1;
+        c->open[c->depth++] = c->tag;
+        if (c->depth > c->plan->max_depth)
+            c->plan->max_depth = c->depth;
+    }
+
+    c->state = TS_DATA;
+    return 0;
+}
+
+static int
+end_tag(struct tpl_compiler *c)
+{
+    if (c->depth == 0 ||
+            strcmp(c->plan->ops[c->open[c->depth - 1]].name, c->name))
+        return -1;
+
+    if (push_op(c, TPL_OP_CLOSE, NULL) < 0)
+        return -1;
+
+    c->depth--;
+    c->state = TS_DATA;
+    return 0;
+}
+
+static int
+start_attr(struct tpl_compiler *c)
+{
+    c->attr = push_op(c, TPL_OP_ATTR, c->name);
+    return c->attr < 0 ? -1 : 0;
+}
+
+/* the tree builder keeps the first one of the duplicated attributes */
+static void
+finish_attr(struct tpl_compiler *c)
+{
+    struct pcintr_template_plan *plan = c->plan;
+    const char *name = plan->ops[c->attr].name;
+
+    for (size_t i = c->tag + 1; i < (size_t)c->attr; i++) {
+        if (strcmp(plan->ops[i].name, name) == 0) {
+            free(plan->ops[c->attr].name);
+            plan->nr_ops--;
+            break;
+        }
+    }
+
+    c->attr = -1;
+}
+
+static int
+feed_literal(struct tpl_compiler *c, const char *p, size_t len)
+{
+    const char *end = p + len;
+
+    while (p < end) {
+        const char *start = p;
+        char ch = *p;
+
+        switch (c->state) {
+        case TS_DATA: {
+            bool raw = false;
+            while (p < end && *p != '<') {
+                if (*p == '&' || *p == '\r' || *p == '\0')
+                    raw = true;
+                p++;
+            }
+            if (p > start && text_piece(c, -1, start, p - start, raw))
+                return -1;
+            if (p < end) {
+                c->text = -1;
+                c->state = TS_TAG_OPEN;
+                p++;
+            }
+            continue;
+        }
+
+        case TS_TAG_OPEN:
+            if (ch == '/') {
+                c->state = TS_END_TAG_OPEN;
+            }
+            else if ((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z')) {
+                c->len_name = 0;
+                if (append_name(c, ch))
+                    return -1;
+                c->state = TS_TAG_NAME;
+            }
+            else {
+                // comments, doctypes and stray `<`
+                return -1;
+            }
+            break;
+
+        case TS_TAG_NAME:
+            if (is_space(ch) || ch == '/' || ch == '>') {
+                if (start_tag(c))
+                    return -1;
+                if (ch == '>') {
+                    if (emit_tag(c, false))
+                        return -1;
+                }
+                else {
+                    c->state = (ch == '/') ? TS_SELF_CLOSING :
+                        TS_BEFORE_ATTR_NAME;
+                }
+            }
+            else if (append_name(c, ch)) {
+                return -1;
+            }
+            break;
+
+        case TS_END_TAG_OPEN:
+            if (!((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z')))
+                return -1;
+            c->len_name = 0;
+            if (append_name(c, ch))
+                return -1;
+            c->state = TS_END_TAG_NAME;
+            break;
+
+        case TS_END_TAG_NAME:
+            if (ch == '>') {
+                if (end_tag(c))
+                    return -1;
+            }
+            else if (is_space(ch)) {
+                c->state = TS_AFTER_END_TAG_NAME;
+            }
+            else if (append_name(c, ch)) {
+                return -1;
+            }
+            break;
+
+        case TS_AFTER_END_TAG_NAME:
+            if (ch == '>') {
+                if (end_tag(c))
+                    return -1;
+            }
+            else if (!is_space(ch)) {
+                return -1;
+            }
+            break;
+
+        case TS_BEFORE_ATTR_NAME:
+            if (is_space(ch))
+                break;
+            if (ch == '/') {
+                c->state = TS_SELF_CLOSING;
+            }
+            else if (ch == '>') {
+                if (emit_tag(c, false))
+                    return -1;
+            }
+            else if (ch == '=' || ch == '"' || ch == '\'' || ch == '<') {
+                return -1;
+            }
+            else {
+                c->len_name = 0;
+                if (append_name(c, ch))
+                    return -1;
+                c->state = TS_ATTR_NAME;
+            }
+            break;
+
+        case TS_ATTR_NAME:
+            if (ch == '=') {
+                if (start_attr(c))
+                    return -1;
+                c->state = TS_BEFORE_ATTR_VALUE;
+            }
+            else if (is_space(ch)) {
+                c->state = TS_AFTER_ATTR_NAME;
+            }
+            else if (ch == '/' || ch == '>' || ch == '"' || ch == '\'' ||
+                    ch == '<' || append_name(c, ch)) {
+                // the attributes without value are kept without value
+                // by the tree builder, while we can only set a value.
+                return -1;
+            }
+            break;
+
+        case TS_AFTER_ATTR_NAME:
+            if (is_space(ch))
+                break;
+            if (ch != '=' || start_attr(c))
+                return -1;
+            c->state = TS_BEFORE_ATTR_VALUE;
+            break;
+
+        case TS_BEFORE_ATTR_VALUE:
+            if (is_space(ch))
+                break;
+            if (ch == '"' || ch == '\'') {
+                c->plan->ops[c->attr].quote = ch;
+                c->state = (ch == '"') ? TS_ATTR_VALUE_DQ : TS_ATTR_VALUE_SQ;
+            }
+            else if (ch == '>') {
+                return -1;
+            }
+            else {
+                c->state = TS_ATTR_VALUE_UNQ;
+                continue;
+            }
+            break;
+
+        case TS_ATTR_VALUE_DQ:
+        case TS_ATTR_VALUE_SQ: {
+            char quote = (c->state == TS_ATTR_VALUE_DQ) ? '"' : '\'';
+            while (p < end && *p != quote) {
+                if (*p == '&' || *p == '\r' || *p == '\0')
+                    return -1;
+                p++;
+            }
+            if (p > start && attr_piece(c, -1, start, p - start))
+                return -1;
+            if (p < end) {
+                finish_attr(c);
+                c->state = TS_AFTER_ATTR_VALUE_QUOTED;
+                p++;
+            }
+            continue;
+        }
+
+        case TS_ATTR_VALUE_UNQ:
+            while (p < end && !is_space(*p) && *p != '>') {
+                if (strchr("\"'<=`&", *p))
+                    return -1;
+                p++;
+            }
+            if (p > start && attr_piece(c, -1, start, p - start))
+                return -1;
+            if (p < end) {
+                finish_attr(c);
+                if (*p == '>') {
+                    if (emit_tag(c, false))
+                        return -1;
+                }
+                else {
+                    c->state = TS_BEFORE_ATTR_NAME;
+                }
+                p++;
+            }
+            continue;
+
+        case TS_AFTER_ATTR_VALUE_QUOTED:
+            if (is_space(ch)) {
+                c->state = TS_BEFORE_ATTR_NAME;
+            }
+            else if (ch == '/') {
+                c->state = TS_SELF_CLOSING;
+            }
+            else if (ch == '>') {
+                if (emit_tag(c, false))
+                    return -1;
+            }
+            else {
+                return -1;
+            }
+            break;
+
+        case TS_SELF_CLOSING:
+            if (ch != '>' || emit_tag(c, true))
+                return -1;
+            break;
+        }
+
+        p++;
+    }
+
+    return 0;
+}
+
+static int
+feed_slot(struct tpl_compiler *c, int slot)
+{
+    switch (c->state) {
+    case TS_DATA:
+        return text_piece(c, slot, NULL, 0, false);
+
+    case TS_BEFORE_ATTR_VALUE:
+        c->state = TS_ATTR_VALUE_UNQ;
+        return attr_piece(c, slot, NULL, 0);
+
+    case TS_ATTR_VALUE_DQ:
+    case TS_ATTR_VALUE_SQ:
+    case TS_ATTR_VALUE_UNQ:
+        return attr_piece(c, slot, NULL, 0);
+
+    default:
+        // an expression in a tag name or an attribute name.
+        break;
+    }
+
+    return -1;
+}
+
+static int
+add_segment(struct pcintr_template_plan *plan, size_t *sz,
+        struct pcvcm_node *node)
+{
+    struct tpl_piece *segs;
+    segs = grow(plan->segs, sz, plan->nr_segs, sizeof(*segs));
+    if (segs == NULL)
+        return -1;
+    plan->segs = segs;
+
+    struct tpl_piece *seg = segs + plan->nr_segs++;
+    if (node->type == PCVCM_NODE_TYPE_STRING) {
+        seg->slot = -1;
+        seg->text = (const char *)node->sz_ptr[1];
+        seg->len = (size_t)node->sz_ptr[0];
+        return 0;
+    }
+
+    struct pcvcm_node **slots;
+    slots = realloc(plan->slots, sizeof(*slots) * (plan->nr_slots + 1));
+    if (slots == NULL)
+        return -1;
+    plan->slots = slots;
+
+    seg->slot = (int)plan->nr_slots;
+    seg->text = NULL;
+    seg->len = 0;
+    slots[plan->nr_slots++] = node;
+    return 0;
+}
+
+static struct pcintr_template_plan *
+plan_compile(struct pcvcm_node *vcm)
+{
+    if (vcm->type != PCVCM_NODE_TYPE_STRING &&
+            vcm->type != PCVCM_NODE_TYPE_FUNC_CONCAT_STRING)
+        return NULL;
+
+    struct tpl_compiler *c = calloc(1, sizeof(*c));
+    struct pcintr_template_plan *plan = calloc(1, sizeof(*plan));
+    if (c == NULL || plan == NULL)
+        goto failed;
+
+    size_t sz_segs = 0;
+    if (vcm->type == PCVCM_NODE_TYPE_STRING) {
+        if (add_segment(plan, &sz_segs, vcm))
+            goto failed;
+    }
+    else {
+        struct pctree_node *child;
+        for (child = pctree_node_child(&vcm->tree_node); child;
+                child = pctree_node_next(child)) {
+            if (add_segment(plan, &sz_segs, (struct pcvcm_node *)child))
+                goto failed;
+        }
+    }
+
+    c->plan = plan;
+    c->state = TS_DATA;
+    c->text = -1;
+    c->attr = -1;
+    for (size_t i = 0; i < plan->nr_segs; i++) {
+        const struct tpl_piece *seg = plan->segs + i;
+        int r = (seg->slot < 0) ? feed_literal(c, seg->text, seg->len) :
+            feed_slot(c, seg->slot);
+        if (r)
+            goto failed;
+    }
+
+    if (c->state != TS_DATA || c->depth > 0)
+        goto failed;
+
+    free(c);
+    return plan;
+
+failed:
+    free(c);
+    pcintr_template_plan_destroy(plan);
+    return NULL;
+}
+
+static struct pcintr_template_plan *
+template_plan(struct pcvdom_template *tpl)
+{
+    if (tpl->plan == NULL && !tpl->no_plan && tpl->vcm) {
+        tpl->plan = plan_compile(tpl->vcm);
+        tpl->no_plan = (tpl->plan == NULL);
+    }
+
+    return tpl->plan;
+}
+
+static purc_variant_t
+make_content(const struct pcintr_template_plan *plan,
+        const struct tpl_value *vals)
+{
+    size_t len = 0;
+    for (size_t i = 0; i < plan->nr_segs; i++) {
+        const struct tpl_piece *seg = plan->segs + i;
+        len += (seg->slot < 0) ? seg->len : vals[seg->slot].len;
+    }
+
+    char *buf = malloc(len + 1);
+    if (buf == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return PURC_VARIANT_INVALID;
+    }
+
+    char *p = buf;
+    for (size_t i = 0; i < plan->nr_segs; i++) {
+        const struct tpl_piece *seg = plan->segs + i;
+        if (seg->slot < 0) {
+            memcpy(p, seg->text, seg->len);
+            p += seg->len;
+        }
+        else {
+            memcpy(p, vals[seg->slot].s, vals[seg->slot].len);
+            p += vals[seg->slot].len;
+        }
+    }
+    *p = '\0';
+
+    purc_variant_t v = purc_variant_make_string_reuse_buff(buf, len + 1,
+            false);
+    if (v == PURC_VARIANT_INVALID)
+        free(buf);
+    return v;
+}
+
+struct pcintr_template_expansion *
+pcintr_template_expand(purc_variant_t val)
+{
+    struct pcvdom_template *tpl = pcintr_template_entity(val);
+    if (tpl == NULL)
+        return NULL;
+
+    pcintr_stack_t stack = pcintr_get_stack();
+    PC_ASSERT(stack);
+
+    struct pcintr_template_expansion *exp = calloc(1, sizeof(*exp));
+    if (exp == NULL) {
+        purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+    exp->tpl = purc_variant_ref(val);
+
+    exp->plan = template_plan(tpl);
+    if (exp->plan == NULL) {
+        exp->content = pcintr_template_expansion(val);
+        if (exp->content == PURC_VARIANT_INVALID)
+            goto failed;
+        return exp;
+    }
+
+    if (exp->plan->nr_slots) {
+        exp->vals = calloc(exp->plan->nr_slots, sizeof(*exp->vals));
+        if (exp->vals == NULL) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            goto failed;
+        }
+    }
+
+    for (size_t i = 0; i < exp->plan->nr_slots; i++) {
+        struct tpl_value *tv = exp->vals + i;
+
+        // TODO: silently
+        tv->v = pcvcm_eval(exp->plan->slots[i], stack, false);
+        exp->nr_vals++;
+        if (tv->v == PURC_VARIANT_INVALID)
+            goto failed;
+
+        if (purc_variant_is_string(tv->v)) {
+            tv->s = purc_variant_get_string_const_ex(tv->v, &tv->len);
+        }
+        else {
+            ssize_t n = purc_variant_stringify_alloc(&tv->buf, tv->v);
+            if (n < 0)
+                goto failed;
+            tv->s = tv->buf ? tv->buf : "";
+            tv->len = (size_t)n;
+        }
+    }
+
+    exp->content = make_content(exp->plan, exp->vals);
+    if (exp->content == PURC_VARIANT_INVALID)
+        goto failed;
+
+    return exp;
+
+failed:
+    pcintr_template_expansion_release(exp);
+    return NULL;
+}
+
+purc_variant_t
+pcintr_template_expansion_content(struct pcintr_template_expansion *exp)
+{
+    return exp->content;
+}
+
+void
+pcintr_template_expansion_release(struct pcintr_template_expansion *exp)
+{
+    if (exp == NULL)
+        return;
+
+    for (size_t i = 0; i < exp->nr_vals; i++) {
+        PURC_VARIANT_SAFE_CLEAR(exp->vals[i].v);
+        free(exp->vals[i].buf);
+    }
+    free(exp->vals);
+
+    PURC_VARIANT_SAFE_CLEAR(exp->content);
+    PURC_VARIANT_SAFE_CLEAR(exp->tpl);
+    free(exp);
+}
+
+struct tpl_builder {
+    purc_document_t                     doc;
+    const struct pcintr_template_plan  *plan;
+    const struct tpl_value             *vals;
+
+    pcdoc_element_t                    *parents;
+    char                               *buf;
+    size_t                              sz_buf;
+};
+
+/* concatenates the pieces of an attribute value or a text content */
+static const char *
+join_pieces(struct tpl_builder *bd, const struct tpl_op *op, size_t *len)
+{
+    const struct tpl_piece *pieces = bd->plan->pieces + op->first;
+
+    if (op->nr == 1) {
+        if (pieces->slot < 0) {
+            *len = pieces->len;
+            return pieces->text;
+        }
+
+        *len = bd->vals[pieces->slot].len;
+        return bd->vals[pieces->slot].s;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < op->nr; i++) {
+        total += (pieces[i].slot < 0) ? pieces[i].len :
+            bd->vals[pieces[i].slot].len;
+    }
+
+    if (total + 1 > bd->sz_buf) {
+        char *buf = realloc(bd->buf, total + 1);
+        if (buf == NULL) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NULL;
+        }
+        bd->buf = buf;
+        bd->sz_buf = total + 1;
+    }
+
+    char *p = bd->buf;
+    for (size_t i = 0; i < op->nr; i++) {
+        if (pieces[i].slot < 0) {
+            memcpy(p, pieces[i].text, pieces[i].len);
+            p += pieces[i].len;
+        }
+        else {
+            memcpy(p, bd->vals[pieces[i].slot].s,
+                    bd->vals[pieces[i].slot].len);
+            p += bd->vals[pieces[i].slot].len;
+        }
+    }
+    *p = '\0';
+
+    *len = total;
+    return bd->buf;
+}
+
+/*
+ * Checks whether the evaluated attribute values are still taken literally
+ * by the tokenizer; for example, a value with a quotation mark would end
+ * the quoted attribute value in the text.
+ */
+static bool
+attrs_are_literal(const struct pcintr_template_plan *plan,
+        const struct tpl_value *vals)
+{
+    for (size_t i = 0; i < plan->nr_ops; i++) {
+        const struct tpl_op *op = plan->ops + i;
+        if (op->type != TPL_OP_ATTR)
+            continue;
+
+        const char *stoppers;
+        if (op->quote == '"')
+            stoppers = "\"&\r";
+        else if (op->quote == '\'')
+            stoppers = "'&\r";
+        else
+            stoppers = " \t\n\f\r\"'<=>`&";
+
+        size_t len = 0;
+        for (size_t j = 0; j < op->nr; j++) {
+            const struct tpl_piece *piece = plan->pieces + op->first + j;
+            if (piece->slot < 0) {
+                len += piece->len;
+                continue;
+            }
+
+            const struct tpl_value *val = vals + piece->slot;
+            if (has_any_of(val->s, val->len, stoppers))
+                return false;
+            len += val->len;
+        }
+
+        if (op->quote == 0 && op->nr > 0 && len == 0)
+            return false;
+    }
+
+    return true;
+}
+
+static int
+build_text(struct tpl_builder *bd, pcdoc_element_t elem, pcdoc_operation op,
+        const struct tpl_op *text)
+{
+    size_t len;
+    const char *s = join_pieces(bd, text, &len);
+    if (s == NULL)
+        return -1;
+    if (len == 0)
+        return 0;
+
+    bool raw = text->raw;
+    for (size_t i = 0; !raw && i < text->nr; i++) {
+        const struct tpl_piece *piece = bd->plan->pieces + text->first + i;
+        if (piece->slot >= 0) {
+            const struct tpl_value *val = bd->vals + piece->slot;
+            raw = has_any_of(val->s, val->len, "<&\r");
+        }
+    }
+
+    if (raw) {
+        pcdoc_node node;
+        node = pcdoc_element_new_content(bd->doc, elem, op, s, len);
+        return node.type == PCDOC_NODE_VOID ? -1 : 0;
+    }
+
+    return pcdoc_element_new_text_content(bd->doc, elem, op, s, len) ?
+        0 : -1;
+}
+
+/* builds the top-level node created by the operation `idx` */
+static int
+build_node(struct tpl_builder *bd, size_t idx, pcdoc_element_t elem,
+        pcdoc_operation op)
+{
+    const struct pcintr_template_plan *plan = bd->plan;
+    const struct tpl_op *ops = plan->ops;
+
+    if (ops[idx].type == TPL_OP_TEXT)
+        return build_text(bd, elem, op, ops + idx);
+
+    pcdoc_element_t curr = NULL;
+    size_t depth = 0;
+    for (size_t i = idx; i < plan->nr_ops; i++) {
+        const struct tpl_op *o = ops + i;
+        const char *s;
+        size_t len;
+
+        switch (o->type) {
+        case TPL_OP_OPEN:
+            if (depth == 0)
+                curr = pcdoc_element_new_element(bd->doc, elem, op,
+                        o->name, false);
+            else
+                curr = pcdoc_element_new_element(bd->doc,
+                        bd->parents[depth - 1], PCDOC_OP_APPEND,
+                        o->name, false);
+            if (curr == NULL)
+                return -1;
+            if (!o->void_elem)
+                bd->parents[depth++] = curr;
+            break;
+
+        case TPL_OP_ATTR:
+            s = join_pieces(bd, o, &len);
+            if (s == NULL)
+                return -1;
+            if (len == 0)
+                s = "";
+            if (pcdoc_element_set_attribute(bd->doc, curr,
+                        PCDOC_OP_DISPLACE, o->name, s, len))
+                return -1;
+            break;
+
+        case TPL_OP_TEXT:
+            if (build_text(bd, bd->parents[depth - 1], PCDOC_OP_APPEND, o))
+                return -1;
+            break;
+
+        case TPL_OP_CLOSE:
+            depth--;
+            break;
+        }
+
+        if (depth == 0 && (i + 1 == plan->nr_ops ||
+                    ops[i + 1].type != TPL_OP_ATTR))
+            break;
+    }
+
+    return 0;
+}
+
+/*
+ * The nodes are built in a staging element first, which takes the place of
+ * the content and carries the tag name of the target element, so that the
+ * raw text is parsed in the same context as before. Only when everything
+ * is built is the staging element replaced by its children (and the old
+ * content erased for `displace`); on failure it is simply erased, and
+ * the document is left as it was.
+ */
+int
+pcintr_template_expansion_insert(purc_document_t doc,
+        pcdoc_element_t elem, pcdoc_operation op,
+        struct pcintr_template_expansion *exp)
+{
+    const struct pcintr_template_plan *plan = exp->plan;
+
+    if (plan == NULL || doc->type != PCDOC_K_TYPE_HTML ||
+            op > PCDOC_OP_DISPLACE || !attrs_are_literal(plan, exp->vals) ||
+            doc->ops->unwrap_element == NULL ||
+            doc->ops->get_tag_name == NULL)
+        return -1;
+
+    char tag[64];
+    size_t tag_len;
+    const char *name = doc->ops->get_tag_name(doc, elem, &tag_len);
+    if (name == NULL || tag_len == 0 || tag_len >= sizeof(tag))
+        return -1;
+    memcpy(tag, name, tag_len);
+    tag[tag_len] = '\0';
+
+    struct tpl_builder bd = {
+        .doc        = doc,
+        .plan       = plan,
+        .vals       = exp->vals,
+    };
+
+    if (plan->max_depth) {
+        bd.parents = malloc(sizeof(*bd.parents) * plan->max_depth);
+        if (bd.parents == NULL) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+    }
+
+    int r = -1;
+    pcdoc_element_t staging = pcdoc_element_new_element(doc, elem,
+            (op == PCDOC_OP_DISPLACE) ? PCDOC_OP_APPEND : op, tag, false);
+    if (staging) {
+        r = 0;
+        for (size_t i = 0; r == 0 && i < plan->nr_tops; i++)
+            r = build_node(&bd, plan->tops[i], staging, PCDOC_OP_APPEND);
+
+        if (r == 0)
+            r = doc->ops->unwrap_element(doc, staging,
+                    op == PCDOC_OP_DISPLACE);
+        if (r)
+            pcdoc_element_erase(doc, staging);
+    }
+
+    free(bd.parents);
+    free(bd.buf);
+
+    if (r) {
+        PC_WARN("failed to build the template content in eDOM: %s\n",
+                purc_get_error_message(purc_get_last_error()));
+        return -1;
+    }
+
+    /* the renderer still gets the markup */
+    pcintr_stack_t stack = pcintr_get_stack();
+    if (stack && stack->co->target_page_handle) {
+        size_t len;
+        const char *s = purc_variant_get_string_const_ex(exp->content, &len);
+        pcintr_rdr_send_dom_req_simple_raw(stack, op,
+                elem, NULL, doc->def_text_type, s, len);
+    }
+
+    return 0;
+}
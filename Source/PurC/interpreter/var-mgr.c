@@ -29,6 +29,7 @@
 #include "internal.h"
 
 #include "private/var-mgr.h"
+#include "private/atom-buckets.h"
 #include "private/errors.h"
 #include "private/instance.h"
 #include "private/utils.h"
@@ -191,9 +192,19 @@ static bool mgr_change_handler(purc_variant_t source, pcvar_op_t msg_type,
     return true;
 }
 
+static inline void
+invalidate_var_caches(void)
+{
+    struct pcintr_heap *heap = pcintr_get_heap();
+    if (heap)
+        heap->vars_generation++;
+}
+
 static bool mgr_handler(purc_variant_t source, pcvar_op_t msg_type,
         void* ctxt, size_t nr_args, purc_variant_t* argv)
 {
+    invalidate_var_caches();
+
     switch (msg_type) {
     case PCVAR_OPERATION_GROW:
         return mgr_grow_handler(source, msg_type, ctxt, nr_args, argv);
@@ -266,6 +277,7 @@ int pcvarmgr_destroy(pcvarmgr_t mgr)
         }
         purc_variant_unref(mgr->object);
         free(mgr);
+        invalidate_var_caches();
     }
     return 0;
 }
@@ -494,6 +506,10 @@ again:
         if (purc_variant_is_object(tmp) == false)
             break;
 
+        size_t sz;
+        if (!purc_variant_object_size(tmp, &sz) || sz == 0)
+            break;
+
         purc_variant_t v;
         v = purc_variant_object_get_by_ckey(tmp, name);
         if (v == PURC_VARIANT_INVALID)
@@ -507,6 +523,57 @@ again:
     goto again;
 }
 
+/*
+ * Resolve a named variable out of the temporary ones for the frame:
+ * the scoped variables visible from the frame, then the coroutine-level
+ * and the instance-level ones. The resolution only depends on the scope
+ * and the position of the frames and on the contents of the variable
+ * managers, so it is cached in the frame until one of them changes.
+ * The value is not referenced by the cache: it is kept alive by the
+ * variable manager, and any change to the manager invalidates the cache.
+ */
+static purc_variant_t
+find_cached_var(purc_coroutine_t cor, struct pcintr_stack_frame *frame,
+        const char *name, purc_atom_t atom)
+{
+    struct pcintr_var_cache_entry *entry;
+    unsigned int generation = cor->owner->vars_generation;
+
+    entry = frame->var_cache + (atom % PCINTR_NR_VAR_CACHE_ENTRIES);
+    if (entry->name == atom && entry->generation == generation &&
+            entry->scope == frame->scope && entry->pos == frame->pos) {
+        return entry->value;
+    }
+
+    purc_variant_t v = PURC_VARIANT_INVALID;
+    struct pcintr_stack_frame *parent = NULL;
+    if (frame->scope) {
+        v = _find_named_scope_var_in_vdom(cor, frame->scope, name, NULL);
+    }
+    else if (frame->pos) {
+        v = pcintr_get_scope_variable(cor, frame->pos, name);
+        if (!v)
+            parent = pcintr_stack_frame_get_parent(frame);
+    }
+
+    if (parent) {
+        /* the parent frame resolves the rest, with its own cache */
+        v = find_cached_var(cor, parent, name, atom);
+    }
+    else if (!v) {
+        v = find_cor_level_var(cor, name);
+        if (!v)
+            v = find_inst_var(name);
+    }
+
+    entry->name = atom;
+    entry->generation = generation;
+    entry->scope = frame->scope;
+    entry->pos = frame->pos;
+    entry->value = v;
+    return v;
+}
+
 purc_variant_t
 pcintr_find_named_var(pcintr_stack_t stack, const char* name)
 {
@@ -515,6 +582,20 @@ pcintr_find_named_var(pcintr_stack_t stack, const char* name)
         return PURC_VARIANT_INVALID;
     }
 
+    /* only the names referred by vDOM are interned */
+    purc_atom_t atom = purc_atom_try_string_ex(ATOM_BUCKET_VARNAME, name);
+    return pcintr_find_named_var_by_atom(stack, name, atom);
+}
+
+purc_variant_t
+pcintr_find_named_var_by_atom(pcintr_stack_t stack, const char* name,
+        purc_atom_t atom)
+{
+    if (!stack || !name) {
+        PC_ASSERT(0); // FIXME: still recoverable???
+        return PURC_VARIANT_INVALID;
+    }
+
     struct pcintr_stack_frame* frame = pcintr_stack_get_bottom_frame(stack);
     PC_ASSERT(frame);
 
@@ -525,6 +606,17 @@ pcintr_find_named_var(pcintr_stack_t stack, const char* name)
         return v;
     }
 
+    if (atom && stack->co) {
+        v = find_cached_var(stack->co, frame, name, atom);
+        if (v) {
+            purc_clr_error();
+            return v;
+        }
+
+        purc_set_error_with_info(PCVARIANT_ERROR_NOT_FOUND, "name:%s", name);
+        return PURC_VARIANT_INVALID;
+    }
+
     v = _find_named_scope_var(stack->co, frame, name, NULL);
     if (v) {
         purc_clr_error();
@@ -604,7 +696,7 @@ pcintr_get_symbolized_var (pcintr_stack_t stack, unsigned int number,
 
 purc_variant_t
 pcintr_find_anchor_symbolized_var(pcintr_stack_t stack, const char *anchor,
-        char symbol)
+        size_t anchor_len, char symbol)
 {
     purc_variant_t ret = PURC_VARIANT_INVALID;
     enum purc_symbol_var symbol_var = _to_symbol(symbol);
@@ -626,7 +718,8 @@ pcintr_find_anchor_symbolized_var(pcintr_stack_t stack, const char *anchor,
 
         if (purc_variant_is_string(elem_id)) {
             const char *id = purc_variant_get_string_const(elem_id);
-            if (id && id[0] == '#' && strcmp(id+1, anchor) == 0) {
+            if (id && id[0] == '#' && strncmp(id + 1, anchor, anchor_len) == 0
+                    && id[anchor_len + 1] == 0) {
                 ret = pcintr_get_symbol_var(frame, symbol_var);
                 if (ret == PURC_VARIANT_INVALID) {
                     purc_set_error_with_info(PCVARIANT_ERROR_NOT_FOUND,
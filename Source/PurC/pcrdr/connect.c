@@ -181,6 +181,9 @@ int pcrdr_free_connection(pcrdr_conn* conn)
             free(pr);
     }
 
+    if (conn->packet_pool)
+        pcrdr_packet_pool_delete(conn->packet_pool);
+
     free(conn);
 
     return 0;
@@ -282,16 +285,18 @@ variant_strcmp(purc_variant_t a, purc_variant_t b)
             purc_variant_get_string_const(b));
 }
 
+/*
+ * The responses arrive in the order of the requests, but a request waiting
+ * for the response synchronously is put at the head of the pending requests
+ * while the requests sent without waiting may be still pending, so search
+ * the whole queue.
+ */
 static int
 handle_response_message(pcrdr_conn* conn, const pcrdr_msg *msg)
 {
-    int retval = -1;
-
-    if (!list_empty(&conn->pending_requests)) {
-        struct pending_request *pr;
-        pr = list_first_entry(&conn->pending_requests,
-                struct pending_request, list);
+    struct pending_request *pr;
 
+    list_for_each_entry(pr, &conn->pending_requests, list) {
         if (variant_strcmp(msg->requestId, pr->request_id) == 0) {
             const char *request_id =
                 purc_variant_get_string_const(msg->requestId);
@@ -302,23 +307,20 @@ handle_response_message(pcrdr_conn* conn, const pcrdr_msg *msg)
                         request_id);
             }
 
-            retval = 0;
             list_del(&pr->list);
             purc_variant_unref(pr->request_id);
             if (pr->in_heap)
                 free(pr);
+            return 0;
         }
-        else {
-            purc_log_error("response not matched the first pending request\n");
-            purc_set_error(PCRDR_ERROR_UNEXPECTED);
-        }
-    }
-    else {
-        purc_log_error("no pending request?\n");
-        purc_set_error(PCRDR_ERROR_UNEXPECTED);
     }
 
-    return retval;
+    if (list_empty(&conn->pending_requests))
+        purc_log_error("no pending request?\n");
+    else
+        purc_log_error("response not matched any pending request\n");
+    purc_set_error(PCRDR_ERROR_UNEXPECTED);
+    return -1;
 }
 
 static int
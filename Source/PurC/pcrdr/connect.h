@@ -51,6 +51,12 @@ struct pcrdr_conn {
     int fd;
     int timeout_ms;
 
+    /* send the messages in the binary format; see message-bin.c */
+    bool binary_msg;
+
+    /* the receive pool of the packets; see packet.c */
+    struct pcrdr_packet_pool *packet_pool;
+
     char* srv_host_name;
     char* own_host_name;
     const char* app_name;
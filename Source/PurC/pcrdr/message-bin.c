@@ -0,0 +1,392 @@
+/*
+ * message-bin.c -- The binary encoding of the renderer messages.
+ *
+ * Copyright (C) 2022 FMSoft (http://www.fmsoft.cn)
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A binary packet starts with a fixed-layout header, all integers in
+ * little endian:
+ *
+ *  offset  size    field
+ *  0       1       magic (PCRDR_BINARY_MSG_MAGIC)
+ *  1       1       version (PCRDR_BINARY_MSG_VERSION)
+ *  2       1       type
+ *  3       1       target
+ *  4       1       elementType
+ *  5       1       dataType
+ *  6       1       reduceOpt
+ *  7       1       the flags of the fields following the header
+ *  8       2       the operation identifier if F_OPERATION_ID is set
+ *  10      2       reserved (0)
+ *  12      4       retCode
+ *  16      8       targetValue
+ *  24      8       resultValue
+ *  32      8       the element handle if F_ELEMENT_HANDLE is set
+ *
+ * The header is followed by the length-prefixed (4 bytes) strings of
+ * operation or eventName, requestId, sourceURI, elementValue and property
+ * in this order if the corresponding flags are set, and then the
+ * length-prefixed data if dataType is not void.
+ */
+
+#include "config.h"
+#include "purc-pcrdr.h"
+#include "private/instance.h"
+#include "private/debug.h"
+#include "private/utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#define F_OPERATION         0x01    /* operation or eventName as a string */
+#define F_OPERATION_ID      0x02    /* operation as an identifier */
+#define F_REQUEST_ID        0x04
+#define F_SOURCE_URI        0x08
+#define F_ELEMENT           0x10    /* elementValue as a string */
+#define F_ELEMENT_HANDLE    0x20    /* elementValue as a handle */
+#define F_PROPERTY          0x40
+
+#define LEN_BUFF_LONGLONGINT    128
+
+static inline void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = (uint8_t)(v >> (i * 8));
+}
+
+static inline void put_u64(uint8_t *p, uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = (uint8_t)(v >> (i * 8));
+}
+
+static inline uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static inline uint64_t get_u64(const uint8_t *p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+/* the atoms of the operations, indexed by the operation identifiers */
+static purc_atom_t op_atoms[PCRDR_NR_OPERATIONS];
+
+static void init_op_atoms(void)
+{
+    for (unsigned int id = 0; id < PCRDR_NR_OPERATIONS; id++)
+        op_atoms[id] = pcrdr_try_operation_atom(pcrdr_operation_from_id(id));
+}
+
+/* returns the identifier of the operation, or -1 if it is not known */
+static int op_id_from_atom(purc_atom_t atom)
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, init_op_atoms);
+
+    for (unsigned int id = 0; id < PCRDR_NR_OPERATIONS; id++) {
+        if (op_atoms[id] == atom)
+            return (int)id;
+    }
+    return -1;
+}
+
+static void write_string(pcrdr_cb_write fn, void *ctxt,
+        const char *str, size_t len)
+{
+    uint8_t buf[4];
+
+    put_u32(buf, (uint32_t)len);
+    fn(ctxt, buf, sizeof(buf));
+    if (len > 0)
+        fn(ctxt, str, len);
+}
+
+static void write_variant(pcrdr_cb_write fn, void *ctxt, purc_variant_t v)
+{
+    size_t len = 0;
+    const char *str = purc_variant_get_string_const_ex(v, &len);
+
+    write_string(fn, ctxt, str, str ? len : 0);
+}
+
+static bool is_request_or_event(const pcrdr_msg *msg)
+{
+    return msg->type == PCRDR_MSG_TYPE_REQUEST ||
+        msg->type == PCRDR_MSG_TYPE_EVENT;
+}
+
+int pcrdr_serialize_message_binary(const pcrdr_msg *msg,
+        pcrdr_cb_write fn, void *ctxt)
+{
+    uint8_t header[PCRDR_BINARY_MSG_HEADER_SIZE] = { 0 };
+    uint8_t flags = 0;
+    int op_id = -1;
+    uint64_t handle = 0;
+
+    if (msg->type == PCRDR_MSG_TYPE_VOID || msg->type > PCRDR_MSG_TYPE_LAST) {
+        purc_set_error(PCRDR_ERROR_BAD_MESSAGE);
+        return -1;
+    }
+
+    if (msg->type == PCRDR_MSG_TYPE_REQUEST) {
+        const char *op = purc_variant_get_string_const(msg->operation);
+        purc_atom_t atom = op ? pcrdr_try_operation_atom(op) : 0;
+        if (atom)
+            op_id = op_id_from_atom(atom);
+        if (op_id >= 0)
+            flags |= F_OPERATION_ID;
+        else
+            flags |= F_OPERATION;
+    }
+    else if (msg->type == PCRDR_MSG_TYPE_EVENT) {
+        flags |= F_OPERATION;
+    }
+
+    if (msg->requestId)
+        flags |= F_REQUEST_ID;
+    if (msg->sourceURI)
+        flags |= F_SOURCE_URI;
+
+    if (is_request_or_event(msg) &&
+            msg->elementType != PCRDR_MSG_ELEMENT_TYPE_VOID) {
+        const char *value = purc_variant_get_string_const(msg->elementValue);
+        char *end = NULL;
+
+        if (msg->elementType == PCRDR_MSG_ELEMENT_TYPE_HANDLE && value) {
+            errno = 0;
+            handle = (uint64_t)strtoull(value, &end, 16);
+        }
+
+        if (end && end != value && *end == '\0' && errno == 0)
+            flags |= F_ELEMENT_HANDLE;
+        else
+            flags |= F_ELEMENT;
+    }
+
+    if (is_request_or_event(msg) && msg->property)
+        flags |= F_PROPERTY;
+
+    header[0] = PCRDR_BINARY_MSG_MAGIC;
+    header[1] = PCRDR_BINARY_MSG_VERSION;
+    header[2] = (uint8_t)msg->type;
+    header[3] = (uint8_t)msg->target;
+    header[4] = (uint8_t)(is_request_or_event(msg) ?
+            msg->elementType : PCRDR_MSG_ELEMENT_TYPE_VOID);
+    header[5] = (uint8_t)msg->dataType;
+    header[6] = (uint8_t)msg->reduceOpt;
+    header[7] = flags;
+    put_u16(header + 8, op_id >= 0 ? (uint16_t)op_id : 0);
+    put_u32(header + 12, msg->retCode);
+    put_u64(header + 16, msg->targetValue);
+    put_u64(header + 24, msg->resultValue);
+    put_u64(header + 32, handle);
+    fn(ctxt, header, sizeof(header));
+
+    if (flags & F_OPERATION)
+        write_variant(fn, ctxt, msg->operation);    /* or eventName */
+    if (flags & F_REQUEST_ID)
+        write_variant(fn, ctxt, msg->requestId);
+    if (flags & F_SOURCE_URI)
+        write_variant(fn, ctxt, msg->sourceURI);
+    if (flags & F_ELEMENT)
+        write_variant(fn, ctxt, msg->elementValue);
+    if (flags & F_PROPERTY)
+        write_variant(fn, ctxt, msg->property);
+
+    if (msg->dataType == PCRDR_MSG_DATA_TYPE_VOID) {
+        // do nothing
+    }
+    else if (msg->dataType == PCRDR_MSG_DATA_TYPE_JSON) {
+        purc_rwstream_t buffer = purc_rwstream_new_buffer(
+                PCRDR_MIN_PACKET_BUFF_SIZE, PCRDR_MAX_INMEM_PAYLOAD_SIZE);
+        if (buffer == NULL)
+            return -1;
+
+        /* always serialize as a standard JSON */
+        if (purc_variant_serialize(msg->data, buffer, 0,
+                PCVARIANT_SERIALIZE_OPT_PLAIN, NULL) < 0) {
+            purc_rwstream_destroy(buffer);
+            return -1;
+        }
+
+        size_t len;
+        const char *text = purc_rwstream_get_mem_buffer(buffer, &len);
+        write_string(fn, ctxt, text, len);
+        purc_rwstream_destroy(buffer);
+    }
+    else {  /* for other text types */
+        size_t len = 0;
+        const char *text = purc_variant_get_string_const_ex(msg->data, &len);
+        if (msg->textLen > 0)   /* override by textLen */
+            len = msg->textLen;
+        write_string(fn, ctxt, text, text ? len : 0);
+    }
+
+    return 0;
+}
+
+/* read a length-prefixed string; return NULL on a truncated packet */
+static const uint8_t *read_string(const uint8_t *p, const uint8_t *end,
+        const char **str, size_t *len)
+{
+    if (end - p < 4)
+        return NULL;
+
+    *len = get_u32(p);
+    p += 4;
+    if ((size_t)(end - p) < *len)
+        return NULL;
+
+    *str = (const char *)p;
+    return p + *len;
+}
+
+static const uint8_t *read_variant(const uint8_t *p, const uint8_t *end,
+        purc_variant_t *v)
+{
+    const char *str;
+    size_t len;
+
+    if ((p = read_string(p, end, &str, &len)) == NULL)
+        return NULL;
+
+    *v = purc_variant_make_string_ex(str, len, true);
+    return *v ? p : NULL;
+}
+
+int pcrdr_parse_binary_packet(const void *packet, size_t sz_packet,
+        pcrdr_msg **msg_out)
+{
+    const uint8_t *header = packet;
+    const uint8_t *p, *end = header + sz_packet;
+    pcrdr_msg *msg;
+
+    if (!pcrdr_is_binary_packet(packet, sz_packet) ||
+            header[1] != PCRDR_BINARY_MSG_VERSION ||
+            header[2] == PCRDR_MSG_TYPE_VOID ||
+            header[2] > PCRDR_MSG_TYPE_LAST ||
+            header[3] > PCRDR_MSG_TARGET_LAST ||
+            header[4] > PCRDR_MSG_ELEMENT_TYPE_LAST ||
+            header[5] > PCRDR_MSG_DATA_TYPE_LAST ||
+            header[6] > PCRDR_MSG_EVENT_REDUCE_OPT_LAST) {
+        purc_set_error(PCRDR_ERROR_BAD_MESSAGE);
+        return -1;
+    }
+
+    if ((msg = pcinst_get_message()) == NULL) {
+        purc_set_error(PCRDR_ERROR_NOMEM);
+        return -1;
+    }
+
+    uint8_t flags = header[7];
+    msg->type = header[2];
+    msg->target = header[3];
+    msg->elementType = header[4];
+    msg->dataType = header[5];
+    msg->reduceOpt = header[6];
+    msg->retCode = get_u32(header + 12);
+    msg->targetValue = get_u64(header + 16);
+    msg->resultValue = get_u64(header + 24);
+
+    p = header + PCRDR_BINARY_MSG_HEADER_SIZE;
+    if (flags & F_OPERATION_ID) {
+        const char *op = pcrdr_operation_from_id(get_u16(header + 8));
+        if (op == NULL)
+            goto failed;
+        msg->operation = purc_variant_make_string_static(op, false);
+        if (msg->operation == NULL)
+            goto failed;
+    }
+    else if ((flags & F_OPERATION) &&
+            (p = read_variant(p, end, &msg->operation)) == NULL) {
+        goto failed;
+    }
+
+    if ((flags & F_REQUEST_ID) &&
+            (p = read_variant(p, end, &msg->requestId)) == NULL)
+        goto failed;
+    if ((flags & F_SOURCE_URI) &&
+            (p = read_variant(p, end, &msg->sourceURI)) == NULL)
+        goto failed;
+
+    if (flags & F_ELEMENT_HANDLE) {
+        char buff[LEN_BUFF_LONGLONGINT];
+        int n = snprintf(buff, sizeof(buff), "%llx",
+                (unsigned long long int)get_u64(header + 32));
+        msg->elementValue = purc_variant_make_string_ex(buff, n, false);
+        if (msg->elementValue == NULL)
+            goto failed;
+    }
+    else if ((flags & F_ELEMENT) &&
+            (p = read_variant(p, end, &msg->elementValue)) == NULL) {
+        goto failed;
+    }
+
+    if ((flags & F_PROPERTY) &&
+            (p = read_variant(p, end, &msg->property)) == NULL)
+        goto failed;
+
+    if (msg->dataType != PCRDR_MSG_DATA_TYPE_VOID) {
+        const char *data;
+        size_t len;
+
+        if ((p = read_string(p, end, &data, &len)) == NULL)
+            goto failed;
+
+        msg->__data_len = len;
+        if (msg->dataType == PCRDR_MSG_DATA_TYPE_JSON)
+            msg->data = purc_variant_make_from_json_string(data, len);
+        else
+            msg->data = purc_variant_make_string_ex(data, len, true);
+
+        if (msg->data == NULL)
+            goto failed;
+    }
+
+    *msg_out = msg;
+    return 0;
+
+failed:
+    pcrdr_release_message(msg);
+    purc_set_error(PCRDR_ERROR_BAD_MESSAGE);
+    return -1;
+}
+
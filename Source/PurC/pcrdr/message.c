@@ -26,6 +26,7 @@
 #include "config.h"
 #include "private/pcrdr.h"
 #include "private/instance.h"
+#include "private/variant.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -364,6 +365,10 @@ pcrdr_msg *pcrdr_clone_message(const pcrdr_msg *src)
         msg->data = purc_variant_ref(src->data);
     }
 
+    if (src->__packet) {
+        msg->__packet = pcrdr_packet_ref(src->__packet);
+    }
+
     return msg;
 }
 
@@ -448,6 +453,14 @@ _COMPILE_TIME_ASSERT(targets,
         PCA_TABLESIZE(target_names) == PCRDR_MSG_TARGET_NR);
 #undef _COMPILE_TIME_ASSERT
 
+/* refer to the packet directly if the message is parsed in place */
+static inline purc_variant_t make_string(pcrdr_msg *msg, const char *value)
+{
+    if (msg->__packet)
+        return pcvariant_make_string_in_packet(msg->__packet, value, true);
+    return purc_variant_make_string(value, true);
+}
+
 static bool on_target(pcrdr_msg *msg, char *value)
 {
     char *target, *target_value;
@@ -483,7 +496,7 @@ static bool on_target(pcrdr_msg *msg, char *value)
 
 static bool on_operation(pcrdr_msg *msg, char *value)
 {
-    msg->operation = purc_variant_make_string(value, true);
+    msg->operation = make_string(msg, value);
     if (msg->operation)
         return true;
     return false;
@@ -491,7 +504,7 @@ static bool on_operation(pcrdr_msg *msg, char *value)
 
 static bool on_event_name(pcrdr_msg *msg, char *value)
 {
-    msg->eventName = purc_variant_make_string(value, true);
+    msg->eventName = make_string(msg, value);
     if (msg->eventName)
         return true;
     return false;
@@ -499,7 +512,7 @@ static bool on_event_name(pcrdr_msg *msg, char *value)
 
 static bool on_source_uri(pcrdr_msg *msg, char *value)
 {
-    msg->sourceURI = purc_variant_make_string(value, true);
+    msg->sourceURI = make_string(msg, value);
     if (msg->sourceURI)
         return true;
     return false;
@@ -546,7 +559,7 @@ static bool on_element(pcrdr_msg *msg, char *value)
     if (element_value == NULL)
         return false;
 
-    msg->elementValue = purc_variant_make_string(element_value, true);
+    msg->elementValue = make_string(msg, element_value);
     if (msg->elementValue)
         return true;
     return false;
@@ -554,7 +567,7 @@ static bool on_element(pcrdr_msg *msg, char *value)
 
 static bool on_property(pcrdr_msg *msg, char *value)
 {
-    msg->property = purc_variant_make_string(value, true);
+    msg->property = make_string(msg, value);
     if (msg->property)
         return true;
     return false;
@@ -562,7 +575,7 @@ static bool on_property(pcrdr_msg *msg, char *value)
 
 static bool on_request_id(pcrdr_msg *msg, char *value)
 {
-    msg->requestId = purc_variant_make_string(value, true);
+    msg->requestId = make_string(msg, value);
     if (msg->requestId)
         return true;
     return false;
@@ -694,7 +707,8 @@ found:
     return key_ops[mid].op;
 }
 
-int pcrdr_parse_packet(char *packet, size_t sz_packet, pcrdr_msg **msg_out)
+static int parse_packet(char *packet, size_t sz_packet, pcrdr_msg **msg_out,
+        bool in_place)
 {
     pcrdr_msg *msg;
 
@@ -703,13 +717,14 @@ int pcrdr_parse_packet(char *packet, size_t sz_packet, pcrdr_msg **msg_out)
     char *saveptr1;
     char *data;
 
-    UNUSED_PARAM(sz_packet);
-
     if ((msg = pcinst_get_message()) == NULL) {
         purc_set_error(PCRDR_ERROR_NOMEM);
         return -1;
     }
 
+    if (in_place)
+        msg->__packet = pcrdr_packet_ref(packet);
+
     for (str1 = packet; ; str1 = NULL) {
         line = strtok_r(str1, STR_LINE_SEPARATOR, &saveptr1);
         if (line == NULL) {
@@ -764,7 +779,17 @@ int pcrdr_parse_packet(char *packet, size_t sz_packet, pcrdr_msg **msg_out)
     else {  /* for other text types */
         // FIXME: check __data_len ???
         assert(data != NULL /* && msg->__data_len > 0 */);
-        msg->data = purc_variant_make_string_ex(data, msg->__data_len, true);
+        if (msg->__packet && data + msg->__data_len < packet + sz_packet &&
+                data[msg->__data_len] == '\0' &&
+                memchr(data, '\0', msg->__data_len) == NULL) {
+            /* the data is null-terminated at the end of the packet */
+            msg->data = pcvariant_make_string_in_packet(msg->__packet,
+                    data, true);
+        }
+        else {
+            msg->data = purc_variant_make_string_ex(data, msg->__data_len,
+                    true);
+        }
 
         if (msg->data == NULL) {
             goto failed;
@@ -775,15 +800,22 @@ int pcrdr_parse_packet(char *packet, size_t sz_packet, pcrdr_msg **msg_out)
     return 0;
 
 failed:
-    for (int i = 0; i < PCRDR_NR_MSG_VARIANTS; i++) {
-        if (msg->variants[i])
-            purc_variant_unref(msg->variants[i]);
-    }
-
+    pcrdr_release_message(msg);
     purc_set_error(PCRDR_ERROR_BAD_MESSAGE);
     return -1;
 }
 
+int pcrdr_parse_packet(char *packet, size_t sz_packet, pcrdr_msg **msg_out)
+{
+    return parse_packet(packet, sz_packet, msg_out, false);
+}
+
+int pcrdr_parse_packet_in_place(char *packet, size_t sz_packet,
+        pcrdr_msg **msg_out)
+{
+    return parse_packet(packet, sz_packet, msg_out, true);
+}
+
 #define LEN_BUFF_LONGLONGINT    128
 
 static int
@@ -1266,8 +1298,13 @@ pcrdr_parse_renderer_capabilities(const char *data)
                 rdr_caps->windowLevel = 0;
             }
 #endif
-            PC_WARN("Unknown renderer capability: %s\n", cap);
-            break;
+            if (pcutils_strcasecmp(cap, "binaryMessage") == 0) {
+                rdr_caps->binaryMessage = strtol(value, NULL, 10);
+            }
+            else {
+                PC_WARN("Unknown renderer capability: %s\n", cap);
+                break;
+            }
         }
 
         line_no++;
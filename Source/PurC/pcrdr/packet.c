@@ -0,0 +1,186 @@
+/*
+ * packet.c -- The receive pool of the packets of a renderer connection.
+ *
+ * Copyright (C) 2022 FMSoft (http://www.fmsoft.cn)
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "purc-pcrdr.h"
+#include "private/instance.h"
+#include "private/pcrdr.h"
+#include "private/debug.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+/* the max number of the free packets kept by a pool */
+#define MAX_FREE_PACKETS        8
+
+struct pcrdr_packet {
+    /* the pool this packet is got from */
+    struct pcrdr_packet_pool   *pool;
+    /* the next one in the free list */
+    struct pcrdr_packet        *next;
+
+    atomic_uint     refc;
+    size_t          sz;
+
+    char            data[];
+};
+
+/*
+ * The pool is used by the instance which owns the connection only, but
+ * a packet may be released in another instance if a message referring
+ * to it was moved; in that case, the packet is freed instead of being
+ * put back to the pool. The pool is referenced by the connection and
+ * every packet in use, so it outlives the connection if needed.
+ */
+struct pcrdr_packet_pool {
+    atomic_uint             refc;
+    struct pcinst          *owner;
+    bool                    closed;
+
+    size_t                  nr_free;
+    struct pcrdr_packet    *free_list;
+
+    size_t                  nr_allocated;
+};
+
+#define PACKET_OF(data)     \
+    ((struct pcrdr_packet *)((data) - offsetof(struct pcrdr_packet, data)))
+
+struct pcrdr_packet_pool *pcrdr_packet_pool_new(void)
+{
+    struct pcrdr_packet_pool *pool = calloc(1, sizeof(*pool));
+    if (pool == NULL) {
+        purc_set_error(PCRDR_ERROR_NOMEM);
+        return NULL;
+    }
+
+    atomic_init(&pool->refc, 1);
+    pool->owner = pcinst_current();
+    return pool;
+}
+
+static void pool_unref(struct pcrdr_packet_pool *pool)
+{
+    if (atomic_fetch_sub(&pool->refc, 1) == 1) {
+        PC_ASSERT(pool->free_list == NULL);
+        free(pool);
+    }
+}
+
+void pcrdr_packet_pool_delete(struct pcrdr_packet_pool *pool)
+{
+    struct pcrdr_packet *packet = pool->free_list;
+
+    while (packet) {
+        struct pcrdr_packet *next = packet->next;
+        free(packet);
+        packet = next;
+    }
+
+    pool->free_list = NULL;
+    pool->nr_free = 0;
+    pool->closed = true;
+    pool_unref(pool);
+}
+
+char *pcrdr_packet_get(struct pcrdr_packet_pool *pool, size_t sz)
+{
+    struct pcrdr_packet *packet = pool->free_list;
+
+    if (packet) {
+        pool->free_list = packet->next;
+        pool->nr_free--;
+
+        if (packet->sz < sz) {
+            struct pcrdr_packet *p;
+            p = realloc(packet, sizeof(*packet) + sz);
+            if (p == NULL) {
+                free(packet);
+                purc_set_error(PCRDR_ERROR_NOMEM);
+                return NULL;
+            }
+            packet = p;
+            packet->sz = sz;
+            pool->nr_allocated++;
+        }
+    }
+    else {
+        if (sz < PCRDR_DEF_PACKET_BUFF_SIZE)
+            sz = PCRDR_DEF_PACKET_BUFF_SIZE;
+
+        packet = malloc(sizeof(*packet) + sz);
+        if (packet == NULL) {
+            purc_set_error(PCRDR_ERROR_NOMEM);
+            return NULL;
+        }
+        packet->sz = sz;
+        pool->nr_allocated++;
+    }
+
+    packet->pool = pool;
+    packet->next = NULL;
+    atomic_init(&packet->refc, 1);
+    atomic_fetch_add(&pool->refc, 1);
+    return packet->data;
+}
+
+char *pcrdr_packet_ref(char *data)
+{
+    struct pcrdr_packet *packet = PACKET_OF(data);
+
+    atomic_fetch_add(&packet->refc, 1);
+    return data;
+}
+
+void pcrdr_packet_unref(char *data)
+{
+    struct pcrdr_packet *packet = PACKET_OF(data);
+
+    if (atomic_fetch_sub(&packet->refc, 1) > 1)
+        return;
+
+    struct pcrdr_packet_pool *pool = packet->pool;
+    if (pool->owner == pcinst_current() && !pool->closed &&
+            pool->nr_free < MAX_FREE_PACKETS) {
+        packet->next = pool->free_list;
+        pool->free_list = packet;
+        pool->nr_free++;
+    }
+    else {
+        free(packet);
+    }
+
+    pool_unref(pool);
+}
+
+void pcrdr_message_detach_packet(pcrdr_msg *msg)
+{
+    /* the strings parsed in place hold their own references */
+    pcrdr_packet_unref(msg->__packet);
+    msg->__packet = NULL;
+}
+
+size_t pcrdr_packet_pool_allocated(struct pcrdr_packet_pool *pool)
+{
+    return pool->nr_allocated;
+}
+
@@ -106,6 +106,14 @@ const char *pcrdr_operation_from_atom(purc_atom_t op_atom, unsigned int *id)
     return NULL;
 }
 
+const char *pcrdr_operation_from_id(unsigned int id)
+{
+    if (id < PCA_TABLESIZE(pcrdr_opatoms))
+        return pcrdr_opatoms[id].op;
+
+    return NULL;
+}
+
 purc_atom_t pcrdr_try_operation_atom(const char *op)
 {
     return purc_atom_try_string_ex(ATOM_BUCKET_RDROP, op);
@@ -216,6 +224,21 @@ static int _init_instance(struct pcinst *curr_inst,
         purc_variant_unref(vs[i * 2 + 1]);
     }
 
+    /* ask for the binary messages if the renderer supports them */
+    bool binary_msg = (rdr_prot == PURC_RDRPROT_PURCMC &&
+            inst->rdr_caps->binaryMessage >= PCRDR_BINARY_MSG_VERSION);
+    if (binary_msg) {
+        purc_variant_t ver = purc_variant_make_ulongint(
+                PCRDR_BINARY_MSG_VERSION);
+        if (ver == PURC_VARIANT_INVALID) {
+            purc_variant_unref(session_data);
+            goto failed;
+        }
+        purc_variant_object_set_by_static_ckey(session_data,
+                "binaryMessage", ver);
+        purc_variant_unref(ver);
+    }
+
     msg->dataType = PCRDR_MSG_DATA_TYPE_JSON;
     msg->data = session_data;
 
@@ -229,6 +252,8 @@ static int _init_instance(struct pcinst *curr_inst,
     int ret_code = response_msg->retCode;
     if (ret_code == PCRDR_SC_OK) {
         inst->rdr_caps->session_handle = response_msg->resultValue;
+        /* the following messages are sent in the binary format */
+        inst->conn_to_rdr->binary_msg = binary_msg;
     }
 
     pcrdr_release_message(response_msg);
@@ -24,6 +24,7 @@
 
 #include "config.h"
 #include "purc-pcrdr.h"
+#include "private/pcrdr.h"
 #include "private/list.h"
 #include "private/debug.h"
 #include "private/utils.h"
@@ -86,6 +87,9 @@ static int my_wait_message (pcrdr_conn* conn, int timeout_ms)
     return select (conn->fd + 1, &rfds, NULL, NULL, NULL);
 }
 
+static int read_packet_alloc (pcrdr_conn* conn, struct pcrdr_packet_pool *pool,
+        void **packet, size_t *sz_packet);
+
 static pcrdr_msg *my_read_message (pcrdr_conn* conn)
 {
     void* packet;
@@ -93,7 +97,13 @@ static pcrdr_msg *my_read_message (pcrdr_conn* conn)
     pcrdr_msg* msg = NULL;
     int err_code = 0, retval;
 
-    retval = pcrdr_purcmc_read_packet_alloc (conn, &packet, &data_len);
+    if (conn->packet_pool == NULL &&
+            (conn->packet_pool = pcrdr_packet_pool_new ()) == NULL) {
+        return NULL;
+    }
+
+    /* the messages parsed in place refer to the pooled packets */
+    retval = read_packet_alloc (conn, conn->packet_pool, &packet, &data_len);
     if (retval) {
         PC_DEBUG ("Failed to read packet\n");
         goto done;
@@ -104,8 +114,11 @@ static pcrdr_msg *my_read_message (pcrdr_conn* conn)
         goto done;
     }
 
-    retval = pcrdr_parse_packet (packet, data_len, &msg);
-    free (packet);
+    if (pcrdr_is_binary_packet (packet, data_len))
+        retval = pcrdr_parse_binary_packet (packet, data_len, &msg);
+    else
+        retval = pcrdr_parse_packet_in_place (packet, data_len, &msg);
+    pcrdr_packet_unref (packet);
 
     if (retval < 0) {
         err_code = PCRDR_ERROR_BAD_MESSAGE;
@@ -133,7 +146,13 @@ static int my_send_message (pcrdr_conn* conn, pcrdr_msg *msg)
     buffer = purc_rwstream_new_buffer (PCRDR_MIN_PACKET_BUFF_SIZE,
             PCRDR_MAX_INMEM_PAYLOAD_SIZE);
 
-    if (pcrdr_serialize_message (msg,
+    if (conn->binary_msg) {
+        if (pcrdr_serialize_message_binary (msg,
+                    (pcrdr_cb_write)purc_rwstream_write, buffer) < 0) {
+            goto done;
+        }
+    }
+    else if (pcrdr_serialize_message (msg,
                 (pcrdr_cb_write)purc_rwstream_write, buffer) < 0) {
         goto done;
     }
@@ -141,7 +160,11 @@ static int my_send_message (pcrdr_conn* conn, pcrdr_msg *msg)
     size_t packet_len;
     const char * packet = purc_rwstream_get_mem_buffer (buffer, &packet_len);
 
-    if (pcrdr_purcmc_send_text_packet (conn, packet, packet_len) < 0) {
+    if (conn->binary_msg) {
+        if (pcrdr_purcmc_send_binary_packet (conn, packet, packet_len) < 0)
+            goto done;
+    }
+    else if (pcrdr_purcmc_send_text_packet (conn, packet, packet_len) < 0) {
         goto done;
     }
 
@@ -450,7 +473,9 @@ done:
     return err_code;
 }
 
-int pcrdr_purcmc_read_packet_alloc (pcrdr_conn* conn, void **packet, size_t *sz_packet)
+/* read a packet into a new buffer, or a buffer got from the pool if any */
+static int read_packet_alloc (pcrdr_conn* conn, struct pcrdr_packet_pool *pool,
+        void **packet, size_t *sz_packet)
 {
     char* packet_buf = NULL;
     int err_code = 0;
@@ -516,7 +541,11 @@ int pcrdr_purcmc_read_packet_alloc (pcrdr_conn* conn, void **packet, size_t *sz_
                 left = 0;
             }
 
-            if ((packet_buf = malloc (total_len + 1)) == NULL) {
+            if (pool)
+                packet_buf = pcrdr_packet_get (pool, total_len + 1);
+            else
+                packet_buf = malloc (total_len + 1);
+            if (packet_buf == NULL) {
                 err_code = PCRDR_ERROR_NOMEM;
                 goto done;
             }
@@ -583,7 +612,9 @@ int pcrdr_purcmc_read_packet_alloc (pcrdr_conn* conn, void **packet, size_t *sz_
 
 done:
     if (err_code) {
-        if (packet_buf)
+        if (packet_buf && pool)
+            pcrdr_packet_unref (packet_buf);
+        else if (packet_buf)
             free (packet_buf);
 
         *packet = NULL;
@@ -595,7 +626,13 @@ done:
     return 0;
 }
 
-int pcrdr_purcmc_send_text_packet (pcrdr_conn* conn, const char* text, size_t len)
+int pcrdr_purcmc_read_packet_alloc (pcrdr_conn* conn, void **packet, size_t *sz_packet)
+{
+    return read_packet_alloc (conn, NULL, packet, sz_packet);
+}
+
+static int send_packet (pcrdr_conn* conn, int opcode,
+        const char* text, size_t len)
 {
     int retv = 0;
 
@@ -607,7 +644,7 @@ int pcrdr_purcmc_send_text_packet (pcrdr_conn* conn, const char* text, size_t le
 
             do {
                 if (left == len) {
-                    header.op = US_OPCODE_TEXT;
+                    header.op = opcode;
                     header.fragmented = len;
                     header.sz_payload = PCRDR_MAX_FRAME_PAYLOAD_SIZE;
                     left -= PCRDR_MAX_FRAME_PAYLOAD_SIZE;
@@ -633,7 +670,7 @@ int pcrdr_purcmc_send_text_packet (pcrdr_conn* conn, const char* text, size_t le
             } while (left > 0 && retv == 0);
         }
         else {
-            header.op = US_OPCODE_TEXT;
+            header.op = opcode;
             header.fragmented = 0;
             header.sz_payload = len;
             if (conn_write (conn->fd, &header, sizeof (USFrameHeader)) == 0)
@@ -650,6 +687,17 @@ int pcrdr_purcmc_send_text_packet (pcrdr_conn* conn, const char* text, size_t le
     return retv;
 }
 
+int pcrdr_purcmc_send_text_packet (pcrdr_conn* conn, const char* text, size_t len)
+{
+    return send_packet (conn, US_OPCODE_TEXT, text, len);
+}
+
+int pcrdr_purcmc_send_binary_packet (pcrdr_conn* conn,
+        const void* data, size_t len)
+{
+    return send_packet (conn, US_OPCODE_BIN, data, len);
+}
+
 #define SCHEMA_UNIX_SOCKET  "unix://"
 
 pcrdr_msg *pcrdr_purcmc_connect(const char* renderer_uri,
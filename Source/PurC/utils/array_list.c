@@ -261,3 +261,25 @@ pcutils_array_list_sort(struct pcutils_array_list *al,
     }
 }
 
+int
+pcutils_array_list_reorder(struct pcutils_array_list *al,
+        const size_t *order)
+{
+    if (al->nr == 0)
+        return 0;
+
+    struct pcutils_array_list_node **nodes;
+    nodes = (struct pcutils_array_list_node**)malloc(al->sz * sizeof(*nodes));
+    if (!nodes)
+        return -1;
+
+    for (size_t i=0; i<al->nr; ++i) {
+        nodes[i] = al->nodes[order[i]];
+        nodes[i]->idx = i;
+    }
+
+    free(al->nodes);
+    al->nodes = nodes;
+
+    return 0;
+}
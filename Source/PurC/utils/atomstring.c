@@ -22,29 +22,76 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "config.h"
+
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
+/* the lookups are lock-free; this needs C11 (stdatomic.h) or above */
+#if HAVE(STDATOMIC_H)           /* { */
+#include <stdatomic.h>
+#else                           /* }{ */
+#error "Not implemented for this platform."
+#endif                          /* } */
+
 #include "purc-ports.h"
 #include "purc-utils.h"
 #include "purc-errors.h"
 #include "private/instance.h"
-#include "private/map.h"
 #include "private/utils.h"
 
 #if PURC_ATOM_BUCKET_BITS > 16
 #error "Too many bits reserved for bucket"
 #endif
 
+/*
+ * The atoms of a bucket are indexed by an open-addressing hash table with
+ * linear probing. Readers never take a lock: a slot is published with a
+ * release store once the entry it points to is complete, and an entry never
+ * moves or goes away before the module is cleaned up.
+ *
+ * The writers are serialized by atom_mutex. The table is append-only:
+ * removing a string only clears the atom of its entry, and the slot of
+ * a removed entry may be taken by a new one later. When the table grows,
+ * the live entries are copied to a new table and the old one is retired;
+ * the retired tables and quark arrays are kept until the cleanup, since
+ * a reader may still be walking them.
+ */
+struct atom_entry {
+    const char                 *string;
+    uint32_t                    hash;
+    bool                        need_free;
+
+    /* 0 after the string was removed */
+    _Atomic(purc_atom_t)        atom;
+
+    /* all the entries of the bucket, for the cleanup */
+    struct atom_entry          *next;
+};
+
+struct atom_table {
+    struct atom_table          *retired;
+    size_t                      mask;
+    size_t                      nr_used;    /* live and removed entries */
+    _Atomic(struct atom_entry *) slots[];
+};
+
+struct atom_quarks {
+    struct atom_quarks         *retired;
+    size_t                      size;
+    _Atomic(const char *)       strings[];
+};
+
 static struct atom_bucket {
-    purc_atom_t     bucket_bits;
-    purc_atom_t     atom_seq_id;
+    _Atomic(purc_atom_t)                atom_seq_id;
+    _Atomic(struct atom_table *)        table;
+    _Atomic(struct atom_quarks *)       quarks;
 
-    pcutils_map    *atom_map;
-    char**          quarks;
+    struct atom_entry                  *entries;
 } atom_buckets[PURC_ATOM_BUCKETS_NR];
 
 #define ATOM_BITS_NR        (sizeof(purc_atom_t) << 3)
@@ -63,67 +110,150 @@ static struct atom_bucket {
 
 #define ATOM_BLOCK_SIZE         (1024 >> PURC_ATOM_BUCKET_BITS)
 #define ATOM_STRING_BLOCK_SIZE  (4096 - sizeof (size_t))
+#define ATOM_TABLE_MIN_SIZE     64
 
-static inline purc_atom_t
-atom_new(struct atom_bucket *bucket, char *string, bool need_free);
-
-static purc_rwlock atom_rwlock;
+static purc_mutex atom_mutex;
 static char *atom_block = NULL;
 static int  atom_block_offset = 0;
 
-static void atom_init_bucket(struct atom_bucket *bucket)
+/* one-at-a-time hash of a null-terminated string */
+static inline uint32_t
+atom_hash(const char *string)
 {
-    assert (bucket->atom_seq_id == 0);
+    uint32_t hash = 0;
 
-    bucket->atom_map = pcutils_map_create(NULL, NULL, NULL, NULL,
-            comp_key_string, false);
-    bucket->quarks = (char **)malloc(sizeof(char *) * ATOM_BLOCK_SIZE);
-    bucket->quarks[0] = NULL;
-    bucket->atom_seq_id = 1;
+    for (const unsigned char *p = (const unsigned char *)string; *p; p++) {
+        hash += *p;
+        hash += (hash << 10);
+        hash ^= (hash >> 6);
+    }
+
+    hash += (hash << 3);
+    hash ^= (hash >> 11);
+    hash += (hash << 15);
 
-    assert(bucket->quarks != NULL);
+    return hash;
 }
 
-static inline struct atom_bucket *atom_get_bucket(int bucket)
+static struct atom_table *
+atom_table_new(size_t size)
 {
-    assert(bucket >= 0 && bucket < PURC_ATOM_BUCKETS_NR);
+    struct atom_table *table;
+
+    table = calloc(1, sizeof(*table) + size * sizeof(table->slots[0]));
+    if (table)
+        table->mask = size - 1;
+
+    return table;
+}
 
-    struct atom_bucket *atom_bucket = atom_buckets + bucket;
-    if (UNLIKELY(atom_bucket->atom_seq_id == 0)) {
-        atom_init_bucket(atom_bucket);
-        atom_bucket->bucket_bits = BUCKET_BITS(bucket);
+static struct atom_quarks *
+atom_quarks_new(size_t size)
+{
+    struct atom_quarks *quarks;
+
+    quarks = calloc(1, sizeof(*quarks) + size * sizeof(quarks->strings[0]));
+    if (quarks)
+        quarks->size = size;
+
+    return quarks;
+}
+
+/* HOLDS: atom_mutex */
+static int atom_init_bucket(struct atom_bucket *bucket)
+{
+    assert(atomic_load_explicit(&bucket->table, memory_order_relaxed) == NULL);
+
+    struct atom_table *table = atom_table_new(ATOM_TABLE_MIN_SIZE);
+    struct atom_quarks *quarks = atom_quarks_new(ATOM_BLOCK_SIZE);
+    if (table == NULL || quarks == NULL) {
+        free(table);
+        free(quarks);
+        return -1;
     }
 
-    return atom_bucket;
+    atomic_store_explicit(&bucket->atom_seq_id, 1, memory_order_relaxed);
+    atomic_store_explicit(&bucket->quarks, quarks, memory_order_release);
+    atomic_store_explicit(&bucket->table, table, memory_order_release);
+    return 0;
 }
 
-static inline void atom_put_bucket(int bucket)
+static inline struct atom_bucket *atom_get_bucket(int bucket)
 {
     assert(bucket >= 0 && bucket < PURC_ATOM_BUCKETS_NR);
+    return atom_buckets + bucket;
+}
 
-    struct atom_bucket *atom_bucket = atom_buckets + bucket;
-    if (LIKELY(atom_bucket->atom_map)) {
-        pcutils_map_destroy(atom_bucket->atom_map);
-        free(atom_bucket->quarks);
-        memset(atom_bucket, 0, sizeof(*atom_bucket));
+static void atom_put_bucket(struct atom_bucket *bucket)
+{
+    struct atom_table *table, *retired_table;
+    table = atomic_load_explicit(&bucket->table, memory_order_relaxed);
+    while (table) {
+        retired_table = table->retired;
+        free(table);
+        table = retired_table;
+    }
+
+    struct atom_quarks *quarks, *retired_quarks;
+    quarks = atomic_load_explicit(&bucket->quarks, memory_order_relaxed);
+    while (quarks) {
+        retired_quarks = quarks->retired;
+        free(quarks);
+        quarks = retired_quarks;
+    }
+
+    struct atom_entry *entry = bucket->entries, *next;
+    while (entry) {
+        next = entry->next;
+        if (entry->need_free)
+            free((char *)entry->string);
+        free(entry);
+        entry = next;
+    }
+
+    memset(bucket, 0, sizeof(*bucket));
+}
+
+/* Returns the live entry of string, or NULL; safe without atom_mutex. */
+static struct atom_entry *
+atom_find(struct atom_table *table, const char *string, uint32_t hash,
+        purc_atom_t *atom)
+{
+    size_t i = hash & table->mask;
+
+    for (;; i = (i + 1) & table->mask) {
+        struct atom_entry *entry;
+        entry = atomic_load_explicit(&table->slots[i], memory_order_acquire);
+        if (entry == NULL)
+            break;
+
+        if (entry->hash != hash)
+            continue;
+
+        purc_atom_t a;
+        a = atomic_load_explicit(&entry->atom, memory_order_acquire);
+        if (a && strcmp(entry->string, string) == 0) {
+            *atom = a;
+            return entry;
+        }
     }
+
+    return NULL;
 }
 
 purc_atom_t
 purc_atom_try_string_ex(int bucket, const char *string)
 {
     struct atom_bucket *atom_bucket = atom_get_bucket(bucket);
-    const pcutils_map_entry* entry = NULL;
     purc_atom_t atom = 0;
 
     if (string == NULL || atom_bucket == NULL)
         return 0;
 
-    purc_rwlock_reader_lock(&atom_rwlock);
-    if ((entry = pcutils_map_find(atom_bucket->atom_map, string))) {
-        atom = (purc_atom_t)(uintptr_t)entry->val;
-    }
-    purc_rwlock_reader_unlock(&atom_rwlock);
+    struct atom_table *table;
+    table = atomic_load_explicit(&atom_bucket->table, memory_order_acquire);
+    if (table)
+        atom_find(table, string, atom_hash(string), &atom);
 
     return atom;
 }
@@ -136,27 +266,30 @@ purc_atom_remove_string_ex(int bucket, const char *string)
     if (string == NULL || atom_bucket == NULL)
         return false;
 
-    const pcutils_map_entry* entry;
-    bool ret;
+    struct atom_table *table;
+    struct atom_entry *entry = NULL;
     purc_atom_t atom;
 
-    purc_rwlock_writer_lock(&atom_rwlock);
-    if ((entry = pcutils_map_find(atom_bucket->atom_map, string))) {
-        atom = (purc_atom_t)(uintptr_t)entry->val;
-        pcutils_map_erase(atom_bucket->atom_map, (void *)string);
+    purc_mutex_lock(&atom_mutex);
+    table = atomic_load_explicit(&atom_bucket->table, memory_order_relaxed);
+    if (table)
+        entry = atom_find(table, string, atom_hash(string), &atom);
+    if (entry) {
+        struct atom_quarks *quarks;
+        quarks = atomic_load_explicit(&atom_bucket->quarks,
+                memory_order_relaxed);
+
+        atomic_store_explicit(&entry->atom, 0, memory_order_release);
         atom = ATOM_TO_SEQUENCE(atom);
-        atom_bucket->quarks[atom] = NULL;
-        ret = true;
+        atomic_store_explicit(&quarks->strings[atom], NULL,
+                memory_order_release);
     }
-    else {
-        ret = false;
-    }
-    purc_rwlock_writer_unlock(&atom_rwlock);
+    purc_mutex_unlock(&atom_mutex);
 
-    return ret;
+    return entry != NULL;
 }
 
-/* HOLDS: atom_rwlock_lock */
+/* HOLDS: atom_mutex */
 static char *
 atom_strdup(const char *string, bool *need_free)
 {
@@ -185,45 +318,175 @@ atom_strdup(const char *string, bool *need_free)
     return copy;
 }
 
-/* HOLDS: purc_atom_rwlock_writer_lock */
-static inline purc_atom_t
-atom_from_string(struct atom_bucket *bucket, const char *string,
-        bool duplicate, bool *newly_created)
+/* HOLDS: atom_mutex */
+static int
+atom_grow_table(struct atom_bucket *bucket)
 {
-    purc_atom_t atom = 0;
-    pcutils_map_entry* entry;
+    struct atom_table *table, *new_table;
+    table = atomic_load_explicit(&bucket->table, memory_order_relaxed);
+
+    /* the removed entries are left behind */
+    size_t nr_live = 0;
+    for (size_t i = 0; i <= table->mask; i++) {
+        struct atom_entry *entry;
+        entry = atomic_load_explicit(&table->slots[i], memory_order_relaxed);
+        if (entry && atomic_load_explicit(&entry->atom, memory_order_relaxed))
+            nr_live++;
+    }
 
-    entry = pcutils_map_find(bucket->atom_map, string);
-    if (entry) {
-        atom = (purc_atom_t)(uintptr_t)entry->val;
-        assert(atom);
+    size_t size = ATOM_TABLE_MIN_SIZE;
+    while (size < nr_live * 4)
+        size <<= 1;
+
+    new_table = atom_table_new(size);
+    if (new_table == NULL)
+        return -1;
+
+    for (size_t i = 0; i <= table->mask; i++) {
+        struct atom_entry *entry;
+        entry = atomic_load_explicit(&table->slots[i], memory_order_relaxed);
+        if (entry == NULL ||
+                !atomic_load_explicit(&entry->atom, memory_order_relaxed))
+            continue;
+
+        size_t j = entry->hash & new_table->mask;
+        while (atomic_load_explicit(&new_table->slots[j],
+                    memory_order_relaxed))
+            j = (j + 1) & new_table->mask;
+        atomic_store_explicit(&new_table->slots[j], entry,
+                memory_order_relaxed);
+    }
 
-        if (newly_created)
-            *newly_created = false;
+    new_table->nr_used = nr_live;
+    new_table->retired = table;
+    atomic_store_explicit(&bucket->table, new_table, memory_order_release);
+    return 0;
+}
+
+/* HOLDS: atom_mutex */
+static int
+atom_grow_quarks(struct atom_bucket *bucket, purc_atom_t seq)
+{
+    struct atom_quarks *quarks, *new_quarks;
+    quarks = atomic_load_explicit(&bucket->quarks, memory_order_relaxed);
+    if (seq < quarks->size)
+        return 0;
+
+    new_quarks = atom_quarks_new(quarks->size * 2);
+    if (new_quarks == NULL)
+        return -1;
+
+    for (size_t i = 0; i < quarks->size; i++) {
+        const char *string = atomic_load_explicit(&quarks->strings[i],
+                memory_order_relaxed);
+        atomic_store_explicit(&new_quarks->strings[i], string,
+                memory_order_relaxed);
     }
-    else {
-        bool need_free;
-        if (duplicate)
-            string = atom_strdup(string, &need_free);
-        else
-            need_free = false;
-        atom = atom_new(bucket, (char *)string, need_free);
 
-        if (newly_created)
-            *newly_created = true;
+    new_quarks->retired = quarks;
+    atomic_store_explicit(&bucket->quarks, new_quarks, memory_order_release);
+    return 0;
+}
+
+/* HOLDS: atom_mutex */
+static purc_atom_t
+atom_new(struct atom_bucket *bucket, purc_atom_t bucket_bits,
+        const char *string, uint32_t hash, bool duplicate)
+{
+    struct atom_table *table;
+    table = atomic_load_explicit(&bucket->table, memory_order_relaxed);
+    if ((table->nr_used + 1) * 4 > (table->mask + 1) * 3) {
+        if (atom_grow_table(bucket))
+            return 0;
+        table = atomic_load_explicit(&bucket->table, memory_order_relaxed);
     }
 
-    return atom;
+    purc_atom_t seq;
+    seq = atomic_load_explicit(&bucket->atom_seq_id, memory_order_relaxed);
+    assert(IS_VALID_SEQ_ID(seq));
+    if (atom_grow_quarks(bucket, seq))
+        return 0;
+
+    struct atom_entry *entry = malloc(sizeof(*entry));
+    if (entry == NULL)
+        return 0;
+
+    entry->need_free = false;
+    if (duplicate) {
+        string = atom_strdup(string, &entry->need_free);
+        if (string == NULL) {
+            free(entry);
+            return 0;
+        }
+    }
+
+    entry->string = string;
+    entry->hash = hash;
+    atomic_init(&entry->atom, seq | bucket_bits);
+    entry->next = bucket->entries;
+    bucket->entries = entry;
+
+    /* take the first free slot, or the slot of a removed entry */
+    size_t i = hash & table->mask;
+    for (;; i = (i + 1) & table->mask) {
+        struct atom_entry *old;
+        old = atomic_load_explicit(&table->slots[i], memory_order_relaxed);
+        if (old == NULL) {
+            table->nr_used++;
+            break;
+        }
+        if (!atomic_load_explicit(&old->atom, memory_order_relaxed))
+            break;
+    }
+
+    struct atom_quarks *quarks;
+    quarks = atomic_load_explicit(&bucket->quarks, memory_order_relaxed);
+    atomic_store_explicit(&quarks->strings[seq], string,
+            memory_order_relaxed);
+    atomic_store_explicit(&bucket->atom_seq_id, seq + 1,
+            memory_order_release);
+    atomic_store_explicit(&table->slots[i], entry, memory_order_release);
+
+    return seq | bucket_bits;
 }
 
-static inline purc_atom_t
-atom_from_string_locked(struct atom_bucket *bucket, const char *string,
-        bool duplicate, bool *newly_created)
+static purc_atom_t
+atom_from_string(int bucket, const char *string, bool duplicate,
+        bool *newly_created)
 {
+    struct atom_bucket *atom_bucket = atom_get_bucket(bucket);
+    uint32_t hash = atom_hash(string);
+    struct atom_table *table;
     purc_atom_t atom = 0;
-    purc_rwlock_writer_lock(&atom_rwlock);
-    atom = atom_from_string(bucket, string, duplicate, newly_created);
-    purc_rwlock_writer_unlock(&atom_rwlock);
+
+    /* the fast path: the string has been interned already */
+    table = atomic_load_explicit(&atom_bucket->table, memory_order_acquire);
+    if (table && atom_find(table, string, hash, &atom)) {
+        if (newly_created)
+            *newly_created = false;
+        return atom;
+    }
+
+    purc_mutex_lock(&atom_mutex);
+    table = atomic_load_explicit(&atom_bucket->table, memory_order_relaxed);
+    if (table == NULL && atom_init_bucket(atom_bucket) == 0)
+        table = atomic_load_explicit(&atom_bucket->table,
+                memory_order_relaxed);
+
+    if (table == NULL) {
+        atom = 0;
+    }
+    else if (atom_find(table, string, hash, &atom)) {
+        if (newly_created)
+            *newly_created = false;
+    }
+    else {
+        atom = atom_new(atom_bucket, BUCKET_BITS(bucket), string, hash,
+                duplicate);
+        if (newly_created)
+            *newly_created = (atom != 0);
+    }
+    purc_mutex_unlock(&atom_mutex);
 
     return atom;
 }
@@ -234,8 +497,7 @@ purc_atom_from_string_ex2(int bucket, const char *string, bool *newly_created)
     if (!string)
         return 0;
 
-    return atom_from_string_locked(atom_get_bucket(bucket), string,
-            true, newly_created);
+    return atom_from_string(bucket, string, true, newly_created);
 }
 
 purc_atom_t
@@ -245,15 +507,14 @@ purc_atom_from_static_string_ex2(int bucket, const char *string,
     if (!string)
         return 0;
 
-    return atom_from_string_locked(atom_get_bucket(bucket), string,
-            false, newly_created);
+    return atom_from_string(bucket, string, false, newly_created);
 }
 
 const char *
 purc_atom_to_string(purc_atom_t atom)
 {
     int bucket;
-    char* result = NULL;
+    const char* result = NULL;
 
     if (atom == 0)
         return NULL;
@@ -261,61 +522,18 @@ purc_atom_to_string(purc_atom_t atom)
     bucket = ATOM_TO_BUCKET(atom);
     struct atom_bucket *atom_bucket = atom_get_bucket(bucket);
     atom = ATOM_TO_SEQUENCE(atom);
-    purc_rwlock_reader_lock(&atom_rwlock);
-    if (atom < atom_bucket->atom_seq_id)
-        result = atom_bucket->quarks[atom];
-    purc_rwlock_reader_unlock(&atom_rwlock);
 
-    return result;
-}
-
-static void free_dup_key(void *key, void *data)
-{
-    UNUSED_PARAM(data);
-    if (key)
-        free(key);
-}
-
-/* HOLDS: purc_atom_rwlock_writer_lock */
-static inline purc_atom_t
-atom_new(struct atom_bucket *bucket, char *string, bool need_free)
-{
-    purc_atom_t atom;
-    char **atoms_new;
-
-    if (bucket->atom_seq_id % ATOM_BLOCK_SIZE == 0) {
-        atoms_new = (char **)malloc(sizeof (char *) *
-                (bucket->atom_seq_id + ATOM_BLOCK_SIZE));
-        if (bucket->atom_seq_id != 0)
-            memcpy(atoms_new, bucket->quarks,
-                    sizeof (char *) * bucket->atom_seq_id);
-        memset(atoms_new + bucket->atom_seq_id, 0,
-                sizeof (char *) * ATOM_BLOCK_SIZE);
-
-        /*
-         * The implementation in glib did not free the old quarks array.
-         * The author said: `This leaks the old quarks array. Its unfortunate,
-         * but it allows us to do lockless lookup of the arrays, and there
-         * shouldn't be that many quarks in an app`.
-         *
-         * In our implementation, we do free the old quarks.
-         * Indeed, we can use realloc() instead of malloc() and memcpy()
-         */
-        free(bucket->quarks);
-        bucket->quarks = atoms_new;
+    /* the quarks loaded after the sequence identifier covers it */
+    if (atom < atomic_load_explicit(&atom_bucket->atom_seq_id,
+                memory_order_acquire)) {
+        struct atom_quarks *quarks;
+        quarks = atomic_load_explicit(&atom_bucket->quarks,
+                memory_order_acquire);
+        result = atomic_load_explicit(&quarks->strings[atom],
+                memory_order_acquire);
     }
 
-    atom = bucket->atom_seq_id;
-    bucket->quarks[atom] = string;
-    atom |= bucket->bucket_bits;
-    pcutils_map_insert_ex(bucket->atom_map,
-                string, (void *)(uintptr_t)atom,
-                need_free ? free_dup_key : NULL);
-    bucket->atom_seq_id++;
-
-    assert(IS_VALID_SEQ_ID(bucket->atom_seq_id));
-
-    return atom;
+    return result;
 }
 
 static void
@@ -324,11 +542,11 @@ atom_cleanup_once(void)
     int bucket;
 
     for (bucket = 0; bucket < PURC_ATOM_BUCKETS_NR; bucket++) {
-        atom_put_bucket(bucket);
+        atom_put_bucket(atom_get_bucket(bucket));
     }
 
-    if (atom_rwlock.native_impl)
-        purc_rwlock_clear(&atom_rwlock);
+    if (atom_mutex.native_impl)
+        purc_mutex_clear(&atom_mutex);
     if (atom_block)
         free(atom_block);
 }
@@ -338,12 +556,12 @@ atom_init_once(void)
 {
     int r = 0;
 
-    purc_rwlock_init(&atom_rwlock);
-    if (atom_rwlock.native_impl == NULL)
+    purc_mutex_init(&atom_mutex);
+    if (atom_mutex.native_impl == NULL)
         goto fail_lock;
 
     /* init the default bucket only */
-    if (!atom_get_bucket(0))
+    if (atom_init_bucket(atom_get_bucket(0)))
         goto fail_atom;
 
     r = atexit(atom_cleanup_once);
@@ -353,14 +571,14 @@ atom_init_once(void)
     return 0;
 
 fail_atexit:
-    atom_put_bucket(0);
+    atom_put_bucket(atom_get_bucket(0));
     if (atom_block) {
         free(atom_block);
         atom_block = NULL;
     }
 
 fail_atom:
-    purc_rwlock_clear(&atom_rwlock);
+    purc_mutex_clear(&atom_mutex);
 
 fail_lock:
     return -1;
@@ -373,4 +591,3 @@ struct pcmodule _module_atom = {
     .init_once       = atom_init_once,
     .init_instance   = NULL,
 };
-
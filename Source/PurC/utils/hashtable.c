@@ -550,7 +550,9 @@ struct pchash_table *pchash_table_new(int size, pchash_entry_free_fn *free_fn, p
         return NULL;
 
     t->count = 0;
+    t->nr_freed = 0;
     t->size = size;
+    t->min_size = size;
     t->table = (struct pchash_entry *)calloc(size, sizeof(struct pchash_entry));
     if (!t->table)
     {
@@ -606,6 +608,7 @@ int pchash_table_resize(struct pchash_table *t, int new_size)
     t->size = new_size;
     t->head = new_t->head;
     t->tail = new_t->tail;
+    t->nr_freed = 0;
     free(new_t);
 
     return 0;
@@ -628,11 +631,26 @@ int pchash_table_insert_w_hash(struct pchash_table *t, const void *k, const void
 {
     unsigned long n;
 
-    if (t->count >= t->size * PCHASH_LOAD_FACTOR)
+    if (t->count + t->nr_freed >= t->size * PCHASH_LOAD_FACTOR)
     {
-        /* Avoid signed integer overflow with large tables. */
-        int new_size = (t->size > INT_MAX / 2) ? INT_MAX : (t->size * 2);
-        if (t->size == INT_MAX || pchash_table_resize(t, new_size) != 0)
+        int new_size;
+        if (t->nr_freed > t->count)
+        {
+            /* Mostly tombstones: rehash, and shrink if sparse enough. */
+            new_size = t->size;
+            while (new_size / 2 >= t->min_size &&
+                    t->count < new_size / 2 * PCHASH_LOAD_FACTOR / 2)
+                new_size /= 2;
+        }
+        else if (t->size == INT_MAX)
+            return -1;
+        else
+        {
+            /* Avoid signed integer overflow with large tables. */
+            new_size = (t->size > INT_MAX / 2) ? INT_MAX : (t->size * 2);
+        }
+
+        if (pchash_table_resize(t, new_size) != 0)
             return -1;
     }
 
@@ -640,8 +658,13 @@ int pchash_table_insert_w_hash(struct pchash_table *t, const void *k, const void
 
     while (1)
     {
-        if (t->table[n].k == PCHASH_EMPTY || t->table[n].k == PCHASH_FREED)
+        if (t->table[n].k == PCHASH_EMPTY)
             break;
+        if (t->table[n].k == PCHASH_FREED)
+        {
+            t->nr_freed--;
+            break;
+        }
         if ((int)++n == t->size)
             n = 0;
     }
@@ -727,6 +750,7 @@ int pchash_table_delete_entry(struct pchash_table *t, struct pchash_entry *e)
         t->free_fn(e);
     t->table[n].v = NULL;
     t->table[n].k = PCHASH_FREED;
+    t->nr_freed++;
     if (t->tail == &t->table[n] && t->head == &t->table[n])
     {
         t->head = t->tail = NULL;
@@ -32,6 +32,7 @@
 #include "private/tls.h"
 #include "private/variant.h"
 #include "private/utf8.h"
+#include "private/pcrdr.h"
 
 #include "variant-internals.h"
 
@@ -339,6 +340,22 @@ purc_variant_t purc_variant_make_string_static(const char* str_utf8,
     return value;
 }
 
+purc_variant_t pcvariant_make_string_in_packet(char *packet,
+        const char *str_utf8, bool check_encoding)
+{
+    PCVARIANT_CHECK_FAIL_RET(packet && str_utf8, PURC_VARIANT_INVALID);
+
+    purc_variant_t value = purc_variant_make_string_static(str_utf8,
+            check_encoding);
+    if (value == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    // VWNOTE: the number of characters is counted on demand.
+    value->flags |= PCVARIANT_FLAG_STRING_PACKET;
+    value->extra_data = pcrdr_packet_ref(packet);
+    return value;
+}
+
 const char* purc_variant_get_string_const_ex(purc_variant_t string,
         size_t *str_len)
 {
@@ -402,7 +419,11 @@ bool purc_variant_string_chars(purc_variant_t string, size_t *nr_chars)
         IS_TYPE(string, PURC_VARIANT_TYPE_ATOMSTRING) ||
         IS_TYPE(string, PURC_VARIANT_TYPE_EXCEPTION)) {
 
-        *nr_chars = string->extra_size;
+        if (string->flags & PCVARIANT_FLAG_STRING_PACKET)
+            *nr_chars = pcutils_string_utf8_chars(
+                    (const char *)string->sz_ptr[1], string->sz_ptr[0] - 1);
+        else
+            *nr_chars = string->extra_size;
         return true;
     }
 
@@ -420,6 +441,9 @@ void pcvariant_string_release (purc_variant_t string)
             pcvariant_stat_set_extra_size (string, 0);
             free ((void *)string->sz_ptr[1]);
         }
+        else if (string->flags & PCVARIANT_FLAG_STRING_PACKET) {
+            pcrdr_packet_unref ((char *)string->extra_data);
+        }
     }
     else
         pcinst_set_error (PCVARIANT_ERROR_INVALID_TYPE);
@@ -29,6 +29,7 @@
 
 #include "private/instance.h"
 #include "private/variant.h"
+#include "private/pcrdr.h"
 
 #include "variant-internals.h"
 
@@ -218,6 +219,10 @@ move_or_clone_immutable(struct pcinst *inst, purc_variant_t v)
             move_heap.stat.sz_mem[v->type] += v->sz_ptr[0];
             move_heap.stat.sz_total_mem += v->sz_ptr[0];
         }
+        else if (v->flags & PCVARIANT_FLAG_STRING_PACKET) {
+            /* the copy refers to the same packet */
+            pcrdr_packet_ref((char *)v->extra_data);
+        }
 
         move_heap.stat.nr_values[v->type]++;
         move_heap.stat.nr_total_values++;
@@ -254,7 +259,7 @@ move_keys_in_cloned_array(struct travel_context *ctxt, purc_variant_t arr)
             break;
 
         case PURC_VARIANT_TYPE_OBJECT:
-            move_keys_in_cloned_array(ctxt, v);
+            move_keys_in_cloned_object(ctxt, v);
             break;
 
         case PURC_VARIANT_TYPE_SET:
@@ -419,7 +424,7 @@ move_or_clone_mutable_descendants_in_array(struct travel_context *ctxt,
 
             move_keys_in_cloned_container(ctxt, retv);
 
-            _p->val = retv;
+            variant_array_member(arr, idx) = retv;
             pcutils_arrlist_append(ctxt->vrts_to_unref, v);
         }
 
@@ -616,7 +621,7 @@ move_or_clone_immutable_descendants_in_array(struct travel_context *ctxt,
         }
 
         if (retv != v) {
-            _p->val = retv;
+            variant_array_member(arr, idx) = retv;
             if (!(v->flags & PCVARIANT_FLAG_NOFREE))
                 pcutils_arrlist_append(ctxt->vrts_to_unref, v);
         }
@@ -730,6 +735,332 @@ move_or_clone_immutable_descendants(struct travel_context *ctxt,
     return true;
 }
 
+/*
+ * An exclusively owned container (every descendant container is only
+ * referenced by its parent) is handed over to another instance without
+ * the move heap: the statistics of the values leave the heap of the sender
+ * and enter the heap of the receiver directly, and the constants are
+ * replaced by the transit ones, which are shared by all instances and never
+ * reference counted. So no lock is needed and nothing is cloned except the
+ * shared immutable descendants.
+ */
+static struct purc_variant transit_undefined = {
+    .type = PURC_VARIANT_TYPE_UNDEFINED, .flags = PCVARIANT_FLAG_NOFREE };
+static struct purc_variant transit_null = {
+    .type = PURC_VARIANT_TYPE_NULL, .flags = PCVARIANT_FLAG_NOFREE };
+static struct purc_variant transit_false = {
+    .type = PURC_VARIANT_TYPE_BOOLEAN, .flags = PCVARIANT_FLAG_NOFREE,
+    .b = false };
+static struct purc_variant transit_true = {
+    .type = PURC_VARIANT_TYPE_BOOLEAN, .flags = PCVARIANT_FLAG_NOFREE,
+    .b = true };
+
+static void
+stat_value(struct pcvariant_heap *heap, purc_variant_t v, bool in)
+{
+    size_t sz = sizeof(purc_variant);
+
+    if (IS_CONTAINER(v->type) ||
+            ((v->type == PURC_VARIANT_TYPE_STRING ||
+                v->type == PURC_VARIANT_TYPE_BSEQUENCE) &&
+            (v->flags & PCVARIANT_FLAG_EXTRA_SIZE))) {
+        sz += v->sz_ptr[0];
+    }
+
+    if (in) {
+        heap->stat.nr_values[v->type]++;
+        heap->stat.nr_total_values++;
+        heap->stat.sz_mem[v->type] += sz;
+        heap->stat.sz_total_mem += sz;
+    }
+    else {
+        heap->stat.nr_values[v->type]--;
+        heap->stat.nr_total_values--;
+        heap->stat.sz_mem[v->type] -= sz;
+        heap->stat.sz_total_mem -= sz;
+    }
+}
+
+static bool is_exclusively_owned(purc_variant_t cntr, int level)
+{
+    purc_variant_t k, v;
+    size_t idx;
+
+    if (cntr->refc != 1 || level > MAX_EMBEDDED_LEVELS)
+        return false;
+
+    switch (cntr->type) {
+    case PURC_VARIANT_TYPE_ARRAY:
+        foreach_value_in_variant_array(cntr, v, idx) {
+            UNUSED_PARAM(idx);
+            if (IS_CONTAINER(v->type) && !is_exclusively_owned(v, level + 1))
+                return false;
+        } end_foreach;
+        break;
+
+    case PURC_VARIANT_TYPE_OBJECT:
+        foreach_key_value_in_variant_object(cntr, k, v) {
+            UNUSED_PARAM(k);
+            if (IS_CONTAINER(v->type) && !is_exclusively_owned(v, level + 1))
+                return false;
+        } end_foreach;
+        break;
+
+    case PURC_VARIANT_TYPE_SET:
+        foreach_value_in_variant_set(cntr, v) {
+            if (IS_CONTAINER(v->type) && !is_exclusively_owned(v, level + 1))
+                return false;
+        } end_foreach;
+        break;
+
+    default:
+        break;
+    }
+
+    return true;
+}
+
+/* replaces a shared immutable value by a private copy; returns NULL on OOM */
+static purc_variant_t
+copy_shared_immutable(struct pcvariant_heap *heap, purc_variant_t v)
+{
+    purc_variant_t retv;
+
+    retv = pcvariant_alloc();
+    if (retv == NULL)
+        return NULL;
+
+    memcpy(retv, v, sizeof(*retv));
+    retv->refc = 1;
+    if ((v->type == PURC_VARIANT_TYPE_STRING ||
+            v->type == PURC_VARIANT_TYPE_BSEQUENCE) &&
+            (v->flags & PCVARIANT_FLAG_EXTRA_SIZE)) {
+        void *buf = malloc(v->sz_ptr[0]);
+        if (buf == NULL) {
+            pcvariant_free(retv);
+            return NULL;
+        }
+        memcpy(buf, (void *)v->sz_ptr[1], v->sz_ptr[0]);
+        retv->sz_ptr[1] = (uintptr_t)buf;
+    }
+    else if (v->flags & PCVARIANT_FLAG_STRING_PACKET) {
+        pcrdr_packet_ref((char *)v->extra_data);
+    }
+
+    /* the copy lives in the heap of the sender until it is handed over */
+    stat_value(heap, retv, true);
+    v->refc--;
+    return retv;
+}
+
+static inline bool is_heap_constant(struct pcvariant_heap *heap,
+        purc_variant_t v)
+{
+    return v == &heap->v_undefined || v == &heap->v_null ||
+        v == &heap->v_false || v == &heap->v_true;
+}
+
+#define PRIVATIZE(heap, slot) do {                                      \
+    purc_variant_t _v = (slot);                                         \
+    if (!IS_CONTAINER(_v->type) && _v->refc > 1 &&                      \
+            !is_heap_constant(heap, _v)) {                              \
+        purc_variant_t _copy = copy_shared_immutable(heap, _v);         \
+        if (_copy == NULL)                                              \
+            return false;                                               \
+        (slot) = _copy;                                                 \
+    }                                                                   \
+} while (0)
+
+/*
+ * Replaces the shared immutable descendants by private copies before
+ * anything is handed over. This is the only step which allocates, and the
+ * tree is still a valid tree of the sender if it fails halfway.
+ */
+static bool
+privatize_shared_immutables(struct pcvariant_heap *heap, purc_variant_t cntr)
+{
+    purc_variant_t k, v;
+    size_t idx;
+
+    switch (cntr->type) {
+    case PURC_VARIANT_TYPE_ARRAY:
+        foreach_value_in_variant_array(cntr, v, idx) {
+            if (IS_CONTAINER(v->type)) {
+                if (!privatize_shared_immutables(heap, v))
+                    return false;
+            }
+            else
+                PRIVATIZE(heap, variant_array_member(cntr, idx));
+        } end_foreach;
+        break;
+
+    case PURC_VARIANT_TYPE_OBJECT:
+        foreach_key_value_in_variant_object(cntr, k, v) {
+            UNUSED_PARAM(k);
+            PRIVATIZE(heap, _node->key);
+            if (IS_CONTAINER(v->type)) {
+                if (!privatize_shared_immutables(heap, v))
+                    return false;
+            }
+            else
+                PRIVATIZE(heap, _node->val);
+        } end_foreach;
+        break;
+
+    case PURC_VARIANT_TYPE_SET:
+        foreach_value_in_variant_set(cntr, v) {
+            if (IS_CONTAINER(v->type)) {
+                if (!privatize_shared_immutables(heap, v))
+                    return false;
+            }
+            else
+                PRIVATIZE(heap, _sn->val);
+        } end_foreach;
+        break;
+
+    default:
+        break;
+    }
+
+    return true;
+}
+
+#undef PRIVATIZE
+
+/* hands over an immutable value; returns the value to replace it */
+static purc_variant_t
+hand_over_immutable(struct pcvariant_heap *heap, purc_variant_t v)
+{
+    purc_variant_t retv;
+
+    if (v == &heap->v_undefined)
+        retv = &transit_undefined;
+    else if (v == &heap->v_null)
+        retv = &transit_null;
+    else if (v == &heap->v_false)
+        retv = &transit_false;
+    else if (v == &heap->v_true)
+        retv = &transit_true;
+    else {
+        /* privatize_shared_immutables() made it exclusively owned */
+        PC_ASSERT(v->refc == 1);
+        stat_value(heap, v, false);
+        return v;
+    }
+
+    /* the constants are kept by the sender */
+    v->refc--;
+    return retv;
+}
+
+static void
+hand_over_container(struct pcvariant_heap *heap, purc_variant_t cntr)
+{
+    purc_variant_t k, v;
+    size_t idx;
+
+    stat_value(heap, cntr, false);
+
+    switch (cntr->type) {
+    case PURC_VARIANT_TYPE_ARRAY:
+        foreach_value_in_variant_array(cntr, v, idx) {
+            UNUSED_PARAM(idx);
+            if (IS_CONTAINER(v->type))
+                hand_over_container(heap, v);
+            else
+                variant_array_member(cntr, idx) = hand_over_immutable(heap, v);
+        } end_foreach;
+        break;
+
+    case PURC_VARIANT_TYPE_OBJECT:
+        foreach_key_value_in_variant_object(cntr, k, v) {
+            _node->key = hand_over_immutable(heap, k);
+            if (IS_CONTAINER(v->type))
+                hand_over_container(heap, v);
+            else
+                _node->val = hand_over_immutable(heap, v);
+        } end_foreach;
+        break;
+
+    case PURC_VARIANT_TYPE_SET:
+        foreach_value_in_variant_set(cntr, v) {
+            if (IS_CONTAINER(v->type))
+                hand_over_container(heap, v);
+            else
+                _sn->val = hand_over_immutable(heap, v);
+        } end_foreach;
+        break;
+
+    default:
+        break;
+    }
+}
+
+static purc_variant_t
+take_over_immutable(struct pcvariant_heap *heap, purc_variant_t v)
+{
+    purc_variant_t retv;
+
+    if (v == &transit_undefined)
+        retv = &heap->v_undefined;
+    else if (v == &transit_null)
+        retv = &heap->v_null;
+    else if (v == &transit_false)
+        retv = &heap->v_false;
+    else if (v == &transit_true)
+        retv = &heap->v_true;
+    else {
+        stat_value(heap, v, true);
+        return v;
+    }
+
+    retv->refc++;
+    return retv;
+}
+
+static void
+take_over_container(struct pcvariant_heap *heap, purc_variant_t cntr)
+{
+    purc_variant_t k, v;
+    size_t idx;
+
+    stat_value(heap, cntr, true);
+
+    switch (cntr->type) {
+    case PURC_VARIANT_TYPE_ARRAY:
+        foreach_value_in_variant_array(cntr, v, idx) {
+            UNUSED_PARAM(idx);
+            if (IS_CONTAINER(v->type))
+                take_over_container(heap, v);
+            else
+                variant_array_member(cntr, idx) = take_over_immutable(heap, v);
+        } end_foreach;
+        break;
+
+    case PURC_VARIANT_TYPE_OBJECT:
+        foreach_key_value_in_variant_object(cntr, k, v) {
+            _node->key = take_over_immutable(heap, k);
+            if (IS_CONTAINER(v->type))
+                take_over_container(heap, v);
+            else
+                _node->val = take_over_immutable(heap, v);
+        } end_foreach;
+        break;
+
+    case PURC_VARIANT_TYPE_SET:
+        foreach_value_in_variant_set(cntr, v) {
+            if (IS_CONTAINER(v->type))
+                take_over_container(heap, v);
+            else
+                _sn->val = take_over_immutable(heap, v);
+        } end_foreach;
+        break;
+
+    default:
+        break;
+    }
+}
+
 static void cb_free_element(void *data)
 {
     purc_variant_unref(data);
@@ -742,6 +1073,17 @@ purc_variant_t pcvariant_move_heap_in(purc_variant_t v)
     struct pcinst *inst = pcinst_current();
     struct travel_context ctxt;
 
+    /* no need to use the move heap for an exclusively owned container */
+    if (IS_CONTAINER(v->type) && is_exclusively_owned(v, 0)) {
+        if (!privatize_shared_immutables(inst->org_vrt_heap, v)) {
+            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return retv;
+        }
+        hand_over_container(inst->org_vrt_heap, v);
+        v->flags |= PCVARIANT_FLAG_IN_TRANSIT;
+        return v;
+    }
+
     ctxt.inst = pcinst_current();
     ctxt.vrts_to_unref = pcutils_arrlist_new(cb_free_element);
     if (ctxt.vrts_to_unref == NULL) {
@@ -846,7 +1188,7 @@ static purc_variant_t move_array_descendants_out(purc_variant_t arr)
             break;
         }
 
-        _p->val = retv;
+        variant_array_member(arr, idx) = retv;
 
     } end_foreach;
 
@@ -1004,6 +1346,12 @@ purc_variant_t pcvariant_move_heap_out(purc_variant_t v)
 {
     purc_variant_t retv = PURC_VARIANT_INVALID;
 
+    if (v->flags & PCVARIANT_FLAG_IN_TRANSIT) {
+        v->flags &= ~PCVARIANT_FLAG_IN_TRANSIT;
+        take_over_container(pcinst_current()->org_vrt_heap, v);
+        return v;
+    }
+
     pcvariant_use_move_heap();
     retv = move_variant_out(v);
     pcvariant_use_norm_heap();
@@ -0,0 +1,494 @@
+/*
+ * @file sort.c
+ * @date 2022/09/24
+ * @brief The key-extracting sort engine for arrays and sets.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "private/variant.h"
+#include "private/errors.h"
+#include "variant-internals.h"
+#include "purc-utils.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* below this number of values, the threads cost more than they save */
+#define SORT_PARALLEL_THRESHOLD     (1 << 14)
+#define SORT_MAX_THREADS            8
+
+/* runs shorter than this are sorted by insertion */
+#define SORT_INSERTION_RUN          24
+
+#define UNDEFINED_STR               "undefined"
+
+/* the key of a value: a number, or the offset of a string in the arena */
+union sort_cell {
+    double          d;
+    size_t          off;
+};
+
+struct sort_ctxt {
+    const struct pcvariant_sort_key *keys;
+    size_t          nr_keys;
+    bool           *by_number;      // resolved from the options of keys
+
+    union sort_cell *cells;         // nr_keys cells per value
+    char           *arena;          // the normalized strings
+    size_t          sz_arena;
+    size_t          len_arena;
+
+    /* the comparator used instead of the keys, if any */
+    int (*cmp)(purc_variant_t l, purc_variant_t r, void *ud);
+    void           *ud;
+    purc_variant_t *vals;
+};
+
+static inline int
+cmp_idx(const struct sort_ctxt *ctxt, size_t l, size_t r)
+{
+    if (ctxt->cmp)
+        return ctxt->cmp(ctxt->vals[l], ctxt->vals[r], ctxt->ud);
+
+    const union sort_cell *cl = ctxt->cells + l * ctxt->nr_keys;
+    const union sort_cell *cr = ctxt->cells + r * ctxt->nr_keys;
+
+    for (size_t k = 0; k < ctxt->nr_keys; k++) {
+        int ret;
+        if (ctxt->by_number[k]) {
+            ret = (cl[k].d > cr[k].d) - (cl[k].d < cr[k].d);
+        }
+        else {
+            ret = strcmp(ctxt->arena + cl[k].off, ctxt->arena + cr[k].off);
+        }
+
+        if (ret)
+            return ctxt->keys[k].desc ? -ret : ret;
+    }
+
+    return 0;
+}
+
+static purc_variant_t
+key_value(const struct pcvariant_sort_key *key, purc_variant_t val)
+{
+    if (key->name == NULL)
+        return val;
+
+    if (!purc_variant_is_object(val))
+        return PURC_VARIANT_INVALID;
+
+    purc_variant_t v = purc_variant_object_get_by_ckey(val, key->name);
+    if (v == PURC_VARIANT_INVALID)
+        purc_clr_error();
+    return v;
+}
+
+static bool
+is_number_type(purc_variant_t v)
+{
+    switch (purc_variant_get_type(v)) {
+    case PURC_VARIANT_TYPE_NUMBER:
+    case PURC_VARIANT_TYPE_LONGINT:
+    case PURC_VARIANT_TYPE_ULONGINT:
+    case PURC_VARIANT_TYPE_LONGDOUBLE:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+static int
+arena_reserve(struct sort_ctxt *ctxt, size_t len)
+{
+    if (ctxt->len_arena + len <= ctxt->sz_arena)
+        return 0;
+
+    size_t sz = ctxt->sz_arena ? ctxt->sz_arena : 1024;
+    while (sz < ctxt->len_arena + len)
+        sz *= 2;
+
+    char *arena = realloc(ctxt->arena, sz);
+    if (arena == NULL)
+        return -1;
+
+    ctxt->arena = arena;
+    ctxt->sz_arena = sz;
+    return 0;
+}
+
+/* append the string form of @v to the arena, lowercased if @caseless */
+static int
+append_string(struct sort_ctxt *ctxt, purc_variant_t v, bool caseless,
+        size_t *off)
+{
+    const char *str = NULL;
+    size_t len = 0;
+
+    if (v == PURC_VARIANT_INVALID) {
+        str = UNDEFINED_STR;
+        len = sizeof(UNDEFINED_STR) - 1;
+    }
+    else if (purc_variant_is_string(v) || purc_variant_is_atomstring(v)) {
+        str = purc_variant_get_string_const_ex(v, &len);
+    }
+
+    *off = ctxt->len_arena;
+    if (str) {
+        if (arena_reserve(ctxt, len + 1))
+            return -1;
+        memcpy(ctxt->arena + *off, str, len);
+    }
+    else {
+        if (arena_reserve(ctxt, 64))
+            return -1;
+
+        ssize_t n = purc_variant_stringify_buff(ctxt->arena + *off,
+                ctxt->sz_arena - *off, v);
+        if (n < 0) {
+            n = 0;
+        }
+        else if ((size_t)n >= ctxt->sz_arena - *off) {
+            if (arena_reserve(ctxt, n + 1))
+                return -1;
+            purc_variant_stringify_buff(ctxt->arena + *off, n + 1, v);
+        }
+        len = n;
+    }
+    ctxt->arena[*off + len] = '\0';
+
+    if (caseless) {
+        char *p = ctxt->arena + *off;
+        bool ascii = true;
+        for (size_t i = 0; i < len; i++) {
+            if ((unsigned char)p[i] >= 0x80) {
+                ascii = false;
+                break;
+            }
+            p[i] = purc_tolower(p[i]);
+        }
+
+        if (!ascii) {
+            size_t new_len;
+            char *lower = pcutils_strtolower(p, len, &new_len);
+            if (lower == NULL)
+                return -1;
+
+            /* the lowercase form may be longer in UTF-8 */
+            int r = arena_reserve(ctxt, new_len + 1);
+            if (r == 0) {
+                memcpy(ctxt->arena + *off, lower, new_len);
+                ctxt->arena[*off + new_len] = '\0';
+                len = new_len;
+            }
+            free(lower);
+            if (r)
+                return -1;
+        }
+    }
+
+    ctxt->len_arena += len + 1;
+    return 0;
+}
+
+static int
+extract_keys(struct sort_ctxt *ctxt, purc_variant_t *vals, size_t nr)
+{
+    size_t nr_keys = ctxt->nr_keys;
+
+    for (size_t k = 0; k < nr_keys; k++) {
+        const struct pcvariant_sort_key *key = ctxt->keys + k;
+        if (key->opt != PCVARIANT_COMPARE_OPT_AUTO) {
+            ctxt->by_number[k] = (key->opt == PCVARIANT_COMPARE_OPT_NUMBER);
+            continue;
+        }
+
+        /* numbers only if all the values are numbers */
+        ctxt->by_number[k] = true;
+        for (size_t i = 0; i < nr; i++) {
+            purc_variant_t v = key_value(key, vals[i]);
+            if (v && !is_number_type(v)) {
+                ctxt->by_number[k] = false;
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < nr; i++) {
+        union sort_cell *cells = ctxt->cells + i * nr_keys;
+        for (size_t k = 0; k < nr_keys; k++) {
+            const struct pcvariant_sort_key *key = ctxt->keys + k;
+            purc_variant_t v = key_value(key, vals[i]);
+            if (ctxt->by_number[k]) {
+                cells[k].d = v ? purc_variant_numberify(v) : 0.0;
+            }
+            else if (append_string(ctxt, v,
+                        key->opt == PCVARIANT_COMPARE_OPT_CASELESS,
+                        &cells[k].off)) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void
+insertion_sort(const struct sort_ctxt *ctxt, size_t *a, size_t n)
+{
+    for (size_t i = 1; i < n; i++) {
+        size_t v = a[i];
+        size_t j = i;
+        while (j > 0 && cmp_idx(ctxt, a[j - 1], v) > 0) {
+            a[j] = a[j - 1];
+            j--;
+        }
+        a[j] = v;
+    }
+}
+
+static void
+merge(const struct sort_ctxt *ctxt, const size_t *l, size_t nl,
+        const size_t *r, size_t nr, size_t *dst)
+{
+    size_t i = 0, j = 0, k = 0;
+    while (i < nl && j < nr) {
+        /* take from the left on ties to keep the sort stable */
+        if (cmp_idx(ctxt, r[j], l[i]) < 0)
+            dst[k++] = r[j++];
+        else
+            dst[k++] = l[i++];
+    }
+
+    if (i < nl)
+        memcpy(dst + k, l + i, (nl - i) * sizeof(*dst));
+    if (j < nr)
+        memcpy(dst + k, r + j, (nr - j) * sizeof(*dst));
+}
+
+/* stable merge sort of @a, using @tmp of the same size */
+static void
+merge_sort(const struct sort_ctxt *ctxt, size_t *a, size_t *tmp, size_t n)
+{
+    if (n <= SORT_INSERTION_RUN) {
+        insertion_sort(ctxt, a, n);
+        return;
+    }
+
+    size_t mid = n / 2;
+    merge_sort(ctxt, a, tmp, mid);
+    merge_sort(ctxt, a + mid, tmp + mid, n - mid);
+
+    /* already in order */
+    if (cmp_idx(ctxt, a[mid - 1], a[mid]) <= 0)
+        return;
+
+    merge(ctxt, a, mid, a + mid, n - mid, tmp);
+    memcpy(a, tmp, n * sizeof(*a));
+}
+
+struct sort_task {
+    const struct sort_ctxt *ctxt;
+    size_t         *src;
+    size_t         *dst;
+    size_t          lo, mid, hi;    // mid == hi: sort [lo, hi) in place
+    pthread_t       thread;
+    bool            started;
+};
+
+static void *
+sort_task_run(void *arg)
+{
+    struct sort_task *task = arg;
+    if (task->mid == task->hi) {
+        merge_sort(task->ctxt, task->src + task->lo, task->dst + task->lo,
+                task->hi - task->lo);
+    }
+    else {
+        merge(task->ctxt, task->src + task->lo, task->mid - task->lo,
+                task->src + task->mid, task->hi - task->mid,
+                task->dst + task->lo);
+    }
+    return NULL;
+}
+
+static void
+run_tasks(struct sort_task *tasks, size_t nr_tasks)
+{
+    /* the first task runs on the calling thread */
+    for (size_t i = 1; i < nr_tasks; i++) {
+        tasks[i].started = pthread_create(&tasks[i].thread, NULL,
+                sort_task_run, tasks + i) == 0;
+    }
+
+    sort_task_run(tasks);
+
+    for (size_t i = 1; i < nr_tasks; i++) {
+        if (tasks[i].started)
+            pthread_join(tasks[i].thread, NULL);
+        else
+            sort_task_run(tasks + i);
+    }
+}
+
+static size_t
+nr_sort_threads(size_t nr)
+{
+    if (nr < SORT_PARALLEL_THRESHOLD)
+        return 1;
+
+    long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t nr_threads = nr_cpus > 0 ? (size_t)nr_cpus : 1;
+    if (nr_threads > SORT_MAX_THREADS)
+        nr_threads = SORT_MAX_THREADS;
+    if (nr_threads > nr / (SORT_PARALLEL_THRESHOLD / 2))
+        nr_threads = nr / (SORT_PARALLEL_THRESHOLD / 2);
+
+    return nr_threads ? nr_threads : 1;
+}
+
+/*
+ * Sort the runs in separate threads, then merge the neighbouring runs
+ * in pairs, also in parallel, until one run is left.
+ */
+static void
+parallel_sort(const struct sort_ctxt *ctxt, size_t *order, size_t *tmp,
+        size_t nr, size_t nr_threads)
+{
+    struct sort_task tasks[SORT_MAX_THREADS];
+    size_t bounds[SORT_MAX_THREADS + 1];
+
+    for (size_t i = 0; i <= nr_threads; i++)
+        bounds[i] = nr * i / nr_threads;
+
+    for (size_t i = 0; i < nr_threads; i++) {
+        tasks[i] = (struct sort_task) { .ctxt = ctxt, .src = order,
+            .dst = tmp, .lo = bounds[i], .mid = bounds[i + 1],
+            .hi = bounds[i + 1] };
+    }
+    run_tasks(tasks, nr_threads);
+
+    size_t *src = order, *dst = tmp;
+    size_t nr_runs = nr_threads;
+    while (nr_runs > 1) {
+        size_t nr_tasks = 0;
+        for (size_t i = 0; i < nr_runs; i += 2) {
+            size_t hi = (i + 2 <= nr_runs) ? bounds[i + 2] : bounds[i + 1];
+            tasks[nr_tasks++] = (struct sort_task) { .ctxt = ctxt,
+                .src = src, .dst = dst, .lo = bounds[i], .mid = bounds[i + 1],
+                .hi = hi };
+        }
+
+        /* an odd run left is copied as is */
+        if (nr_runs % 2) {
+            struct sort_task *last = tasks + nr_tasks - 1;
+            memcpy(dst + last->lo, src + last->lo,
+                    (last->hi - last->lo) * sizeof(*dst));
+            nr_tasks--;
+        }
+        run_tasks(tasks, nr_tasks);
+
+        size_t j = 0;
+        for (size_t i = 0; i < nr_runs; i += 2)
+            bounds[j++] = bounds[i];
+        bounds[j] = nr;
+        nr_runs = j;
+
+        size_t *t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != order)
+        memcpy(order, src, nr * sizeof(*order));
+}
+
+int
+pcvar_sort_by_keys(purc_variant_t *vals, size_t nr,
+        const struct pcvariant_sort_key *keys, size_t nr_keys,
+        size_t *order)
+{
+    for (size_t i = 0; i < nr; i++)
+        order[i] = i;
+
+    if (nr < 2 || nr_keys == 0)
+        return 0;
+
+    int ret = -1;
+    struct sort_ctxt ctxt = { keys, nr_keys, NULL, NULL, NULL, 0, 0,
+        NULL, NULL, NULL };
+    size_t *tmp = NULL;
+
+    ctxt.by_number = calloc(nr_keys, sizeof(*ctxt.by_number));
+    ctxt.cells = malloc(nr * nr_keys * sizeof(*ctxt.cells));
+    tmp = malloc(nr * sizeof(*tmp));
+    if (!ctxt.by_number || !ctxt.cells || !tmp) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        goto out;
+    }
+
+    if (extract_keys(&ctxt, vals, nr)) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        goto out;
+    }
+
+    size_t nr_threads = nr_sort_threads(nr);
+    if (nr_threads > 1)
+        parallel_sort(&ctxt, order, tmp, nr, nr_threads);
+    else
+        merge_sort(&ctxt, order, tmp, nr);
+    ret = 0;
+
+out:
+    free(tmp);
+    free(ctxt.arena);
+    free(ctxt.cells);
+    free(ctxt.by_number);
+    return ret;
+}
+
+int
+pcvar_sort_by_cmp(purc_variant_t *vals, size_t nr,
+        int (*cmp)(purc_variant_t l, purc_variant_t r, void *ud), void *ud,
+        size_t *order)
+{
+    for (size_t i = 0; i < nr; i++)
+        order[i] = i;
+
+    if (nr < 2)
+        return 0;
+
+    size_t *tmp = malloc(nr * sizeof(*tmp));
+    if (tmp == NULL) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    /* the comparator may not be thread-safe; sort on the calling thread */
+    struct sort_ctxt ctxt = { NULL, 0, NULL, NULL, NULL, 0, 0,
+        cmp, ud, vals };
+    merge_sort(&ctxt, order, tmp, nr);
+
+    free(tmp);
+    return 0;
+}
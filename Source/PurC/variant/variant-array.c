@@ -39,8 +39,7 @@
 static size_t
 variant_arr_length(variant_arr_t data)
 {
-    struct pcutils_array_list *al = &data->al;
-    return pcutils_array_list_length(al);
+    return data->nr;
 }
 
 static inline bool
@@ -129,100 +128,173 @@ pcvar_arr_get_data(purc_variant_t arr)
     return (variant_arr_t)arr->sz_ptr[1];
 }
 
+
+static inline purc_variant_t *
+arr_slot(variant_arr_t data, size_t idx)
+{
+    return data->vals + data->head + idx;
+}
+
+/* The edge from a member to the array is shared by all the occurrences of
+ * the member, so it is only broken when the last occurrence goes. Edges only
+ * exist while the array belongs to a set, so the scan is skipped otherwise. */
+static bool
+arr_holds_elsewhere(variant_arr_t data, size_t idx, purc_variant_t val)
+{
+    for (size_t i = 0; i < data->nr; i++) {
+        if (i != idx && *arr_slot(data, i) == val)
+            return true;
+    }
+
+    return false;
+}
+
 static void
-break_rev_update_chain(purc_variant_t arr, struct arr_node *node)
+break_rev_update_chain(purc_variant_t arr, size_t idx, purc_variant_t val)
 {
+    if (!pcvariant_is_mutable(val))
+        return;
+
+    if (pcvar_container_belongs_to_set(arr) &&
+            arr_holds_elsewhere(pcvar_arr_get_data(arr), idx, val))
+        return;
+
     struct pcvar_rev_update_edge edge = {
         .parent        = arr,
-        .arr_me        = node,
+        .arr_me        = arr,
     };
 
-    pcvar_break_edge_to_parent(node->val, &edge);
-    pcvar_break_rue_downward(node->val);
+    pcvar_break_edge_to_parent(val, &edge);
+    pcvar_break_rue_downward(val);
 }
 
-static void
-arr_node_release(purc_variant_t arr, struct arr_node *node)
+static int
+build_rev_update_chain(purc_variant_t arr, purc_variant_t val)
 {
-    if (!node)
-        return;
+    if (!pcvariant_is_mutable(val))
+        return 0;
 
-    break_rev_update_chain(arr, node);
+    if (!pcvar_container_belongs_to_set(arr))
+        return 0;
 
-    if (node->node.idx != (size_t)-1) {
-        variant_arr_t data = pcvar_arr_get_data(arr);
-        PC_ASSERT(data);
+    int r;
 
-        struct pcutils_array_list *al = &data->al;
-        PC_ASSERT(al);
+    struct pcvar_rev_update_edge edge = {
+        .parent        = arr,
+        .arr_me        = arr,
+    };
 
-        struct pcutils_array_list_node *p;
-        int r = pcutils_array_list_remove(al, node->node.idx, &p);
-        PC_ASSERT(r == 0);
-        PC_ASSERT(&node->node == p);
-        PC_ASSERT(node->node.idx == (size_t)-1);
+    r = pcvar_build_edge_to_parent(val, &edge);
+    if (r == 0) {
+        r = pcvar_build_rue_downward(val);
     }
 
-    PURC_VARIANT_SAFE_CLEAR(node->val);
+    return r ? -1 : 0;
 }
 
-static void
-arr_node_destroy(purc_variant_t arr, struct arr_node *node)
+/* Move the members to a buffer of sz_vals slots, starting from head. */
+static int
+arr_relocate(variant_arr_t data, size_t sz_vals, size_t head)
 {
-    if (!node)
-        return;
+    if (sz_vals == data->sz_vals) {
+        memmove(data->vals + head, arr_slot(data, 0),
+                data->nr * sizeof(*data->vals));
+    }
+    else if (head == data->head) {
+        purc_variant_t *vals = realloc(data->vals, sz_vals * sizeof(*vals));
+        if (!vals) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
 
-    arr_node_release(arr, node);
-    free(node);
-}
+        data->vals = vals;
+        data->sz_vals = sz_vals;
+    }
+    else {
+        purc_variant_t *vals = malloc(sz_vals * sizeof(*vals));
+        if (!vals) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
 
-static purc_variant_t
-variant_arr_make_pos(variant_arr_t data, size_t idx)
-{
-    size_t len = variant_arr_length(data);
-    if (idx > len)
-        idx = len;
+        if (data->nr)
+            memcpy(vals + head, arr_slot(data, 0),
+                    data->nr * sizeof(*vals));
+        free(data->vals);
+        data->vals = vals;
+        data->sz_vals = sz_vals;
+    }
 
-    return purc_variant_make_longint(idx);
+    data->head = head;
+    return 0;
 }
 
-static struct arr_node*
-arr_node_create(purc_variant_t val)
+/* Open a slot for a new member at idx by moving the shorter side of the
+ * members; the buffer grows, or the members are centred in it, when there
+ * is no room on that side. */
+static int
+arr_open_slot(variant_arr_t data, size_t idx)
 {
-    struct arr_node *node;
-    node = (struct arr_node*)calloc(1, sizeof(*node));
-    if (!node) {
-        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
-        return NULL;
+    size_t nr = data->nr;
+    size_t front = data->head;
+    size_t back = data->sz_vals - data->head - nr;
+    bool to_front = idx < nr - idx;
+
+    if (to_front ? front == 0 : back == 0) {
+        size_t sz_vals = data->sz_vals;
+        size_t room = front + back;
+        if (room < 2 || room < nr / 4)
+            sz_vals = sz_vals < 4 ? 4 : sz_vals * 2;
+
+        room = sz_vals - nr;
+        size_t head = (to_front || front > 0) ? room / 2 : 0;
+        if (arr_relocate(data, sz_vals, head))
+            return -1;
     }
 
-    node->node.idx = (size_t)-1;
-
-    node->val = val;
-    purc_variant_ref(val);
+    if (to_front) {
+        memmove(data->vals + data->head - 1, data->vals + data->head,
+                idx * sizeof(*data->vals));
+        data->head--;
+    }
+    else {
+        memmove(arr_slot(data, idx + 1), arr_slot(data, idx),
+                (nr - idx) * sizeof(*data->vals));
+    }
 
-    return node;
+    data->nr++;
+    return 0;
 }
 
-static int
-build_rev_update_chain(purc_variant_t arr, struct arr_node *node)
+/* Close the slot of the member at idx by moving the shorter side. */
+static void
+arr_close_slot(variant_arr_t data, size_t idx)
 {
-    if (!pcvar_container_belongs_to_set(arr))
-        return 0;
+    size_t nr = data->nr;
 
-    int r;
+    if (idx < nr - idx - 1) {
+        memmove(data->vals + data->head + 1, data->vals + data->head,
+                idx * sizeof(*data->vals));
+        data->head++;
+    }
+    else {
+        memmove(arr_slot(data, idx), arr_slot(data, idx + 1),
+                (nr - idx - 1) * sizeof(*data->vals));
+    }
 
-    struct pcvar_rev_update_edge edge = {
-        .parent        = arr,
-        .arr_me        = node,
-    };
+    data->nr--;
+    if (data->nr == 0)
+        data->head = 0;
+}
 
-    r = pcvar_build_edge_to_parent(node->val, &edge);
-    if (r == 0) {
-        r = pcvar_build_rue_downward(node->val);
-    }
+static purc_variant_t
+variant_arr_make_pos(variant_arr_t data, size_t idx)
+{
+    size_t len = variant_arr_length(data);
+    if (idx > len)
+        idx = len;
 
-    return r ? -1 : 0;
+    return purc_variant_make_longint(idx);
 }
 
 static int
@@ -240,7 +312,11 @@ check_grow(purc_variant_t arr, size_t idx, purc_variant_t val)
         size_t i;
         purc_variant_t v;
         foreach_value_in_variant_array(arr, v, i) {
-            PC_ASSERT(i < idx);
+            if (i == idx) {
+                r = pcvar_arr_append(_new, val);
+                if (r)
+                    break;
+            }
             r = pcvar_arr_append(_new, v);
             if (r)
                 break;
@@ -249,9 +325,11 @@ check_grow(purc_variant_t arr, size_t idx, purc_variant_t val)
         if (r)
             break;
 
-        r = pcvar_arr_append(_new, val);
-        if (r)
-            break;
+        if (idx >= variant_arr_length(pcvar_arr_get_data(arr))) {
+            r = pcvar_arr_append(_new, val);
+            if (r)
+                break;
+        }
 
         int r = pcvar_reverse_check(arr, _new);
         if (r)
@@ -278,18 +356,16 @@ variant_arr_insert_before(purc_variant_t arr, size_t idx, purc_variant_t val,
     variant_arr_t data = pcvar_arr_get_data(arr);
     PC_ASSERT(data);
 
-    struct pcutils_array_list *al = &data->al;
-    PC_ASSERT(al);
-
-    size_t nr = pcutils_array_list_length(al);
+    size_t nr = variant_arr_length(data);
     if (idx > nr)
         idx = nr;
 
-    purc_variant_t pos = variant_arr_make_pos(data, idx);
-    if (pos == PURC_VARIANT_INVALID)
-        return -1;
-
-    struct arr_node *node = NULL;
+    purc_variant_t pos = PURC_VARIANT_INVALID;
+    if (check) {
+        pos = variant_arr_make_pos(data, idx);
+        if (pos == PURC_VARIANT_INVALID)
+            return -1;
+    }
 
     do {
         if (check) {
@@ -300,35 +376,28 @@ variant_arr_insert_before(purc_variant_t arr, size_t idx, purc_variant_t val,
                 break;
         }
 
-        node = arr_node_create(val);
-        if (!node)
+        if (arr_open_slot(data, idx))
             break;
 
-        int r;
-        PC_ASSERT(node->node.idx == (size_t)-1);
-        r = pcutils_array_list_insert_before(al, idx, &node->node);
-        if (r) {
-            PC_ASSERT(node->node.idx == (size_t)-1);
-            purc_set_error(PURC_ERROR_OUT_OF_MEMORY);
-            break;
-        }
-        PC_ASSERT(node->node.idx != (size_t)-1);
+        *arr_slot(data, idx) = purc_variant_ref(val);
 
         if (check) {
-            if (build_rev_update_chain(arr, node))
+            if (build_rev_update_chain(arr, val)) {
+                break_rev_update_chain(arr, idx, val);
+                arr_close_slot(data, idx);
+                purc_variant_unref(val);
                 break;
+            }
 
             pcvar_adjust_set_by_descendant(arr);
             grown(arr, pos, val, check);
+            purc_variant_unref(pos);
         }
 
-        purc_variant_unref(pos);
-
         return 0;
     } while (0);
 
-    arr_node_destroy(arr, node);
-    purc_variant_unref(pos);
+    PURC_VARIANT_SAFE_CLEAR(pos);
 
     return -1;
 }
@@ -340,9 +409,7 @@ refresh_extra(purc_variant_t arr)
     variant_arr_t data = pcvar_arr_get_data(arr);
     if (data) {
         extra += sizeof(*data);
-        struct pcutils_array_list *al = &data->al;
-        extra += al->sz * sizeof(*al->nodes);
-        extra += al->nr * sizeof(struct arr_node);
+        extra += data->sz_vals * sizeof(*data->vals);
     }
     pcvariant_stat_set_extra_size(arr, extra);
 }
@@ -352,8 +419,7 @@ variant_arr_append(purc_variant_t arr, purc_variant_t val,
         bool check)
 {
     variant_arr_t data = pcvar_arr_get_data(arr);
-    struct pcutils_array_list *al = &data->al;
-    size_t nr = pcutils_array_list_length(al);
+    size_t nr = variant_arr_length(data);
     int r = variant_arr_insert_before(arr, nr, val, check);
     refresh_extra(arr);
     return r ? -1 : 0;
@@ -369,19 +435,14 @@ variant_arr_prepend(purc_variant_t arr, purc_variant_t val,
 static purc_variant_t
 variant_arr_get(variant_arr_t data, size_t idx)
 {
-    struct pcutils_array_list *al = &data->al;
-    struct pcutils_array_list_node *p;
-    p = pcutils_array_list_get(al, idx);
-    if (p == NULL)
+    if (idx >= data->nr)
         return PURC_VARIANT_INVALID;
 
-    struct arr_node *node;
-    node = (struct arr_node*)container_of(p, struct arr_node, node);
-    return node->val;
+    return *arr_slot(data, idx);
 }
 
 static int
-check_change(purc_variant_t arr, struct arr_node *node, purc_variant_t val)
+check_change(purc_variant_t arr, size_t idx, purc_variant_t val)
 {
     if (!pcvar_container_belongs_to_set(arr))
         return 0;
@@ -396,10 +457,10 @@ check_change(purc_variant_t arr, struct arr_node *node, purc_variant_t val)
         size_t i;
         purc_variant_t v;
         foreach_value_in_variant_array(arr, v, i) {
-            if (i == node->node.idx) {
+            if (i == idx) {
                 found = true;
             }
-            r = pcvar_arr_append(_new, i == node->node.idx ? val : v);
+            r = pcvar_arr_append(_new, i == idx ? val : v);
             if (r)
                 break;
         } end_foreach;
@@ -429,23 +490,16 @@ variant_arr_set(purc_variant_t arr, size_t idx, purc_variant_t val,
     variant_arr_t data = pcvar_arr_get_data(arr);
     PC_ASSERT(data);
 
-    struct pcutils_array_list *al = &data->al;
-    PC_ASSERT(al);
-
-    size_t nr = pcutils_array_list_length(al);
+    size_t nr = variant_arr_length(data);
     if (idx >= nr) {
         purc_set_error(PURC_ERROR_OVERFLOW);
         return -1;
     }
 
-    struct pcutils_array_list_node *p;
-    p = pcutils_array_list_get(al, idx);
-    PC_ASSERT(p);
-
-    struct arr_node *old_node;
-    old_node = (struct arr_node*)container_of(p, struct arr_node, node);
-    PC_ASSERT(old_node->val != PURC_VARIANT_INVALID);
-    if (old_node->val == val) {
+    purc_variant_t *slot = arr_slot(data, idx);
+    purc_variant_t old = *slot;
+    PC_ASSERT(old != PURC_VARIANT_INVALID);
+    if (old == val) {
         // NOTE: keep refc intact
         return 0;
     }
@@ -455,28 +509,22 @@ variant_arr_set(purc_variant_t arr, size_t idx, purc_variant_t val,
         return -1;
 
     do {
-        purc_variant_t old = old_node->val;
-
         if (check) {
             if (!change(arr, pos, old, val, check))
                 break;
 
-            if (check_change(arr, old_node, val))
+            if (check_change(arr, idx, val))
                 break;
 
-            old_node->val = val;
-
-            if (build_rev_update_chain(arr, old_node)) {
-                break_rev_update_chain(arr, old_node);
-                old_node->val = old;
+            if (build_rev_update_chain(arr, val)) {
+                break_rev_update_chain(arr, idx, val);
                 break;
             }
 
-            old_node->val = old;
-            break_rev_update_chain(arr, old_node);
+            break_rev_update_chain(arr, idx, old);
         }
 
-        old_node->val = purc_variant_ref(val);
+        *slot = purc_variant_ref(val);
 
         if (check) {
             pcvar_adjust_set_by_descendant(arr);
@@ -496,7 +544,7 @@ variant_arr_set(purc_variant_t arr, size_t idx, purc_variant_t val,
 }
 
 static int
-check_shrink(purc_variant_t arr, struct arr_node *node)
+check_shrink(purc_variant_t arr, size_t idx)
 {
     if (!pcvar_container_belongs_to_set(arr))
         return 0;
@@ -511,7 +559,7 @@ check_shrink(purc_variant_t arr, struct arr_node *node)
         size_t i;
         purc_variant_t v;
         foreach_value_in_variant_array(arr, v, i) {
-            if (i == node->node.idx) {
+            if (i == idx) {
                 PC_ASSERT(!found);
                 found = true;
                 continue;
@@ -546,10 +594,7 @@ variant_arr_remove(purc_variant_t arr, size_t idx,
     variant_arr_t data = pcvar_arr_get_data(arr);
     PC_ASSERT(data);
 
-    struct pcutils_array_list *al = &data->al;
-    PC_ASSERT(al);
-
-    size_t nr = pcutils_array_list_length(al);
+    size_t nr = variant_arr_length(data);
     if (idx >= nr) {
         // FIXME: failure or success???
         return 0;
@@ -559,38 +604,29 @@ variant_arr_remove(purc_variant_t arr, size_t idx,
     if (pos == PURC_VARIANT_INVALID)
         return -1;
 
-    struct pcutils_array_list_node *p, *n;
-    p = pcutils_array_list_get(al, idx);
-    PC_ASSERT(p);
-
-    struct arr_node *node;
-    node = (struct arr_node*)container_of(p, struct arr_node, node);
-    PC_ASSERT(node->val);
+    purc_variant_t val = *arr_slot(data, idx);
+    PC_ASSERT(val);
 
     do {
         if (check) {
-            if (!shrink(arr, pos, node->val, check))
+            if (!shrink(arr, pos, val, check))
                 break;
 
-            if (check_shrink(arr, node))
+            if (check_shrink(arr, idx))
                 break;
 
-            break_rev_update_chain(arr, node);
+            break_rev_update_chain(arr, idx, val);
         }
 
-        PC_ASSERT(node->node.idx != (size_t)-1);
-        int r = pcutils_array_list_remove(al, idx, &n);
-        PC_ASSERT(r == 0);
-        PC_ASSERT(&node->node == n);
-        PC_ASSERT(node->node.idx == (size_t)-1);
+        arr_close_slot(data, idx);
 
         if (check) {
             pcvar_adjust_set_by_descendant(arr);
 
-            shrunk(arr, pos, node->val, check);
+            shrunk(arr, pos, val, check);
         }
 
-        arr_node_destroy(arr, node);
+        purc_variant_unref(val);
         purc_variant_unref(pos);
 
         return 0;
@@ -608,13 +644,23 @@ array_release (purc_variant_t arr)
     if (!data)
         return;
 
-    struct pcutils_array_list *al = &data->al;
-    struct arr_node *p, *n;
-    array_list_for_each_entry_reverse_safe(al, p, n, node) {
-        arr_node_destroy(arr, p);
+    struct pcvar_rev_update_edge edge = {
+        .parent        = arr,
+        .arr_me        = arr,
     };
 
-    pcutils_array_list_reset(al);
+    while (data->nr > 0) {
+        purc_variant_t val = *arr_slot(data, data->nr - 1);
+        data->nr--;
+
+        if (pcvariant_is_mutable(val)) {
+            pcvar_break_edge_to_parent(val, &edge);
+            pcvar_break_rue_downward(val);
+        }
+        purc_variant_unref(val);
+    }
+
+    free(data->vals);
 
     if (data->rev_update_chain) {
         pcvar_destroy_rev_update_chain(data->rev_update_chain);
@@ -640,24 +686,21 @@ make_array(size_t sz)
         var->flags         = PCVARIANT_FLAG_EXTRA_SIZE;
         var->refc          = 1;
 
-        size_t initial_size = ARRAY_LIST_DEFAULT_SIZE;
-        if (sz>initial_size)
-            initial_size = sz;
-
         variant_arr_t data = (variant_arr_t)calloc(1, sizeof(*data));
         if (!data) {
             pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
             break;
         }
 
-        struct pcutils_array_list *al;
-        al = &data->al;
-        pcutils_array_list_init(al);
-        if (pcutils_array_list_expand(al, initial_size)) {
-            pcutils_array_list_reset(al);
-            free(data);
-            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
-            break;
+        // the buffer of an empty array is allocated on the first insertion
+        if (sz > 0) {
+            data->vals = malloc(sz * sizeof(*data->vals));
+            if (!data->vals) {
+                free(data);
+                pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+                break;
+            }
+            data->sz_vals = sz;
         }
 
         var->sz_ptr[1]     = (uintptr_t)data;
@@ -863,35 +906,42 @@ bool purc_variant_array_insert_after (purc_variant_t arr, int idx,
     return purc_variant_array_insert_before(arr, idx+1, value);
 }
 
-struct arr_user_data {
-    int (*cmp)(purc_variant_t l, purc_variant_t r, void *ud);
-    void *ud;
-};
-
+/* sorts the members by the comparator or by the keys, stably */
 static int
-sort_cmp(struct pcutils_array_list_node *l, struct pcutils_array_list_node *r,
-        void *ud)
-{
-    struct arr_node *l_n, *r_n;
-    l_n = container_of(l, struct arr_node, node);
-    r_n = container_of(r, struct arr_node, node);
-
-    struct arr_user_data *d = (struct arr_user_data*)ud;
-    return d->cmp(l_n->val, r_n->val, d->ud);
-}
-
-static int vrtcmp(purc_variant_t l, purc_variant_t r, void *ud)
+arr_sort(purc_variant_t arr, const struct pcvariant_sort_key *keys,
+        size_t nr_keys, int (*cmp)(purc_variant_t l, purc_variant_t r,
+            void *ud), void *ud)
 {
-    uintptr_t sort_flags;
-    purc_vrtcmp_opt_t cmpopt;
+    variant_arr_t data = pcvar_arr_get_data(arr);
+    size_t nr = variant_arr_length(data);
+    if (nr < 2)
+        return 0;
 
-    sort_flags = (uintptr_t)ud;
-    cmpopt = (purc_vrtcmp_opt_t)(sort_flags & PCVARIANT_CMPOPT_MASK);
+    int r = -1;
+    purc_variant_t *vals = arr_slot(data, 0);
+    purc_variant_t *sorted = malloc(nr * sizeof(*sorted));
+    size_t *order = malloc(nr * sizeof(*order));
+    if (!sorted || !order) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        goto out;
+    }
 
-    int retv = purc_variant_compare_ex(l, r, cmpopt);
-    if (sort_flags & PCVARIANT_SORT_DESC)
-        retv = -retv;
-    return retv;
+    if (cmp) {
+        if (pcvar_sort_by_cmp(vals, nr, cmp, ud, order))
+            goto out;
+    }
+    else if (pcvar_sort_by_keys(vals, nr, keys, nr_keys, order))
+        goto out;
+
+    for (size_t i = 0; i < nr; i++)
+        sorted[i] = vals[order[i]];
+    memcpy(vals, sorted, nr * sizeof(*vals));
+    r = 0;
+
+out:
+    free(order);
+    free(sorted);
+    return r;
 }
 
 int pcvariant_array_sort(purc_variant_t arr, void *ud,
@@ -900,20 +950,26 @@ int pcvariant_array_sort(purc_variant_t arr, void *ud,
     if (!arr || arr->type != PURC_VARIANT_TYPE_ARRAY)
         return -1;
 
-    variant_arr_t data = pcvar_arr_get_data(arr);
-
-    struct arr_user_data d = {
-        .cmp = cmp,
-        .ud  = ud,
-    };
-
-    if (d.cmp == NULL) {
-        d.cmp = vrtcmp;
+    if (cmp == NULL) {
+        uintptr_t sort_flags = (uintptr_t)ud;
+        struct pcvariant_sort_key key = {
+            .name = NULL,
+            .opt  = (purc_vrtcmp_opt_t)(sort_flags & PCVARIANT_CMPOPT_MASK),
+            .desc = (sort_flags & PCVARIANT_SORT_DESC) ? true : false,
+        };
+        return pcvariant_array_sort_by_keys(arr, &key, 1);
     }
 
-    pcutils_array_list_sort(&data->al, &d, sort_cmp);
+    return arr_sort(arr, NULL, 0, cmp, ud);
+}
 
-    return 0;
+int pcvariant_array_sort_by_keys(purc_variant_t arr,
+        const struct pcvariant_sort_key *keys, size_t nr_keys)
+{
+    if (!arr || arr->type != PURC_VARIANT_TYPE_ARRAY)
+        return -1;
+
+    return arr_sort(arr, keys, nr_keys, NULL, NULL);
 }
 
 purc_variant_t
@@ -961,15 +1017,18 @@ pcvar_array_break_rue_downward(purc_variant_t arr)
     if (!data)
         return;
 
-    struct arr_node *p;
-    foreach_in_variant_array(arr, p) {
-        struct pcvar_rev_update_edge edge = {
-            .parent         = arr,
-            .arr_me         = p,
-        };
-        pcvar_break_edge_to_parent(p->val, &edge);
-        pcvar_break_rue_downward(p->val);
-    }
+    struct pcvar_rev_update_edge edge = {
+        .parent         = arr,
+        .arr_me         = arr,
+    };
+
+    purc_variant_t v;
+    size_t idx;
+    foreach_value_in_variant_array(arr, v, idx) {
+        UNUSED_PARAM(idx);
+        pcvar_break_edge_to_parent(v, &edge);
+        pcvar_break_rue_downward(v);
+    } end_foreach;
 }
 
 void
@@ -996,19 +1055,22 @@ pcvar_array_build_rue_downward(purc_variant_t arr)
     if (!data)
         return 0;
 
-    struct arr_node *p;
-    foreach_in_variant_array(arr, p) {
-        struct pcvar_rev_update_edge edge = {
-            .parent         = arr,
-            .arr_me         = p,
-        };
-        int r = pcvar_build_edge_to_parent(p->val, &edge);
+    struct pcvar_rev_update_edge edge = {
+        .parent         = arr,
+        .arr_me         = arr,
+    };
+
+    purc_variant_t v;
+    size_t idx;
+    foreach_value_in_variant_array(arr, v, idx) {
+        UNUSED_PARAM(idx);
+        int r = pcvar_build_edge_to_parent(v, &edge);
         if (r)
             return -1;
-        r = pcvar_build_rue_downward(p->val);
+        r = pcvar_build_rue_downward(v);
         if (r)
             return -1;
-    }
+    } end_foreach;
 
     return 0;
 }
@@ -1040,67 +1102,13 @@ pcvar_array_build_edge_to_parent(purc_variant_t arr,
     return r ? -1 : 0;
 }
 
-static struct pcutils_array_list_node*
-next_node(struct pcutils_array_list *al, struct pcutils_array_list_node *node)
-{
-    if (!node)
-        return NULL;
-    size_t count = pcutils_array_list_length(al);
-    size_t idx = node->idx + 1;
-    if (idx >= count)
-        return NULL;
-
-    return pcutils_array_list_get(al, idx);
-}
-
-static struct pcutils_array_list_node*
-prev_node(struct pcutils_array_list *al, struct pcutils_array_list_node *node)
-{
-    if (!node)
-        return NULL;
-    if (node->idx == 0)
-        return NULL;
-
-    size_t count = pcutils_array_list_length(al);
-    size_t idx = node->idx - 1;
-    if (idx >= count)
-        return NULL;
-
-    return pcutils_array_list_get(al, idx);
-}
-
 static void
-it_refresh(struct arr_iterator *it,
-        struct pcutils_array_list *al,
-        struct pcutils_array_list_node *curr)
+it_refresh(struct arr_iterator *it, size_t idx)
 {
-    struct pcutils_array_list_node *next  = NULL;
-    struct pcutils_array_list_node *prev  = NULL;
-    if (curr) {
-        next  = next_node(al, curr);
-        prev  = prev_node(al, curr);
-    }
-
-    if (curr) {
-        it->curr = container_of(curr, struct arr_node, node);
-    }
-    else {
-        it->curr = NULL;
-    }
-
-    if (next) {
-        it->next = container_of(next, struct arr_node, node);
-    }
-    else {
-        it->next = NULL;
-    }
+    variant_arr_t data = pcvar_arr_get_data(it->arr);
 
-    if (prev) {
-        it->prev = container_of(prev, struct arr_node, node);
-    }
-    else {
-        it->prev = NULL;
-    }
+    it->idx = idx;
+    it->curr = variant_arr_get(data, idx);
 }
 
 struct arr_iterator
@@ -1112,17 +1120,7 @@ pcvar_arr_it_first(purc_variant_t arr)
     if (arr == PURC_VARIANT_INVALID)
         return it;
 
-    variant_arr_t data = pcvar_arr_get_data(arr);
-    size_t count = variant_arr_length(data);
-    if (count == 0)
-        return it;
-
-    struct pcutils_array_list *al = &data->al;
-
-    struct pcutils_array_list_node *first;
-    first = pcutils_array_list_get_first(al);
-
-    it_refresh(&it, al, first);
+    it_refresh(&it, 0);
 
     return it;
 }
@@ -1141,12 +1139,7 @@ pcvar_arr_it_last(purc_variant_t arr)
     if (count == 0)
         return it;
 
-    struct pcutils_array_list *al = &data->al;
-
-    struct pcutils_array_list_node *last;
-    last = pcutils_array_list_get_last(al);
-
-    it_refresh(&it, al, last);
+    it_refresh(&it, count - 1);
 
     return it;
 }
@@ -1154,45 +1147,22 @@ pcvar_arr_it_last(purc_variant_t arr)
 void
 pcvar_arr_it_next(struct arr_iterator *it)
 {
-    if (it->curr == NULL)
+    if (it->curr == PURC_VARIANT_INVALID)
         return;
 
-    if (it->next) {
-        variant_arr_t data = pcvar_arr_get_data(it->arr);
-        struct pcutils_array_list *al = &data->al;
-
-        struct pcutils_array_list_node *next;
-        next = &it->next->node;
-
-        it_refresh(it, al, next);
-    }
-    else {
-        it->curr = NULL;
-        it->next = NULL;
-        it->prev = NULL;
-    }
+    it_refresh(it, it->idx + 1);
 }
 
 void
 pcvar_arr_it_prev(struct arr_iterator *it)
 {
-    if (it->curr == NULL)
+    if (it->curr == PURC_VARIANT_INVALID)
         return;
 
-    if (it->prev) {
-        variant_arr_t data = pcvar_arr_get_data(it->arr);
-        struct pcutils_array_list *al = &data->al;
-
-        struct pcutils_array_list_node *prev;
-        prev = &it->prev->node;
-
-        it_refresh(it, al, prev);
-    }
-    else {
-        it->curr = NULL;
-        it->next = NULL;
-        it->prev = NULL;
+    if (it->idx == 0) {
+        it->curr = PURC_VARIANT_INVALID;
+        return;
     }
-}
-
 
+    it_refresh(it, it->idx - 1);
+}
@@ -78,6 +78,23 @@ variant_obj_t
 pcvar_obj_get_data(purc_variant_t obj) WTF_INTERNAL;
 variant_set_t
 pcvar_set_get_data(purc_variant_t set) WTF_INTERNAL;
+
+/*
+ * Compute the sorted order of the @nr values in @vals by the keys, and
+ * store the original indexes in @order.
+ */
+int
+pcvar_sort_by_keys(purc_variant_t *vals, size_t nr,
+        const struct pcvariant_sort_key *keys, size_t nr_keys,
+        size_t *order) WTF_INTERNAL;
+
+/*
+ * The same as pcvar_sort_by_keys(), but compare the values with @cmp.
+ */
+int
+pcvar_sort_by_cmp(purc_variant_t *vals, size_t nr,
+        int (*cmp)(purc_variant_t l, purc_variant_t r, void *ud), void *ud,
+        size_t *order) WTF_INTERNAL;
 void
 pcvar_adjust_set_by_descendant(purc_variant_t val) WTF_INTERNAL;
 
@@ -178,9 +195,8 @@ pcvar_obj_it_prev(struct obj_iterator *it);
 struct arr_iterator {
     purc_variant_t                arr;
 
-    struct arr_node              *curr;
-    struct arr_node              *next;
-    struct arr_node              *prev;
+    size_t                        idx;
+    purc_variant_t                curr;     // invalid at the end
 };
 
 struct arr_iterator
@@ -194,7 +210,7 @@ pcvar_arr_it_prev(struct arr_iterator *it);
 
 enum set_it_type {
     SET_IT_ARRAY,
-    SET_IT_RBTREE,
+    SET_IT_SORTED,
 };
 
 struct set_iterator {
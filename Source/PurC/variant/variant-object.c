@@ -36,7 +36,14 @@
 #include <string.h>
 
 #define OBJ_EXTRA_SIZE(data) (sizeof(*data) + \
-        (data->size) * sizeof(struct obj_node))
+        (data->size) * sizeof(struct obj_node) + \
+        (data->sz_nodes + data->sz_index) * sizeof(struct obj_node*))
+
+/* objects with more members than this are indexed by a hash table */
+#define OBJ_SMALL_SIZE          8
+#define OBJ_MIN_NODES           4
+
+#define OBJ_NODE_UNLINKED       ((size_t)-1)
 
 static inline bool
 grow(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
@@ -127,6 +134,228 @@ pcvar_obj_get_data(purc_variant_t obj)
     return data;
 }
 
+static inline const char *
+node_key(struct obj_node *node)
+{
+    return purc_variant_get_string_const(node->key);
+}
+
+/* FNV-1a; keys are compared with strcmp(), so stop at the first NUL */
+static inline uint32_t
+key_hash(const char *key)
+{
+    uint32_t hash = 0x811c9dc5;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        hash ^= *p;
+        hash *= 0x01000193;
+    }
+    return hash;
+}
+
+static struct obj_node *
+find_node(variant_obj_t data, const char *key, uint32_t hash)
+{
+    struct obj_node *node;
+
+    if (data->index) {
+        size_t mask = data->sz_index - 1;
+        for (size_t i = hash & mask; (node = data->index[i]);
+                i = (i + 1) & mask) {
+            if (node->hash == hash && strcmp(key, node_key(node)) == 0)
+                return node;
+        }
+        return NULL;
+    }
+
+    for (size_t i = 0; i < data->nr_slots; i++) {
+        node = data->nodes[i];
+        if (node && node->hash == hash && strcmp(key, node_key(node)) == 0)
+            return node;
+    }
+
+    return NULL;
+}
+
+static void
+index_insert(variant_obj_t data, struct obj_node *node)
+{
+    size_t mask = data->sz_index - 1;
+    size_t i = node->hash & mask;
+    while (data->index[i])
+        i = (i + 1) & mask;
+
+    data->index[i] = node;
+}
+
+static void
+index_remove(variant_obj_t data, struct obj_node *node)
+{
+    size_t mask = data->sz_index - 1;
+    size_t i = node->hash & mask;
+    while (data->index[i] != node) {
+        PC_ASSERT(data->index[i]);
+        i = (i + 1) & mask;
+    }
+
+    // backward-shift deletion: no tombstones are left behind
+    size_t j = i;
+    data->index[i] = NULL;
+    for (;;) {
+        j = (j + 1) & mask;
+        struct obj_node *p = data->index[j];
+        if (p == NULL)
+            break;
+
+        size_t k = p->hash & mask;
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+
+        data->index[i] = p;
+        data->index[j] = NULL;
+        i = j;
+    }
+}
+
+/* squeeze out the holes left by the removed nodes, keeping the order */
+static void
+nodes_compact(variant_obj_t data)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < data->nr_slots; i++) {
+        struct obj_node *node = data->nodes[i];
+        if (node) {
+            node->idx = n;
+            data->nodes[n++] = node;
+        }
+    }
+
+    PC_ASSERT(n == data->size);
+    data->nr_slots = n;
+}
+
+/* make room for one more node; build or grow the index if needed */
+static int
+nodes_reserve(variant_obj_t data)
+{
+    size_t count = data->size + 1;
+
+    if (data->nr_slots == data->sz_nodes && data->nr_slots > data->size)
+        nodes_compact(data);
+
+    if (data->nr_slots + 1 > data->sz_nodes) {
+        size_t sz = data->sz_nodes ? data->sz_nodes * 2 : OBJ_MIN_NODES;
+        struct obj_node **nodes;
+        nodes = (struct obj_node**)realloc(data->nodes, sz * sizeof(*nodes));
+        if (!nodes) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+        data->nodes = nodes;
+        data->sz_nodes = sz;
+    }
+
+    if (count <= OBJ_SMALL_SIZE || count * 2 <= data->sz_index)
+        return 0;
+
+    size_t sz = data->sz_index ? data->sz_index * 2 : OBJ_SMALL_SIZE * 4;
+    while (sz < count * 2)
+        sz *= 2;
+
+    struct obj_node **index;
+    index = (struct obj_node**)calloc(sz, sizeof(*index));
+    if (!index) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    free(data->index);
+    data->index = index;
+    data->sz_index = sz;
+    for (size_t i = 0; i < data->nr_slots; i++) {
+        if (data->nodes[i])
+            index_insert(data, data->nodes[i]);
+    }
+
+    return 0;
+}
+
+/* the room must have been reserved by nodes_reserve() */
+static void
+nodes_append(variant_obj_t data, struct obj_node *node)
+{
+    PC_ASSERT(data->nr_slots < data->sz_nodes);
+
+    // the last slot is never a hole
+    if (data->nr_slots > 0 && !data->unsorted &&
+            strcmp(node_key(data->nodes[data->nr_slots - 1]),
+                node_key(node)) > 0)
+        data->unsorted = true;
+
+    node->idx = data->nr_slots;
+    data->nodes[data->nr_slots++] = node;
+    data->size++;
+
+    if (data->index)
+        index_insert(data, node);
+}
+
+static void
+nodes_remove(variant_obj_t data, struct obj_node *node)
+{
+    if (node->idx == OBJ_NODE_UNLINKED)
+        return;
+
+    if (data->index)
+        index_remove(data, node);
+
+    // leave a hole instead of moving the following nodes; the holes are
+    // squeezed out on the next ordered access or when the room runs out
+    data->nodes[node->idx] = NULL;
+    data->size--;
+    while (data->nr_slots > 0 && data->nodes[data->nr_slots - 1] == NULL)
+        data->nr_slots--;
+
+    node->idx = OBJ_NODE_UNLINKED;
+}
+
+static int
+cmp_nodes(const void *l, const void *r)
+{
+    struct obj_node *ln = *(struct obj_node**)l;
+    struct obj_node *rn = *(struct obj_node**)r;
+    return strcmp(node_key(ln), node_key(rn));
+}
+
+struct obj_node **
+pcvar_obj_get_sorted(purc_variant_t obj, size_t *nr)
+{
+    variant_obj_t data = pcvar_obj_get_data(obj);
+    PC_ASSERT(data);
+
+    if (data->nr_slots > data->size)
+        nodes_compact(data);
+
+    if (data->unsorted) {
+        qsort(data->nodes, data->size, sizeof(*data->nodes), cmp_nodes);
+        for (size_t i = 0; i < data->size; i++)
+            data->nodes[i]->idx = i;
+        data->unsorted = false;
+    }
+
+    *nr = data->size;
+    return data->nodes;
+}
+
+struct obj_node **
+pcvar_obj_get_slots(purc_variant_t obj, size_t *nr)
+{
+    variant_obj_t data = pcvar_obj_get_data(obj);
+    PC_ASSERT(data);
+
+    *nr = data->nr_slots;
+    return data->nodes;
+}
+
 static purc_variant_t v_object_new_with_capacity(void)
 {
     purc_variant_t var = pcvariant_get(PVT(_OBJECT));
@@ -147,8 +376,6 @@ static purc_variant_t v_object_new_with_capacity(void)
         return PURC_VARIANT_INVALID;
     }
 
-    data->kvs = RB_ROOT;
-
     var->sz_ptr[1]     = (uintptr_t)data;
     var->refc          = 1;
 
@@ -181,12 +408,7 @@ obj_node_release(purc_variant_t obj, struct obj_node *node)
     variant_obj_t data = pcvar_obj_get_data(obj);
     PC_ASSERT(data);
 
-    struct rb_root *root = &data->kvs;
-    if (&node->node == root->rb_node || node->node.rb_parent) {
-        --data->size;
-        pcutils_rbtree_erase(&node->node, root);
-        node->node.rb_parent = NULL;
-    }
+    nodes_remove(data, node);
 
     PURC_VARIANT_SAFE_CLEAR(node->key);
     PURC_VARIANT_SAFE_CLEAR(node->val);
@@ -220,6 +442,8 @@ obj_node_create(purc_variant_t k, purc_variant_t v)
 
     node->key = purc_variant_ref(k);
     node->val = purc_variant_ref(v);
+    node->hash = key_hash(purc_variant_get_string_const(k));
+    node->idx = OBJ_NODE_UNLINKED;
 
     return node;
 }
@@ -295,29 +519,8 @@ v_object_remove(purc_variant_t obj, const char *key, bool silently,
         bool check)
 {
     variant_obj_t data = pcvar_obj_get_data(obj);
-    struct rb_root *root = &data->kvs;
-    struct rb_node **pnode = &root->rb_node;
-    struct rb_node *parent = NULL;
-    struct rb_node *entry = NULL;
-    while (*pnode) {
-        struct obj_node *node;
-        node = container_of(*pnode, struct obj_node, node);
-        const char *sk = purc_variant_get_string_const(node->key);
-        int ret = strcmp(key, sk);
-
-        parent = *pnode;
-
-        if (ret < 0)
-            pnode = &parent->rb_left;
-        else if (ret > 0)
-            pnode = &parent->rb_right;
-        else{
-            entry = *pnode;
-            break;
-        }
-    }
-
-    if (!entry) {
+    struct obj_node *node = find_node(data, key, key_hash(key));
+    if (!node) {
         if (silently)
             return 0;
 
@@ -325,8 +528,6 @@ v_object_remove(purc_variant_t obj, const char *key, bool silently,
         return -1;
     }
 
-    struct obj_node *node;
-    node = container_of(entry, struct obj_node, node);
     purc_variant_t k = node->key;
     purc_variant_t v = node->val;
 
@@ -341,10 +542,7 @@ v_object_remove(purc_variant_t obj, const char *key, bool silently,
             break_rev_update_chain(obj, node);
         }
 
-        --data->size;
-        PC_ASSERT(entry == root->rb_node || entry->rb_parent);
-        pcutils_rbtree_erase(entry, root);
-        entry->rb_parent = NULL;
+        nodes_remove(data, node);
 
         if (check) {
             pcvar_adjust_set_by_descendant(obj);
@@ -473,30 +671,9 @@ v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
     variant_obj_t data = pcvar_obj_get_data(obj);
     PC_ASSERT(data);
 
-    struct rb_root *root = &data->kvs;
-    struct rb_node **pnode = &root->rb_node;
-    struct rb_node *parent = NULL;
-    struct rb_node *entry = NULL;
-    while (*pnode) {
-        struct obj_node *node;
-        node = container_of(*pnode, struct obj_node, node);
-        const char *sko = purc_variant_get_string_const(node->key);
-        int ret = strcmp(sk, sko);
-
-        parent = *pnode;
-
-        if (ret < 0)
-            pnode = &parent->rb_left;
-        else if (ret > 0)
-            pnode = &parent->rb_right;
-        else{
-            entry = *pnode;
-            break;
-        }
-    }
-
-    if (!entry) { //new the entry
-        struct obj_node *node = obj_node_create(key, val);
+    struct obj_node *node = find_node(data, sk, key_hash(sk));
+    if (!node) { //new the entry
+        node = obj_node_create(key, val);
         if (!node)
             return -1;
 
@@ -509,12 +686,10 @@ v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
                     break;
             }
 
-            entry = &node->node;
-
-            pcutils_rbtree_link_node(entry, parent, pnode);
-            pcutils_rbtree_insert_color(entry, root);
+            if (nodes_reserve(data))
+                break;
 
-            ++data->size;
+            nodes_append(data, node);
 
             if (check) {
                 if (build_rev_update_chain(obj, node))
@@ -536,8 +711,6 @@ v_object_set(purc_variant_t obj, purc_variant_t key, purc_variant_t val,
         return -1;
     }
 
-    struct obj_node *node;
-    node = container_of(entry, struct obj_node, node);
     if (node->val == val) {
         // NOTE: keep refc intact
         return 0;
@@ -752,16 +925,14 @@ void pcvariant_object_release (purc_variant_t value)
 {
     variant_obj_t data = pcvar_obj_get_data(value);
 
-    struct rb_root *root = &data->kvs;
-
-    struct rb_node *p, *n;
-    pcutils_rbtree_for_each_safe(pcutils_rbtree_first(root), p, n) {
-        struct obj_node *node;
-        node = container_of(p, struct obj_node, node);
-
-        obj_node_destroy(value, node);
+    // the last slot is never a hole
+    while (data->nr_slots > 0) {
+        obj_node_destroy(value, data->nodes[data->nr_slots - 1]);
     }
 
+    free(data->nodes);
+    free(data->index);
+
     if (data->rev_update_chain) {
         pcvar_destroy_rev_update_chain(data->rev_update_chain);
         data->rev_update_chain = NULL;
@@ -804,38 +975,13 @@ purc_variant_object_get_by_ckey(purc_variant_t obj, const char* key)
         PURC_VARIANT_INVALID);
 
     variant_obj_t data = pcvar_obj_get_data(obj);
-    struct rb_root *root = &data->kvs;
-
-    struct rb_node **pnode = &root->rb_node;
-    struct rb_node *parent = NULL;
-    struct rb_node *entry = NULL;
-    while (*pnode) {
-        struct obj_node *node;
-        node = container_of(*pnode, struct obj_node, node);
-        const char *sk = purc_variant_get_string_const(node->key);
-
-        int ret = strcmp(key, sk);
-
-        parent = *pnode;
-
-        if (ret < 0)
-            pnode = &parent->rb_left;
-        else if (ret > 0)
-            pnode = &parent->rb_right;
-        else{
-            entry = *pnode;
-            break;
-        }
-    }
-
-    if (!entry) {
+    struct obj_node *node = find_node(data, key, key_hash(key));
+    if (!node) {
         pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
 
         return PURC_VARIANT_INVALID;
     }
 
-    struct obj_node *node;
-    node = container_of(entry, struct obj_node, node);
     return node->val;
 }
 
@@ -1039,11 +1185,10 @@ pcvar_object_break_rue_downward(purc_variant_t obj)
     if (!data)
         return;
 
-    struct rb_root *root = &data->kvs;
-    struct rb_node *p = pcutils_rbtree_first(root);
-    for (; p; p = pcutils_rbtree_next(p)) {
-        struct obj_node *node;
-        node = container_of(p, struct obj_node, node);
+    for (size_t i = 0; i < data->nr_slots; i++) {
+        struct obj_node *node = data->nodes[i];
+        if (node == NULL)
+            continue;
         struct pcvar_rev_update_edge edge = {
             .parent         = obj,
             .obj_me         = node,
@@ -1076,11 +1221,10 @@ pcvar_object_build_rue_downward(purc_variant_t obj)
     if (!data)
         return 0;
 
-    struct rb_root *root = &data->kvs;
-    struct rb_node *p = pcutils_rbtree_first(root);
-    for (; p; p = pcutils_rbtree_next(p)) {
-        struct obj_node *node;
-        node = container_of(p, struct obj_node, node);
+    for (size_t i = 0; i < data->nr_slots; i++) {
+        struct obj_node *node = data->nodes[i];
+        if (node == NULL)
+            continue;
         struct pcvar_rev_update_edge edge = {
             .parent         = obj,
             .obj_me         = node,
@@ -1124,34 +1268,19 @@ pcvar_object_build_edge_to_parent(purc_variant_t obj,
 }
 
 static void
-it_refresh(struct obj_iterator *it, struct rb_node *curr)
+it_refresh(struct obj_iterator *it, struct obj_node *curr)
 {
-    struct rb_node *next  = NULL;
-    struct rb_node *prev  = NULL;
-    if (curr) {
-        next  = pcutils_rbtree_next(curr);
-        prev  = pcutils_rbtree_prev(curr);
-    }
+    it->curr = curr;
+    it->next = NULL;
+    it->prev = NULL;
 
     if (curr) {
-        it->curr = container_of(curr, struct obj_node, node);
-    }
-    else {
-        it->curr = NULL;
-    }
-
-    if (next) {
-        it->next = container_of(next, struct obj_node, node);
-    }
-    else {
-        it->next = NULL;
-    }
-
-    if (prev) {
-        it->prev = container_of(prev, struct obj_node, node);
-    }
-    else {
-        it->prev = NULL;
+        size_t nr;
+        struct obj_node **nodes = pcvar_obj_get_sorted(it->obj, &nr);
+        if (curr->idx + 1 < nr)
+            it->next = nodes[curr->idx + 1];
+        if (curr->idx > 0)
+            it->prev = nodes[curr->idx - 1];
     }
 }
 
@@ -1168,10 +1297,9 @@ pcvar_obj_it_first(purc_variant_t obj)
     if (data->size==0)
         return it;
 
-    struct rb_root *root = &data->kvs;
-
-    struct rb_node *first = pcutils_rbtree_first(root);
-    it_refresh(&it, first);
+    size_t nr;
+    struct obj_node **nodes = pcvar_obj_get_sorted(obj, &nr);
+    it_refresh(&it, nodes[0]);
 
     return it;
 }
@@ -1189,10 +1317,9 @@ pcvar_obj_it_last(purc_variant_t obj)
     if (data->size==0)
         return it;
 
-    struct rb_root *root = &data->kvs;
-
-    struct rb_node *last = pcutils_rbtree_last(root);
-    it_refresh(&it, last);
+    size_t nr;
+    struct obj_node **nodes = pcvar_obj_get_sorted(obj, &nr);
+    it_refresh(&it, nodes[nr - 1]);
 
     return it;
 }
@@ -1204,8 +1331,7 @@ pcvar_obj_it_next(struct obj_iterator *it)
         return;
 
     if (it->next) {
-        struct rb_node *next = &it->next->node;
-        it_refresh(it, next);
+        it_refresh(it, it->next);
     }
     else {
         it->curr = NULL;
@@ -1221,8 +1347,7 @@ pcvar_obj_it_prev(struct obj_iterator *it)
         return;
 
     if (it->prev) {
-        struct rb_node *prev = &it->prev->node;
-        it_refresh(it, prev);
+        it_refresh(it, it->prev);
     }
     else {
         it->curr = NULL;
@@ -1230,4 +1355,3 @@ pcvar_obj_it_prev(struct obj_iterator *it)
         it->prev = NULL;
     }
 }
-
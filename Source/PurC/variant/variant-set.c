@@ -22,7 +22,7 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#define _GNU_SOURCE       // qsort_r
+#define _GNU_SOURCE
 
 #include "config.h"
 #include "private/variant.h"
@@ -140,6 +140,7 @@ variant_set_get_extra_size(variant_set_t data)
 
     extra += sz_record * count;
     extra += sizeof(struct set_node*)*(data->al.nr);
+    extra += sizeof(struct set_node*)*(data->sz_index + data->sz_sorted);
 
     return extra;
 }
@@ -150,77 +151,11 @@ pcv_set_set_data(purc_variant_t set, variant_set_t data)
     set->sz_ptr[1]     = (uintptr_t)data;
 }
 
-static int
-obj_node_diff(struct obj_node *l, struct obj_node *r)
-{
-    int diff = 0;
-
-    purc_variant_t lk, rk;
-    lk = l->key;
-    rk = r->key;
-    PC_ASSERT(lk);
-    PC_ASSERT(rk);
-
-    if (lk != rk) {
-        diff = pcvariant_diff(lk, rk);
-        if (diff)
-            return diff;
-    }
-
-    purc_variant_t lv, rv;
-    lv = l->val;
-    rv = r->val;
-    PC_ASSERT(lv);
-    PC_ASSERT(rv);
-
-    if (lv != rv) {
-        diff = pcvariant_diff(lv, rv);
-    }
-
-    return diff;
-}
-
-static int
-variant_set_compare_by_set_keys(purc_variant_t set,
-        purc_variant_t l, purc_variant_t r)
-{
-    PC_ASSERT(set != PURC_VARIANT_INVALID);
-    PC_ASSERT(purc_variant_is_set(set));
-    PC_ASSERT(l != PURC_VARIANT_INVALID);
-    PC_ASSERT(r != PURC_VARIANT_INVALID);
-    PC_ASSERT(pcvariant_is_mutable(l));
-    PC_ASSERT(pcvariant_is_mutable(r));
-
-    int diff;
-
-    struct kv_iterator lit, rit;
-    lit = pcvar_kv_it_first(set, l);
-    rit = pcvar_kv_it_first(set, r);
-    while (1) {
-        struct obj_node *ln = lit.it.curr;
-        struct obj_node *rn = rit.it.curr;
-        if (ln == NULL && rn == NULL)
-            return 0;
-        if (ln == NULL)
-            return -1;
-        if (rn == NULL)
-            return 1;
-
-        diff = obj_node_diff(ln, rn);
-        if (diff)
-            return diff;
-
-        pcvar_kv_it_next(&lit);
-        pcvar_kv_it_next(&rit);
-    }
-}
-
 static int
 variant_set_init(variant_set_t data, const char *unique_key, bool caseless)
 {
     data->caseless = caseless;
 
-    data->elems = RB_ROOT;
     pcutils_array_list_init(&data->al);
 
     if (!unique_key || !*unique_key) {
@@ -354,10 +289,9 @@ elem_node_revoke_constraints(purc_variant_t set, struct set_node *node)
     break_rev_update_chain(set, node);
 }
 
-struct element_rb_node {
-    struct rb_node     **pnode;
-    struct rb_node      *parent;
-    struct rb_node      *entry;
+struct element_slot {
+    uint64_t             hash;
+    struct set_node     *entry;
 };
 
 static int
@@ -436,60 +370,231 @@ _compare(purc_variant_t _new, purc_variant_t _old,
 }
 
 static void
-find_element_rb_node(struct element_rb_node *node,
+find_element_slot(struct element_slot *slot,
         purc_variant_t set, purc_variant_t kvs)
 {
     variant_set_t data = pcvar_set_get_data(set);
-    struct rb_root *root = &data->elems;
-    struct rb_node **pnode = &root->rb_node;
-    struct rb_node *parent = NULL;
-    struct rb_node *entry = NULL;
-    char md5[33];
-    pcvariant_md5_by_set(md5, kvs, set);
-
-    while (*pnode) {
-        struct set_node *on;
-        on = container_of(*pnode, struct set_node, rbnode);
-        int diff;
-        if (0) {
-            diff = variant_set_compare_by_set_keys(set, kvs, on->val);
-        }
-        else if (0) {
-            diff = pcvariant_diff_by_set(md5, kvs, on->md5, on->val, set);
-        }
-        else {
-            diff = _compare(kvs, on->val, data);
-        }
 
-        parent = *pnode;
+    slot->hash  = pcvariant_hash_by_set(kvs, set);
+    slot->entry = NULL;
 
-        if (diff < 0) {
-            pnode = &parent->rb_left;
-        }
-        else if (diff > 0) {
-            pnode = &parent->rb_right;
-        }
-        else{
-            entry = *pnode;
+    if (data->sz_index == 0)
+        return;
+
+    size_t mask = data->sz_index - 1;
+    size_t i = slot->hash & mask;
+    struct set_node *on;
+    while ((on = data->index[i])) {
+        if (on->hash == slot->hash && _compare(kvs, on->val, data) == 0) {
+            slot->entry = on;
             break;
         }
+        i = (i + 1) & mask;
     }
-
-    node->pnode  = pnode;
-    node->parent = parent;
-    node->entry  = entry;
 }
 
 static struct set_node*
 find_element(purc_variant_t set, purc_variant_t kvs)
 {
-    struct element_rb_node node;
-    find_element_rb_node(&node, set, kvs);
+    struct element_slot slot;
+    find_element_slot(&slot, set, kvs);
 
-    if (!node.entry)
-        return NULL;
+    return slot.entry;
+}
+
+static void
+index_insert(variant_set_t data, struct set_node *node)
+{
+    PC_ASSERT(data->sz_index > 0);
+
+    size_t mask = data->sz_index - 1;
+    size_t i = node->hash & mask;
+    while (data->index[i])
+        i = (i + 1) & mask;
+
+    data->index[i] = node;
+}
+
+static void
+index_remove(variant_set_t data, struct set_node *node)
+{
+    PC_ASSERT(data->sz_index > 0);
+
+    size_t mask = data->sz_index - 1;
+    size_t i = node->hash & mask;
+    while (data->index[i] != node) {
+        PC_ASSERT(data->index[i]);
+        i = (i + 1) & mask;
+    }
+
+    // shift the following entries of the cluster back instead of
+    // leaving a tombstone
+    size_t j = i;
+    data->index[i] = NULL;
+    for (;;) {
+        j = (j + 1) & mask;
+        struct set_node *p = data->index[j];
+        if (p == NULL)
+            break;
+
+        // keep p in place if its home slot lies cyclically in (i, j]
+        size_t k = p->hash & mask;
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+
+        data->index[i] = p;
+        data->index[j] = NULL;
+        i = j;
+    }
+}
+
+#define SET_INDEX_MIN_SIZE      8
+
+/* make room for count elements; keep the load factor of index under 1/2 */
+static int
+variant_set_reserve(variant_set_t data, size_t count)
+{
+    if (count > data->sz_sorted) {
+        size_t sz = data->sz_sorted ? data->sz_sorted * 2 : SET_INDEX_MIN_SIZE;
+        while (sz < count)
+            sz *= 2;
+
+        struct set_node **sorted;
+        sorted = (struct set_node**)realloc(data->sorted, sz * sizeof(*sorted));
+        if (!sorted) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return -1;
+        }
+        data->sorted = sorted;
+        data->sz_sorted = sz;
+    }
+
+    if (count * 2 <= data->sz_index)
+        return 0;
+
+    size_t sz = data->sz_index ? data->sz_index * 2 : SET_INDEX_MIN_SIZE;
+    while (sz < count * 2)
+        sz *= 2;
+
+    struct set_node **index;
+    index = (struct set_node**)calloc(sz, sizeof(*index));
+    if (!index) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return -1;
+    }
+
+    struct set_node **old = data->index;
+    size_t sz_old = data->sz_index;
+    data->index = index;
+    data->sz_index = sz;
+    for (size_t i = 0; i < sz_old; i++) {
+        if (old[i])
+            index_insert(data, old[i]);
+    }
+    free(old);
+
+    return 0;
+}
 
-    return container_of(node.entry, struct set_node, rbnode);
+/* squeezes out the holes left by the removed nodes */
+static void
+sorted_compact(variant_set_t data)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < data->nr_sorted; i++) {
+        struct set_node *node = data->sorted[i];
+        if (node) {
+            node->sorted_idx = n;
+            data->sorted[n++] = node;
+        }
+    }
+    data->nr_sorted = n;
+}
+
+/* the room must have been reserved by variant_set_reserve() */
+static void
+sorted_append(variant_set_t data, struct set_node *node)
+{
+    if (data->nr_sorted == data->sz_sorted)
+        sorted_compact(data);
+    PC_ASSERT(data->nr_sorted < data->sz_sorted);
+
+    // the last slot is never a hole
+    if (data->nr_sorted > 0 && !data->unsorted &&
+            _compare(node->val, data->sorted[data->nr_sorted - 1]->val,
+                data) < 0)
+        data->unsorted = true;
+
+    node->sorted_idx = data->nr_sorted;
+    data->sorted[data->nr_sorted++] = node;
+}
+
+static void
+sorted_remove(variant_set_t data, struct set_node *node)
+{
+    size_t idx = node->sorted_idx;
+    PC_ASSERT(idx < data->nr_sorted && data->sorted[idx] == node);
+
+    // leave a hole instead of moving the following nodes
+    data->sorted[idx] = NULL;
+    while (data->nr_sorted > 0 && data->sorted[data->nr_sorted - 1] == NULL)
+        data->nr_sorted--;
+}
+
+/* the nodes equal by the keys keep the order of the members */
+static int
+cmp_sorted_nodes(struct set_node *l, struct set_node *r, variant_set_t data)
+{
+    int diff = _compare(l->val, r->val, data);
+    if (diff == 0)
+        diff = (l->alnode.idx > r->alnode.idx) -
+            (l->alnode.idx < r->alnode.idx);
+    return diff;
+}
+
+#if OS(HURD) || OS(LINUX)
+static int cmp_sorted(const void *l, const void *r, void *ud)
+{
+    return cmp_sorted_nodes(*(struct set_node**)l, *(struct set_node**)r,
+            (variant_set_t)ud);
+}
+#elif OS(DARWIN) || OS(FREEBSD) || OS(NETBSD) || OS(OPENBSD) || OS(WINDOWS)
+static int cmp_sorted(void *ud, const void *l, const void *r)
+{
+    return cmp_sorted_nodes(*(struct set_node**)l, *(struct set_node**)r,
+            (variant_set_t)ud);
+}
+#else
+#error Unsupported operating system.
+#endif
+
+struct set_node **
+pcvar_set_get_sorted(purc_variant_t set, size_t *nr)
+{
+    variant_set_t data = pcvar_set_get_data(set);
+    PC_ASSERT(data);
+
+    if (data->nr_sorted > pcutils_array_list_length(&data->al))
+        sorted_compact(data);
+    PC_ASSERT(data->nr_sorted == pcutils_array_list_length(&data->al));
+
+    if (data->unsorted) {
+        struct set_node **nodes = data->sorted;
+        size_t count = data->nr_sorted;
+#if OS(HURD) || OS(LINUX)
+        qsort_r(nodes, count, sizeof(*nodes), cmp_sorted, data);
+#elif OS(DARWIN) || OS(FREEBSD) || OS(NETBSD) || OS(OPENBSD)
+        qsort_r(nodes, count, sizeof(*nodes), data, cmp_sorted);
+#elif OS(WINDOWS)
+        qsort_s(nodes, count, sizeof(*nodes), cmp_sorted, data);
+#endif
+        for (size_t i = 0; i < count; i++)
+            nodes[i]->sorted_idx = i;
+        data->unsorted = false;
+    }
+
+    *nr = data->nr_sorted;
+    return data->sorted;
 }
 
 static int
@@ -573,11 +678,12 @@ elem_node_remove(purc_variant_t set, struct set_node *node)
     variant_set_t data = pcvar_set_get_data(set);
     PC_ASSERT(data);
 
-    pcutils_rbtree_erase(&node->rbnode, &data->elems);
+    struct pcutils_array_list *al = &data->al;
+    index_remove(data, node);
+    sorted_remove(data, node);
 
     int r;
     struct pcutils_array_list_node *old;
-    struct pcutils_array_list *al = &data->al;
     r = pcutils_array_list_remove(al, node->alnode.idx, &old);
     PC_ASSERT(r == 0);
     PC_ASSERT(old == &node->alnode);
@@ -646,6 +752,15 @@ variant_set_release_elems(purc_variant_t set, variant_set_t data)
     }
 
     pcutils_array_list_reset(&data->al);
+
+    free(data->index);
+    data->index = NULL;
+    data->sz_index = 0;
+    free(data->sorted);
+    data->sorted = NULL;
+    data->nr_sorted = 0;
+    data->sz_sorted = 0;
+    data->unsorted = false;
 }
 
 static void
@@ -715,7 +830,7 @@ variant_set_create_elem_node(purc_variant_t set, purc_variant_t val)
         return NULL;
     }
 
-    pcvariant_md5_by_set(_new->md5, val, set);
+    _new->hash = pcvariant_hash_by_set(val, set);
 
     _new->alnode.idx = (size_t)-1;
     _new->val = val;
@@ -840,9 +955,7 @@ check_grow(purc_variant_t set, purc_variant_t val)
 
 static int
 insert(purc_variant_t set, variant_set_t data,
-        purc_variant_t val,
-        struct rb_node *parent, struct rb_node **pnode,
-        bool check)
+        purc_variant_t val, bool check)
 {
     struct set_node *node = NULL;
 
@@ -855,6 +968,10 @@ insert(purc_variant_t set, variant_set_t data,
                 break;
         }
 
+        size_t count = pcutils_array_list_length(&data->al);
+        if (variant_set_reserve(data, count + 1))
+            break;
+
         node = variant_set_create_elem_node(set, val);
         if (!node)
             break;
@@ -865,13 +982,10 @@ insert(purc_variant_t set, variant_set_t data,
             break;
         PC_ASSERT(node->alnode.idx != (size_t)-1);
 
-        size_t count = pcutils_array_list_length(&data->al);
-        node->alnode.idx = count - 1;
+        node->alnode.idx = count;
 
-        struct rb_node *entry = &node->rbnode;
-
-        pcutils_rbtree_link_node(entry, parent, pnode);
-        pcutils_rbtree_insert_color(entry, &data->elems);
+        index_insert(data, node);
+        sorted_append(data, node);
 
         if (check) {
             if (!elem_node_setup_constraints(set, node))
@@ -896,16 +1010,16 @@ pcvar_set_add(purc_variant_t set, purc_variant_t val)
     variant_set_t data = pcvar_set_get_data(set);
     PC_ASSERT(data);
 
-    struct element_rb_node rbn;
-    find_element_rb_node(&rbn, set, val);
+    struct element_slot slot;
+    find_element_slot(&slot, set, val);
 
-    if (rbn.entry) {
+    if (slot.entry) {
         purc_set_error(PURC_ERROR_DUPLICATED);
         return -1;
     }
 
     bool check = false;
-    return insert(set, data, val, rbn.parent, rbn.pnode, check);
+    return insert(set, data, val, check);
 }
 
 static int
@@ -959,11 +1073,11 @@ insert_or_replace(purc_variant_t set,
         variant_set_t data, purc_variant_t val, bool overwrite,
         bool check)
 {
-    struct element_rb_node rbn;
-    find_element_rb_node(&rbn, set, val);
+    struct element_slot slot;
+    find_element_slot(&slot, set, val);
 
-    if (!rbn.entry) {
-        int r = insert(set, data, val, rbn.parent, rbn.pnode, check);
+    if (!slot.entry) {
+        int r = insert(set, data, val, check);
 
         return r ? -1 : 0;
     }
@@ -975,8 +1089,7 @@ insert_or_replace(purc_variant_t set,
         return -1;
     }
 
-    struct set_node *curr;
-    curr = container_of(rbn.entry, struct set_node, rbnode);
+    struct set_node *curr = slot.entry;
 
     if (curr->val == val)
         return 0;
@@ -1346,8 +1459,8 @@ purc_variant_set_set_by_index(purc_variant_t set,
 
 struct purc_variant_set_iterator {
     purc_variant_t      set;
-    struct rb_node     *curr;
-    struct rb_node     *prev, *next;
+    struct set_node    *curr;
+    struct set_node    *prev, *next;
 };
 
 static void
@@ -1365,19 +1478,10 @@ iterator_refresh(struct purc_variant_set_iterator *it)
         it->prev = NULL;
         return;
     }
-    struct rb_node *first, *last;
-    first = pcutils_rbtree_first(&data->elems);
-    last  = pcutils_rbtree_last(&data->elems);
-    if (it->curr == first) {
-        it->prev = NULL;
-    } else {
-        it->prev = pcutils_rbtree_prev(it->curr);
-    }
-    if (it->curr == last) {
-        it->next = NULL;
-    } else {
-        it->next = pcutils_rbtree_next(it->curr);
-    }
+    struct set_node **sorted = pcvar_set_get_sorted(it->set, &count);
+    size_t idx = it->curr->sorted_idx;
+    it->prev = idx > 0 ? sorted[idx - 1] : NULL;
+    it->next = idx + 1 < count ? sorted[idx + 1] : NULL;
 }
 
 struct purc_variant_set_iterator*
@@ -1403,11 +1507,8 @@ purc_variant_set_make_iterator_begin(purc_variant_t set)
     }
     it->set = set;
 
-    struct rb_node *p;
-    p = pcutils_rbtree_first(&data->elems);
-    PC_ASSERT(p);
-
-    it->curr = p;
+    struct set_node **sorted = pcvar_set_get_sorted(set, &count);
+    it->curr = sorted[0];
     iterator_refresh(it);
 
     return it;
@@ -1436,11 +1537,8 @@ purc_variant_set_make_iterator_end(purc_variant_t set)
     }
     it->set = set;
 
-    struct rb_node *p;
-    p = pcutils_rbtree_last(&data->elems);
-    PC_ASSERT(p);
-
-    it->curr = p;
+    struct set_node **sorted = pcvar_set_get_sorted(set, &count);
+    it->curr = sorted[count - 1];
     iterator_refresh(it);
 
     return it;
@@ -1493,9 +1591,7 @@ purc_variant_set_iterator_get_value(struct purc_variant_set_iterator* it)
         it->set->type==PVT(_SET) && it->curr,
         PURC_VARIANT_INVALID);
 
-    struct set_node *p;
-    p = container_of(it->curr, struct set_node, rbnode);
-    return p->val;
+    return it->curr->val;
 }
 
 void
@@ -1539,20 +1635,6 @@ struct set_user_data {
     void *ud;
 };
 
-static int vrtcmp(purc_variant_t l, purc_variant_t r, void *ud)
-{
-    uintptr_t sort_flags;
-    purc_vrtcmp_opt_t cmpopt;
-
-    sort_flags = (uintptr_t)ud;
-    cmpopt = (purc_vrtcmp_opt_t)(sort_flags & PCVARIANT_CMPOPT_MASK);
-
-    int retv = purc_variant_compare_ex(l, r, cmpopt);
-    if (sort_flags & PCVARIANT_SORT_DESC)
-        retv = -retv;
-    return retv;
-}
-
 static int
 cmp_f(struct pcutils_array_list_node *l, struct pcutils_array_list_node *r,
         void *ud)
@@ -1573,11 +1655,21 @@ int pcvariant_set_sort(purc_variant_t value, void *ud,
 {
     PC_ASSERT(value != PURC_VARIANT_INVALID);
 
+    if (cmp == NULL) {
+        uintptr_t sort_flags = (uintptr_t)ud;
+        struct pcvariant_sort_key key = {
+            .name = NULL,
+            .opt  = (purc_vrtcmp_opt_t)(sort_flags & PCVARIANT_CMPOPT_MASK),
+            .desc = (sort_flags & PCVARIANT_SORT_DESC) ? true : false,
+        };
+        return pcvariant_set_sort_by_keys(value, &key, 1);
+    }
+
     variant_set_t data = pcvar_set_get_data(value);
     struct pcutils_array_list *al = &data->al;
 
     struct set_user_data d = {
-        .cmp = cmp ? cmp : vrtcmp,
+        .cmp = cmp,
         .ud  = ud,
     };
 
@@ -1586,6 +1678,46 @@ int pcvariant_set_sort(purc_variant_t value, void *ud,
     return 0;
 }
 
+int pcvariant_set_sort_by_keys(purc_variant_t value,
+        const struct pcvariant_sort_key *keys, size_t nr_keys)
+{
+    PC_ASSERT(value != PURC_VARIANT_INVALID);
+
+    variant_set_t data = pcvar_set_get_data(value);
+    struct pcutils_array_list *al = &data->al;
+    size_t nr = pcutils_array_list_length(al);
+    if (nr < 2)
+        return 0;
+
+    int r = -1;
+    purc_variant_t *vals = malloc(nr * sizeof(*vals));
+    size_t *order = malloc(nr * sizeof(*order));
+    if (!vals || !order) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        goto out;
+    }
+
+    for (size_t i = 0; i < nr; i++) {
+        struct set_node *p;
+        p = container_of(al->nodes[i], struct set_node, alnode);
+        vals[i] = p->val;
+    }
+
+    if (pcvar_sort_by_keys(vals, nr, keys, nr_keys, order))
+        goto out;
+
+    if (pcutils_array_list_reorder(al, order)) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        goto out;
+    }
+    r = 0;
+
+out:
+    free(order);
+    free(vals);
+    return r;
+}
+
 purc_variant_t
 pcvariant_set_find(purc_variant_t set, purc_variant_t value)
 {
@@ -1716,11 +1848,13 @@ next_node(struct set_iterator *it, struct set_node *curr)
         return container_of(alnode, struct set_node, alnode);
     }
 
-    if (it->it_type == SET_IT_RBTREE) {
-        struct rb_node *p = pcutils_rbtree_next(&curr->rbnode);
-        if (!p)
+    if (it->it_type == SET_IT_SORTED) {
+        size_t count;
+        struct set_node **sorted = pcvar_set_get_sorted(it->set, &count);
+        size_t idx = curr->sorted_idx + 1;
+        if (idx >= count)
             return NULL;
-        return container_of(p, struct set_node, rbnode);
+        return sorted[idx];
     }
 
     PC_ASSERT(0);
@@ -1750,11 +1884,12 @@ prev_node(struct set_iterator *it, struct set_node *curr)
         return container_of(alnode, struct set_node, alnode);
     }
 
-    if (it->it_type == SET_IT_RBTREE) {
-        struct rb_node *p = pcutils_rbtree_prev(&curr->rbnode);
-        if (!p)
+    if (it->it_type == SET_IT_SORTED) {
+        size_t count;
+        struct set_node **sorted = pcvar_set_get_sorted(it->set, &count);
+        if (curr->sorted_idx == 0)
             return NULL;
-        return container_of(p, struct set_node, rbnode);
+        return sorted[curr->sorted_idx - 1];
     }
 
     PC_ASSERT(0);
@@ -1790,8 +1925,6 @@ pcvar_set_it_first(purc_variant_t set, enum set_it_type it_type)
     if (data == NULL)
         return it;
 
-    struct rb_root *root = &data->elems;
-
     struct pcutils_array_list *arr = &data->al;
     if (arr == NULL)
         return it;
@@ -1808,10 +1941,9 @@ pcvar_set_it_first(purc_variant_t set, enum set_it_type it_type)
         PC_ASSERT(alnode);
         curr = container_of(alnode, struct set_node, alnode);
     }
-    else if (it_type == SET_IT_RBTREE) {
-        struct rb_node *p = pcutils_rbtree_first(root);
-        PC_ASSERT(p);
-        curr = container_of(p, struct set_node, rbnode);
+    else if (it_type == SET_IT_SORTED) {
+        struct set_node **sorted = pcvar_set_get_sorted(set, &count);
+        curr = sorted[0];
     }
     else {
         PC_ASSERT(0);
@@ -1835,8 +1967,6 @@ pcvar_set_it_last(purc_variant_t set, enum set_it_type it_type)
     if (data == NULL)
         return it;
 
-    struct rb_root *root = &data->elems;
-
     struct pcutils_array_list *arr = &data->al;
     if (arr == NULL)
         return it;
@@ -1853,10 +1983,9 @@ pcvar_set_it_last(purc_variant_t set, enum set_it_type it_type)
         PC_ASSERT(alnode);
         curr = container_of(alnode, struct set_node, alnode);
     }
-    else if (it_type == SET_IT_RBTREE) {
-        struct rb_node *p = pcutils_rbtree_last(root);
-        PC_ASSERT(p);
-        curr = container_of(p, struct set_node, rbnode);
+    else if (it_type == SET_IT_SORTED) {
+        struct set_node **sorted = pcvar_set_get_sorted(set, &count);
+        curr = sorted[count - 1];
     }
     else {
         PC_ASSERT(0);
@@ -2090,16 +2219,17 @@ pcvar_readjust_set(purc_variant_t set, struct set_node *node)
     PC_ASSERT(purc_variant_is_set(set));
     variant_set_t data = pcvar_set_get_data(set);
 
-    pcutils_rbtree_erase(&node->rbnode, &data->elems);
+    index_remove(data, node);
 
-    struct element_rb_node rbn;
-    find_element_rb_node(&rbn, set, node->val);
-    PC_ASSERT(rbn.entry == NULL);
+    struct element_slot slot;
+    find_element_slot(&slot, set, node->val);
+    PC_ASSERT(slot.entry == NULL);
 
-    struct rb_node *entry = &node->rbnode;
+    node->hash = slot.hash;
+    index_insert(data, node);
 
-    pcutils_rbtree_link_node(entry, rbn.parent, rbn.pnode);
-    pcutils_rbtree_insert_color(entry, &data->elems);
+    // the value has changed in place; sort again on the next ordered access
+    data->unsorted = true;
 
     return 0;
 }
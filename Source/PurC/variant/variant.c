@@ -1618,6 +1618,8 @@ purc_variant_t purc_variant_load_from_json_stream(purc_rwstream_t stream)
     struct pcejson* parser = NULL;
 
     int ret = pcejson_parse (&root, &parser, stream, PCEJSON_DEFAULT_DEPTH);
+    if (parser)
+        pcejson_give_back(parser);
     if (ret != PCEJSON_SUCCESS) {
         goto ret;
     }
@@ -2813,6 +2815,8 @@ purc_variant_ejson_parse_stream(purc_rwstream_t rws)
     struct pcejson* parser = NULL;
 
     int ret = pcejson_parse(&root, &parser, rws, PCEJSON_DEFAULT_DEPTH);
+    if (parser)
+        pcejson_give_back(parser);
     if (ret == PCEJSON_SUCCESS) {
         pcejson_destroy(parser);
         return (struct purc_ejson_parse_tree *)root;
@@ -2848,17 +2852,13 @@ cmp_by_obj(purc_variant_t l, purc_variant_t r,
     rd = (variant_obj_t)r->sz_ptr[1];
     PC_ASSERT(ld);
     PC_ASSERT(rd);
-    struct rb_root *lroot = &ld->kvs;
-    struct rb_root *rroot = &rd->kvs;
-    struct rb_node *lnode = pcutils_rbtree_first(lroot);
-    struct rb_node *rnode = pcutils_rbtree_first(rroot);
-    for (;
-        lnode && rnode;
-        lnode = pcutils_rbtree_next(lnode), rnode = pcutils_rbtree_next(rnode))
-    {
-        struct obj_node *lo, *ro;
-        lo = container_of(lnode, struct obj_node, node);
-        ro = container_of(rnode, struct obj_node, node);
+    size_t lnr, rnr;
+    struct obj_node **lnodes = pcvar_obj_get_sorted(l, &lnr);
+    struct obj_node **rnodes = pcvar_obj_get_sorted(r, &rnr);
+    size_t i;
+    for (i = 0; i < lnr && i < rnr; i++) {
+        struct obj_node *lo = lnodes[i];
+        struct obj_node *ro = rnodes[i];
         PC_ASSERT(lo->key);
         PC_ASSERT(ro->key);
         const char *lk = purc_variant_get_string_const(lo->key);
@@ -2881,9 +2881,9 @@ cmp_by_obj(purc_variant_t l, purc_variant_t r,
             return diff;
     }
 
-    if (lnode)
+    if (i < lnr)
         return 1;
-    else if (rnode)
+    else if (i < rnr)
         return -1;
     else
         return 0;
@@ -2901,23 +2901,10 @@ cmp_by_arr(purc_variant_t l, purc_variant_t r,
     PC_ASSERT(ld);
     PC_ASSERT(rd);
 
-    struct pcutils_array_list *la = &ld->al;
-    struct pcutils_array_list *ra = &rd->al;
-
-    struct pcutils_array_list_node *lnode = pcutils_array_list_get_first(la);
-    struct pcutils_array_list_node *rnode = pcutils_array_list_get_first(ra);
-
-    for (;
-        lnode && rnode;
-        lnode = pcutils_array_list_get(la, lnode->idx + 1),
-        rnode = pcutils_array_list_get(ra, rnode->idx + 1))
-    {
-        struct arr_node *lo, *ro;
-        lo = container_of(lnode, struct arr_node, node);
-        ro = container_of(rnode, struct arr_node, node);
-
-        purc_variant_t lv = lo->val;
-        purc_variant_t rv = ro->val;
+    size_t i;
+    for (i = 0; i < ld->nr && i < rd->nr; i++) {
+        purc_variant_t lv = ld->vals[ld->head + i];
+        purc_variant_t rv = rd->vals[rd->head + i];
         PC_ASSERT(lv != PURC_VARIANT_INVALID);
         PC_ASSERT(rv != PURC_VARIANT_INVALID);
 
@@ -2926,9 +2913,9 @@ cmp_by_arr(purc_variant_t l, purc_variant_t r,
             return diff;
     }
 
-    if (lnode)
+    if (i < ld->nr)
         return 1;
-    else if (rnode)
+    else if (i < rd->nr)
         return -1;
     else
         return 0;
@@ -2946,20 +2933,13 @@ cmp_by_set(purc_variant_t l, purc_variant_t r,
     PC_ASSERT(ld);
     PC_ASSERT(rd);
 
-    struct rb_root *lroot = &ld->elems;
-    struct rb_root *rroot = &rd->elems;
-    struct rb_node *lnode = pcutils_rbtree_first(lroot);
-    struct rb_node *rnode = pcutils_rbtree_first(rroot);
-    for (;
-        lnode && rnode;
-        lnode = pcutils_rbtree_next(lnode), rnode = pcutils_rbtree_next(rnode))
-    {
-        struct set_node *lo, *ro;
-        lo = container_of(lnode, struct set_node, rbnode);
-        ro = container_of(rnode, struct set_node, rbnode);
-
-        purc_variant_t lv = lo->val;
-        purc_variant_t rv = ro->val;
+    size_t lnr, rnr;
+    struct set_node **lnodes = pcvar_set_get_sorted(l, &lnr);
+    struct set_node **rnodes = pcvar_set_get_sorted(r, &rnr);
+    size_t i;
+    for (i = 0; i < lnr && i < rnr; i++) {
+        purc_variant_t lv = lnodes[i]->val;
+        purc_variant_t rv = rnodes[i]->val;
         PC_ASSERT(lv != PURC_VARIANT_INVALID);
         PC_ASSERT(rv != PURC_VARIANT_INVALID);
 
@@ -2968,9 +2948,9 @@ cmp_by_set(purc_variant_t l, purc_variant_t r,
             return diff;
     }
 
-    if (lnode)
+    if (i < lnr)
         return 1;
-    else if (rnode)
+    else if (i < rnr)
         return -1;
     else
         return 0;
@@ -3608,108 +3588,142 @@ void pcvariant_md5_ex(char *md5, purc_variant_t val, const char *salt,
     pcutils_bin2hex(md5_digest, MD5_DIGEST_SIZE, md5, uppercase);
 }
 
-void
-pcvariant_md5_by_set(char *md5, purc_variant_t val, purc_variant_t set)
-{
-    PC_ASSERT(md5);
-    PC_ASSERT(val != PURC_VARIANT_INVALID);
-    PC_ASSERT(set != PURC_VARIANT_INVALID);
+/*
+ * The members of a set are compared by their stringified forms (see
+ * compare_string_method()), so the hash is computed on the same text:
+ * FNV-1a over the bytes up to the first NUL, as strcmp() stops there.
+ *
+ * For a caseless set, the ASCII letters are folded. A non-ASCII character
+ * may be lowered to an ASCII letter (KELVIN SIGN to `k`, and the dotted or
+ * dotless I to `i` in some locales), or to several characters, so every run
+ * of non-ASCII bytes and the letters `i` and `k` are hashed as one token.
+ */
+#define FNV_OFFSET_BASIS        0xcbf29ce484222325ULL
+#define FNV_PRIME               0x100000001b3ULL
 
-    variant_set_t data = pcvar_set_get_data(set);
-    PC_ASSERT(data);
+#define HASH_TOKEN_FOLDED       0x80
 
-    if (data->unique_key == NULL) {
-        pcvariant_md5(md5, val);
+struct stringify_hash {
+    uint64_t    hash;
+    bool        caseless;
+    bool        in_folded;
+    bool        ended;
+};
+
+static void
+do_stringify_hash(struct stringify_arg *arg, const void *src, size_t len)
+{
+    struct stringify_hash *ud = (struct stringify_hash*)(arg->arg);
+    if (ud->ended)
         return;
-    }
 
-    purc_variant_t undefined = purc_variant_make_undefined();
-    PC_ASSERT(undefined);
+    const unsigned char *p = (const unsigned char *)src;
+    const unsigned char *end = p + (len ? len : strlen(src));
+    uint64_t hash = ud->hash;
 
-    if (val->type != PVT(_OBJECT)) {
-        pcvariant_md5(md5, undefined);
-        purc_variant_unref(undefined);
-        return;
+    for (; p < end; p++) {
+        unsigned char c = *p;
+        if (c == 0) {
+            ud->ended = true;
+            break;
+        }
+
+        if (ud->caseless) {
+            if (c >= 'A' && c <= 'Z')
+                c += 'a' - 'A';
+
+            if (c >= 0x80 || c == 'i' || c == 'k') {
+                if (ud->in_folded)
+                    continue;
+                ud->in_folded = true;
+                c = HASH_TOKEN_FOLDED;
+            }
+            else {
+                ud->in_folded = false;
+            }
+        }
+
+        hash ^= c;
+        hash *= FNV_PRIME;
     }
 
-    pcutils_md5_ctxt ud;
+    ud->hash = hash;
+}
 
-    pcutils_md5_begin(&ud);
+static uint64_t
+hash_by_stringify(uint64_t hash, purc_variant_t val, bool caseless)
+{
+    struct stringify_hash ud = {
+        .hash       = hash,
+        .caseless   = caseless,
+        .in_folded  = false,
+        .ended      = false,
+    };
 
     struct stringify_arg arg;
-    arg.cb    = do_stringify_md5;
+    arg.cb    = do_stringify_hash;
     arg.arg   = &ud;
     arg.flags = 0;
 
-    for (size_t i=0; i<data->nr_keynames; ++i) {
-        purc_variant_t v;
-        v = purc_variant_object_get_by_ckey(val, data->keynames[i]);
-        if (v == PURC_VARIANT_INVALID) {
-            v = undefined;
-        }
-        stringify_kv(&arg, data->keynames[i], v);
+    if (val->type == PVT(_STRING)) {
+        size_t len;
+        const char *s = purc_variant_get_string_const_ex(val, &len);
+        if (len)
+            do_stringify_hash(&arg, s, len);
+    }
+    else {
+        variant_stringify(&arg, val);
     }
 
-    unsigned char md5_digest[MD5_DIGEST_SIZE];
-    pcutils_md5_end(&ud, md5_digest);
-
-    bool uppercase = true;
-    pcutils_bin2hex(md5_digest, MD5_DIGEST_SIZE, md5, uppercase);
-
-    purc_variant_unref(undefined);
+    /* separate the values of the unique keys */
+    ud.hash ^= 0xff;
+    ud.hash *= FNV_PRIME;
+    return ud.hash;
 }
 
-int
-pcvariant_diff_by_set(const char *md5l, purc_variant_t l,
-        const char *md5r, purc_variant_t r, purc_variant_t set)
+uint64_t
+pcvariant_hash_by_set(purc_variant_t val, purc_variant_t set)
 {
-    // TODO: https://gitlab.fmsoft.cn/hvml/hvml-docs/-/blob/master/zh/hvml-spec-v1.0-zh.md#21610-%E9%9B%86%E5%90%88%E5%8F%98%E9%87%8F
-
-    PC_ASSERT(md5l);
-    PC_ASSERT(l != PURC_VARIANT_INVALID);
-    PC_ASSERT(md5r);
-    PC_ASSERT(r != PURC_VARIANT_INVALID);
-
+    PC_ASSERT(val != PURC_VARIANT_INVALID);
     PC_ASSERT(set != PURC_VARIANT_INVALID);
 
-    int diff;
-
     variant_set_t data = pcvar_set_get_data(set);
     PC_ASSERT(data);
 
+    uint64_t hash = FNV_OFFSET_BASIS;
     if (data->unique_key == NULL) {
-        return pcvariant_diff(l, r);
+        hash = hash_by_stringify(hash, val, data->caseless);
     }
+    else {
+        purc_variant_t undefined = PURC_VARIANT_INVALID;
+        for (size_t i = 0; i < data->nr_keynames; ++i) {
+            purc_variant_t v = PURC_VARIANT_INVALID;
+            if (val->type == PVT(_OBJECT)) {
+                v = purc_variant_object_get_by_ckey(val, data->keynames[i]);
+                if (v == PURC_VARIANT_INVALID)
+                    purc_clr_error();
+            }
 
-    diff = strcmp(md5l, md5r);
-    if (diff)
-        return diff;
-
-    purc_variant_t undefined = purc_variant_make_undefined();
-    PC_ASSERT(undefined);
-
-    for (size_t i=0; i<data->nr_keynames; ++i) {
-        purc_variant_t vl = PURC_VARIANT_INVALID;
-        purc_variant_t vr = PURC_VARIANT_INVALID;
-
-        if (l->type == PVT(_OBJECT))
-            vl = purc_variant_object_get_by_ckey(l, data->keynames[i]);
-        if (r->type == PVT(_OBJECT))
-            vr = purc_variant_object_get_by_ckey(r, data->keynames[i]);
+            if (v == PURC_VARIANT_INVALID) {
+                if (undefined == PURC_VARIANT_INVALID)
+                    undefined = purc_variant_make_undefined();
+                v = undefined;
+            }
 
-        if (vl == PURC_VARIANT_INVALID)
-            vl = undefined;
-        if (vr == PURC_VARIANT_INVALID)
-            vr = undefined;
+            hash = hash_by_stringify(hash, v, data->caseless);
+        }
 
-        diff = pcvariant_diff(vl, vr);
-        if (diff)
-            break;
+        if (undefined)
+            purc_variant_unref(undefined);
     }
 
-    purc_variant_unref(undefined);
-
-    return diff;
+    /* finalize as MurmurHash3 does, the low bits are used as the slot */
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
 }
 
 bool pcvariant_is_scalar(purc_variant_t v)
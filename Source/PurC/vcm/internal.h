@@ -0,0 +1,89 @@
+/*
+ * @file internal.h
+ * @date 2022/08/20
+ * @brief The internal interfaces shared by the VCM tree walker and
+ *      the VCM program compiler/evaluator.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PURC_VCM_INTERNAL_H
+#define PURC_VCM_INTERNAL_H
+
+#include "purc-rwstream.h"
+#include "private/vcm.h"
+
+/* compile a tree once it has been evaluated this many times */
+#define PCVCM_COMPILE_THRESHOLD     1
+
+enum method_type {
+    GETTER_METHOD,
+    SETTER_METHOD
+};
+
+/* find a variable whose literal name was interned as an atom */
+typedef purc_variant_t (*cb_find_var_by_atom)(void *ctxt, const char *name,
+        purc_atom_t atom);
+
+PCA_EXTERN_C_BEGIN
+
+/* Helpers implemented in vcm.c, shared with the program evaluator. */
+bool pcvcm_has_fatal_error(void);
+
+bool pcvcm_is_handle_as_getter(struct pcvcm_node *node);
+
+bool is_cjsonee_op(struct pcvcm_node *node);
+
+/* evaluate a tree which does not refer to any variable */
+purc_variant_t pcvcm_node_make_constant(struct pcvcm_node *node);
+
+void pcvcm_concat_string_append(purc_rwstream_t rws, purc_variant_t v);
+
+purc_variant_t pcvcm_concat_string_finish(purc_rwstream_t rws);
+
+bool pcvcm_get_element_index(struct pcvcm_node *param_node,
+        purc_variant_t param_var, int64_t *index);
+
+purc_variant_t pcvcm_get_element(purc_variant_t root, purc_variant_t caller_var,
+        purc_variant_t param_var, bool has_index, int64_t index,
+        bool as_getter, bool silently);
+
+bool pcvcm_is_callable(purc_variant_t caller_var);
+
+purc_variant_t pcvcm_call_method(purc_variant_t root, purc_variant_t caller_var,
+        size_t nr_params, purc_variant_t *params, enum method_type type,
+        bool silently);
+
+/*
+ * Compile a VCM tree to a linear program. Returns NULL if the tree
+ * contains a construct the compiler does not handle; the caller should
+ * keep using the tree walker for it in that case.
+ */
+struct pcvcm_prog *pcvcm_prog_compile(struct pcvcm_node *tree);
+
+/* Evaluate a compiled program; same semantics as the tree walker. */
+purc_variant_t pcvcm_prog_eval(struct pcvcm_prog *prog,
+        cb_find_var find_var, cb_find_var_by_atom find_var_by_atom,
+        void *ctxt, bool silently);
+
+void pcvcm_prog_destroy(struct pcvcm_prog *prog);
+
+PCA_EXTERN_C_END
+
+#endif  /* PURC_VCM_INTERNAL_H */
+
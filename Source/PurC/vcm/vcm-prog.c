@@ -0,0 +1,942 @@
+/*
+ * @file vcm-prog.c
+ * @date 2022/08/20
+ * @brief The compiler and the evaluator of linear VCM programs.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * A VCM tree which is evaluated repeatedly (attribute values, text content,
+ * `iterate` conditions, and so on) is compiled once into a flat array of
+ * instructions. Every node of the tree owns one register; an instruction
+ * reads the registers of the child nodes and writes the register of its
+ * node, so the program is just the post-order of the tree, plus jumps for
+ * the short-circuit operators of CJSONEE.
+ *
+ * Concatenations which do not refer to any variable are folded into string
+ * literals at compile time. A program never holds variants: the vDOM which
+ * owns the tree is shared by the instances and may outlive all of them, so
+ * literals are turned into variants by every evaluation, as the tree walker
+ * does.
+ *
+ * The evaluator keeps the semantics of the tree walker in vcm.c: they share
+ * the helpers which access elements and call methods, and the evaluator
+ * applies the same `silently` rule after every instruction.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "config.h"
+#include "purc-utils.h"
+#include "purc-errors.h"
+#include "purc-rwstream.h"
+#include "private/errors.h"
+#include "private/vcm.h"
+
+#include "internal.h"
+
+#define TREE_NODE(node)              ((struct pctree_node*)(node))
+#define VCM_NODE(node)               ((struct pcvcm_node*)(node))
+#define FIRST_CHILD(node)            \
+    (VCM_NODE(pctree_node_child(TREE_NODE(node))))
+#define NEXT_CHILD(node)             \
+    ((node) ? VCM_NODE(pctree_node_next(TREE_NODE(node))) : NULL)
+#define CHILDREN_NUMBER(node)        \
+    (pctree_node_children_number(TREE_NODE(node)))
+
+#define MIN_BUF_SIZE                32
+#define MAX_BUF_SIZE                SIZE_MAX
+
+#define NO_REG                      UINT32_MAX
+
+/* the evaluator uses the stack for programs not larger than these */
+#define NR_LOCAL_REGS               32
+#define NR_LOCAL_ARGS               8
+
+enum pcvcm_opcode {
+    /* r[dst] = literals[a] */
+    OP_LOAD_LITERAL,
+    /* r[dst] = INVALID; the node has no operand to evaluate */
+    OP_LOAD_INVALID,
+    /* r[dst] = { r[args[0]]: r[args[1]], ... } */
+    OP_MAKE_OBJECT,
+    /* r[dst] = [ r[args[0]], r[args[1]], ... ] */
+    OP_MAKE_ARRAY,
+    /* r[dst] = string(r[args[0]]) ~ string(r[args[1]]) ~ ... */
+    OP_CONCAT_STRING,
+    /* r[dst] = $(r[a]) */
+    OP_GET_VARIABLE,
+    /* r[dst] = $name, the name is a literal interned as atom */
+    OP_FIND_VARIABLE,
+    /* r[dst] = r[a][r[b]], r[c] is the root of a dynamic caller */
+    OP_GET_ELEMENT,
+    /* if r[a] is not callable: r[dst] = INVALID, pc = jump */
+    OP_CHECK_CALLABLE,
+    /* r[dst] = r[a](r[args[0]], ...), r[c] is the root of the caller */
+    OP_CALL_GETTER,
+    /* r[dst] = r[a]!(r[args[0]], ...), r[c] is the root of the caller */
+    OP_CALL_SETTER,
+    /* r[dst] = r[a] */
+    OP_MOVE,
+    /* if !r[a]: pc = jump */
+    OP_JUMP_IF_FALSE,
+    /* if r[a]: pc = jump */
+    OP_JUMP_IF_TRUE,
+};
+
+struct pcvcm_insn {
+    uint8_t             op;
+    /* for OP_GET_ELEMENT */
+    bool                as_getter;
+    bool                literal_key;
+    bool                has_index;
+    uint32_t            dst;
+    uint32_t            a;
+    uint32_t            b;
+    uint32_t            c;
+    /* the operands in prog->args */
+    uint32_t            first_arg;
+    uint32_t            nr_args;
+    /* the target of jumps */
+    uint32_t            jump;
+    /* the index parsed from a literal key */
+    int64_t             index;
+    /* for OP_FIND_VARIABLE; the name is owned by the tree */
+    const char         *name;
+    purc_atom_t         atom;
+};
+
+struct pcvcm_literal {
+    /* a scalar node of the tree */
+    struct pcvcm_node  *node;
+    /* or a string folded at compile time */
+    char               *str;
+    size_t              len;
+};
+
+struct pcvcm_prog {
+    struct pcvcm_insn  *insns;
+    size_t              nr_insns;
+    size_t              sz_insns;
+
+    uint32_t           *args;
+    size_t              nr_args;
+    size_t              sz_args;
+
+    struct pcvcm_literal *literals;
+    size_t              nr_literals;
+    size_t              sz_literals;
+
+    uint32_t            nr_regs;
+    uint32_t            max_call_args;
+    uint32_t            result;
+};
+
+static bool
+grow_array(void **array, size_t *sz, size_t nr, size_t nr_more, size_t unit)
+{
+    if (nr + nr_more <= *sz)
+        return true;
+
+    size_t sz_new = *sz ? *sz * 2 : 16;
+    while (sz_new < nr + nr_more)
+        sz_new *= 2;
+
+    void *p = realloc(*array, sz_new * unit);
+    if (p == NULL) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+
+    *array = p;
+    *sz = sz_new;
+    return true;
+}
+
+static int
+emit_insn(struct pcvcm_prog *prog, enum pcvcm_opcode op, uint32_t dst)
+{
+    if (!grow_array((void **)&prog->insns, &prog->sz_insns,
+                prog->nr_insns, 1, sizeof(prog->insns[0])))
+        return -1;
+
+    struct pcvcm_insn *insn = prog->insns + prog->nr_insns;
+    memset(insn, 0, sizeof(*insn));
+    insn->op = op;
+    insn->dst = dst;
+    insn->a = insn->b = insn->c = NO_REG;
+    return (int)prog->nr_insns++;
+}
+
+static bool
+emit_args(struct pcvcm_prog *prog, int i, const uint32_t *regs, size_t nr)
+{
+    if (!grow_array((void **)&prog->args, &prog->sz_args,
+                prog->nr_args, nr, sizeof(prog->args[0])))
+        return false;
+
+    if (nr)
+        memcpy(prog->args + prog->nr_args, regs, sizeof(regs[0]) * nr);
+    prog->insns[i].first_arg = prog->nr_args;
+    prog->insns[i].nr_args = nr;
+    prog->nr_args += nr;
+    return true;
+}
+
+static bool is_constant(struct pcvcm_node *node)
+{
+    switch (node->type) {
+    case PCVCM_NODE_TYPE_UNDEFINED:
+    case PCVCM_NODE_TYPE_STRING:
+    case PCVCM_NODE_TYPE_NULL:
+    case PCVCM_NODE_TYPE_BOOLEAN:
+    case PCVCM_NODE_TYPE_NUMBER:
+    case PCVCM_NODE_TYPE_LONG_INT:
+    case PCVCM_NODE_TYPE_ULONG_INT:
+    case PCVCM_NODE_TYPE_LONG_DOUBLE:
+    case PCVCM_NODE_TYPE_BYTE_SEQUENCE:
+        return true;
+
+    case PCVCM_NODE_TYPE_FUNC_CONCAT_STRING:
+        for (struct pcvcm_node *child = FIRST_CHILD(node); child;
+                child = NEXT_CHILD(child)) {
+            if (!is_constant(child))
+                return false;
+        }
+        return true;
+
+    default:
+        break;
+    }
+
+    return false;
+}
+
+static uint32_t
+compile_node(struct pcvcm_prog *prog, struct pcvcm_node *node,
+        uint32_t *root_reg);
+
+/*
+ * The tree walker passes the value of the first child of the caller node
+ * as the root of a dynamic method; it never records the value of a string
+ * or a byte sequence node, so neither do we.
+ */
+static uint32_t
+compile_caller(struct pcvcm_prog *prog, struct pcvcm_node *caller_node,
+        uint32_t *root_reg)
+{
+    uint32_t first_reg = NO_REG;
+    uint32_t reg = compile_node(prog, caller_node, &first_reg);
+
+    struct pcvcm_node *first = FIRST_CHILD(caller_node);
+    if (first == NULL || first->type == PCVCM_NODE_TYPE_STRING ||
+            first->type == PCVCM_NODE_TYPE_BYTE_SEQUENCE) {
+        first_reg = NO_REG;
+    }
+    *root_reg = first_reg;
+    return reg;
+}
+
+static bool
+fold_constant(struct pcvcm_literal *literal, struct pcvcm_node *node)
+{
+    literal->node = NULL;
+    literal->str = NULL;
+    if (node->type != PCVCM_NODE_TYPE_FUNC_CONCAT_STRING) {
+        literal->node = node;
+        return true;
+    }
+
+    purc_variant_t v = pcvcm_node_make_constant(node);
+    if (v == PURC_VARIANT_INVALID)
+        return false;
+
+    size_t len;
+    const char *str = purc_variant_get_string_const_ex(v, &len);
+    if (str)
+        literal->str = strndup(str, len);
+    literal->len = len;
+    purc_variant_unref(v);
+
+    if (literal->str == NULL) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return false;
+    }
+    return true;
+}
+
+static uint32_t
+compile_constant(struct pcvcm_prog *prog, struct pcvcm_node *node)
+{
+    if (!grow_array((void **)&prog->literals, &prog->sz_literals,
+                prog->nr_literals, 1, sizeof(prog->literals[0])))
+        return NO_REG;
+    if (!fold_constant(prog->literals + prog->nr_literals, node))
+        return NO_REG;
+
+    uint32_t dst = prog->nr_regs++;
+    int i = emit_insn(prog, OP_LOAD_LITERAL, dst);
+    if (i < 0) {
+        free(prog->literals[prog->nr_literals].str);
+        return NO_REG;
+    }
+    prog->insns[i].a = prog->nr_literals++;
+    return dst;
+}
+
+static uint32_t
+compile_invalid(struct pcvcm_prog *prog)
+{
+    uint32_t dst = prog->nr_regs++;
+    if (emit_insn(prog, OP_LOAD_INVALID, dst) < 0)
+        return NO_REG;
+    return dst;
+}
+
+/* compile the children of a container, then build it from their values */
+static uint32_t
+compile_children(struct pcvcm_prog *prog, struct pcvcm_node *node,
+        enum pcvcm_opcode op, uint32_t *root_reg)
+{
+    size_t nr = CHILDREN_NUMBER(node);
+    /* the tree walker ignores the last key of an object without a value */
+    if (op == OP_MAKE_OBJECT)
+        nr &= ~(size_t)1;
+
+    uint32_t *regs = NULL;
+    uint32_t dst = NO_REG;
+    if (nr) {
+        regs = malloc(sizeof(regs[0]) * nr);
+        if (regs == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NO_REG;
+        }
+    }
+
+    struct pcvcm_node *child = FIRST_CHILD(node);
+    for (size_t i = 0; i < nr; i++) {
+        regs[i] = compile_node(prog, child, NULL);
+        if (regs[i] == NO_REG)
+            goto out;
+        child = NEXT_CHILD(child);
+    }
+
+    uint32_t reg = prog->nr_regs++;
+    int i = emit_insn(prog, op, reg);
+    if (i < 0 || !emit_args(prog, i, regs, nr))
+        goto out;
+
+    if (root_reg && nr)
+        *root_reg = regs[0];
+    dst = reg;
+
+out:
+    free(regs);
+    return dst;
+}
+
+static uint32_t
+compile_get_variable(struct pcvcm_prog *prog, struct pcvcm_node *node,
+        uint32_t *root_reg)
+{
+    struct pcvcm_node *name_node = FIRST_CHILD(node);
+    if (name_node == NULL)
+        return compile_invalid(prog);
+
+    if (node->atom) {
+        /* a literal name is never a root, see compile_caller() */
+        if (root_reg)
+            *root_reg = NO_REG;
+
+        uint32_t dst = prog->nr_regs++;
+        int i = emit_insn(prog, OP_FIND_VARIABLE, dst);
+        if (i < 0)
+            return NO_REG;
+
+        prog->insns[i].name = (const char *)name_node->sz_ptr[1];
+        prog->insns[i].atom = node->atom;
+        return dst;
+    }
+
+    uint32_t name_reg = compile_node(prog, name_node, NULL);
+    if (name_reg == NO_REG)
+        return NO_REG;
+
+    uint32_t dst = prog->nr_regs++;
+    int i = emit_insn(prog, OP_GET_VARIABLE, dst);
+    if (i < 0)
+        return NO_REG;
+
+    prog->insns[i].a = name_reg;
+    if (root_reg)
+        *root_reg = name_reg;
+    return dst;
+}
+
+static uint32_t
+compile_get_element(struct pcvcm_prog *prog, struct pcvcm_node *node,
+        uint32_t *root_reg)
+{
+    struct pcvcm_node *caller_node = FIRST_CHILD(node);
+    if (caller_node == NULL)
+        return compile_invalid(prog);
+
+    /* malformed tree; leave it to the tree walker */
+    struct pcvcm_node *param_node = NEXT_CHILD(caller_node);
+    if (param_node == NULL)
+        return NO_REG;
+
+    uint32_t caller_root;
+    uint32_t caller_reg = compile_caller(prog, caller_node, &caller_root);
+    if (caller_reg == NO_REG)
+        return NO_REG;
+
+    uint32_t param_reg = compile_node(prog, param_node, NULL);
+    if (param_reg == NO_REG)
+        return NO_REG;
+
+    uint32_t dst = prog->nr_regs++;
+    int i = emit_insn(prog, OP_GET_ELEMENT, dst);
+    if (i < 0)
+        return NO_REG;
+
+    struct pcvcm_insn *insn = prog->insns + i;
+    insn->a = caller_reg;
+    insn->b = param_reg;
+    insn->c = caller_root;
+    insn->as_getter = pcvcm_is_handle_as_getter(node);
+    if (param_node->type == PCVCM_NODE_TYPE_STRING) {
+        insn->literal_key = true;
+        insn->has_index = pcvcm_get_element_index(param_node,
+                PURC_VARIANT_INVALID, &insn->index);
+    }
+
+    if (root_reg)
+        *root_reg = caller_reg;
+    return dst;
+}
+
+static uint32_t
+compile_call_method(struct pcvcm_prog *prog, struct pcvcm_node *node,
+        enum pcvcm_opcode op, uint32_t *root_reg)
+{
+    struct pcvcm_node *caller_node = FIRST_CHILD(node);
+    if (caller_node == NULL)
+        return compile_invalid(prog);
+
+    uint32_t caller_root;
+    uint32_t caller_reg = compile_caller(prog, caller_node, &caller_root);
+    if (caller_reg == NO_REG)
+        return NO_REG;
+
+    uint32_t dst = prog->nr_regs++;
+    int check = emit_insn(prog, OP_CHECK_CALLABLE, dst);
+    if (check < 0)
+        return NO_REG;
+    prog->insns[check].a = caller_reg;
+
+    size_t nr_params = CHILDREN_NUMBER(node) - 1;
+    uint32_t *regs = NULL;
+    uint32_t ret = NO_REG;
+    if (nr_params) {
+        regs = malloc(sizeof(regs[0]) * nr_params);
+        if (regs == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return NO_REG;
+        }
+    }
+
+    struct pcvcm_node *param_node = NEXT_CHILD(caller_node);
+    for (size_t n = 0; n < nr_params; n++) {
+        regs[n] = compile_node(prog, param_node, NULL);
+        if (regs[n] == NO_REG)
+            goto out;
+        param_node = NEXT_CHILD(param_node);
+    }
+
+    int i = emit_insn(prog, op, dst);
+    if (i < 0 || !emit_args(prog, i, regs, nr_params))
+        goto out;
+
+    prog->insns[i].a = caller_reg;
+    prog->insns[i].c = caller_root;
+    prog->insns[check].jump = prog->nr_insns;
+    if (nr_params > prog->max_call_args)
+        prog->max_call_args = nr_params;
+
+    if (root_reg)
+        *root_reg = caller_reg;
+    ret = dst;
+
+out:
+    free(regs);
+    return ret;
+}
+
+/* operand ((&& | || | ;) operand)* [;] */
+static bool is_valid_cjsonee(struct pcvcm_node *node)
+{
+    struct pcvcm_node *child = FIRST_CHILD(node);
+    while (child) {
+        if (is_cjsonee_op(child))
+            return false;
+
+        struct pcvcm_node *op_node = NEXT_CHILD(child);
+        if (op_node == NULL)
+            break;
+        if (!is_cjsonee_op(op_node))
+            return false;
+
+        child = NEXT_CHILD(op_node);
+        if (child == NULL &&
+                op_node->type != PCVCM_NODE_TYPE_CJSONEE_OP_SEMICOLON)
+            return false;
+    }
+    return true;
+}
+
+static uint32_t
+compile_cjsonee(struct pcvcm_prog *prog, struct pcvcm_node *node,
+        uint32_t *root_reg)
+{
+    /* let the tree walker report the error */
+    if (!is_valid_cjsonee(node))
+        return NO_REG;
+
+    struct pcvcm_node *child = FIRST_CHILD(node);
+    if (child == NULL)
+        return compile_invalid(prog);
+
+    uint32_t dst = prog->nr_regs++;
+    uint32_t reg = compile_node(prog, child, NULL);
+    if (reg == NO_REG)
+        return NO_REG;
+    if (root_reg)
+        *root_reg = reg;
+
+    int i = emit_insn(prog, OP_MOVE, dst);
+    if (i < 0)
+        return NO_REG;
+    prog->insns[i].a = reg;
+
+    struct pcvcm_node *op_node = NEXT_CHILD(child);
+    while (op_node && (child = NEXT_CHILD(op_node))) {
+        /* the jump skips the operand when the result is already known */
+        int jump = -1;
+        if (op_node->type == PCVCM_NODE_TYPE_CJSONEE_OP_AND)
+            jump = emit_insn(prog, OP_JUMP_IF_FALSE, NO_REG);
+        else if (op_node->type == PCVCM_NODE_TYPE_CJSONEE_OP_OR)
+            jump = emit_insn(prog, OP_JUMP_IF_TRUE, NO_REG);
+
+        if (op_node->type != PCVCM_NODE_TYPE_CJSONEE_OP_SEMICOLON) {
+            if (jump < 0)
+                return NO_REG;
+            prog->insns[jump].a = dst;
+        }
+
+        reg = compile_node(prog, child, NULL);
+        if (reg == NO_REG)
+            return NO_REG;
+
+        i = emit_insn(prog, OP_MOVE, dst);
+        if (i < 0)
+            return NO_REG;
+        prog->insns[i].a = reg;
+
+        if (jump >= 0)
+            prog->insns[jump].jump = prog->nr_insns;
+        op_node = NEXT_CHILD(child);
+    }
+
+    return dst;
+}
+
+/*
+ * Compiles the node and returns its register, or NO_REG if the tree
+ * cannot be compiled. If `root_reg` is not NULL, it returns the register
+ * of the first child of the node, if the child has one.
+ */
+static uint32_t
+compile_node(struct pcvcm_prog *prog, struct pcvcm_node *node,
+        uint32_t *root_reg)
+{
+    if (is_constant(node))
+        return compile_constant(prog, node);
+
+    switch (node->type) {
+    case PCVCM_NODE_TYPE_OBJECT:
+        return compile_children(prog, node, OP_MAKE_OBJECT, root_reg);
+
+    case PCVCM_NODE_TYPE_ARRAY:
+        return compile_children(prog, node, OP_MAKE_ARRAY, root_reg);
+
+    case PCVCM_NODE_TYPE_FUNC_CONCAT_STRING:
+        return compile_children(prog, node, OP_CONCAT_STRING, root_reg);
+
+    case PCVCM_NODE_TYPE_FUNC_GET_VARIABLE:
+        return compile_get_variable(prog, node, root_reg);
+
+    case PCVCM_NODE_TYPE_FUNC_GET_ELEMENT:
+        return compile_get_element(prog, node, root_reg);
+
+    case PCVCM_NODE_TYPE_FUNC_CALL_GETTER:
+        return compile_call_method(prog, node, OP_CALL_GETTER, root_reg);
+
+    case PCVCM_NODE_TYPE_FUNC_CALL_SETTER:
+        return compile_call_method(prog, node, OP_CALL_SETTER, root_reg);
+
+    case PCVCM_NODE_TYPE_CJSONEE:
+        return compile_cjsonee(prog, node, root_reg);
+
+    default:
+        break;
+    }
+
+    return NO_REG;
+}
+
+struct pcvcm_prog *pcvcm_prog_compile(struct pcvcm_node *tree)
+{
+    struct pcvcm_prog *prog = calloc(1, sizeof(*prog));
+    if (prog == NULL) {
+        pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+        return NULL;
+    }
+
+    prog->result = compile_node(prog, tree, NULL);
+    if (prog->result == NO_REG) {
+        pcvcm_prog_destroy(prog);
+        return NULL;
+    }
+
+    return prog;
+}
+
+void pcvcm_prog_destroy(struct pcvcm_prog *prog)
+{
+    for (size_t i = 0; i < prog->nr_literals; i++) {
+        free(prog->literals[i].str);
+    }
+
+    free(prog->literals);
+    free(prog->args);
+    free(prog->insns);
+    free(prog);
+}
+
+static purc_variant_t
+make_literal(const struct pcvcm_literal *literal)
+{
+    struct pcvcm_node *node = literal->node;
+    if (node == NULL)
+        return purc_variant_make_string_ex(literal->str, literal->len, false);
+
+    switch (node->type) {
+    case PCVCM_NODE_TYPE_UNDEFINED:
+        return purc_variant_make_undefined();
+
+    case PCVCM_NODE_TYPE_STRING:
+        return purc_variant_make_string((char*)node->sz_ptr[1], false);
+
+    case PCVCM_NODE_TYPE_NULL:
+        return purc_variant_make_null();
+
+    case PCVCM_NODE_TYPE_BOOLEAN:
+        return purc_variant_make_boolean(node->b);
+
+    case PCVCM_NODE_TYPE_NUMBER:
+        return purc_variant_make_number(node->d);
+
+    case PCVCM_NODE_TYPE_LONG_INT:
+        return purc_variant_make_longint(node->i64);
+
+    case PCVCM_NODE_TYPE_ULONG_INT:
+        return purc_variant_make_ulongint(node->u64);
+
+    case PCVCM_NODE_TYPE_LONG_DOUBLE:
+        return purc_variant_make_longdouble(node->ld);
+
+    case PCVCM_NODE_TYPE_BYTE_SEQUENCE:
+        return (node->sz_ptr[0] > 0) ? purc_variant_make_byte_sequence(
+                (void*)node->sz_ptr[1], node->sz_ptr[0])
+                : purc_variant_make_byte_sequence_empty();
+
+    default:
+        break;
+    }
+
+    PC_ASSERT(0);
+    return PURC_VARIANT_INVALID;
+}
+
+static purc_variant_t
+make_object(const struct pcvcm_prog *prog, const struct pcvcm_insn *insn,
+        purc_variant_t *regs)
+{
+    purc_variant_t object = purc_variant_make_object(0,
+            PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
+    if (object == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    const uint32_t *args = prog->args + insn->first_arg;
+    for (uint32_t i = 0; i < insn->nr_args; i += 2) {
+        if (!purc_variant_object_set(object, regs[args[i]],
+                    regs[args[i + 1]])) {
+            purc_variant_unref(object);
+            return PURC_VARIANT_INVALID;
+        }
+    }
+
+    return object;
+}
+
+static purc_variant_t
+make_array(const struct pcvcm_prog *prog, const struct pcvcm_insn *insn,
+        purc_variant_t *regs)
+{
+    purc_variant_t array = purc_variant_make_array(0, PURC_VARIANT_INVALID);
+    if (array == PURC_VARIANT_INVALID)
+        return PURC_VARIANT_INVALID;
+
+    const uint32_t *args = prog->args + insn->first_arg;
+    for (uint32_t i = 0; i < insn->nr_args; i++) {
+        if (!purc_variant_array_append(array, regs[args[i]])) {
+            purc_variant_unref(array);
+            return PURC_VARIANT_INVALID;
+        }
+    }
+
+    return array;
+}
+
+static purc_variant_t
+concat_string(const struct pcvcm_prog *prog, const struct pcvcm_insn *insn,
+        purc_variant_t *regs)
+{
+    purc_rwstream_t rws = purc_rwstream_new_buffer(MIN_BUF_SIZE, MAX_BUF_SIZE);
+    if (!rws)
+        return PURC_VARIANT_INVALID;
+
+    const uint32_t *args = prog->args + insn->first_arg;
+    for (uint32_t i = 0; i < insn->nr_args; i++) {
+        pcvcm_concat_string_append(rws, regs[args[i]]);
+    }
+
+    purc_variant_t ret = pcvcm_concat_string_finish(rws);
+    purc_rwstream_destroy(rws);
+    return ret;
+}
+
+static purc_variant_t
+get_variable(purc_variant_t name_var, cb_find_var find_var, void *ctxt)
+{
+    if (!purc_variant_is_string(name_var))
+        return PURC_VARIANT_INVALID;
+
+    const char *name = purc_variant_get_string_const(name_var);
+    if (!name || name[0] == 0)
+        return PURC_VARIANT_INVALID;
+
+    if (!find_var) {
+        pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
+        return PURC_VARIANT_INVALID;
+    }
+
+    purc_variant_t ret = find_var(ctxt, name);
+    if (ret)
+        purc_variant_ref(ret);
+    return ret;
+}
+
+static purc_variant_t
+find_variable(const struct pcvcm_insn *insn, cb_find_var find_var,
+        cb_find_var_by_atom find_var_by_atom, void *ctxt)
+{
+    purc_variant_t ret;
+    if (find_var_by_atom) {
+        ret = find_var_by_atom(ctxt, insn->name, insn->atom);
+    }
+    else if (find_var) {
+        ret = find_var(ctxt, insn->name);
+    }
+    else {
+        pcinst_set_error(PCVARIANT_ERROR_NOT_FOUND);
+        return PURC_VARIANT_INVALID;
+    }
+
+    if (ret)
+        purc_variant_ref(ret);
+    return ret;
+}
+
+static inline purc_variant_t
+root_of(const struct pcvcm_insn *insn, purc_variant_t *regs)
+{
+    return (insn->c == NO_REG) ? PURC_VARIANT_INVALID : regs[insn->c];
+}
+
+static inline void
+set_reg(purc_variant_t *regs, uint32_t reg, purc_variant_t v)
+{
+    if (regs[reg])
+        purc_variant_unref(regs[reg]);
+    regs[reg] = v;
+}
+
+purc_variant_t pcvcm_prog_eval(struct pcvcm_prog *prog,
+        cb_find_var find_var, cb_find_var_by_atom find_var_by_atom,
+        void *ctxt, bool silently)
+{
+    purc_variant_t local_regs[NR_LOCAL_REGS];
+    purc_variant_t local_argv[NR_LOCAL_ARGS];
+    purc_variant_t *regs = local_regs;
+    purc_variant_t *argv = local_argv;
+    purc_variant_t ret = PURC_VARIANT_INVALID;
+
+    if (prog->nr_regs > NR_LOCAL_REGS) {
+        regs = calloc(prog->nr_regs, sizeof(regs[0]));
+        if (regs == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            return PURC_VARIANT_INVALID;
+        }
+    }
+    else {
+        memset(regs, 0, sizeof(regs[0]) * prog->nr_regs);
+    }
+
+    if (prog->max_call_args > NR_LOCAL_ARGS) {
+        argv = malloc(sizeof(argv[0]) * prog->max_call_args);
+        if (argv == NULL) {
+            pcinst_set_error(PURC_ERROR_OUT_OF_MEMORY);
+            goto out;
+        }
+    }
+
+    size_t pc = 0;
+    while (pc < prog->nr_insns) {
+        const struct pcvcm_insn *insn = prog->insns + pc++;
+        purc_variant_t v = PURC_VARIANT_INVALID;
+
+        switch (insn->op) {
+        case OP_LOAD_LITERAL:
+            v = make_literal(prog->literals + insn->a);
+            break;
+
+        case OP_LOAD_INVALID:
+            break;
+
+        case OP_MAKE_OBJECT:
+            v = make_object(prog, insn, regs);
+            break;
+
+        case OP_MAKE_ARRAY:
+            v = make_array(prog, insn, regs);
+            break;
+
+        case OP_CONCAT_STRING:
+            v = concat_string(prog, insn, regs);
+            break;
+
+        case OP_GET_VARIABLE:
+            v = get_variable(regs[insn->a], find_var, ctxt);
+            break;
+
+        case OP_FIND_VARIABLE:
+            v = find_variable(insn, find_var, find_var_by_atom, ctxt);
+            break;
+
+        case OP_GET_ELEMENT:
+        {
+            int64_t index = insn->index;
+            bool has_index = insn->has_index;
+            if (!insn->literal_key) {
+                has_index = purc_variant_cast_to_longint(regs[insn->b],
+                        &index, true);
+            }
+            v = pcvcm_get_element(root_of(insn, regs), regs[insn->a],
+                    regs[insn->b], has_index, index, insn->as_getter,
+                    silently);
+            break;
+        }
+
+        case OP_CHECK_CALLABLE:
+            if (pcvcm_is_callable(regs[insn->a]))
+                continue;
+            pc = insn->jump;
+            break;
+
+        case OP_CALL_GETTER:
+        case OP_CALL_SETTER:
+        {
+            const uint32_t *args = prog->args + insn->first_arg;
+            for (uint32_t i = 0; i < insn->nr_args; i++) {
+                argv[i] = regs[args[i]];
+            }
+            v = pcvcm_call_method(root_of(insn, regs), regs[insn->a],
+                    insn->nr_args, insn->nr_args ? argv : NULL,
+                    (insn->op == OP_CALL_GETTER) ? GETTER_METHOD :
+                    SETTER_METHOD, silently);
+            break;
+        }
+
+        case OP_MOVE:
+            set_reg(regs, insn->dst, purc_variant_ref(regs[insn->a]));
+            continue;
+
+        case OP_JUMP_IF_FALSE:
+            if (!purc_variant_booleanize(regs[insn->a]))
+                pc = insn->jump;
+            continue;
+
+        case OP_JUMP_IF_TRUE:
+            if (purc_variant_booleanize(regs[insn->a]))
+                pc = insn->jump;
+            continue;
+
+        default:
+            PC_ASSERT(0);
+            break;
+        }
+
+        if (v == PURC_VARIANT_INVALID) {
+            if (!silently || pcvcm_has_fatal_error())
+                goto out;
+            v = purc_variant_make_undefined();
+        }
+        set_reg(regs, insn->dst, v);
+    }
+
+    ret = regs[prog->result];
+    regs[prog->result] = PURC_VARIANT_INVALID;
+
+out:
+    for (uint32_t i = 0; i < prog->nr_regs; i++) {
+        if (regs[i])
+            purc_variant_unref(regs[i]);
+    }
+
+    if (argv != local_argv)
+        free(argv);
+    if (regs != local_regs)
+        free(regs);
+    return ret;
+}
+
@@ -26,6 +26,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "config.h"
 #include "purc-utils.h"
@@ -36,6 +37,9 @@
 #include "private/stack.h"
 #include "private/interpreter.h"
 #include "private/utils.h"
+#include "private/atom-buckets.h"
+
+#include "internal.h"
 
 #define TREE_NODE(node)              ((struct pctree_node*)(node))
 #define VCM_NODE(node)               ((struct pcvcm_node*)(node))
@@ -70,6 +74,7 @@ void pcvcm_node_serialize_to_rwstream(purc_rwstream_t rws,
 
 struct pcvcm_node_op {
     cb_find_var find_var;
+    cb_find_var_by_atom find_var_by_atom;
     void *find_var_ctxt;
 };
 
@@ -920,6 +925,9 @@ static void pcvcm_node_destroy_callback(struct pctree_node *n,  void *data)
         ) && node->sz_ptr[1]) {
         free((void*)node->sz_ptr[1]);
     }
+    if (node->prog) {
+        pcvcm_prog_destroy(node->prog);
+    }
     free(node);
 }
 
@@ -931,6 +939,30 @@ void pcvcm_node_destroy(struct pcvcm_node *root)
     }
 }
 
+static void intern_variable_name(struct pctree_node *n,  void *data)
+{
+    UNUSED_PARAM(data);
+    struct pcvcm_node *node = VCM_NODE(n);
+    if (node->type != PCVCM_NODE_TYPE_FUNC_GET_VARIABLE) {
+        return;
+    }
+
+    struct pcvcm_node *name_node = FIRST_CHILD(node);
+    if (name_node && name_node->type == PCVCM_NODE_TYPE_STRING
+            && name_node->sz_ptr[0] > 0) {
+        node->atom = purc_atom_from_string_ex(ATOM_BUCKET_VARNAME,
+                (const char *)name_node->sz_ptr[1]);
+    }
+}
+
+void pcvcm_intern_variable_names(struct pcvcm_node *tree)
+{
+    if (tree) {
+        pctree_node_pre_order_traversal(TREE_NODE(tree),
+                intern_variable_name, NULL);
+    }
+}
+
 struct pcvcm_stack {
     struct pcutils_stack *stack;
 };
@@ -1059,33 +1091,20 @@ out_unref_array:
     return PURC_VARIANT_INVALID;
 }
 
-purc_variant_t pcvcm_node_concat_string_to_variant(struct pcvcm_node *node,
-       struct pcvcm_node_op *ops, bool silently)
+void pcvcm_concat_string_append(purc_rwstream_t rws, purc_variant_t v)
 {
-    purc_rwstream_t rws = purc_rwstream_new_buffer(MIN_BUF_SIZE, MAX_BUF_SIZE);
-    if (!rws) {
-        return PURC_VARIANT_INVALID;
+    // FIXME: stringify or serialize
+    char *buf = NULL;
+    int total = purc_variant_stringify_alloc(&buf, v);
+    if (total) {
+        purc_rwstream_write(rws, buf, total);
     }
+    free(buf);
+}
 
+purc_variant_t pcvcm_concat_string_finish(purc_rwstream_t rws)
+{
     purc_variant_t ret_var = PURC_VARIANT_INVALID;
-    struct pcvcm_node *child = FIRST_CHILD(node);
-    while (child) {
-        purc_variant_t v = pcvcm_node_to_variant(child, ops, silently);
-        if (v == PURC_VARIANT_INVALID) {
-            goto out_destroy_rws;
-        }
-
-        // FIXME: stringify or serialize
-        char *buf = NULL;
-        int total = purc_variant_stringify_alloc(&buf, v);
-        if (total) {
-            purc_rwstream_write(rws, buf, total);
-        }
-        free(buf);
-        purc_variant_unref(v);
-
-        child = NEXT_CHILD(child);
-    }
 
     // do not forget tailing-null-terminator
     purc_rwstream_write(rws, "", 1);
@@ -1111,6 +1130,33 @@ purc_variant_t pcvcm_node_concat_string_to_variant(struct pcvcm_node *node,
         }
     }
 
+    return ret_var;
+}
+
+purc_variant_t pcvcm_node_concat_string_to_variant(struct pcvcm_node *node,
+       struct pcvcm_node_op *ops, bool silently)
+{
+    purc_rwstream_t rws = purc_rwstream_new_buffer(MIN_BUF_SIZE, MAX_BUF_SIZE);
+    if (!rws) {
+        return PURC_VARIANT_INVALID;
+    }
+
+    purc_variant_t ret_var = PURC_VARIANT_INVALID;
+    struct pcvcm_node *child = FIRST_CHILD(node);
+    while (child) {
+        purc_variant_t v = pcvcm_node_to_variant(child, ops, silently);
+        if (v == PURC_VARIANT_INVALID) {
+            goto out_destroy_rws;
+        }
+
+        pcvcm_concat_string_append(rws, v);
+        purc_variant_unref(v);
+
+        child = NEXT_CHILD(child);
+    }
+
+    ret_var = pcvcm_concat_string_finish(rws);
+
 out_destroy_rws:
     purc_rwstream_destroy(rws);
     return ret_var;
@@ -1151,7 +1197,12 @@ purc_variant_t pcvcm_node_get_variable_to_variant(struct pcvcm_node *node,
         goto out_unref_name_var;
     }
 
-    ret = ops->find_var(ops->find_var_ctxt, name);
+    if (node->atom && ops->find_var_by_atom) {
+        ret = ops->find_var_by_atom(ops->find_var_ctxt, name, node->atom);
+    }
+    else {
+        ret = ops->find_var(ops->find_var_ctxt, name);
+    }
     if (ret) {
         purc_variant_ref(ret);
     }
@@ -1173,7 +1224,7 @@ static bool is_action_node(struct pcvcm_node *node)
             );
 }
 
-static bool is_handle_as_getter(struct pcvcm_node *node)
+bool pcvcm_is_handle_as_getter(struct pcvcm_node *node)
 {
     struct pcvcm_node *parent_node = PARENT_NODE(node);
     if (is_action_node(parent_node) && FIRST_CHILD(parent_node) == node) {
@@ -1182,11 +1233,6 @@ static bool is_handle_as_getter(struct pcvcm_node *node)
     return true;
 }
 
-enum method_type {
-    GETTER_METHOD,
-    SETTER_METHOD
-};
-
 static
 purc_variant_t call_dvariant_method(purc_variant_t root, purc_variant_t var,
         size_t nr_args, purc_variant_t *argv, enum method_type type,
@@ -1277,40 +1323,28 @@ inner_native_wrapper_get_param(purc_variant_t val)
     return purc_variant_object_get_by_ckey(val, KEY_PARAM_NODE);
 }
 
-static
-purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
-       struct pcvcm_node_op *ops, bool silently)
+bool pcvcm_get_element_index(struct pcvcm_node *param_node,
+        purc_variant_t param_var, int64_t *index)
 {
-    purc_variant_t ret_var = PURC_VARIANT_INVALID;
-    struct pcvcm_node *caller_node = FIRST_CHILD(node);
-    if (!caller_node) {
-        goto out;
-    }
-
-    purc_variant_t caller_var = pcvcm_node_to_variant(caller_node, ops,
-            silently);
-    if (caller_var == PURC_VARIANT_INVALID) {
-        goto out;
-    }
-
-    struct pcvcm_node *param_node  = NEXT_CHILD(caller_node);
-    purc_variant_t param_var = pcvcm_node_to_variant(param_node, ops,
-            silently);
-    if (param_var == PURC_VARIANT_INVALID) {
-        goto out_unref_caller_var;
-    }
-
-    bool has_index = true;
-    int64_t index = -1;
+    *index = -1;
     if (param_node->type == PCVCM_NODE_TYPE_STRING) {
         if (pcutils_parse_int64((const char*)param_node->sz_ptr[1],
-                    param_node->sz_ptr[0], &index) != 0) {
-            has_index = false;
+                    param_node->sz_ptr[0], index) != 0) {
+            return false;
         }
     }
-    else if (!purc_variant_cast_to_longint(param_var, &index, true)) {
-        has_index = false;
+    else if (!purc_variant_cast_to_longint(param_var, index, true)) {
+        return false;
     }
+    return true;
+}
+
+purc_variant_t pcvcm_get_element(purc_variant_t root, purc_variant_t caller_var,
+        purc_variant_t param_var, bool has_index, int64_t index,
+        bool as_getter, bool silently)
+{
+    purc_variant_t ret_var = PURC_VARIANT_INVALID;
+    purc_variant_ref(caller_var);
 
     // FIXME: {{ $SESSION.myobj.bcPipe.status[0] }}
     if (is_inner_native_wrapper(caller_var)) {
@@ -1328,18 +1362,18 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
     if (purc_variant_is_object(caller_var)) {
         purc_variant_t val = purc_variant_object_get(caller_var, param_var);
         if (val == PURC_VARIANT_INVALID) {
-            goto out_unref_param_var;
+            goto out;
         }
 
         purc_variant_ref(val);
         if (!purc_variant_is_dynamic(val)) {
             ret_var = val;
-            goto out_unref_param_var;
+            goto out;
         }
 
-        if (!is_handle_as_getter(node)) {
+        if (!as_getter) {
             ret_var = val;
-            goto out_unref_param_var;
+            goto out;
         }
 
         ret_var = call_dvariant_method(caller_var, val, 0, NULL, GETTER_METHOD,
@@ -1348,30 +1382,30 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
     }
     else if (purc_variant_is_array(caller_var)) {
         if (!has_index) {
-            goto out_unref_param_var;
+            goto out;
         }
         if (index < 0) {
             size_t len = purc_variant_array_get_size(caller_var);
             index += len;
         }
         if (index < 0) {
-            goto out_unref_param_var;
+            goto out;
         }
 
         purc_variant_t val = purc_variant_array_get(caller_var, index);
         if (val == PURC_VARIANT_INVALID) {
-            goto out_unref_param_var;
+            goto out;
         }
 
         purc_variant_ref(val);
         if (!purc_variant_is_dynamic(val)) {
             ret_var = val;
-            goto out_unref_param_var;
+            goto out;
         }
 
-        if (!is_handle_as_getter(node)) {
+        if (!as_getter) {
             ret_var = val;
-            goto out_unref_param_var;
+            goto out;
         }
         ret_var = call_dvariant_method(caller_var, val, 0, NULL, GETTER_METHOD,
                 silently);
@@ -1379,54 +1413,83 @@ purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
     }
     else if (purc_variant_is_set(caller_var)) {
         if (!has_index) {
-            goto out_unref_param_var;
+            goto out;
         }
         if (index < 0) {
             size_t len = purc_variant_set_get_size(caller_var);
             index += len;
         }
         if (index < 0) {
-            goto out_unref_param_var;
+            goto out;
         }
 
         purc_variant_t val = purc_variant_set_get_by_index(caller_var, index);
         if (val == PURC_VARIANT_INVALID) {
-            goto out_unref_param_var;
+            goto out;
         }
 
         purc_variant_ref(val);
         if (!purc_variant_is_dynamic(val)) {
             ret_var = val;
-            goto out_unref_param_var;
+            goto out;
         }
 
-        if (!is_handle_as_getter(node)) {
+        if (!as_getter) {
             ret_var = val;
-            goto out_unref_param_var;
+            goto out;
         }
         ret_var = call_dvariant_method(caller_var, val, 0, NULL, GETTER_METHOD,
                 silently);
         purc_variant_unref(val);
     }
     else if (purc_variant_is_dynamic(caller_var)) {
-        ret_var = call_dvariant_method(
-                get_attach_variant(FIRST_CHILD(caller_node)),
-                caller_var, 1, &param_var, GETTER_METHOD,
-                silently);
-        goto out_unref_param_var;
+        ret_var = call_dvariant_method(root, caller_var, 1, &param_var,
+                GETTER_METHOD, silently);
     }
     else if (purc_variant_is_native(caller_var)) {
-        if (!is_handle_as_getter(node)) {
+        if (!as_getter) {
             ret_var = inner_native_wrapper_create(caller_var, param_var);
-            goto out_unref_param_var;
+            goto out;
         }
         ret_var = call_nvariant_method(caller_var,
                 purc_variant_get_string_const(param_var), 0, NULL,
                 GETTER_METHOD, silently);
-        goto out_unref_param_var;
     }
 
-out_unref_param_var:
+out:
+    purc_variant_unref(caller_var);
+    return ret_var;
+}
+
+static
+purc_variant_t pcvcm_node_get_element_to_variant(struct pcvcm_node *node,
+       struct pcvcm_node_op *ops, bool silently)
+{
+    purc_variant_t ret_var = PURC_VARIANT_INVALID;
+    struct pcvcm_node *caller_node = FIRST_CHILD(node);
+    if (!caller_node) {
+        goto out;
+    }
+
+    purc_variant_t caller_var = pcvcm_node_to_variant(caller_node, ops,
+            silently);
+    if (caller_var == PURC_VARIANT_INVALID) {
+        goto out;
+    }
+
+    struct pcvcm_node *param_node  = NEXT_CHILD(caller_node);
+    purc_variant_t param_var = pcvcm_node_to_variant(param_node, ops,
+            silently);
+    if (param_var == PURC_VARIANT_INVALID) {
+        goto out_unref_caller_var;
+    }
+
+    int64_t index;
+    bool has_index = pcvcm_get_element_index(param_node, param_var, &index);
+    ret_var = pcvcm_get_element(get_attach_variant(FIRST_CHILD(caller_node)),
+            caller_var, param_var, has_index, index,
+            pcvcm_is_handle_as_getter(node), silently);
+
     purc_variant_unref(param_var);
 out_unref_caller_var:
     purc_variant_unref(caller_var);
@@ -1434,6 +1497,35 @@ out:
     return ret_var;
 }
 
+bool pcvcm_is_callable(purc_variant_t caller_var)
+{
+    return purc_variant_is_dynamic(caller_var)
+        || is_inner_native_wrapper(caller_var);
+}
+
+purc_variant_t pcvcm_call_method(purc_variant_t root, purc_variant_t caller_var,
+        size_t nr_params, purc_variant_t *params, enum method_type type,
+        bool silently)
+{
+    purc_variant_t ret_var = PURC_VARIANT_INVALID;
+    if (purc_variant_is_dynamic(caller_var)) {
+        ret_var = call_dvariant_method(root, caller_var, nr_params, params,
+                type, silently);
+    }
+    else if (is_inner_native_wrapper(caller_var)) {
+        purc_variant_t nv = inner_native_wrapper_get_caller(caller_var);
+        if (purc_variant_is_native(nv)) {
+            purc_variant_t name = inner_native_wrapper_get_param(caller_var);
+            if (name) {
+                ret_var = call_nvariant_method(nv,
+                        purc_variant_get_string_const(name), nr_params,
+                        params, type, silently);
+            }
+        }
+    }
+    return ret_var;
+}
+
 purc_variant_t pcvcm_node_call_method_to_variant(struct pcvcm_node *node,
        struct pcvcm_node_op *ops, enum method_type type, bool silently)
 {
@@ -1448,8 +1540,7 @@ purc_variant_t pcvcm_node_call_method_to_variant(struct pcvcm_node *node,
         goto out;
     }
 
-    if (!purc_variant_is_dynamic(caller_var)
-            && !is_inner_native_wrapper(caller_var)) {
+    if (!pcvcm_is_callable(caller_var)) {
         goto out_unref_caller_var;
     }
 
@@ -1476,22 +1567,8 @@ purc_variant_t pcvcm_node_call_method_to_variant(struct pcvcm_node *node,
         }
     }
 
-    if (purc_variant_is_dynamic(caller_var)) {
-        ret_var = call_dvariant_method(
-                get_attach_variant(FIRST_CHILD(caller_node)),
-                caller_var, nr_params, params, type, silently);
-    }
-    else if (is_inner_native_wrapper(caller_var)) {
-        purc_variant_t nv = inner_native_wrapper_get_caller(caller_var);
-        if (purc_variant_is_native(nv)) {
-            purc_variant_t name = inner_native_wrapper_get_param(caller_var);
-            if (name) {
-                ret_var = call_nvariant_method(nv,
-                        purc_variant_get_string_const(name), nr_params,
-                        params, type, silently);
-            }
-        }
-    }
+    ret_var = pcvcm_call_method(get_attach_variant(FIRST_CHILD(caller_node)),
+            caller_var, nr_params, params, type, silently);
 
 out_unref_params:
     for (size_t i = 0; i < nr_params; i++) {
@@ -1606,7 +1683,7 @@ failed:
     return PURC_VARIANT_INVALID;
 }
 
-static bool has_fatal_error()
+bool pcvcm_has_fatal_error(void)
 {
     int err = purc_get_last_error();
     return (err == PURC_ERROR_OUT_OF_MEMORY);
@@ -1695,7 +1772,7 @@ purc_variant_t pcvcm_node_to_variant(struct pcvcm_node *node,
     }
 
     if (ret == PURC_VARIANT_INVALID
-            && silently && !has_fatal_error()) {
+            && silently && !pcvcm_has_fatal_error()) {
         ret = purc_variant_make_undefined();
     }
 
@@ -1714,7 +1791,8 @@ static inline bool is_digit(char c)
 }
 
 static
-purc_variant_t find_stack_var(void *ctxt, const char *name)
+purc_variant_t find_stack_var_by_atom(void *ctxt, const char *name,
+        purc_atom_t atom)
 {
     struct pcintr_stack *stack = (struct pcintr_stack*)ctxt;
     size_t nr_name = strlen(name);
@@ -1733,36 +1811,62 @@ purc_variant_t find_stack_var(void *ctxt, const char *name)
 
     // # + anchor + symbol
     if (name[0] == '#') {
-        char* anchor = strndup(name + 1, nr_name - 2);
-        if (!anchor) {
-            return PURC_VARIANT_INVALID;
-        }
-        purc_variant_t var = pcintr_find_anchor_symbolized_var(stack, anchor,
-                last);
-        free(anchor);
-        return var;
+        return pcintr_find_anchor_symbolized_var(stack, name + 1,
+                nr_name - 2, last);
     }
 
-    return pcintr_find_named_var(ctxt, name);
+    if (atom) {
+        return pcintr_find_named_var_by_atom(stack, name, atom);
+    }
+    return pcintr_find_named_var(stack, name);
 }
 
+static
+purc_variant_t find_stack_var(void *ctxt, const char *name)
+{
+    return find_stack_var_by_atom(ctxt, name, 0);
+}
+
+static purc_variant_t
+eval_tree(struct pcvcm_node *tree, cb_find_var find_var,
+        cb_find_var_by_atom find_var_by_atom, void *ctxt, bool silently);
+
 purc_variant_t pcvcm_eval(struct pcvcm_node *tree, struct pcintr_stack *stack,
         bool silently)
 {
     if (stack) {
-        return pcvcm_eval_ex(tree, find_stack_var, stack, silently);
+        return eval_tree(tree, find_stack_var, find_stack_var_by_atom, stack,
+                silently);
     }
-    return pcvcm_eval_ex(tree, NULL, NULL, silently);
+    return eval_tree(tree, NULL, NULL, NULL, silently);
+}
+
+purc_variant_t pcvcm_node_make_constant(struct pcvcm_node *node)
+{
+    return pcvcm_node_to_variant(node, NULL, false);
 }
 
 purc_variant_t pcvcm_eval_ex(struct pcvcm_node *tree,
         cb_find_var find_var, void *ctxt, bool silently)
+{
+    return eval_tree(tree, find_var, NULL, ctxt, silently);
+}
+
+static void check_log_env(void)
 {
     const char *env_value;
     if ((env_value = getenv(PURC_ENV_VCM_LOG_ENABLE))) {
         _print_vcm_log = (*env_value == '1' ||
                 pcutils_strcasecmp(env_value, "true") == 0);
     }
+}
+
+static purc_variant_t
+eval_tree(struct pcvcm_node *tree, cb_find_var find_var,
+        cb_find_var_by_atom find_var_by_atom, void *ctxt, bool silently)
+{
+    static pthread_once_t log_env_once = PTHREAD_ONCE_INIT;
+    pthread_once(&log_env_once, check_log_env);
 
     if (_print_vcm_log) {
         PC_DEBUG("pcvcm_eval_ex|begin|silently=%d\n", silently);
@@ -1772,11 +1876,41 @@ purc_variant_t pcvcm_eval_ex(struct pcvcm_node *tree,
 
     struct pcvcm_node_op ops = {
         .find_var = find_var,
+        .find_var_by_atom = find_var_by_atom,
         .find_var_ctxt = ctxt,
     };
 
     if (tree) {
-        ret = pcvcm_node_to_variant(tree, &ops, silently);
+        /* the log shows every node, so keep the tree walker for it */
+        /* the tree may be shared by the runners via vDOM cache */
+        struct pcvcm_prog *prog = NULL;
+        if (!_print_vcm_log) {
+            prog = __atomic_load_n(&tree->prog, __ATOMIC_ACQUIRE);
+        }
+
+        if (!_print_vcm_log && prog == NULL &&
+                __atomic_load_n(&tree->nr_evals, __ATOMIC_RELAXED) <=
+                PCVCM_COMPILE_THRESHOLD) {
+            if (__atomic_fetch_add(&tree->nr_evals, 1, __ATOMIC_RELAXED) ==
+                    PCVCM_COMPILE_THRESHOLD) {
+                struct pcvcm_prog *expected = NULL;
+                prog = pcvcm_prog_compile(tree);
+                if (prog && !__atomic_compare_exchange_n(&tree->prog,
+                            &expected, prog, false,
+                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                    pcvcm_prog_destroy(prog);
+                    prog = expected;
+                }
+            }
+        }
+
+        if (prog) {
+            ret = pcvcm_prog_eval(prog, find_var, find_var_by_atom,
+                    ctxt, silently);
+        }
+        else {
+            ret = pcvcm_node_to_variant(tree, &ops, silently);
+        }
     }
     else if (silently) {
         ret = purc_variant_make_undefined();
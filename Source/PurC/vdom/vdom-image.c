@@ -0,0 +1,727 @@
+/*
+ * @file vdom-image.c
+ * @date 2022/09/05
+ * @brief The binary image of a vdom document and its VCM trees.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "private/instance.h"
+#include "private/errors.h"
+#include "private/debug.h"
+#include "private/utils.h"
+#include "private/vdom.h"
+
+#include "vdom-internal.h"
+
+/*
+ * The layout of an image (all integers are in the host byte order):
+ *
+ *  - the header: struct image_header;
+ *  - the document: the doctype (name and system information), the flags,
+ *    then the children;
+ *  - every node: the node type (one byte) followed by the payload of
+ *    the type; an element has its tag name, flags, attributes, and then
+ *    its children; a content has a VCM tree; a comment has its text;
+ *  - every VCM tree: the node type, the flags, the extra, the payload
+ *    of the type, and then the children in pre-order.
+ *
+ * A string is stored as its length (uint32_t) followed by the bytes;
+ * the length NULL_STRING denotes a NULL string. The children of a node
+ * are stored after the number of them (uint32_t).
+ *
+ * The compiled programs and the evaluation statistics of VCM trees are
+ * not stored; they will be rebuilt on demand.
+ */
+
+#define IMAGE_MAGIC             "PCVDOMIM"
+#define BYTE_ORDER_MARK         0x01020304
+
+#define NULL_STRING             UINT32_MAX
+
+/* the max depth of the nested nodes accepted when loading an image */
+#define MAX_DEPTH               1024
+
+#define ELEMENT_FLAG_SELF_CLOSING   0x01
+#define ELEMENT_FLAG_HEAD           0x02
+#define ELEMENT_FLAG_BODY           0x04
+#define ELEMENT_FLAG_LAST_BODY      0x08
+
+#define VCM_FLAG_CLOSED             0x01
+#define VCM_FLAG_HAS_NODE           0x80
+
+struct image_header {
+    char        magic[8];
+    uint32_t    version;
+    uint32_t    byte_order;
+    /* long double is stored as is; the size must match */
+    uint32_t    sz_long_double;
+    uint32_t    reserved;
+    unsigned char md5[MD5_DIGEST_SIZE];
+};
+
+struct image_writer {
+    purc_rwstream_t out;
+    struct pcvdom_document *doc;
+    int failed;
+};
+
+static void
+write_bytes(struct image_writer *wr, const void *buf, size_t count)
+{
+    if (wr->failed || count == 0)
+        return;
+
+    if (purc_rwstream_write(wr->out, buf, count) != (ssize_t)count)
+        wr->failed = 1;
+}
+
+static inline void
+write_u8(struct image_writer *wr, uint8_t u8)
+{
+    write_bytes(wr, &u8, sizeof(u8));
+}
+
+static inline void
+write_u32(struct image_writer *wr, uint32_t u32)
+{
+    write_bytes(wr, &u32, sizeof(u32));
+}
+
+static void
+write_string(struct image_writer *wr, const char *str, size_t len)
+{
+    if (str == NULL) {
+        write_u32(wr, NULL_STRING);
+    }
+    else if (len >= NULL_STRING) {
+        wr->failed = 1;
+    }
+    else {
+        write_u32(wr, (uint32_t)len);
+        write_bytes(wr, str, len);
+    }
+}
+
+static inline void
+write_cstring(struct image_writer *wr, const char *str)
+{
+    write_string(wr, str, str ? strlen(str) : 0);
+}
+
+static void
+write_vcm(struct image_writer *wr, struct pcvcm_node *node)
+{
+    uint8_t flags = VCM_FLAG_HAS_NODE;
+
+    if (node == NULL) {
+        write_u8(wr, 0);
+        return;
+    }
+
+    if (node->is_closed)
+        flags |= VCM_FLAG_CLOSED;
+    write_u8(wr, flags);
+    write_u8(wr, (uint8_t)node->type);
+    write_u32(wr, node->extra);
+
+    switch (node->type) {
+    case PCVCM_NODE_TYPE_BOOLEAN:
+        write_u8(wr, node->b ? 1 : 0);
+        break;
+
+    case PCVCM_NODE_TYPE_NUMBER:
+        write_bytes(wr, &node->d, sizeof(node->d));
+        break;
+
+    case PCVCM_NODE_TYPE_LONG_INT:
+        write_bytes(wr, &node->i64, sizeof(node->i64));
+        break;
+
+    case PCVCM_NODE_TYPE_ULONG_INT:
+        write_bytes(wr, &node->u64, sizeof(node->u64));
+        break;
+
+    case PCVCM_NODE_TYPE_LONG_DOUBLE:
+        write_bytes(wr, &node->ld, sizeof(node->ld));
+        break;
+
+    case PCVCM_NODE_TYPE_STRING:
+    case PCVCM_NODE_TYPE_BYTE_SEQUENCE:
+        write_string(wr, (const char *)node->sz_ptr[1], node->sz_ptr[0]);
+        break;
+
+    default:
+        break;
+    }
+
+    write_u32(wr, (uint32_t)node->tree_node.nr_children);
+    struct pctree_node *child = node->tree_node.first_child;
+    while (child) {
+        write_vcm(wr, container_of(child, struct pcvcm_node, tree_node));
+        child = child->next;
+    }
+}
+
+static int
+write_attr(void *key, void *val, void *ud)
+{
+    UNUSED_PARAM(key);
+    struct image_writer *wr = ud;
+    struct pcvdom_attr *attr = val;
+
+    write_cstring(wr, attr->key);
+    write_u8(wr, (uint8_t)attr->op);
+    write_vcm(wr, attr->val);
+    return wr->failed ? -1 : 0;
+}
+
+static void
+write_node(struct image_writer *wr, struct pcvdom_node *node);
+
+static void
+write_children(struct image_writer *wr, struct pcvdom_node *node)
+{
+    write_u32(wr, (uint32_t)node->node.nr_children);
+
+    struct pctree_node *child = node->node.first_child;
+    while (child) {
+        write_node(wr, container_of(child, struct pcvdom_node, node));
+        child = child->next;
+    }
+}
+
+static bool
+is_body(struct pcvdom_document *doc, struct pcvdom_element *elem)
+{
+    size_t nr = pcutils_arrlist_length(doc->bodies);
+    for (size_t i = 0; i < nr; i++) {
+        if (pcutils_arrlist_get_idx(doc->bodies, i) == elem)
+            return true;
+    }
+
+    return false;
+}
+
+static void
+write_element(struct image_writer *wr, struct pcvdom_element *elem)
+{
+    uint8_t flags = 0;
+
+    if (elem->self_closing)
+        flags |= ELEMENT_FLAG_SELF_CLOSING;
+    if (elem == wr->doc->head)
+        flags |= ELEMENT_FLAG_HEAD;
+    if (is_body(wr->doc, elem))
+        flags |= ELEMENT_FLAG_BODY;
+    if (elem == wr->doc->body)
+        flags |= ELEMENT_FLAG_LAST_BODY;
+
+    write_cstring(wr, elem->tag_name);
+    write_u8(wr, flags);
+
+    write_u32(wr, (uint32_t)pcutils_map_get_size(elem->attrs));
+    pcutils_map_traverse(elem->attrs, wr, write_attr);
+
+    write_children(wr, &elem->node);
+}
+
+static void
+write_node(struct image_writer *wr, struct pcvdom_node *node)
+{
+    write_u8(wr, (uint8_t)node->type);
+
+    switch (node->type) {
+    case PCVDOM_NODE_ELEMENT:
+        write_element(wr, PCVDOM_ELEMENT_FROM_NODE(node));
+        break;
+
+    case PCVDOM_NODE_CONTENT:
+        write_vcm(wr, PCVDOM_CONTENT_FROM_NODE(node)->vcm);
+        break;
+
+    case PCVDOM_NODE_COMMENT:
+        write_cstring(wr, PCVDOM_COMMENT_FROM_NODE(node)->text);
+        break;
+
+    default:
+        wr->failed = 1;
+        break;
+    }
+}
+
+int
+pcvdom_document_write_image(struct pcvdom_document *doc,
+        const unsigned char *md5, purc_rwstream_t out)
+{
+    struct image_writer wr = { out, doc, 0 };
+    struct image_header header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+    header.version = PCVDOM_IMAGE_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.sz_long_double = sizeof(long double);
+    memcpy(header.md5, md5, MD5_DIGEST_SIZE);
+    write_bytes(&wr, &header, sizeof(header));
+
+    write_cstring(&wr, doc->doctype.name);
+    write_cstring(&wr, doc->doctype.system_info);
+    write_u8(&wr, doc->quirks ? 1 : 0);
+    write_children(&wr, &doc->node);
+
+    if (wr.failed) {
+        purc_set_error(PURC_ERROR_OUTPUT);
+        return -1;
+    }
+
+    return 0;
+}
+
+struct image_reader {
+    const uint8_t *p;
+    const uint8_t *end;
+    struct pcvdom_document *doc;
+    int depth;
+    int failed;
+};
+
+static bool
+read_bytes(struct image_reader *rd, void *buf, size_t count)
+{
+    if (rd->failed || (size_t)(rd->end - rd->p) < count) {
+        rd->failed = 1;
+        return false;
+    }
+
+    memcpy(buf, rd->p, count);
+    rd->p += count;
+    return true;
+}
+
+static inline uint8_t
+read_u8(struct image_reader *rd)
+{
+    uint8_t u8 = 0;
+    read_bytes(rd, &u8, sizeof(u8));
+    return u8;
+}
+
+static inline uint32_t
+read_u32(struct image_reader *rd)
+{
+    uint32_t u32 = 0;
+    read_bytes(rd, &u32, sizeof(u32));
+    return u32;
+}
+
+/* the returned string refers to the image and is not null-terminated */
+static const char *
+read_string(struct image_reader *rd, size_t *len)
+{
+    uint32_t u32 = read_u32(rd);
+
+    *len = 0;
+    if (rd->failed || u32 == NULL_STRING)
+        return NULL;
+
+    if ((size_t)(rd->end - rd->p) < u32) {
+        rd->failed = 1;
+        return NULL;
+    }
+
+    const char *str = (const char *)rd->p;
+    rd->p += u32;
+    *len = u32;
+    return str;
+}
+
+/* read a string as a null-terminated one; returns NULL for NULL string */
+static char *
+read_cstring(struct image_reader *rd, char *buf, size_t sz_buf)
+{
+    size_t len;
+    const char *str = read_string(rd, &len);
+
+    if (str == NULL)
+        return NULL;
+
+    char *dst = buf;
+    if (len >= sz_buf && (dst = malloc(len + 1)) == NULL) {
+        rd->failed = 1;
+        return NULL;
+    }
+
+    memcpy(dst, str, len);
+    dst[len] = '\0';
+    return dst;
+}
+
+static inline void
+free_cstring(char *str, char *buf)
+{
+    if (str != buf)
+        free(str);
+}
+
+static struct pcvcm_node *
+new_vcm_node(struct image_reader *rd, enum pcvcm_node_type type)
+{
+    struct pcvcm_node *node = NULL;
+
+    switch (type) {
+    case PCVCM_NODE_TYPE_UNDEFINED:
+        node = pcvcm_node_new_undefined();
+        break;
+
+    case PCVCM_NODE_TYPE_OBJECT:
+        node = pcvcm_node_new_object(0, NULL);
+        break;
+
+    case PCVCM_NODE_TYPE_ARRAY:
+        node = pcvcm_node_new_array(0, NULL);
+        break;
+
+    case PCVCM_NODE_TYPE_STRING:
+    {
+        char buf[128];
+        char *str = read_cstring(rd, buf, sizeof(buf));
+        if (str) {
+            node = pcvcm_node_new_string(str);
+            free_cstring(str, buf);
+        }
+        break;
+    }
+
+    case PCVCM_NODE_TYPE_NULL:
+        node = pcvcm_node_new_null();
+        break;
+
+    case PCVCM_NODE_TYPE_BOOLEAN:
+        node = pcvcm_node_new_boolean(read_u8(rd) != 0);
+        break;
+
+    case PCVCM_NODE_TYPE_NUMBER:
+    {
+        double d = 0;
+        if (read_bytes(rd, &d, sizeof(d)))
+            node = pcvcm_node_new_number(d);
+        break;
+    }
+
+    case PCVCM_NODE_TYPE_LONG_INT:
+    {
+        int64_t i64 = 0;
+        if (read_bytes(rd, &i64, sizeof(i64)))
+            node = pcvcm_node_new_longint(i64);
+        break;
+    }
+
+    case PCVCM_NODE_TYPE_ULONG_INT:
+    {
+        uint64_t u64 = 0;
+        if (read_bytes(rd, &u64, sizeof(u64)))
+            node = pcvcm_node_new_ulongint(u64);
+        break;
+    }
+
+    case PCVCM_NODE_TYPE_LONG_DOUBLE:
+    {
+        long double ld = 0;
+        if (read_bytes(rd, &ld, sizeof(ld)))
+            node = pcvcm_node_new_longdouble(ld);
+        break;
+    }
+
+    case PCVCM_NODE_TYPE_BYTE_SEQUENCE:
+    {
+        size_t len;
+        const char *bytes = read_string(rd, &len);
+        if (!rd->failed)
+            node = pcvcm_node_new_byte_sequence(bytes, len);
+        break;
+    }
+
+    case PCVCM_NODE_TYPE_FUNC_CONCAT_STRING:
+        node = pcvcm_node_new_concat_string(0, NULL);
+        break;
+
+    case PCVCM_NODE_TYPE_FUNC_GET_VARIABLE:
+        node = pcvcm_node_new_get_variable(NULL);
+        break;
+
+    case PCVCM_NODE_TYPE_FUNC_GET_ELEMENT:
+        node = pcvcm_node_new_get_element(NULL, NULL);
+        break;
+
+    case PCVCM_NODE_TYPE_FUNC_CALL_GETTER:
+        node = pcvcm_node_new_call_getter(NULL, 0, NULL);
+        break;
+
+    case PCVCM_NODE_TYPE_FUNC_CALL_SETTER:
+        node = pcvcm_node_new_call_setter(NULL, 0, NULL);
+        break;
+
+    case PCVCM_NODE_TYPE_CJSONEE:
+        node = pcvcm_node_new_cjsonee();
+        break;
+
+    case PCVCM_NODE_TYPE_CJSONEE_OP_AND:
+        node = pcvcm_node_new_cjsonee_op_and();
+        break;
+
+    case PCVCM_NODE_TYPE_CJSONEE_OP_OR:
+        node = pcvcm_node_new_cjsonee_op_or();
+        break;
+
+    case PCVCM_NODE_TYPE_CJSONEE_OP_SEMICOLON:
+        node = pcvcm_node_new_cjsonee_op_semicolon();
+        break;
+    }
+
+    if (node == NULL)
+        rd->failed = 1;
+    return node;
+}
+
+static struct pcvcm_node *
+read_vcm(struct image_reader *rd)
+{
+    uint8_t flags = read_u8(rd);
+    if (rd->failed || !(flags & VCM_FLAG_HAS_NODE))
+        return NULL;
+
+    uint8_t type = read_u8(rd);
+    uint32_t extra = read_u32(rd);
+    if (rd->failed || type > PCVCM_NODE_TYPE_CJSONEE_OP_SEMICOLON ||
+            ++rd->depth > MAX_DEPTH) {
+        rd->failed = 1;
+        return NULL;
+    }
+
+    struct pcvcm_node *node = new_vcm_node(rd, (enum pcvcm_node_type)type);
+    if (node == NULL)
+        return NULL;
+
+    node->extra = extra;
+    node->is_closed = (flags & VCM_FLAG_CLOSED) ? true : false;
+
+    uint32_t nr_children = read_u32(rd);
+    for (uint32_t i = 0; i < nr_children && !rd->failed; i++) {
+        struct pcvcm_node *child = read_vcm(rd);
+        if (child == NULL) {
+            rd->failed = 1;
+            break;
+        }
+
+        pctree_node_append_child(&node->tree_node, &child->tree_node);
+    }
+
+    rd->depth--;
+    if (rd->failed) {
+        pcvcm_node_destroy(node);
+        return NULL;
+    }
+
+    return node;
+}
+
+static int
+read_children(struct image_reader *rd, struct pcvdom_node *parent);
+
+static int
+read_attrs(struct image_reader *rd, struct pcvdom_element *elem)
+{
+    uint32_t nr_attrs = read_u32(rd);
+
+    for (uint32_t i = 0; i < nr_attrs && !rd->failed; i++) {
+        char buf[64];
+        char *key = read_cstring(rd, buf, sizeof(buf));
+        uint8_t op = read_u8(rd);
+        struct pcvcm_node *vcm = read_vcm(rd);
+
+        struct pcvdom_attr *attr = NULL;
+        if (key && !rd->failed)
+            attr = pcvdom_attr_create(key, (enum pchvml_attr_operator)op, vcm);
+        free_cstring(key, buf);
+
+        if (attr == NULL) {
+            if (vcm)
+                pcvcm_node_destroy(vcm);
+            rd->failed = 1;
+            break;
+        }
+
+        if (pcvdom_element_append_attr(elem, attr)) {
+            pcvdom_attr_destroy(attr);
+            rd->failed = 1;
+        }
+    }
+
+    return rd->failed ? -1 : 0;
+}
+
+static struct pcvdom_element *
+read_element(struct image_reader *rd)
+{
+    char buf[64];
+    char *tag_name = read_cstring(rd, buf, sizeof(buf));
+    uint8_t flags = read_u8(rd);
+
+    struct pcvdom_element *elem = NULL;
+    if (tag_name && !rd->failed)
+        elem = pcvdom_element_create_c(tag_name);
+    free_cstring(tag_name, buf);
+
+    if (elem == NULL) {
+        rd->failed = 1;
+        return NULL;
+    }
+
+    if (flags & ELEMENT_FLAG_SELF_CLOSING)
+        elem->self_closing = 1;
+
+    /* the document owns the head and bodies by the tree only */
+    struct pcvdom_document *doc = rd->doc;
+    if (flags & ELEMENT_FLAG_HEAD)
+        doc->head = elem;
+    if (flags & ELEMENT_FLAG_BODY) {
+        size_t nr = pcutils_arrlist_length(doc->bodies);
+        if (pcutils_arrlist_put_idx(doc->bodies, nr, elem))
+            rd->failed = 1;
+    }
+    if (flags & ELEMENT_FLAG_LAST_BODY)
+        doc->body = elem;
+
+    if (read_attrs(rd, elem) == 0)
+        read_children(rd, &elem->node);
+
+    return elem;
+}
+
+static int
+read_children(struct image_reader *rd, struct pcvdom_node *parent)
+{
+    uint32_t nr_children = read_u32(rd);
+
+    if (rd->failed || ++rd->depth > MAX_DEPTH) {
+        rd->failed = 1;
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < nr_children && !rd->failed; i++) {
+        uint8_t type = read_u8(rd);
+        struct pcvdom_node *node = NULL;
+
+        switch (type) {
+        case PCVDOM_NODE_ELEMENT:
+        {
+            struct pcvdom_element *elem = read_element(rd);
+            if (elem)
+                node = &elem->node;
+            break;
+        }
+
+        case PCVDOM_NODE_CONTENT:
+        {
+            struct pcvcm_node *vcm = read_vcm(rd);
+            struct pcvdom_content *content = NULL;
+            if (vcm && (content = pcvdom_content_create(vcm)) == NULL)
+                pcvcm_node_destroy(vcm);
+            if (content)
+                node = &content->node;
+            break;
+        }
+
+        case PCVDOM_NODE_COMMENT:
+        {
+            char buf[128];
+            char *text = read_cstring(rd, buf, sizeof(buf));
+            struct pcvdom_comment *comment = NULL;
+            if (text)
+                comment = pcvdom_comment_create(text);
+            free_cstring(text, buf);
+            if (comment)
+                node = &comment->node;
+            break;
+        }
+
+        default:
+            break;
+        }
+
+        if (node == NULL) {
+            rd->failed = 1;
+            break;
+        }
+
+        /* attach the node first, so it is freed with the document */
+        pctree_node_append_child(&parent->node, &node->node);
+        if (parent->type == PCVDOM_NODE_DOCUMENT &&
+                node->type == PCVDOM_NODE_ELEMENT && rd->doc->root == NULL)
+            rd->doc->root = PCVDOM_ELEMENT_FROM_NODE(node);
+    }
+
+    rd->depth--;
+    return rd->failed ? -1 : 0;
+}
+
+struct pcvdom_document *
+pcvdom_document_from_image(const void *image, size_t sz,
+        const unsigned char *md5)
+{
+    struct image_reader rd = { image, (const uint8_t *)image + sz,
+        NULL, 0, 0 };
+    struct image_header header;
+
+    if (!read_bytes(&rd, &header, sizeof(header)) ||
+            memcmp(header.magic, IMAGE_MAGIC, sizeof(header.magic)) ||
+            header.version != PCVDOM_IMAGE_VERSION ||
+            header.byte_order != BYTE_ORDER_MARK ||
+            header.sz_long_double != sizeof(long double) ||
+            (md5 && memcmp(header.md5, md5, MD5_DIGEST_SIZE))) {
+        purc_set_error(PURC_ERROR_NOT_DESIRED_ENTITY);
+        return NULL;
+    }
+
+    rd.doc = pcvdom_document_create();
+    if (rd.doc == NULL)
+        return NULL;
+
+    char name_buf[64], si_buf[64];
+    char *name = read_cstring(&rd, name_buf, sizeof(name_buf));
+    char *si = read_cstring(&rd, si_buf, sizeof(si_buf));
+    if (name && si && pcvdom_document_set_doctype(rd.doc, name, si))
+        rd.failed = 1;
+    free_cstring(name, name_buf);
+    free_cstring(si, si_buf);
+
+    if (read_u8(&rd))
+        rd.doc->quirks = 1;
+
+    read_children(&rd, &rd.doc->node);
+
+    if (rd.failed || rd.p != rd.end) {
+        pcvdom_document_unref(rd.doc);
+        purc_set_error(PURC_ERROR_NOT_DESIRED_ENTITY);
+        return NULL;
+    }
+
+    return rd.doc;
+}
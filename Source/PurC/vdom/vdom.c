@@ -255,6 +255,7 @@ pcvdom_attr_create(const char *key, enum pchvml_attr_operator op,
     }
 
     attr->val = vcm;
+    pcvcm_intern_variable_names(vcm);
 
     return attr;
 }
@@ -1137,6 +1138,7 @@ content_create(struct pcvcm_node *vcm_content)
     content->node.remove_child = NULL;
 
     content->vcm = vcm_content;
+    pcvcm_intern_variable_names(vcm_content);
 
     return content;
 }
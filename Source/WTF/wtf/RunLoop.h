@@ -96,6 +96,11 @@ public:
 #if USE(GLIB_EVENT_LOOP)
     WTF_EXPORT_PRIVATE GMainContext* mainContext() const { return m_mainContext.get(); }
     WTF_EXPORT_PRIVATE void setIdleCallback(PurCWTF::Function<void()>&& function);
+    // Called from the idle callback: do not call it again until
+    // wakeUpIdleCallback() or the timeout (negative for none) expires.
+    // Returns false if a wake-up is already pending.
+    WTF_EXPORT_PRIVATE bool suspendIdleCallback(Seconds timeout);
+    WTF_EXPORT_PRIVATE void wakeUpIdleCallback();
     WTF_EXPORT_PRIVATE uintptr_t addFdMonitor(gint fd, GIOCondition condition,
             Function<gboolean(gint, GIOCondition)>&& callback);
     WTF_EXPORT_PRIVATE void removeFdMonitor(uintptr_t handle);
@@ -239,6 +244,9 @@ private:
 
     GRefPtr<GSource> m_idleSource;
     Function<void()> m_idleCallback;
+    Lock m_idleLock;
+    bool m_idleWakeUpPending { false };
+    bool m_idleSuspended { false };
 
     Vector<RefPtr<GFdMonitor>> m_fdMonitors;
 #elif USE(GENERIC_EVENT_LOOP)
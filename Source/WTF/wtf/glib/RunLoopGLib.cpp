@@ -71,12 +71,19 @@ RunLoop::RunLoop()
     }, this, nullptr);
     g_source_attach(m_source.get(), m_mainContext.get());
 
-    m_idleSource = adoptGRef(g_idle_source_new());
+    m_idleSource = adoptGRef(g_source_new(&runLoopSourceFunctions, sizeof(GSource)));
     g_source_set_priority(m_idleSource.get(), RunLoopSourcePriority::RunLoopDispatcher);
     g_source_set_name(m_idleSource.get(), "[PurCFetcher] RunLoop idle");
     g_source_set_can_recurse(m_idleSource.get(), TRUE);
     g_source_set_callback(m_idleSource.get(), [](gpointer userData) -> gboolean {
         RunLoop* runloop = static_cast<RunLoop*>(userData);
+        {
+            auto locker = holdLock(runloop->m_idleLock);
+            runloop->m_idleWakeUpPending = false;
+            runloop->m_idleSuspended = false;
+        }
+        // Keep calling the idle callback unless it suspends itself.
+        g_source_set_ready_time(runloop->m_idleSource.get(), 0);
         if (runloop->m_idleCallback) {
             runloop->m_idleCallback();
         }
@@ -101,10 +108,39 @@ void RunLoop::setIdleCallback(PurCWTF::Function<void()>&& function)
     RunLoop& runloop = RunLoop::current();
     runloop.m_idleCallback = WTFMove(function);
     if (runloop.m_idleCallback && runloop.m_idleSource->context == NULL) {
+        g_source_set_ready_time(runloop.m_idleSource.get(), 0);
         g_source_attach(runloop.m_idleSource.get(), runloop.m_mainContext.get());
     }
 }
 
+bool RunLoop::suspendIdleCallback(Seconds timeout)
+{
+    auto locker = holdLock(m_idleLock);
+    if (m_idleWakeUpPending)
+        return false;
+
+    m_idleSuspended = true;
+    if (timeout < 0_s) {
+        g_source_set_ready_time(m_idleSource.get(), -1);
+        return true;
+    }
+
+    gint64 currentTime = g_get_monotonic_time();
+    gint64 targetTime = currentTime + std::min<gint64>(G_MAXINT64 - currentTime, timeout.microsecondsAs<gint64>());
+    g_source_set_ready_time(m_idleSource.get(), targetTime);
+    return true;
+}
+
+void RunLoop::wakeUpIdleCallback()
+{
+    auto locker = holdLock(m_idleLock);
+    m_idleWakeUpPending = true;
+    if (m_idleSuspended) {
+        m_idleSuspended = false;
+        g_source_set_ready_time(m_idleSource.get(), 0);
+    }
+}
+
 uintptr_t RunLoop::addFdMonitor(gint fd, GIOCondition condition,
             Function<gboolean(gint, GIOCondition)>&& callback)
 {
@@ -165,6 +201,9 @@ void RunLoop::stop()
 void RunLoop::wakeUp()
 {
     g_source_set_ready_time(m_source.get(), 0);
+    // The work queued for the loop may leave something for the idle
+    // callback to do, e.g. a coroutine made ready by a fetcher response.
+    wakeUpIdleCallback();
 }
 
 RunLoop::CycleResult RunLoop::cycle(RunLoopMode)
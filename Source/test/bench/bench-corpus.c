@@ -0,0 +1,184 @@
+/*
+ * @file bench-corpus.c
+ * @date 2022/08/24
+ * @brief The generators of the deterministic corpora used by purc_bench.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libgen.h>
+
+struct strbuf {
+    char   *buf;
+    size_t  len;
+    size_t  sz;
+};
+
+static bool strbuf_append(struct strbuf *sb, const char *str, size_t len)
+{
+    if (sb->len + len + 1 > sb->sz) {
+        size_t sz = sb->sz ? sb->sz : 4096;
+        while (sb->len + len + 1 > sz)
+            sz *= 2;
+
+        char *buf = realloc(sb->buf, sz);
+        if (buf == NULL)
+            return false;
+        sb->buf = buf;
+        sb->sz = sz;
+    }
+
+    memcpy(sb->buf + sb->len, str, len);
+    sb->len += len;
+    sb->buf[sb->len] = 0;
+    return true;
+}
+
+static bool strbuf_appendf(struct strbuf *sb, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static bool strbuf_appendf(struct strbuf *sb, const char *fmt, ...)
+{
+    char buf[512];
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    if (n < 0 || (size_t)n >= sizeof(buf))
+        return false;
+    return strbuf_append(sb, buf, n);
+}
+
+static char *strbuf_finish(struct strbuf *sb, bool ok, size_t *len)
+{
+    if (!ok) {
+        free(sb->buf);
+        return NULL;
+    }
+
+    if (len)
+        *len = sb->len;
+    return sb->buf;
+}
+
+char *bench_make_json_corpus(size_t nr_records, size_t *len)
+{
+    struct strbuf sb = { };
+    bool ok = strbuf_append(&sb, "[", 1);
+
+    for (size_t i = 0; ok && i < nr_records; i++) {
+        ok = strbuf_appendf(&sb,
+                "%s{\"id\":%zu,\"name\":\"record-%zu\",\"title\":\"标题 %zu\","
+                "\"score\":%zu.5,\"tags\":[\"a\",\"b\",\"c\"],\"ok\":true,"
+                "\"extra\":null}",
+                i ? "," : "", i, i, i, i % 100);
+    }
+
+    ok = ok && strbuf_append(&sb, "]", 1);
+    return strbuf_finish(&sb, ok, len);
+}
+
+char *bench_make_hvml_corpus(size_t nr_records, size_t *len)
+{
+    struct strbuf sb = { };
+    bool ok = strbuf_appendf(&sb, "%s",
+            "<!DOCTYPE hvml>\n"
+            "<hvml target=\"html\">\n"
+            "<head><title>bench</title></head>\n"
+            "<body>\n"
+            "<init as=\"items\" with=\"[]\" />\n");
+
+    for (size_t i = 0; ok && i < nr_records; i++) {
+        ok = strbuf_appendf(&sb,
+                "<div id=\"item-%zu\" class=\"row %s\">"
+                "<update on=\"$items\" to=\"append\" with=\"{ id: %zu, "
+                "title: $STR.join('item-', %zu) }\" />"
+                "<p title=\"$DATA.title\">Item %zu: 中文内容</p></div>\n",
+                i, (i % 2) ? "odd" : "even", i, i, i);
+    }
+
+    ok = ok && strbuf_appendf(&sb, "%s", "</body>\n</hvml>\n");
+    return strbuf_finish(&sb, ok, len);
+}
+
+char *bench_make_html_corpus(size_t nr_records, size_t *len)
+{
+    struct strbuf sb = { };
+    bool ok = strbuf_appendf(&sb, "%s",
+            "<!DOCTYPE html>\n"
+            "<html>\n"
+            "<head><title>bench</title></head>\n"
+            "<body>\n<table id=\"records\">\n");
+
+    for (size_t i = 0; ok && i < nr_records; i++) {
+        ok = strbuf_appendf(&sb,
+                "<tr id=\"row-%zu\" class=\"row %s\"><td>%zu</td>"
+                "<td><a href=\"/records/%zu\">record &amp; %zu</a></td>"
+                "<td>中文内容</td></tr>\n",
+                i, (i % 2) ? "odd" : "even", i, i, i);
+    }
+
+    ok = ok && strbuf_appendf(&sb, "%s", "</table>\n</body>\n</html>\n");
+    return strbuf_finish(&sb, ok, len);
+}
+
+char *bench_load_file(const char *file, size_t *len)
+{
+    FILE *fp = fopen(file, "rb");
+    if (fp == NULL)
+        return NULL;
+
+    struct strbuf sb = { };
+    char buf[4096];
+    size_t n;
+    bool ok = true;
+    while (ok && (n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        ok = strbuf_append(&sb, buf, n);
+
+    ok = ok && !ferror(fp) && sb.len > 0;
+    fclose(fp);
+    return strbuf_finish(&sb, ok, len);
+}
+
+const char *bench_comp_dir(void)
+{
+    static char path[4096 + 1];
+
+    if (path[0] == 0) {
+        const char *env = getenv("PURC_BENCH_COMP_DIR");
+        if (env) {
+            snprintf(path, sizeof(path), "%s", env);
+        }
+        else {
+            char tmp[4096 + 1];
+            snprintf(tmp, sizeof(tmp), "%s", __FILE__);
+            snprintf(path, sizeof(path), "%s/../interpreter/comp",
+                    dirname(tmp));
+        }
+    }
+
+    return path;
+}
@@ -0,0 +1,193 @@
+/*
+ * @file bench-interp.c
+ * @date 2022/08/24
+ * @brief The benchmark scenarios of the HVML interpreter.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NR_COROUTINES           64
+#define NR_COROUTINES_QUICK     8
+
+/*
+ * The programs in test/interpreter/comp/ which run to the end without
+ * sleeping or writing to stdout, so they can be run back to back.
+ */
+static const char *comp_programs[] = {
+    "00-hello-world-html.hvml",
+    "07-init-iterate-on-with.hvml",
+    "07-init-iterate-onlyif-with.hvml",
+    "07-init-iterate-with-while.hvml",
+    "10-load-string-exit.hvml",
+    "12-load-another-body-sync.hvml",
+    "20-call-like-func.hvml",
+};
+
+/* the program run by every coroutine of the fan-out scenario */
+static const char *fanout_program =
+    "<!DOCTYPE hvml>"
+    "<hvml target=\"void\">"
+    "  <init as \"numbers\" with [] >"
+    "    <iterate on 0L onlyif $L.lt($0<, 64L) "
+    "        with $EJSON.arith('+', $0<, 1) nosetotail >"
+    "      <update on=\"$numbers\" to=\"append\" "
+    "          with=\"$EJSON.arith('*', $?, $?)\" />"
+    "    </iterate>"
+    "  </init>"
+    "  <exit with $numbers />"
+    "</hvml>";
+
+struct interp_state {
+    char       *hvml;
+    size_t      nr_coroutines;
+    size_t      nr_exited;
+};
+
+static int interp_cond_handler(purc_cond_t event, void *arg, void *data)
+{
+    (void)data;
+
+    if (event == PURC_COND_COR_EXITED) {
+        purc_coroutine_t cor = arg;
+        struct interp_state *st = purc_coroutine_get_user_data(cor);
+        if (st)
+            st->nr_exited++;
+    }
+
+    return 0;
+}
+
+static void interp_cleanup(void *data)
+{
+    struct interp_state *st = data;
+    free(st->hvml);
+    free(st);
+}
+
+static void *program_prepare(const struct bench_scenario *sc, bool quick)
+{
+    (void)quick;
+
+    struct interp_state *st = calloc(1, sizeof(*st));
+    if (st == NULL)
+        return NULL;
+
+    char path[4096 + 1];
+    snprintf(path, sizeof(path), "%s/%s", bench_comp_dir(), sc->arg);
+    st->hvml = bench_load_file(path, NULL);
+    if (st->hvml == NULL) {
+        fprintf(stderr, "Failed to load %s\n", path);
+        interp_cleanup(st);
+        return NULL;
+    }
+
+    st->nr_coroutines = 1;
+    return st;
+}
+
+static void *fanout_prepare(const struct bench_scenario *sc, bool quick)
+{
+    (void)sc;
+
+    struct interp_state *st = calloc(1, sizeof(*st));
+    if (st == NULL)
+        return NULL;
+
+    st->hvml = strdup(fanout_program);
+    if (st->hvml == NULL) {
+        interp_cleanup(st);
+        return NULL;
+    }
+
+    st->nr_coroutines = quick ? NR_COROUTINES_QUICK : NR_COROUTINES;
+    return st;
+}
+
+/*
+ * Schedules the coroutines and runs them to the end. The vDOM is
+ * parsed once and then taken from the cache of the loader, so this
+ * measures the interpreter rather than the parser.
+ */
+static long run_coroutines(void *data)
+{
+    struct interp_state *st = data;
+
+    purc_vdom_t vdom = purc_load_hvml_from_string(st->hvml);
+    if (vdom == NULL)
+        return -1;
+
+    for (size_t i = 0; i < st->nr_coroutines; i++) {
+        purc_coroutine_t cor = purc_schedule_vdom_null(vdom);
+        if (cor == NULL)
+            return -1;
+        purc_coroutine_set_user_data(cor, st);
+    }
+
+    st->nr_exited = 0;
+    purc_run(interp_cond_handler);
+
+    if (st->nr_exited != st->nr_coroutines)
+        return -1;
+    return st->nr_coroutines;
+}
+
+static char *program_name(const char *file)
+{
+    char name[256];
+    size_t len = strlen(file);
+
+    if (len > 5 && strcmp(file + len - 5, ".hvml") == 0)
+        len -= 5;
+    snprintf(name, sizeof(name), "interp/%.*s", (int)len, file);
+    return strdup(name);
+}
+
+void bench_register_interp(struct bench_scenario_list *list)
+{
+    /* the names are kept until the program exits */
+    static char *names[PCA_TABLESIZE(comp_programs)];
+
+    for (size_t i = 0; i < PCA_TABLESIZE(comp_programs); i++) {
+        if (names[i] == NULL && (names[i] = program_name(comp_programs[i]))
+                == NULL)
+            continue;
+
+        struct bench_scenario sc = {
+            names[i],
+            "run a program in test/interpreter/comp (op: a run)",
+            PURC_MODULE_HVML,
+            program_prepare, run_coroutines, interp_cleanup,
+            comp_programs[i]
+        };
+        bench_add(list, &sc);
+    }
+
+    static const struct bench_scenario fanout = {
+        "interp/coroutine_fanout",
+        "run many coroutines of one vDOM concurrently (op: a coroutine)",
+        PURC_MODULE_HVML,
+        fanout_prepare, run_coroutines, interp_cleanup, NULL
+    };
+    bench_add(list, &fanout);
+}
@@ -0,0 +1,299 @@
+/*
+ * @file bench-parse.c
+ * @date 2022/08/24
+ * @brief The benchmark scenarios of the parsers and the VCM evaluator.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include "private/document.h"
+#include "private/ejson.h"
+#include "private/hvml.h"
+#include "private/vdom.h"
+#include "hvml/hvml-token.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NR_RECORDS              5000
+#define NR_RECORDS_QUICK        500
+
+/* the number of evaluations in one call of the scenario */
+#define NR_EVALS                100
+
+struct parse_state {
+    size_t      nr;
+    char       *text;
+    size_t      len;
+
+    /* for the VCM evaluator */
+    struct pcvcm_node *tree;
+    purc_variant_t  data;
+
+    /* for the selectors */
+    purc_document_t doc;
+};
+
+static void parse_cleanup(void *data)
+{
+    struct parse_state *st = data;
+
+    if (st->tree)
+        pcvcm_node_destroy(st->tree);
+    if (st->data)
+        purc_variant_unref(st->data);
+    if (st->doc)
+        purc_document_delete(st->doc);
+    free(st->text);
+    free(st);
+}
+
+static void *parse_prepare(const struct bench_scenario *sc, bool quick)
+{
+    struct parse_state *st = calloc(1, sizeof(*st));
+    if (st == NULL)
+        return NULL;
+
+    st->nr = quick ? NR_RECORDS_QUICK : NR_RECORDS;
+    if (strcmp(sc->arg, "json") == 0)
+        st->text = bench_make_json_corpus(st->nr, &st->len);
+    else if (strcmp(sc->arg, "hvml") == 0)
+        st->text = bench_make_hvml_corpus(st->nr, &st->len);
+    else
+        st->text = bench_make_html_corpus(st->nr, &st->len);
+
+    if (st->text == NULL) {
+        parse_cleanup(st);
+        return NULL;
+    }
+
+    return st;
+}
+
+static long ejson_parse(void *data)
+{
+    struct parse_state *st = data;
+    purc_rwstream_t rws = purc_rwstream_new_from_mem(st->text, st->len);
+    if (rws == NULL)
+        return -1;
+
+    struct pcvcm_node *root = NULL;
+    struct pcejson *parser = NULL;
+    int ret = pcejson_parse(&root, &parser, rws, PCEJSON_DEFAULT_DEPTH);
+
+    if (root)
+        pcvcm_node_destroy(root);
+    if (parser)
+        pcejson_destroy(parser);
+    purc_rwstream_destroy(rws);
+
+    return (ret == 0) ? (long)st->nr : -1;
+}
+
+static long hvml_tokenize(void *data)
+{
+    struct parse_state *st = data;
+    purc_rwstream_t rws = purc_rwstream_new_from_mem(st->text, st->len);
+    if (rws == NULL)
+        return -1;
+
+    struct pchvml_parser *parser = pchvml_create(0, 32);
+    if (parser == NULL) {
+        purc_rwstream_destroy(rws);
+        return -1;
+    }
+
+    long nr = 0;
+    bool eof = false;
+    struct pchvml_token *token;
+    while (!eof && (token = pchvml_next_token(parser, rws)) != NULL) {
+        nr++;
+        eof = pchvml_token_is_type(token, PCHVML_TOKEN_EOF);
+        pchvml_token_destroy(token);
+    }
+
+    pchvml_destroy(parser);
+    purc_rwstream_destroy(rws);
+    return eof ? nr : -1;
+}
+
+static long hvml_load(void *data)
+{
+    struct parse_state *st = data;
+    purc_rwstream_t rws = purc_rwstream_new_from_mem(st->text, st->len);
+    if (rws == NULL)
+        return -1;
+
+    /* bypass the vDOM cache of purc_load_hvml_from_string() */
+    purc_vdom_t vdom = purc_load_hvml_from_rwstream(rws);
+    purc_rwstream_destroy(rws);
+    if (vdom == NULL)
+        return -1;
+
+    pcvdom_document_unref(vdom);
+    return st->nr;
+}
+
+static long html_load(void *data)
+{
+    struct parse_state *st = data;
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML,
+            st->text, st->len);
+    if (doc == NULL)
+        return -1;
+
+    purc_document_delete(doc);
+    return st->nr;
+}
+
+static const char *vcm_data =
+    "{ \"name\": \"bench\", \"count\": 3, \"items\": ["
+    "{ \"id\": 1, \"title\": \"one\" },"
+    "{ \"id\": 2, \"title\": \"two\" },"
+    "{ \"id\": 3, \"title\": \"three\" } ] }";
+
+static const char *vcm_expr =
+    "{ \"name\": $DATA.name, \"count\": $DATA.count, "
+    "\"first\": $DATA.items[0], \"last\": $DATA.items[2], "
+    "\"list\": [ $DATA.count, $DATA.items[1], true, null, 3.14 ] }";
+
+static purc_variant_t vcm_find_var(void *ctxt, const char *name)
+{
+    struct parse_state *st = ctxt;
+    return strcmp(name, "DATA") == 0 ? st->data : PURC_VARIANT_INVALID;
+}
+
+static void *vcm_prepare(const struct bench_scenario *sc, bool quick)
+{
+    (void)sc;
+    (void)quick;
+
+    struct parse_state *st = calloc(1, sizeof(*st));
+    if (st == NULL)
+        return NULL;
+
+    st->data = purc_variant_make_from_json_string(vcm_data,
+            strlen(vcm_data));
+
+    purc_rwstream_t rws = purc_rwstream_new_from_mem((void *)vcm_expr,
+            strlen(vcm_expr));
+    if (rws) {
+        struct pcejson *parser = NULL;
+        pcejson_parse(&st->tree, &parser, rws, PCEJSON_DEFAULT_DEPTH);
+        if (parser)
+            pcejson_destroy(parser);
+        purc_rwstream_destroy(rws);
+    }
+
+    if (st->data == PURC_VARIANT_INVALID || st->tree == NULL) {
+        parse_cleanup(st);
+        return NULL;
+    }
+
+    return st;
+}
+
+static long vcm_eval(void *data)
+{
+    struct parse_state *st = data;
+
+    for (int i = 0; i < NR_EVALS; i++) {
+        purc_variant_t v = pcvcm_eval_ex(st->tree, vcm_find_var, st, false);
+        if (v == PURC_VARIANT_INVALID)
+            return -1;
+        purc_variant_unref(v);
+    }
+
+    return NR_EVALS;
+}
+
+/* the selectors used by the query scenario */
+static const char *queries[] = {
+    "#row-42",
+    "tr.odd",
+    "table > tr.even td:nth-child(2) a",
+    "tr:nth-child(3n+1) > td:first-child",
+    "td a[href^='/records/1']",
+};
+
+static void *query_prepare(const struct bench_scenario *sc, bool quick)
+{
+    struct parse_state *st = parse_prepare(sc, quick);
+    if (st == NULL)
+        return NULL;
+
+    st->doc = purc_document_load(PCDOC_K_TYPE_HTML, st->text, st->len);
+    if (st->doc == NULL) {
+        parse_cleanup(st);
+        return NULL;
+    }
+
+    return st;
+}
+
+static long doc_query(void *data)
+{
+    struct parse_state *st = data;
+
+    for (size_t i = 0; i < PCA_TABLESIZE(queries); i++) {
+        pcdoc_elem_coll_t coll;
+        coll = pcdoc_elem_coll_new_from_document(st->doc, queries[i]);
+        if (coll == NULL)
+            return -1;
+        pcdoc_elem_coll_delete(st->doc, coll);
+    }
+
+    return PCA_TABLESIZE(queries);
+}
+
+void bench_register_parse(struct bench_scenario_list *list)
+{
+    static const struct bench_scenario scenarios[] = {
+        { "parse/ejson",
+            "parse a JSON corpus with pcejson_parse (op: a record)",
+            PURC_MODULE_EJSON,
+            parse_prepare, ejson_parse, parse_cleanup, "json" },
+        { "parse/html",
+            "load an HTML document (op: a table row)",
+            PURC_MODULE_HTML,
+            parse_prepare, html_load, parse_cleanup, "html" },
+        { "parse/hvml-tokens",
+            "tokenize a large HVML document (op: a token)",
+            PURC_MODULE_HVML,
+            parse_prepare, hvml_tokenize, parse_cleanup, "hvml" },
+        { "parse/hvml",
+            "load a large HVML document to vDOM (op: a record)",
+            PURC_MODULE_HVML,
+            parse_prepare, hvml_load, parse_cleanup, "hvml" },
+        { "vcm/eval",
+            "evaluate a VCM tree referring to a variable",
+            PURC_MODULE_EJSON,
+            vcm_prepare, vcm_eval, parse_cleanup, NULL },
+        { "doc/query",
+            "select elements of an HTML document by CSS selectors "
+                "(op: a selector)",
+            PURC_MODULE_HTML,
+            query_prepare, doc_query, parse_cleanup, "html" },
+    };
+
+    for (size_t i = 0; i < PCA_TABLESIZE(scenarios); i++)
+        bench_add(list, scenarios + i);
+}
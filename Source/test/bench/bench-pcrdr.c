@@ -0,0 +1,270 @@
+/*
+ * @file bench-pcrdr.c
+ * @date 2022/09/02
+ * @brief The benchmark scenarios of the renderer message codecs.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include "private/pcrdr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the number of round trips of every message in one call of the scenario */
+#define NR_ROUNDS               100
+#define NR_ROUNDS_QUICK         10
+
+#define NR_MESSAGES             4
+
+/* the text format replaces a null source URI with `-` */
+#define SOURCE_URI              "edpt://localhost/cn.fmsoft/main"
+
+struct pcrdr_state {
+    bool        binary;
+    int         nr_rounds;
+    pcrdr_msg  *msgs[NR_MESSAGES];
+
+    char       *buf;
+    size_t      len;
+    size_t      sz;
+
+    /* for the receive scenarios */
+    struct pcrdr_packet_pool *pool;
+    char       *packets[NR_MESSAGES];
+    size_t      lens[NR_MESSAGES];
+};
+
+static ssize_t write_to_buf(void *ctxt, const void *buf, size_t count)
+{
+    struct pcrdr_state *st = ctxt;
+
+    if (st->len + count + 1 > st->sz) {
+        size_t sz = st->sz ? st->sz : 1024;
+        while (sz < st->len + count + 1)
+            sz *= 2;
+
+        char *p = realloc(st->buf, sz);
+        if (p == NULL)
+            return -1;
+        st->buf = p;
+        st->sz = sz;
+    }
+
+    memcpy(st->buf + st->len, buf, count);
+    st->len += count;
+    return count;
+}
+
+/* serialize a message to the buffer, then parse it */
+static pcrdr_msg *round_trip(struct pcrdr_state *st, const pcrdr_msg *msg)
+{
+    pcrdr_msg *parsed = NULL;
+
+    st->len = 0;
+    if (st->binary) {
+        if (pcrdr_serialize_message_binary(msg, write_to_buf, st) < 0 ||
+                pcrdr_parse_binary_packet(st->buf, st->len, &parsed) < 0)
+            return NULL;
+    }
+    else {
+        if (pcrdr_serialize_message(msg, write_to_buf, st) < 0)
+            return NULL;
+
+        st->buf[st->len] = '\0';
+        if (pcrdr_parse_packet(st->buf, st->len, &parsed) < 0)
+            return NULL;
+    }
+
+    return parsed;
+}
+
+static void pcrdr_cleanup(void *data)
+{
+    struct pcrdr_state *st = data;
+
+    for (int i = 0; i < NR_MESSAGES; i++) {
+        if (st->msgs[i])
+            pcrdr_release_message(st->msgs[i]);
+        free(st->packets[i]);
+    }
+    if (st->pool)
+        pcrdr_packet_pool_delete(st->pool);
+    free(st->buf);
+    free(st);
+}
+
+static void *pcrdr_prepare(const struct bench_scenario *sc, bool quick)
+{
+    static const char *event_data =
+        "{ \"x\": 100, \"y\": 200, \"button\": \"left\", "
+        "\"modifiers\": [ \"ctrl\", \"shift\" ] }";
+
+    struct pcrdr_state *st = calloc(1, sizeof(*st));
+    if (st == NULL)
+        return NULL;
+
+    st->binary = (strcmp(sc->arg, "binary") == 0);
+    if (strcmp(sc->arg, "pooled") == 0 &&
+            (st->pool = pcrdr_packet_pool_new()) == NULL)
+        goto failed;
+    st->nr_rounds = quick ? NR_ROUNDS_QUICK : NR_ROUNDS;
+
+    /* the typical messages exchanged with a renderer */
+    st->msgs[0] = pcrdr_make_request_message(PCRDR_MSG_TARGET_DOM,
+            0x55aa3c8e10, PCRDR_OPERATION_UPDATE,
+            "REQ-0000000000001", SOURCE_URI,
+            PCRDR_MSG_ELEMENT_TYPE_HANDLE, "55aa3c9f70", "textContent",
+            PCRDR_MSG_DATA_TYPE_PLAIN, "The quick brown fox", 0);
+    st->msgs[1] = pcrdr_make_request_message(PCRDR_MSG_TARGET_DOM,
+            0x55aa3c8e10, PCRDR_OPERATION_APPEND,
+            "REQ-0000000000002", SOURCE_URI,
+            PCRDR_MSG_ELEMENT_TYPE_HANDLE, "55aa3c9f70", NULL,
+            PCRDR_MSG_DATA_TYPE_HTML,
+            "<li class=\"item\"><a href=\"/records/42\">record 42</a></li>", 0);
+    st->msgs[2] = pcrdr_make_response_message("REQ-0000000000001",
+            SOURCE_URI, PCRDR_SC_OK, 0, PCRDR_MSG_DATA_TYPE_VOID, NULL, 0);
+    st->msgs[3] = pcrdr_make_event_message(PCRDR_MSG_TARGET_DOM,
+            0x55aa3c8e10, "click", SOURCE_URI,
+            PCRDR_MSG_ELEMENT_TYPE_HANDLE, "55aa3c9f70", NULL,
+            PCRDR_MSG_DATA_TYPE_JSON, event_data, strlen(event_data));
+
+    for (int i = 0; i < NR_MESSAGES; i++) {
+        if (st->msgs[i] == NULL)
+            goto failed;
+
+        /* make sure the codec keeps the messages intact */
+        pcrdr_msg *parsed = round_trip(st, st->msgs[i]);
+        if (parsed == NULL)
+            goto failed;
+
+        bool same = (st->msgs[i]->dataType == PCRDR_MSG_DATA_TYPE_JSON) ||
+            pcrdr_compare_messages(st->msgs[i], parsed) == 0;
+        pcrdr_release_message(parsed);
+        if (!same) {
+            fprintf(stderr, "pcrdr/%s: message %d changed after round trip\n",
+                    sc->arg, i);
+            goto failed;
+        }
+
+        /* the packets to receive */
+        if (!st->binary) {
+            st->len = 0;
+            pcrdr_serialize_message(st->msgs[i], write_to_buf, st);
+            st->buf[st->len] = '\0';
+            st->lens[i] = st->len + 1;
+            if ((st->packets[i] = malloc(st->lens[i])) == NULL)
+                goto failed;
+            memcpy(st->packets[i], st->buf, st->lens[i]);
+        }
+    }
+
+    return st;
+
+failed:
+    pcrdr_cleanup(st);
+    return NULL;
+}
+
+static long pcrdr_round_trip(void *data)
+{
+    struct pcrdr_state *st = data;
+
+    for (int n = 0; n < st->nr_rounds; n++) {
+        for (int i = 0; i < NR_MESSAGES; i++) {
+            pcrdr_msg *parsed = round_trip(st, st->msgs[i]);
+            if (parsed == NULL)
+                return -1;
+            pcrdr_release_message(parsed);
+        }
+    }
+
+    return (long)st->nr_rounds * NR_MESSAGES;
+}
+
+/* receive a text packet to a buffer, then parse it */
+static pcrdr_msg *receive(struct pcrdr_state *st, int i)
+{
+    pcrdr_msg *msg = NULL;
+    char *packet;
+
+    if (st->pool) {
+        if ((packet = pcrdr_packet_get(st->pool, st->lens[i])) == NULL)
+            return NULL;
+        memcpy(packet, st->packets[i], st->lens[i]);
+        pcrdr_parse_packet_in_place(packet, st->lens[i], &msg);
+        pcrdr_packet_unref(packet);
+    }
+    else {
+        if ((packet = malloc(st->lens[i])) == NULL)
+            return NULL;
+        memcpy(packet, st->packets[i], st->lens[i]);
+        pcrdr_parse_packet(packet, st->lens[i], &msg);
+        free(packet);
+    }
+
+    return msg;
+}
+
+static long pcrdr_receive(void *data)
+{
+    struct pcrdr_state *st = data;
+
+    for (int n = 0; n < st->nr_rounds; n++) {
+        for (int i = 0; i < NR_MESSAGES; i++) {
+            pcrdr_msg *msg = receive(st, i);
+            if (msg == NULL)
+                return -1;
+            pcrdr_release_message(msg);
+        }
+    }
+
+    return (long)st->nr_rounds * NR_MESSAGES;
+}
+
+void bench_register_pcrdr(struct bench_scenario_list *list)
+{
+    static const struct bench_scenario scenarios[] = {
+        { "pcrdr/text",
+            "serialize and parse renderer messages in the text format "
+                "(op: a message)",
+            PURC_MODULE_VARIANT,
+            pcrdr_prepare, pcrdr_round_trip, pcrdr_cleanup, "text" },
+        { "pcrdr/binary",
+            "serialize and parse renderer messages in the binary format "
+                "(op: a message)",
+            PURC_MODULE_VARIANT,
+            pcrdr_prepare, pcrdr_round_trip, pcrdr_cleanup, "binary" },
+        { "pcrdr/receive",
+            "parse received text packets in newly allocated buffers "
+                "(op: a message)",
+            PURC_MODULE_VARIANT,
+            pcrdr_prepare, pcrdr_receive, pcrdr_cleanup, "text" },
+        { "pcrdr/receive-pooled",
+            "parse received text packets in place in pooled buffers "
+                "(op: a message)",
+            PURC_MODULE_VARIANT,
+            pcrdr_prepare, pcrdr_receive, pcrdr_cleanup, "pooled" },
+    };
+
+    for (size_t i = 0; i < PCA_TABLESIZE(scenarios); i++)
+        bench_add(list, scenarios + i);
+}
@@ -0,0 +1,274 @@
+/*
+ * @file bench-variant.c
+ * @date 2022/08/24
+ * @brief The benchmark scenarios of variants and containers.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NR_ELEMENTS             10000
+#define NR_ELEMENTS_QUICK       1000
+
+#define NR_RECORDS              5000
+#define NR_RECORDS_QUICK        500
+
+struct variant_state {
+    size_t      nr;
+    char      **keys;
+
+    /* the corpus for serialization */
+    purc_variant_t  corpus;
+    char           *buf;
+    size_t          sz_buf;
+};
+
+static void variant_cleanup(void *data)
+{
+    struct variant_state *st = data;
+
+    if (st->keys) {
+        for (size_t i = 0; i < st->nr; i++)
+            free(st->keys[i]);
+        free(st->keys);
+    }
+
+    if (st->corpus)
+        purc_variant_unref(st->corpus);
+    free(st->buf);
+    free(st);
+}
+
+static void *variant_prepare(const struct bench_scenario *sc, bool quick)
+{
+    (void)sc;
+
+    struct variant_state *st = calloc(1, sizeof(*st));
+    if (st == NULL)
+        return NULL;
+
+    st->nr = quick ? NR_ELEMENTS_QUICK : NR_ELEMENTS;
+    st->keys = calloc(st->nr, sizeof(char *));
+    if (st->keys == NULL)
+        goto failed;
+
+    for (size_t i = 0; i < st->nr; i++) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "key-%zu", i);
+        if ((st->keys[i] = strdup(buf)) == NULL)
+            goto failed;
+    }
+
+    return st;
+
+failed:
+    variant_cleanup(st);
+    return NULL;
+}
+
+static long make_unref(void *data)
+{
+    struct variant_state *st = data;
+
+    for (size_t i = 0; i < st->nr; i++) {
+        purc_variant_t v;
+
+        switch (i % 4) {
+        case 0:
+            v = purc_variant_make_number((double)i);
+            break;
+        case 1:
+            v = purc_variant_make_longint((int64_t)i);
+            break;
+        case 2:
+            v = purc_variant_make_string_static(st->keys[i], false);
+            break;
+        default:
+            v = purc_variant_make_string(st->keys[i], false);
+            break;
+        }
+
+        if (v == PURC_VARIANT_INVALID)
+            return -1;
+        purc_variant_unref(v);
+    }
+
+    return st->nr;
+}
+
+static long object_set_get(void *data)
+{
+    struct variant_state *st = data;
+    purc_variant_t obj = purc_variant_make_object_0();
+    if (obj == PURC_VARIANT_INVALID)
+        return -1;
+
+    long ret = st->nr;
+    for (size_t i = 0; i < st->nr; i++) {
+        purc_variant_t v = purc_variant_make_ulongint(i);
+        bool ok = purc_variant_object_set_by_static_ckey(obj, st->keys[i], v);
+        purc_variant_unref(v);
+        if (!ok) {
+            ret = -1;
+            goto done;
+        }
+    }
+
+    for (size_t i = 0; i < st->nr; i++) {
+        if (purc_variant_object_get_by_ckey(obj, st->keys[i]) ==
+                PURC_VARIANT_INVALID) {
+            ret = -1;
+            goto done;
+        }
+    }
+
+done:
+    purc_variant_unref(obj);
+    return ret;
+}
+
+static long array_append(void *data)
+{
+    struct variant_state *st = data;
+    purc_variant_t arr = purc_variant_make_array_0();
+    if (arr == PURC_VARIANT_INVALID)
+        return -1;
+
+    long ret = st->nr;
+    for (size_t i = 0; i < st->nr; i++) {
+        purc_variant_t v = purc_variant_make_ulongint(i);
+        bool ok = purc_variant_array_append(arr, v);
+        purc_variant_unref(v);
+        if (!ok) {
+            ret = -1;
+            break;
+        }
+    }
+
+    purc_variant_unref(arr);
+    return ret;
+}
+
+static long set_add(void *data)
+{
+    struct variant_state *st = data;
+    purc_variant_t set = purc_variant_make_set_by_ckey(0, "id",
+            PURC_VARIANT_INVALID);
+    if (set == PURC_VARIANT_INVALID)
+        return -1;
+
+    long ret = st->nr;
+    for (size_t i = 0; i < st->nr; i++) {
+        purc_variant_t id = purc_variant_make_string_static(st->keys[i],
+                false);
+        purc_variant_t v = purc_variant_make_object_by_static_ckey(1,
+                "id", id);
+        purc_variant_unref(id);
+
+        bool ok = v && purc_variant_set_add(set, v, false);
+        if (v)
+            purc_variant_unref(v);
+        if (!ok) {
+            ret = -1;
+            break;
+        }
+    }
+
+    purc_variant_unref(set);
+    return ret;
+}
+
+static void *serialize_prepare(const struct bench_scenario *sc, bool quick)
+{
+    (void)sc;
+
+    struct variant_state *st = calloc(1, sizeof(*st));
+    if (st == NULL)
+        return NULL;
+
+    size_t len;
+    st->nr = quick ? NR_RECORDS_QUICK : NR_RECORDS;
+    char *json = bench_make_json_corpus(st->nr, &len);
+    if (json == NULL)
+        goto failed;
+
+    st->corpus = purc_variant_make_from_json_string(json, len);
+    free(json);
+    if (st->corpus == PURC_VARIANT_INVALID)
+        goto failed;
+
+    /* the serialized text is not longer than twice the source */
+    st->sz_buf = len * 2;
+    if ((st->buf = malloc(st->sz_buf)) == NULL)
+        goto failed;
+
+    return st;
+
+failed:
+    variant_cleanup(st);
+    return NULL;
+}
+
+static long serialize(void *data)
+{
+    struct variant_state *st = data;
+    purc_rwstream_t rws = purc_rwstream_new_from_mem(st->buf, st->sz_buf);
+    if (rws == NULL)
+        return -1;
+
+    size_t len_expected = 0;
+    ssize_t n = purc_variant_serialize(st->corpus, rws, 0,
+            PCVARIANT_SERIALIZE_OPT_PLAIN, &len_expected);
+    purc_rwstream_destroy(rws);
+
+    return (n > 0) ? (long)st->nr : -1;
+}
+
+void bench_register_variant(struct bench_scenario_list *list)
+{
+    static const struct bench_scenario scenarios[] = {
+        { "variant/make_unref",
+            "make and unref numbers and strings",
+            PURC_MODULE_VARIANT,
+            variant_prepare, make_unref, variant_cleanup, NULL },
+        { "variant/object_set_get",
+            "set and get the properties of an object",
+            PURC_MODULE_VARIANT,
+            variant_prepare, object_set_get, variant_cleanup, NULL },
+        { "variant/array_append",
+            "append members to an array",
+            PURC_MODULE_VARIANT,
+            variant_prepare, array_append, variant_cleanup, NULL },
+        { "variant/set_add",
+            "add objects to a set with a unique key",
+            PURC_MODULE_VARIANT,
+            variant_prepare, set_add, variant_cleanup, NULL },
+        { "variant/serialize",
+            "serialize an array of records (op: a record)",
+            PURC_MODULE_EJSON,
+            serialize_prepare, serialize, variant_cleanup, NULL },
+    };
+
+    for (size_t i = 0; i < PCA_TABLESIZE(scenarios); i++)
+        bench_add(list, scenarios + i);
+}
@@ -0,0 +1,82 @@
+/*
+ * @file bench.h
+ * @date 2022/08/24
+ * @brief The interfaces shared by the scenarios of purc_bench.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PURC_BENCH_H
+#define PURC_BENCH_H
+
+#include "purc.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * A scenario is prepared once, then its `run` operation is called
+ * repeatedly while the driver measures it. The state returned by
+ * `prepare` is passed to `run` and finally to `cleanup`.
+ *
+ * `run` returns the number of logical operations it performed (for
+ * example, the number of records parsed), or -1 on failure.
+ */
+struct bench_scenario {
+    const char *name;
+    const char *desc;
+
+    /* the PurC modules required by this scenario */
+    unsigned int modules;
+
+    void *(*prepare)(const struct bench_scenario *sc, bool quick);
+    long (*run)(void *state);
+    void (*cleanup)(void *state);
+
+    /* an optional argument for the scenario; e.g., the program file */
+    const char *arg;
+};
+
+struct bench_scenario_list {
+    struct bench_scenario *scenarios;
+    size_t nr;
+    size_t sz;
+};
+
+/* add a scenario to the list; returns false on memory error */
+bool bench_add(struct bench_scenario_list *list,
+        const struct bench_scenario *sc);
+
+/* the registrars of the scenario groups */
+void bench_register_variant(struct bench_scenario_list *list);
+void bench_register_parse(struct bench_scenario_list *list);
+void bench_register_interp(struct bench_scenario_list *list);
+void bench_register_pcrdr(struct bench_scenario_list *list);
+
+/* helpers for generating deterministic corpora */
+char *bench_make_json_corpus(size_t nr_records, size_t *len);
+char *bench_make_hvml_corpus(size_t nr_records, size_t *len);
+char *bench_make_html_corpus(size_t nr_records, size_t *len);
+
+/* read a whole file into a NUL-terminated buffer */
+char *bench_load_file(const char *file, size_t *len);
+
+/* the directory of the comprehensive HVML programs */
+const char *bench_comp_dir(void);
+
+#endif /* PURC_BENCH_H */
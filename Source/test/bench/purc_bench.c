@@ -0,0 +1,602 @@
+/*
+ * @file purc_bench.c
+ * @date 2022/08/24
+ * @brief The driver of the micro/macro benchmark suite of PurC.
+ *
+ * Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+ *
+ * This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define BENCH_APP_NAME          "cn.fmsoft.hvml.bench"
+#define BENCH_RUN_NAME          "bench"
+
+/* the version of the JSON report format */
+#define BENCH_REPORT_VERSION    1
+
+#define DEF_REPEATS             5
+#define DEF_MIN_TIME            0.2
+#define QUICK_REPEATS           1
+#define QUICK_MIN_TIME          0.01
+
+/*
+ * Allocation counting interposes malloc() and friends, and forwards
+ * the calls to the glibc allocator. It is disabled when the program is
+ * built with AddressSanitizer, which interposes the same functions.
+ */
+#ifndef PURC_BENCH_COUNT_ALLOCS
+#   if defined(__SANITIZE_ADDRESS__)
+#       define PURC_BENCH_COUNT_ALLOCS  0
+#   elif defined(__has_feature)
+#       if __has_feature(address_sanitizer)
+#           define PURC_BENCH_COUNT_ALLOCS  0
+#       endif
+#   endif
+#endif
+
+#ifndef PURC_BENCH_COUNT_ALLOCS
+#   ifdef __GLIBC__
+#       define PURC_BENCH_COUNT_ALLOCS  1
+#   else
+#       define PURC_BENCH_COUNT_ALLOCS  0
+#   endif
+#endif
+
+static struct {
+    int         counting;
+    uint64_t    nr_allocs;
+    uint64_t    nr_frees;
+    uint64_t    nr_bytes;
+} alloc_stat;
+
+#if PURC_BENCH_COUNT_ALLOCS
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+static inline void count_alloc(size_t size)
+{
+    if (__atomic_load_n(&alloc_stat.counting, __ATOMIC_RELAXED)) {
+        __atomic_fetch_add(&alloc_stat.nr_allocs, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&alloc_stat.nr_bytes, size, __ATOMIC_RELAXED);
+    }
+}
+
+void *malloc(size_t size)
+{
+    count_alloc(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    count_alloc(nmemb * size);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    count_alloc(size);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+    if (ptr && __atomic_load_n(&alloc_stat.counting, __ATOMIC_RELAXED))
+        __atomic_fetch_add(&alloc_stat.nr_frees, 1, __ATOMIC_RELAXED);
+    __libc_free(ptr);
+}
+
+#endif /* PURC_BENCH_COUNT_ALLOCS */
+
+static void alloc_stat_start(void)
+{
+    alloc_stat.nr_allocs = 0;
+    alloc_stat.nr_frees = 0;
+    alloc_stat.nr_bytes = 0;
+    __atomic_store_n(&alloc_stat.counting, 1, __ATOMIC_SEQ_CST);
+}
+
+static void alloc_stat_stop(void)
+{
+    __atomic_store_n(&alloc_stat.counting, 0, __ATOMIC_SEQ_CST);
+}
+
+static double now_in_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/* Resets the high water mark of the resident set size; Linux only. */
+static void reset_peak_rss(void)
+{
+    FILE *fp = fopen("/proc/self/clear_refs", "w");
+    if (fp) {
+        fputs("5", fp);
+        fclose(fp);
+    }
+}
+
+/* Returns the peak resident set size in KiB. */
+static long read_peak_rss(void)
+{
+    long kb = -1;
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (fp) {
+        char line[256];
+        while (fgets(line, sizeof(line), fp)) {
+            if (strncmp(line, "VmHWM:", 6) == 0) {
+                kb = strtol(line + 6, NULL, 10);
+                break;
+            }
+        }
+        fclose(fp);
+    }
+
+    if (kb < 0) {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+            kb = usage.ru_maxrss;
+    }
+
+    return kb;
+}
+
+bool bench_add(struct bench_scenario_list *list,
+        const struct bench_scenario *sc)
+{
+    if (list->nr == list->sz) {
+        size_t sz = list->sz ? list->sz * 2 : 32;
+        struct bench_scenario *scs = realloc(list->scenarios,
+                sizeof(*scs) * sz);
+        if (scs == NULL)
+            return false;
+        list->scenarios = scs;
+        list->sz = sz;
+    }
+
+    list->scenarios[list->nr++] = *sc;
+    return true;
+}
+
+struct bench_result {
+    const struct bench_scenario *sc;
+    bool        failed;
+    uint64_t    nr_calls;
+    uint64_t    nr_ops;
+    double      ns_per_op;
+    double      ops_per_sec;
+    long        peak_rss_kb;
+    double      allocs_per_op;
+    double      frees_per_op;
+    double      bytes_per_op;
+};
+
+struct bench_opts {
+    bool        quick;
+    bool        list;
+    int         repeats;
+    double      min_time;
+    const char *filter;
+    const char *json_file;
+    const char *baseline_file;
+    const char *label;
+};
+
+static void measure(const struct bench_opts *opts,
+        const struct bench_scenario *sc, struct bench_result *result)
+{
+    memset(result, 0, sizeof(*result));
+    result->sc = sc;
+    result->failed = true;
+
+    void *state = sc->prepare ? sc->prepare(sc, opts->quick) : NULL;
+    if (sc->prepare && state == NULL)
+        return;
+
+    /* warm up the caches and the lazily initialized modules */
+    if (sc->run(state) < 0)
+        goto done;
+
+    reset_peak_rss();
+    alloc_stat_start();
+
+    double best = INFINITY;
+    for (int i = 0; i < opts->repeats; i++) {
+        uint64_t nr_ops = 0, nr_calls = 0;
+        double start = now_in_seconds(), elapsed;
+        do {
+            long n = sc->run(state);
+            if (n < 0) {
+                alloc_stat_stop();
+                goto done;
+            }
+            nr_ops += n;
+            nr_calls++;
+            elapsed = now_in_seconds() - start;
+        } while (elapsed < opts->min_time);
+
+        if (nr_ops > 0 && elapsed * 1e9 / nr_ops < best)
+            best = elapsed * 1e9 / nr_ops;
+        result->nr_ops += nr_ops;
+        result->nr_calls += nr_calls;
+    }
+
+    alloc_stat_stop();
+
+    if (result->nr_ops == 0)
+        goto done;
+
+    result->ns_per_op = best;
+    result->ops_per_sec = 1e9 / best;
+    result->peak_rss_kb = read_peak_rss();
+#if PURC_BENCH_COUNT_ALLOCS
+    result->allocs_per_op = (double)alloc_stat.nr_allocs / result->nr_ops;
+    result->frees_per_op = (double)alloc_stat.nr_frees / result->nr_ops;
+    result->bytes_per_op = (double)alloc_stat.nr_bytes / result->nr_ops;
+#else
+    result->allocs_per_op = -1;
+    result->frees_per_op = -1;
+    result->bytes_per_op = -1;
+#endif
+    result->failed = false;
+
+done:
+    if (sc->cleanup)
+        sc->cleanup(state);
+}
+
+static void write_json_string(FILE *fp, const char *str)
+{
+    fputc('"', fp);
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        if (*p == '"' || *p == '\\')
+            fprintf(fp, "\\%c", *p);
+        else if (*p < 0x20)
+            fprintf(fp, "\\u%04x", *p);
+        else
+            fputc(*p, fp);
+    }
+    fputc('"', fp);
+}
+
+static void write_report(FILE *fp, const struct bench_opts *opts,
+        const struct bench_result *results, size_t nr_results)
+{
+    fprintf(fp, "{\n  \"format\": %d,\n  \"purc\": ", BENCH_REPORT_VERSION);
+    write_json_string(fp, PURC_VERSION_STRING);
+    fprintf(fp, ",\n  \"label\": ");
+    write_json_string(fp, opts->label ? opts->label : "");
+    fprintf(fp, ",\n  \"quick\": %s,\n  \"repeats\": %d,\n"
+            "  \"countAllocs\": %s,\n  \"scenarios\": [",
+            opts->quick ? "true" : "false", opts->repeats,
+            PURC_BENCH_COUNT_ALLOCS ? "true" : "false");
+
+    for (size_t i = 0; i < nr_results; i++) {
+        const struct bench_result *r = results + i;
+
+        fprintf(fp, "%s\n    { \"name\": ", i ? "," : "");
+        write_json_string(fp, r->sc->name);
+        if (r->failed) {
+            fprintf(fp, ", \"failed\": true }");
+            continue;
+        }
+
+        fprintf(fp, ", \"calls\": %llu, \"ops\": %llu, "
+                "\"nsPerOp\": %.3f, \"opsPerSec\": %.3f, "
+                "\"peakRssKB\": %ld, \"allocsPerOp\": %.3f, "
+                "\"freesPerOp\": %.3f, \"bytesPerOp\": %.3f }",
+                (unsigned long long)r->nr_calls,
+                (unsigned long long)r->nr_ops,
+                r->ns_per_op, r->ops_per_sec, r->peak_rss_kb,
+                r->allocs_per_op, r->frees_per_op, r->bytes_per_op);
+    }
+
+    fprintf(fp, "\n  ]\n}\n");
+}
+
+static void print_result(FILE *fp, const struct bench_result *r)
+{
+    if (r->failed) {
+        fprintf(fp, "%-40s FAILED\n", r->sc->name);
+        return;
+    }
+
+    fprintf(fp, "%-40s %12.1f %14.1f %10ld %10.1f %12.1f\n",
+            r->sc->name, r->ns_per_op, r->ops_per_sec, r->peak_rss_kb,
+            r->allocs_per_op, r->bytes_per_op);
+}
+
+static double baseline_ns_per_op(purc_variant_t scenarios, const char *name)
+{
+    size_t nr;
+    if (!purc_variant_array_size(scenarios, &nr))
+        return -1;
+
+    for (size_t i = 0; i < nr; i++) {
+        purc_variant_t sc = purc_variant_array_get(scenarios, i);
+        purc_variant_t v = purc_variant_object_get_by_ckey(sc, "name");
+        const char *str = v ? purc_variant_get_string_const(v) : NULL;
+        if (str == NULL || strcmp(str, name))
+            continue;
+
+        double d;
+        v = purc_variant_object_get_by_ckey(sc, "nsPerOp");
+        if (v && purc_variant_cast_to_number(v, &d, false))
+            return d;
+        break;
+    }
+
+    purc_clr_error();
+    return -1;
+}
+
+static void compare_with_baseline(FILE *fp, const char *file,
+        const struct bench_result *results, size_t nr_results)
+{
+    purc_variant_t report = purc_variant_load_from_json_file(file);
+    if (report == PURC_VARIANT_INVALID) {
+        fprintf(stderr, "Failed to load the baseline report: %s\n", file);
+        return;
+    }
+
+    purc_variant_t scenarios = purc_variant_object_get_by_ckey(report,
+            "scenarios");
+    if (scenarios == PURC_VARIANT_INVALID) {
+        fprintf(stderr, "Bad baseline report: %s\n", file);
+        goto done;
+    }
+
+    fprintf(fp, "\n%-40s %12s %12s %9s\n",
+            "scenario", "base ns/op", "ns/op", "change");
+    for (size_t i = 0; i < nr_results; i++) {
+        const struct bench_result *r = results + i;
+        if (r->failed)
+            continue;
+
+        double base = baseline_ns_per_op(scenarios, r->sc->name);
+        if (base <= 0) {
+            fprintf(fp, "%-40s %12s %12.1f %9s\n",
+                    r->sc->name, "-", r->ns_per_op, "new");
+            continue;
+        }
+
+        fprintf(fp, "%-40s %12.1f %12.1f %+8.1f%%\n",
+                r->sc->name, base, r->ns_per_op,
+                (r->ns_per_op - base) * 100.0 / base);
+    }
+
+done:
+    purc_variant_unref(report);
+}
+
+static void print_usage(FILE *fp)
+{
+    fprintf(fp,
+        "purc_bench (%s) - the benchmark suite of PurC\n"
+        "\n"
+        "Usage: purc_bench [ options ... ]\n"
+        "\n"
+        "The following options can be supplied to the command:\n"
+        "\n"
+        "  -f --filter=<substring>\n"
+        "        Only run the scenarios whose names contain <substring>.\n"
+        "\n"
+        "  -j --json=<file>\n"
+        "        Write a JSON report to <file>; use `-` for stdout.\n"
+        "\n"
+        "  -b --baseline=<file>\n"
+        "        Compare the results with a JSON report written before.\n"
+        "\n"
+        "  -L --label=<label>\n"
+        "        A label recorded in the JSON report (e.g., a commit id).\n"
+        "\n"
+        "  -r --repeats=<n>\n"
+        "        Measure each scenario <n> times and keep the best one.\n"
+        "\n"
+        "  -t --min-time=<seconds>\n"
+        "        The minimal time of each measurement.\n"
+        "\n"
+        "  -q --quick\n"
+        "        Use small corpora and a short measurement (smoke test).\n"
+        "\n"
+        "  -l --list\n"
+        "        List the scenarios and exit.\n"
+        "\n"
+        "  -h --help\n"
+        "        This help.\n"
+        "\n",
+        PURC_VERSION_STRING);
+}
+
+static int read_option_args(struct bench_opts *opts, int argc, char **argv)
+{
+    static const char short_options[] = "f:j:b:L:r:t:qlh";
+    static const struct option long_opts[] = {
+        { "filter"    , required_argument, NULL, 'f' },
+        { "json"      , required_argument, NULL, 'j' },
+        { "baseline"  , required_argument, NULL, 'b' },
+        { "label"     , required_argument, NULL, 'L' },
+        { "repeats"   , required_argument, NULL, 'r' },
+        { "min-time"  , required_argument, NULL, 't' },
+        { "quick"     , no_argument,       NULL, 'q' },
+        { "list"      , no_argument,       NULL, 'l' },
+        { "help"      , no_argument,       NULL, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    int o, idx = 0;
+    int repeats = 0;
+    double min_time = 0;
+
+    while ((o = getopt_long(argc, argv, short_options, long_opts, &idx)) >= 0) {
+        switch (o) {
+        case 'f':
+            opts->filter = optarg;
+            break;
+        case 'j':
+            opts->json_file = optarg;
+            break;
+        case 'b':
+            opts->baseline_file = optarg;
+            break;
+        case 'L':
+            opts->label = optarg;
+            break;
+        case 'r':
+            repeats = atoi(optarg);
+            if (repeats <= 0)
+                return -1;
+            break;
+        case 't':
+            min_time = atof(optarg);
+            if (min_time <= 0)
+                return -1;
+            break;
+        case 'q':
+            opts->quick = true;
+            break;
+        case 'l':
+            opts->list = true;
+            break;
+        case 'h':
+            print_usage(stdout);
+            return 1;
+        default:
+            return -1;
+        }
+    }
+
+    if (optind < argc)
+        return -1;
+
+    opts->repeats = repeats ? repeats :
+        (opts->quick ? QUICK_REPEATS : DEF_REPEATS);
+    opts->min_time = min_time ? min_time :
+        (opts->quick ? QUICK_MIN_TIME : DEF_MIN_TIME);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    struct bench_opts opts = { };
+    int ret = read_option_args(&opts, argc, argv);
+    if (ret > 0)
+        return EXIT_SUCCESS;
+    else if (ret < 0) {
+        print_usage(stderr);
+        return EXIT_FAILURE;
+    }
+
+    struct bench_scenario_list all = { };
+    bench_register_variant(&all);
+    bench_register_parse(&all);
+    bench_register_interp(&all);
+    bench_register_pcrdr(&all);
+
+    /* select the scenarios and the modules they need */
+    unsigned int modules = PURC_MODULE_VARIANT;
+    size_t nr_selected = 0;
+    for (size_t i = 0; i < all.nr; i++) {
+        struct bench_scenario *sc = all.scenarios + i;
+        if (opts.filter && strstr(sc->name, opts.filter) == NULL)
+            continue;
+
+        modules |= sc->modules;
+        all.scenarios[nr_selected++] = *sc;
+    }
+
+    if (opts.list) {
+        for (size_t i = 0; i < nr_selected; i++) {
+            fprintf(stdout, "%-40s %s\n", all.scenarios[i].name,
+                    all.scenarios[i].desc);
+        }
+        free(all.scenarios);
+        return EXIT_SUCCESS;
+    }
+
+    purc_instance_extra_info info = { };
+    ret = purc_init_ex(modules, BENCH_APP_NAME, BENCH_RUN_NAME, &info);
+    if (ret != PURC_ERROR_OK) {
+        fprintf(stderr, "Failed to initialize the PurC instance: %s\n",
+                purc_get_error_message(ret));
+        free(all.scenarios);
+        return EXIT_FAILURE;
+    }
+
+    /* the table goes to stderr if the JSON report is written to stdout */
+    FILE *table = stdout;
+    if (opts.json_file && strcmp(opts.json_file, "-") == 0)
+        table = stderr;
+
+    struct bench_result *results = calloc(nr_selected ? nr_selected : 1,
+            sizeof(*results));
+    bool failed = false;
+
+    fprintf(table, "%-40s %12s %14s %10s %10s %12s\n",
+            "scenario", "ns/op", "ops/s", "peakRSS/KB", "allocs/op",
+            "bytes/op");
+    for (size_t i = 0; i < nr_selected; i++) {
+        measure(&opts, all.scenarios + i, results + i);
+        print_result(table, results + i);
+        fflush(table);
+        if (results[i].failed)
+            failed = true;
+    }
+
+    if (opts.json_file) {
+        FILE *fp = stdout;
+        if (strcmp(opts.json_file, "-"))
+            fp = fopen(opts.json_file, "w");
+
+        if (fp) {
+            write_report(fp, &opts, results, nr_selected);
+            if (fp != stdout)
+                fclose(fp);
+        }
+        else {
+            fprintf(stderr, "Failed to open %s for writing\n",
+                    opts.json_file);
+            failed = true;
+        }
+    }
+
+    if (opts.baseline_file)
+        compare_with_baseline(table, opts.baseline_file, results,
+                nr_selected);
+
+    free(results);
+    free(all.scenarios);
+    purc_cleanup();
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -864,3 +864,82 @@ TEST(executors, utf8_wchar)
 {
 }
 
+static size_t
+iterate_with_rule(purc_exec_ops_t ops, purc_variant_t input, const char *rule)
+{
+    purc_exec_inst_t inst = ops->create(PURC_EXEC_TYPE_ITERATE, input, true);
+    if (inst == NULL)
+        return (size_t)-1;
+
+    size_t nr = 0;
+    purc_exec_iter_t it = ops->it_begin(inst, rule);
+    while (it) {
+        nr++;
+        it = ops->it_next(inst, it, NULL);
+    }
+
+    ops->destroy(inst);
+    return nr;
+}
+
+TEST(executors, rule_cache)
+{
+    purc_instance_extra_info info = {};
+    int r = purc_init_ex(PURC_MODULE_HVML, "cn.fmsoft.hvml.test", "executors",
+            &info);
+    ASSERT_EQ(r, PURC_ERROR_OK);
+
+    purc_exec_ops_t filter, range;
+    ASSERT_TRUE(purc_get_executor("FILTER", &filter));
+    ASSERT_TRUE(purc_get_executor("RANGE", &range));
+
+    purc_variant_t input = pcejson_parser_parse_string("[1, 2, 3, 4, 5]",
+            0, 0);
+    ASSERT_NE(input, PURC_VARIANT_INVALID);
+
+    size_t nr_rules, nr_hits, nr_misses, hits, misses;
+    pcexecutor_get_rule_cache_stats(NULL, &nr_hits, &nr_misses);
+
+    /* the same rule is parsed once, even by nested users */
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(iterate_with_rule(filter, input, "FILTER: ALL"), 5);
+        EXPECT_EQ(iterate_with_rule(range, input, "RANGE: FROM 1"), 4);
+    }
+    pcexecutor_get_rule_cache_stats(NULL, &hits, &misses);
+    EXPECT_EQ(misses - nr_misses, 2);
+    EXPECT_EQ(hits - nr_hits, 18);
+
+    /* a rule held by an executor instance is shared with other users */
+    pcexecutor_get_rule_cache_stats(NULL, NULL, &nr_misses);
+    purc_exec_inst_t inst = filter->create(PURC_EXEC_TYPE_ITERATE, input, true);
+    ASSERT_NE(inst, nullptr);
+    EXPECT_NE(filter->it_begin(inst, "FILTER: ALL"), nullptr);
+    EXPECT_EQ(iterate_with_rule(filter, input, "FILTER: ALL"), 5);
+    pcexecutor_get_rule_cache_stats(NULL, NULL, &misses);
+    EXPECT_EQ(misses, nr_misses);
+
+    /* a rule in use survives the eviction */
+    char rule[64];
+    for (int i = 0; i < PCEXEC_MAX_CACHED_RULES * 2; i++) {
+        snprintf(rule, sizeof(rule), "RANGE: FROM %d", i);
+        iterate_with_rule(range, input, rule);
+    }
+    pcexecutor_get_rule_cache_stats(&nr_rules, NULL, NULL);
+    EXPECT_LE(nr_rules, (size_t)PCEXEC_MAX_CACHED_RULES);
+    EXPECT_NE(filter->it_value(inst, filter->it_begin(inst, "FILTER: ALL")),
+            PURC_VARIANT_INVALID);
+    filter->destroy(inst);
+
+    /* failures are not cached */
+    pcexecutor_get_rule_cache_stats(NULL, NULL, &nr_misses);
+    EXPECT_EQ(iterate_with_rule(filter, input, "FILTER: BAD RULE"), 0);
+    EXPECT_EQ(iterate_with_rule(filter, input, "FILTER: BAD RULE"), 0);
+    pcexecutor_get_rule_cache_stats(NULL, NULL, &misses);
+    EXPECT_EQ(misses - nr_misses, 2);
+
+    purc_variant_unref(input);
+
+    bool ok = purc_cleanup ();
+    ASSERT_TRUE(ok);
+}
+
@@ -19,7 +19,7 @@
 
 #include "purc.h"
 
-#include "purc-executor.h"
+#include "private/executor.h"
 
 #include "private/utils.h"
 
@@ -30,6 +30,8 @@
 #include "../helpers.h"
 
 extern "C" {
+#include "pcexe-helper.h"
+#include "exe_sql.h"
 #include "exe_sql.tab.h"
 }
 
@@ -68,10 +70,10 @@ parse(const char *rule, char *err_msg, size_t sz_err_msg)
     r = exe_sql_parse(rule, strlen(rule), &param) == 0;
     if (param.err_msg) {
         snprintf(err_msg, sz_err_msg, "%s", param.err_msg);
-        free(param.err_msg);
-        param.err_msg = NULL;
     }
 
+    exe_sql_param_reset(&param);
+
     return r;
 }
 
@@ -105,3 +107,101 @@ TEST(exe_sql, files)
     ASSERT_TRUE(ok);
 }
 
+
+static std::string
+query(const char *rule, purc_variant_t input)
+{
+    purc_exec_ops_t ops;
+    if (!purc_get_executor("SQL", &ops))
+        return "no executor";
+
+    purc_exec_inst_t inst = ops->create(PURC_EXEC_TYPE_REDUCE, input, true);
+    if (!inst)
+        return "no instance";
+
+    std::string result;
+    purc_variant_t v = ops->reduce(inst, rule);
+    if (v == PURC_VARIANT_INVALID) {
+        result = inst->err_msg ? inst->err_msg : "error";
+    }
+    else {
+        purc_rwstream_t rws = purc_rwstream_new_buffer(64, 0);
+        purc_variant_serialize(v, rws, 0, PCVARIANT_SERIALIZE_OPT_PLAIN, NULL);
+        size_t sz = 0;
+        const char *buf = (const char *)purc_rwstream_get_mem_buffer(rws, &sz);
+        result.assign(buf, sz);
+        purc_rwstream_destroy(rws);
+        purc_variant_unref(v);
+    }
+
+    ops->destroy(inst);
+    return result;
+}
+
+TEST(exe_sql, execute)
+{
+    purc_instance_extra_info info = {};
+    int r = purc_init_ex(PURC_MODULE_HVML, "cn.fmsoft.hvml.test", "exe_sql",
+            &info);
+    ASSERT_EQ(r, PURC_ERROR_OK);
+
+    const char *json =
+        "[{\"name\":\"a\",\"locale\":\"zh_CN\",\"rank\":80,\"age\":3},"
+        "{\"name\":\"b\",\"locale\":\"en_US\",\"rank\":60,\"age\":3},"
+        "{\"name\":\"c\",\"locale\":\"zh_TW\",\"rank\":90,\"age\":5},"
+        "{\"name\":\"d\",\"locale\":\"zh_HK\",\"rank\":50,\"age\":5},"
+        "{\"name\":\"e\",\"locale\":\"fr_FR\",\"rank\":75}]";
+    purc_variant_t input = purc_variant_make_from_json_string(json,
+            strlen(json));
+    ASSERT_NE(input, PURC_VARIANT_INVALID);
+
+    EXPECT_EQ(query("SQL: SELECT name WHERE locale LIKE 'zh_*' AND rank > 70",
+                input),
+            "[{\"name\":\"a\"},{\"name\":\"c\"}]");
+    EXPECT_EQ(query("SQL: SELECT name WHERE rank < 60 OR "
+                "NOT locale IN ('zh_CN', 'zh_TW', 'zh_HK')", input),
+            "[{\"name\":\"b\"},{\"name\":\"d\"},{\"name\":\"e\"}]");
+    EXPECT_EQ(query("SQL: SELECT age, count(*) AS n, avg(rank) AS r "
+                "GROUP BY age ORDER BY n DESC, age", input),
+            "[{\"age\":3,\"n\":2,\"r\":70},{\"age\":5,\"n\":2,\"r\":70},"
+            "{\"age\":null,\"n\":1,\"r\":75}]");
+    EXPECT_EQ(query("SQL: SELECT count(*) AS n, sum(rank) AS s "
+                "WHERE rank > 1000", input),
+            "[{\"n\":0,\"s\":null}]");
+    EXPECT_EQ(query("SQL: SELECT name, (rank + 1) AS r "
+                "ORDER BY rank DESC LIMIT 2", input),
+            "[{\"name\":\"c\",\"r\":91},{\"name\":\"a\",\"r\":81}]");
+    EXPECT_EQ(query("SQL: SELECT name WHERE age = 3 "
+                "UNION SELECT name WHERE rank > 70", input),
+            "[{\"name\":\"a\"},{\"name\":\"b\"},{\"name\":\"c\"},"
+            "{\"name\":\"e\"}]");
+
+    /* the plan is checked along with the syntax */
+    EXPECT_NE(query("SQL: SELECT name WHERE count(*) > 1", input)[0], '[');
+    EXPECT_NE(query("SQL: SELECT median(rank)", input)[0], '[');
+
+    /* numeric strings match numbers, but sort after all the numbers */
+    const char *mixed_json =
+        "[{\"v\":10},{\"v\":\"9\"},{\"v\":\"10\"},{\"v\":2}]";
+    purc_variant_t mixed = purc_variant_make_from_json_string(mixed_json,
+            strlen(mixed_json));
+    ASSERT_NE(mixed, PURC_VARIANT_INVALID);
+    EXPECT_EQ(query("SQL: SELECT v ORDER BY v", mixed),
+            "[{\"v\":2},{\"v\":10},{\"v\":\"10\"},{\"v\":\"9\"}]");
+    EXPECT_EQ(query("SQL: SELECT v WHERE v = 10", mixed),
+            "[{\"v\":10},{\"v\":\"10\"}]");
+    EXPECT_EQ(query("SQL: SELECT max(v) AS m", mixed), "[{\"m\":\"9\"}]");
+    purc_variant_unref(mixed);
+
+    purc_variant_t wrapper = purc_variant_make_object_by_static_ckey(1,
+            "rows", input);
+    EXPECT_EQ(query("SQL: SELECT name FROM rows ORDER BY rank LIMIT 1",
+                wrapper),
+            "[{\"name\":\"d\"}]");
+    purc_variant_unref(wrapper);
+
+    purc_variant_unref(input);
+
+    bool ok = purc_cleanup ();
+    ASSERT_TRUE(ok);
+}
@@ -34,6 +34,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
 
 #if OS(LINUX) || OS(UNIX)
 // get path from env or __FILE__/../<rel> otherwise
@@ -171,3 +174,229 @@ TEST(local_fetcher, async)
     purc_cleanup();
 #endif                        /* } */
 }
+
+static std::string
+fetch_sync(const char *url, int *ret_code)
+{
+    struct pcfetcher_resp_header resp_header = { };
+    purc_rwstream_t resp = pcfetcher_request_sync(url,
+            PCFETCHER_REQUEST_METHOD_GET, NULL, 10, &resp_header);
+    *ret_code = resp_header.ret_code;
+
+    std::string content;
+    if (resp) {
+        purc_rwstream_t rws_out = purc_rwstream_new_buffer(1024, 0);
+        purc_rwstream_dump_to_another(resp, rws_out, -1);
+
+        size_t sz = 0;
+        const char *buf = (const char*)purc_rwstream_get_mem_buffer(rws_out,
+                &sz);
+        content.assign(buf, sz);
+
+        purc_rwstream_destroy(rws_out);
+        purc_rwstream_destroy(resp);
+    }
+
+    if (resp_header.mime_type) {
+        free(resp_header.mime_type);
+    }
+    return content;
+}
+
+static void
+write_file(const char *file, const char *content)
+{
+    FILE *fp = fopen(file, "w");
+    ASSERT_NE(fp, nullptr);
+    fputs(content, fp);
+    fclose(fp);
+}
+
+TEST(local_fetcher, cache)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HVML, "cn.fmsoft.hybridos.sample",
+            "pcfetcher", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    char file[] = "/tmp/purc-local-fetcher-XXXXXX";
+    int fd = mkstemp(file);
+    ASSERT_GE(fd, 0);
+    close(fd);
+
+    char url[PATH_MAX + 8];
+    snprintf(url, sizeof(url), "file://%s", file);
+    pcfetcher_set_base_url(NULL);
+
+    int ret_code = 0;
+    write_file(file, "hello");
+    EXPECT_EQ(fetch_sync(url, &ret_code), "hello");
+    EXPECT_EQ(ret_code, 200);
+
+    /* served from the cache */
+    EXPECT_EQ(fetch_sync(url, &ret_code), "hello");
+    EXPECT_EQ(ret_code, 200);
+
+    /* a changed file is loaded again */
+    write_file(file, "hello, world");
+    EXPECT_EQ(fetch_sync(url, &ret_code), "hello, world");
+    EXPECT_EQ(ret_code, 200);
+
+    unlink(file);
+    EXPECT_EQ(fetch_sync(url, &ret_code), "");
+    EXPECT_EQ(ret_code, 404);
+
+    purc_cleanup();
+}
+
+/* FETCHER_CACHE_QUOTA of the instance */
+#define CACHE_QUOTA     10240
+
+/* keeps the size and the mtime, so a cached copy is still taken as valid */
+static void
+rewrite_file_in_place(const char *file, const char *content)
+{
+    struct stat st;
+    ASSERT_EQ(stat(file, &st), 0);
+    write_file(file, content);
+
+    struct timespec times[2] = { st.st_atim, st.st_mtim };
+    ASSERT_EQ(utimensat(AT_FDCWD, file, times, 0), 0);
+}
+
+TEST(local_fetcher, cache_eviction)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HVML, "cn.fmsoft.hybridos.sample",
+            "pcfetcher", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+    pcfetcher_set_base_url(NULL);
+
+    /* two files fit in the cache, but three do not */
+    const size_t sz_file = CACHE_QUOTA * 2 / 5;
+    char files[3][32];
+    char urls[3][PATH_MAX + 8];
+    std::string old_content[3], new_content[3];
+    for (int i = 0; i < 3; i++) {
+        strcpy(files[i], "/tmp/purc-local-fetcher-XXXXXX");
+        int fd = mkstemp(files[i]);
+        ASSERT_GE(fd, 0);
+        close(fd);
+        snprintf(urls[i], sizeof(urls[i]), "file://%s", files[i]);
+
+        old_content[i].assign(sz_file, 'a' + i);
+        new_content[i].assign(sz_file, 'A' + i);
+        write_file(files[i], old_content[i].c_str());
+    }
+
+    int ret_code = 0;
+    EXPECT_EQ(fetch_sync(urls[0], &ret_code), old_content[0]);
+    EXPECT_EQ(fetch_sync(urls[1], &ret_code), old_content[1]);
+
+    /* served from the cache, and becomes the most recently used one */
+    rewrite_file_in_place(files[0], new_content[0].c_str());
+    EXPECT_EQ(fetch_sync(urls[0], &ret_code), old_content[0]);
+    EXPECT_EQ(ret_code, 200);
+
+    /* the least recently used one is evicted to make room */
+    EXPECT_EQ(fetch_sync(urls[2], &ret_code), old_content[2]);
+    rewrite_file_in_place(files[1], new_content[1].c_str());
+    EXPECT_EQ(fetch_sync(urls[0], &ret_code), old_content[0]);
+    EXPECT_EQ(fetch_sync(urls[1], &ret_code), new_content[1]);
+    EXPECT_EQ(ret_code, 200);
+
+    /* a file larger than the quota is never cached */
+    std::string large(CACHE_QUOTA + 1, 'x');
+    write_file(files[2], large.c_str());
+    EXPECT_EQ(fetch_sync(urls[2], &ret_code), large);
+    large.assign(CACHE_QUOTA + 1, 'y');
+    rewrite_file_in_place(files[2], large.c_str());
+    EXPECT_EQ(fetch_sync(urls[2], &ret_code), large);
+
+    for (int i = 0; i < 3; i++) {
+        unlink(files[i]);
+    }
+
+    purc_cleanup();
+}
+
+struct cancel_ctxt {
+    int nr_calls;
+    int ret_code;
+};
+
+static void
+cancel_response_handler(purc_variant_t request_id, void* ctxt,
+        const struct pcfetcher_resp_header *resp_header,
+        purc_rwstream_t resp)
+{
+    UNUSED_PARAM(request_id);
+
+    struct cancel_ctxt *cc = (struct cancel_ctxt *)ctxt;
+    cc->nr_calls++;
+    cc->ret_code = resp_header->ret_code;
+    if (resp) {
+        purc_rwstream_destroy(resp);
+    }
+}
+
+static void
+run_loop_for(Seconds duration)
+{
+    RunLoop::current().dispatchAfter(duration, [] {
+        RunLoop::current().stop();
+    });
+    RunLoop::run();
+}
+
+TEST(local_fetcher, cancel_in_worker)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HVML, "cn.fmsoft.hybridos.sample",
+            "pcfetcher", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+    pcfetcher_set_base_url(NULL);
+
+    /* opening a FIFO blocks the worker until there is a writer */
+    char dir[] = "/tmp/purc-local-fetcher-XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    char fifo[sizeof(dir) + 8];
+    snprintf(fifo, sizeof(fifo), "%s/fifo", dir);
+    ASSERT_EQ(mkfifo(fifo, 0600), 0);
+
+    char url[PATH_MAX + 8];
+    snprintf(url, sizeof(url), "file://%s", fifo);
+
+    struct cancel_ctxt cc = { 0, 0 };
+    purc_variant_t req = pcfetcher_request_async(url,
+            PCFETCHER_REQUEST_METHOD_GET, NULL, 10,
+            cancel_response_handler, &cc);
+    ASSERT_NE(req, PURC_VARIANT_INVALID);
+
+    /* a writer can only be opened once the worker is opening the FIFO */
+    int fd = -1;
+    for (int i = 0; i < 500 && fd < 0; i++) {
+        fd = open(fifo, O_WRONLY | O_NONBLOCK);
+        if (fd < 0) {
+            usleep(10 * 1000);
+        }
+    }
+    ASSERT_GE(fd, 0);
+
+    /* the worker is released now, and races with the cancellation */
+    pcfetcher_cancel_async(req);
+    EXPECT_EQ(cc.nr_calls, 1);
+    EXPECT_EQ(cc.ret_code, RESP_CODE_USER_CANCEL);
+    close(fd);
+
+    /* the response of the worker is dropped */
+    run_loop_for(200_ms);
+    EXPECT_EQ(cc.nr_calls, 1);
+    EXPECT_EQ(cc.ret_code, RESP_CODE_USER_CANCEL);
+
+    purc_variant_unref(req);
+    unlink(fifo);
+    rmdir(dir);
+
+    purc_cleanup();
+}
@@ -0,0 +1,179 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "purc.h"
+#include "private/document.h"
+#include "private/hashtable.h"
+
+#include <gtest/gtest.h>
+#include <string>
+
+static const char *html =
+    "<html lang=\"en-US\"><head><title>selectors</title></head><body>"
+    "<div id=\"main\" class=\"box\">"
+      "<h1 id=\"h\">Title</h1>"
+      "<p id=\"p1\" class=\"note first\" data-x=\"a-b c\">one</p>"
+      "<p id=\"p2\" class=\"note\">two</p>"
+      "<span id=\"s1\"></span>"
+      "<p id=\"p3\" lang=\"fr\">three</p>"
+      "<ul id=\"list\">"
+        "<li id=\"l1\">1</li><li id=\"l2\">2</li><li id=\"l3\">3</li>"
+        "<li id=\"l4\">4</li><li id=\"l5\">5</li>"
+      "</ul>"
+    "</div>"
+    "<form id=\"f\">"
+      "<input id=\"i1\" type=\"checkbox\" checked>"
+      "<input id=\"i2\" disabled>"
+      "<a id=\"a1\" href=\"/x\">x</a><a id=\"a2\">y</a>"
+    "</form>"
+    "</body></html>";
+
+static std::string
+select(purc_document_t doc, const char *selector)
+{
+    pcdoc_elem_coll_t coll = pcdoc_elem_coll_new_from_document(doc, selector);
+    if (coll == NULL)
+        return "<error>";
+
+    std::string result;
+    size_t nr = pcutils_arrlist_length(coll->elems);
+    for (size_t i = 0; i < nr; i++) {
+        pcdoc_element_t elem;
+        elem = (pcdoc_element_t)pcutils_arrlist_get_idx(coll->elems, i);
+
+        const char *id;
+        size_t len;
+        if (i > 0)
+            result += ",";
+        if ((id = pcdoc_element_id(doc, elem, &len)))
+            result.append(id, len);
+        else
+            result += "-";
+    }
+
+    pcdoc_elem_coll_delete(doc, coll);
+    return result;
+}
+
+TEST(css_selector, select)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HTML, "cn.fmsoft.hvml.test",
+            "css_selector", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML, html, 0);
+    ASSERT_NE(doc, nullptr);
+
+    static const struct {
+        const char *selector;
+        const char *result;
+    } cases[] = {
+        { "p", "p1,p2,p3" },
+        { "P.note", "p1,p2" },
+        { "#p2", "p2" },
+        { "div#main > p.note.first", "p1" },
+        { "body p", "p1,p2,p3" },
+        { "form > *", "i1,i2,a1,a2" },
+        { "h1 + p", "p1" },
+        { "h1 ~ p", "p1,p2,p3" },
+        { "h1 ~ span + p", "p3" },
+        { "p, h1", "h,p1,p2,p3" },
+        { "[data-x]", "p1" },
+        { "[data-x=\"a-b c\"]", "p1" },
+        { "[data-x~=c]", "p1" },
+        { "[data-x|=a]", "p1" },
+        { "[data-x^='a-']", "p1" },
+        { "[data-x$=c]", "p1" },
+        { "[data-x*=\"b \"]", "p1" },
+        { "[id=p3]", "p3" },
+        { "[class~=note]", "p1,p2" },
+        { "[data-x^='']", "" },
+        { "li:first-child", "l1" },
+        { "li:last-child", "l5" },
+        { "li:nth-child(2n+1)", "l1,l3,l5" },
+        { "li:nth-child(even)", "l2,l4" },
+        { "li:nth-child(-n+2)", "l1,l2" },
+        { "li:nth-last-child(2)", "l4" },
+        { "#main > p:nth-of-type(2)", "p2" },
+        { "#main > :last-of-type", "h,s1,p3,list" },
+        { "ul:only-of-type", "list" },
+        { "li:only-child", "" },
+        { "span:empty", "s1" },
+        { "p:not(.note)", "p3" },
+        { "li:not(:nth-child(odd))", "l2,l4" },
+        { ":root", "-" },
+        { "p:lang(fr)", "p3" },
+        { "h1:lang(en)", "h" },
+        { "input:checked", "i1" },
+        { "input:disabled", "i2" },
+        { "input:enabled", "i1" },
+        { "a:link", "a1" },
+        { "a:hover", "" },
+        { "p::first-line", "" },
+        { "*|p#p1", "p1" },
+        { "#\\70 1", "p1" },
+    };
+
+    for (size_t i = 0; i < PCA_TABLESIZE(cases); i++) {
+        EXPECT_EQ(select(doc, cases[i].selector), cases[i].result)
+            << "selector: " << cases[i].selector;
+    }
+
+    /* the compiled selectors are cached */
+    ASSERT_NE(doc->selectors, nullptr);
+    int count = doc->selectors->count;
+    ASSERT_EQ(select(doc, "P.note"), "p1,p2");
+    ASSERT_EQ(doc->selectors->count, count);
+
+    pcdoc_element_t elem = pcdoc_find_element_in_document(doc, "ul > li + li");
+    ASSERT_NE(elem, nullptr);
+    size_t len;
+    const char *id = pcdoc_element_id(doc, elem, &len);
+    ASSERT_EQ(std::string(id, len), "l2");
+
+    purc_document_delete(doc);
+    purc_cleanup();
+}
+
+TEST(css_selector, bad)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HTML, "cn.fmsoft.hvml.test",
+            "css_selector", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML, html, 0);
+    ASSERT_NE(doc, nullptr);
+
+    static const char *bad[] = {
+        "", " ", "p,", ",p", "p >", "> p", "p..note", "#", "[id", "[id=]",
+        "[id~]", "p:unknown", "li:nth-child(x)", "li:nth-child(2n+)",
+        "p:not(p:not(a))", "p:not(::before)", "p:not(.a", "'p'", "p!",
+    };
+
+    for (size_t i = 0; i < PCA_TABLESIZE(bad); i++) {
+        EXPECT_EQ(select(doc, bad[i]), "<error>") << "selector: " << bad[i];
+        EXPECT_EQ(purc_get_last_error(), PURC_ERROR_INVALID_VALUE)
+            << "selector: " << bad[i];
+    }
+
+    purc_document_delete(doc);
+    purc_cleanup();
+}
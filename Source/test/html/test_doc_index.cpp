@@ -0,0 +1,182 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "purc.h"
+#include "purc-document.h"
+
+#include <gtest/gtest.h>
+#include <string>
+
+static const char *html =
+    "<html><head><title>index</title></head><body>"
+    "<div id=\"a\" class=\"box red\">"
+    "  <p id=\"b\" class=\"red\">one</p>"
+    "  <p class=\"  blue red  red \">two</p>"
+    "</div>"
+    "<div id=\"c\" class=\"box\"><span class=\"red\">three</span></div>"
+    "<p id=\"b\">dup</p>"
+    "</body></html>";
+
+static int
+collect_tag(purc_document_t doc, pcdoc_element_t elem, void *ctxt)
+{
+    std::string *result = (std::string *)ctxt;
+    const char *val;
+    size_t len;
+
+    if (result->length())
+        result->append(",");
+
+    if (pcdoc_element_get_attribute(doc, elem, "id", &val, &len) == 0)
+        result->append(val, len);
+    else
+        result->append("-");
+    return 0;
+}
+
+static std::string
+query_id(purc_document_t doc, pcdoc_element_t ancestor, const char *id)
+{
+    std::string result;
+    size_t n = 0;
+    int r = pcdoc_travel_descendant_elements_by_id(doc, ancestor, id,
+            collect_tag, &result, &n);
+    EXPECT_EQ(r, 0);
+    return result + "#" + std::to_string(n);
+}
+
+static std::string
+query_class(purc_document_t doc, pcdoc_element_t ancestor, const char *klass)
+{
+    std::string result;
+    size_t n = 0;
+    int r = pcdoc_travel_descendant_elements_by_class(doc, ancestor, klass,
+            collect_tag, &result, &n);
+    EXPECT_EQ(r, 0);
+    return result + "#" + std::to_string(n);
+}
+
+static int
+find_first(purc_document_t doc, pcdoc_element_t elem, void *ctxt)
+{
+    (void)doc;
+    *(pcdoc_element_t *)ctxt = elem;
+    return -1;
+}
+
+static pcdoc_element_t
+get_by_id(purc_document_t doc, const char *id)
+{
+    pcdoc_element_t elem = NULL;
+    pcdoc_travel_descendant_elements_by_id(doc, NULL, id,
+            find_first, &elem, NULL);
+    return elem;
+}
+
+TEST(doc_index, query)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HTML, "cn.fmsoft.hvml.test",
+            "doc_index", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML, html, 0);
+    ASSERT_NE(doc, nullptr);
+
+    ASSERT_EQ(query_id(doc, NULL, "a"), "a#1");
+    ASSERT_EQ(query_id(doc, NULL, "b"), "b,b#2");
+    ASSERT_EQ(query_id(doc, NULL, "none"), "#0");
+
+    /* document order; duplicated tokens are matched once */
+    ASSERT_EQ(query_class(doc, NULL, "red"), "a,b,-,-#4");
+    ASSERT_EQ(query_class(doc, NULL, "box"), "a,c#2");
+    ASSERT_EQ(query_class(doc, NULL, "blue"), "-#1");
+    ASSERT_EQ(query_class(doc, NULL, "re"), "#0");
+
+    /* limited to a subtree */
+    pcdoc_element_t c = get_by_id(doc, "c");
+    ASSERT_NE(c, nullptr);
+    ASSERT_EQ(query_class(doc, c, "red"), "-#1");
+    ASSERT_EQ(query_class(doc, c, "box"), "c#1");
+    ASSERT_EQ(query_id(doc, c, "b"), "#0");
+
+    /* breaking the travel */
+    ASSERT_NE(pcdoc_travel_descendant_elements_by_class(doc, NULL, "red",
+            find_first, &c, NULL), 0);
+
+    purc_document_delete(doc);
+    purc_cleanup();
+}
+
+TEST(doc_index, update)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_HTML, "cn.fmsoft.hvml.test",
+            "doc_index", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    purc_document_t doc = purc_document_load(PCDOC_K_TYPE_HTML, html, 0);
+    ASSERT_NE(doc, nullptr);
+
+    /* build the indexes */
+    ASSERT_EQ(query_class(doc, NULL, "red"), "a,b,-,-#4");
+
+    /* change the identifier and the class names */
+    pcdoc_element_t c = get_by_id(doc, "c");
+    ASSERT_NE(c, nullptr);
+    pcdoc_element_set_attribute(doc, c, PCDOC_OP_DISPLACE, "id", "d", 0);
+    pcdoc_element_set_attribute(doc, c, PCDOC_OP_DISPLACE,
+            "class", "red green", 0);
+    ASSERT_EQ(query_id(doc, NULL, "c"), "#0");
+    ASSERT_EQ(query_id(doc, NULL, "d"), "d#1");
+    ASSERT_EQ(query_class(doc, NULL, "box"), "a#1");
+    ASSERT_EQ(query_class(doc, NULL, "red"), "a,b,-,d,-#5");
+    ASSERT_EQ(query_class(doc, NULL, "green"), "d#1");
+
+    pcdoc_element_set_attribute(doc, c, PCDOC_OP_ERASE, "class", NULL, 0);
+    ASSERT_EQ(query_class(doc, NULL, "green"), "#0");
+
+    /* new content */
+    pcdoc_element_new_content(doc, c, PCDOC_OP_APPEND,
+            "<b id=\"e\" class=\"green\"><i class=\"green\">x</i></b>", 0);
+    ASSERT_EQ(query_id(doc, NULL, "e"), "e#1");
+    ASSERT_EQ(query_class(doc, NULL, "green"), "e,-#2");
+    ASSERT_EQ(query_class(doc, NULL, "red"), "a,b,-,-#4");
+
+    pcdoc_element_new_content(doc, c, PCDOC_OP_DISPLACE,
+            "<b id=\"f\" class=\"green\"></b>", 0);
+    ASSERT_EQ(query_id(doc, NULL, "e"), "#0");
+    ASSERT_EQ(query_class(doc, NULL, "green"), "f#1");
+    ASSERT_EQ(query_class(doc, NULL, "red"), "a,b,-#3");
+
+    /* clear and erase */
+    pcdoc_element_clear(doc, c);
+    ASSERT_EQ(query_id(doc, NULL, "f"), "#0");
+    ASSERT_EQ(query_id(doc, NULL, "d"), "d#1");
+
+    pcdoc_element_t a = get_by_id(doc, "a");
+    ASSERT_NE(a, nullptr);
+    pcdoc_element_erase(doc, a);
+    ASSERT_EQ(query_id(doc, NULL, "a"), "#0");
+    ASSERT_EQ(query_id(doc, NULL, "b"), "b#1");
+    ASSERT_EQ(query_class(doc, NULL, "red"), "#0");
+
+    purc_document_delete(doc);
+    purc_cleanup();
+}
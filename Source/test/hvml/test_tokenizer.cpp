@@ -363,3 +363,159 @@ std::vector<hvml_token_test_data> read_hvml_token_test_data()
 INSTANTIATE_TEST_SUITE_P(hvml_token, hvml_parser_next_token,
         testing::ValuesIn(read_hvml_token_test_data()));
 
+
+/* the reader pulls the input in 4 KB blocks */
+#define READER_BLOCK_SIZE       4096
+
+/* a read-only stream returning at most `step` bytes per read */
+struct short_reader {
+    const char *buf;
+    size_t len;
+    size_t pos;
+    size_t step;
+};
+
+static ssize_t
+short_read(void *ctxt, void *buf, size_t count)
+{
+    struct short_reader *rd = (struct short_reader *)ctxt;
+    size_t n = rd->len - rd->pos;
+    if (n > rd->step)
+        n = rd->step;
+    if (n > count)
+        n = count;
+    memcpy(buf, rd->buf + rd->pos, n);
+    rd->pos += n;
+    return n;
+}
+
+static int
+tokenize(purc_rwstream_t rws, std::string &serial)
+{
+    struct pchvml_parser* parser = pchvml_create(0, 32);
+    struct pchvml_token* token;
+
+    purc_clr_error();
+    while ((token = pchvml_next_token(parser, rws)) != NULL) {
+        struct tkz_buffer* token_buff = pchvml_token_to_string(token);
+        if (token_buff) {
+            serial += pchvml_token_get_type_name(token);
+            serial += "|";
+            serial += tkz_buffer_get_bytes(token_buff);
+            serial += "\n";
+            tkz_buffer_destroy(token_buff);
+        }
+        enum pchvml_token_type type = pchvml_token_get_type(token);
+        pchvml_token_destroy(token);
+        if (type == PCHVML_TOKEN_EOF)
+            break;
+    }
+
+    pchvml_destroy(parser);
+    return purc_get_last_error();
+}
+
+static size_t
+count_substr(const std::string &s, const char *sub)
+{
+    size_t nr = 0;
+    for (size_t pos = s.find(sub); pos != std::string::npos;
+            pos = s.find(sub, pos + 1))
+        nr++;
+    return nr;
+}
+
+/* puts some 3-byte characters around each of the first block boundaries */
+static std::string
+make_boundary_text(void)
+{
+    std::string text;
+    for (int i = 1; i <= 3; i++) {
+        text.append(READER_BLOCK_SIZE * i - text.size() - 2, 'x');
+        text += "中文字";
+    }
+    return text;
+}
+
+TEST(hvml_tokenizer, block_boundary)
+{
+    purc_init_ex(PURC_MODULE_HVML, "cn.fmsoft.hybridos.test",
+            "hvml_token", NULL);
+
+    std::string text = make_boundary_text();
+    std::string hvml = "<hvml><body><p title=\"" + text + "\">" + text +
+        "</p></body></hvml>";
+
+    purc_rwstream_t rws = purc_rwstream_new_from_mem((void*)hvml.c_str(),
+            hvml.size());
+    std::string expected;
+    ASSERT_EQ(tokenize(rws, expected), PCHVML_SUCCESS);
+    purc_rwstream_destroy(rws);
+    ASSERT_EQ(count_substr(expected, "中文字"), 6u);
+
+    const size_t steps[] = { 1, 2, 5, READER_BLOCK_SIZE - 1,
+        READER_BLOCK_SIZE + 1 };
+    for (size_t i = 0; i < PCA_TABLESIZE(steps); i++) {
+        struct short_reader rd = { hvml.c_str(), hvml.size(), 0, steps[i] };
+        rws = purc_rwstream_new_for_read(&rd, short_read);
+
+        std::string serial;
+        ASSERT_EQ(tokenize(rws, serial), PCHVML_SUCCESS)
+            << "step: " << steps[i];
+        ASSERT_EQ(serial, expected) << "step: " << steps[i];
+        purc_rwstream_destroy(rws);
+    }
+
+    purc_cleanup();
+}
+
+TEST(ejson_tokenizer, block_boundary)
+{
+    purc_init_ex(PURC_MODULE_EJSON, "cn.fmsoft.hybridos.test",
+            "ejson_token", NULL);
+
+    std::string text = make_boundary_text();
+    std::string json = "[\"" + text + "\"]";
+
+    const size_t steps[] = { 1, 2, 5, READER_BLOCK_SIZE - 1,
+        READER_BLOCK_SIZE + 1 };
+    for (size_t i = 0; i < PCA_TABLESIZE(steps); i++) {
+        struct short_reader rd = { json.c_str(), json.size(), 0, steps[i] };
+        purc_rwstream_t rws = purc_rwstream_new_for_read(&rd, short_read);
+
+        purc_variant_t v = purc_variant_load_from_json_stream(rws);
+        ASSERT_NE(v, PURC_VARIANT_INVALID) << "step: " << steps[i];
+        purc_variant_t s = purc_variant_array_get(v, 0);
+        ASSERT_STREQ(purc_variant_get_string_const(s), text.c_str());
+        purc_variant_unref(v);
+        purc_rwstream_destroy(rws);
+    }
+
+    purc_cleanup();
+}
+
+TEST(ejson_tokenizer, give_back_unparsed)
+{
+    purc_init_ex(PURC_MODULE_EJSON, "cn.fmsoft.hybridos.test",
+            "ejson_token", NULL);
+
+    /* the bytes read ahead are given back to the seekable stream,
+       so the values can be loaded one after another */
+    char json[] = "[1] [2]";
+    purc_rwstream_t rws = purc_rwstream_new_from_mem(json, strlen(json));
+    purc_variant_t v = purc_variant_load_from_json_stream(rws);
+    ASSERT_NE(v, PURC_VARIANT_INVALID);
+    /* the white space which ends the value is consumed as well */
+    ASSERT_EQ(purc_rwstream_tell(rws), 4);
+    purc_variant_unref(v);
+
+    v = purc_variant_load_from_json_stream(rws);
+    ASSERT_NE(v, PURC_VARIANT_INVALID);
+    int64_t l = 0;
+    purc_variant_cast_to_longint(purc_variant_array_get(v, 0), &l, false);
+    ASSERT_EQ(l, 2);
+    purc_variant_unref(v);
+    purc_rwstream_destroy(rws);
+
+    purc_cleanup();
+}
@@ -0,0 +1,226 @@
+/*
+** Copyright (C) 2022 FMSoft <https://www.fmsoft.cn>
+**
+** This file is a part of PurC (short for Purring Cat), an HVML interpreter.
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU Lesser General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU Lesser General Public License for more details.
+**
+** You should have received a copy of the GNU Lesser General Public License
+** along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "purc.h"
+#include "private/msg-queue.h"
+#include "private/hashtable.h"
+
+#include <gtest/gtest.h>
+
+static pcrdr_msg *
+make_event(const char *element, const char *name,
+        pcrdr_msg_event_reduce_opt opt, int64_t data)
+{
+    pcrdr_msg *msg = pcrdr_make_event_message(
+            PCRDR_MSG_TARGET_COROUTINE, 1,
+            name, NULL,
+            PCRDR_MSG_ELEMENT_TYPE_HANDLE, element, NULL,
+            PCRDR_MSG_DATA_TYPE_VOID, NULL, 0);
+
+    msg->reduceOpt = opt;
+    msg->dataType = PCRDR_MSG_DATA_TYPE_JSON;
+    msg->data = purc_variant_make_longint(data);
+    return msg;
+}
+
+static int64_t
+data_of(const pcrdr_msg *msg)
+{
+    int64_t v = -1;
+    purc_variant_cast_to_longint(msg->data, &v, false);
+    return v;
+}
+
+TEST(msg_queue, reduce)
+{
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.purc.test",
+            "msg_queue", NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    struct pcinst_msg_queue *queue = pcinst_msg_queue_create();
+    ASSERT_NE(queue, nullptr);
+
+    // an event storm on the same element is reduced to one event
+    for (int i = 0; i < 1000; i++) {
+        pcinst_msg_queue_append(queue,
+                make_event("1", "mousemove",
+                    PCRDR_MSG_EVENT_REDUCE_OPT_OVERLAY, i));
+    }
+    ASSERT_EQ(pcinst_msg_queue_count(queue), 1);
+    ASSERT_EQ(queue->nr_reduced_events, 999);
+
+    // the events of other elements or names are kept
+    pcinst_msg_queue_append(queue,
+            make_event("2", "mousemove", PCRDR_MSG_EVENT_REDUCE_OPT_OVERLAY, 0));
+    pcinst_msg_queue_append(queue,
+            make_event("1", "click", PCRDR_MSG_EVENT_REDUCE_OPT_IGNORE, 1));
+    ASSERT_EQ(pcinst_msg_queue_count(queue), 3);
+
+    // ignored for the queued one
+    pcinst_msg_queue_append(queue,
+            make_event("1", "click", PCRDR_MSG_EVENT_REDUCE_OPT_IGNORE, 2));
+    ASSERT_EQ(pcinst_msg_queue_count(queue), 3);
+    ASSERT_EQ(queue->nr_dropped_events, 1);
+
+    // the kept events having the same key are all queued,
+    // and a later one is overlaid on the first of them
+    pcinst_msg_queue_append(queue,
+            make_event("3", "change", PCRDR_MSG_EVENT_REDUCE_OPT_KEEP, 10));
+    pcinst_msg_queue_append(queue,
+            make_event("3", "change", PCRDR_MSG_EVENT_REDUCE_OPT_KEEP, 11));
+    pcinst_msg_queue_prepend(queue,
+            make_event("3", "change", PCRDR_MSG_EVENT_REDUCE_OPT_KEEP, 9));
+    pcinst_msg_queue_append(queue,
+            make_event("3", "change", PCRDR_MSG_EVENT_REDUCE_OPT_OVERLAY, 12));
+    ASSERT_EQ(pcinst_msg_queue_count(queue), 6);
+    ASSERT_EQ(queue->nr_reduced_events, 1000);
+
+    static const struct {
+        const char *element;
+        const char *name;
+        int64_t     data;
+    } expected[] = {
+        { "3", "change", 12 },
+        { "1", "mousemove", 999 },
+        { "2", "mousemove", 0 },
+        { "1", "click", 1 },
+        { "3", "change", 13 },
+        { "3", "change", 11 },
+    };
+
+    for (size_t i = 0; i < PCA_TABLESIZE(expected); i++) {
+        pcrdr_msg *msg = pcinst_msg_queue_get_msg(queue);
+        ASSERT_NE(msg, nullptr);
+        ASSERT_STREQ(purc_variant_get_string_const(msg->elementValue),
+                expected[i].element);
+        ASSERT_STREQ(purc_variant_get_string_const(msg->eventName),
+                expected[i].name);
+        ASSERT_EQ(data_of(msg), expected[i].data);
+        pcrdr_release_message(msg);
+
+        // overlaid on the next kept one once the first one is dequeued
+        if (i == 0) {
+            pcinst_msg_queue_append(queue,
+                    make_event("3", "change",
+                        PCRDR_MSG_EVENT_REDUCE_OPT_OVERLAY, 13));
+            ASSERT_EQ(pcinst_msg_queue_count(queue), 5);
+        }
+    }
+
+    ASSERT_EQ(pcinst_msg_queue_count(queue), 0);
+    ASSERT_EQ(pcinst_msg_queue_destroy(queue), 0);
+    purc_cleanup();
+}
+
+TEST(msg_queue, get_event_by_element)
+{
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.purc.test",
+            "msg_queue", NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    struct pcinst_msg_queue *queue = pcinst_msg_queue_create();
+    ASSERT_NE(queue, nullptr);
+
+    char req_id[16];
+    for (int i = 0; i < 100; i++) {
+        pcrdr_msg *msg = make_event("1", "click",
+                PCRDR_MSG_EVENT_REDUCE_OPT_KEEP, i);
+        sprintf(req_id, "REQ-%d", i % 10);
+        msg->requestId = purc_variant_make_string(req_id, false);
+        pcinst_msg_queue_append(queue, msg);
+    }
+    ASSERT_EQ(pcinst_msg_queue_count(queue), 100);
+
+    purc_variant_t request_id = purc_variant_make_string("REQ-7", false);
+    purc_variant_t element = purc_variant_make_string("1", false);
+    purc_variant_t name = purc_variant_make_string("click", false);
+
+    // the events are got in the order of the queue
+    for (int i = 7; i < 100; i += 10) {
+        pcrdr_msg *msg = pcinst_msg_queue_get_event_by_element(queue,
+                request_id, element, name);
+        ASSERT_NE(msg, nullptr);
+        ASSERT_EQ(data_of(msg), i);
+        pcrdr_release_message(msg);
+    }
+    ASSERT_EQ(pcinst_msg_queue_get_event_by_element(queue,
+                request_id, element, name), nullptr);
+    ASSERT_EQ(pcinst_msg_queue_count(queue), 90);
+
+    // the event got is removed from all the indexes
+    pcrdr_msg *msg = pcinst_msg_queue_get_msg(queue);
+    ASSERT_EQ(data_of(msg), 0);
+    pcrdr_release_message(msg);
+
+    purc_variant_unref(request_id);
+    purc_variant_unref(element);
+    purc_variant_unref(name);
+
+    ASSERT_EQ(pcinst_msg_queue_destroy(queue), 89);
+    purc_cleanup();
+}
+
+TEST(msg_queue, index_churn)
+{
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.purc.test",
+            "msg_queue", NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    struct pcinst_msg_queue *queue = pcinst_msg_queue_create();
+    ASSERT_NE(queue, nullptr);
+
+    char element[16];
+
+    // a burst of events on distinct elements grows the indexes
+    for (int i = 0; i < 10000; i++) {
+        sprintf(element, "%d", i);
+        pcinst_msg_queue_append(queue,
+                make_event(element, "click", PCRDR_MSG_EVENT_REDUCE_OPT_KEEP, i));
+    }
+    ASSERT_EQ(pcinst_msg_queue_count(queue), 10000);
+    int burst_size = queue->event_index->size;
+    ASSERT_GE(burst_size, 10000);
+
+    for (int i = 0; i < 10000; i++) {
+        pcrdr_msg *msg = pcinst_msg_queue_get_msg(queue);
+        ASSERT_NE(msg, nullptr);
+        pcrdr_release_message(msg);
+    }
+
+    // one event at a time on ever new elements leaves only tombstones,
+    // which are reclaimed and let the indexes shrink back
+    for (int i = 0; i < 100000; i++) {
+        sprintf(element, "x%d", i);
+        pcinst_msg_queue_append(queue,
+                make_event(element, "click", PCRDR_MSG_EVENT_REDUCE_OPT_KEEP, i));
+        pcrdr_msg *msg = pcinst_msg_queue_get_msg(queue);
+        ASSERT_NE(msg, nullptr);
+        ASSERT_EQ(data_of(msg), i);
+        pcrdr_release_message(msg);
+
+        ASSERT_LE(queue->event_index->size, burst_size);
+        ASSERT_LE(queue->event_index->nr_freed,
+                queue->event_index->size * 2 / 3 + 1);
+    }
+    ASSERT_EQ(queue->event_index->size, HASHTABLE_DEFAULT_SIZE);
+    ASSERT_EQ(queue->event_req_index->size, HASHTABLE_DEFAULT_SIZE);
+
+    ASSERT_EQ(pcinst_msg_queue_destroy(queue), 0);
+    purc_cleanup();
+}
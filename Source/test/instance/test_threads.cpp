@@ -288,3 +288,247 @@ TEST(instance, threads)
     purc_cleanup();
 }
 
+
+#define NR_PRODUCERS        8
+#define NR_MSGS_PER_PRODUCER    200
+
+static void* producer_entry(void* arg)
+{
+    int th_no = (int)(intptr_t)arg;
+    char runner_name[32];
+
+    sprintf(runner_name, "producer%d", th_no);
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.purc.test",
+            runner_name, NULL);
+    if (ret != PURC_ERROR_OK)
+        return NULL;
+
+    for (int i = 0; i < NR_MSGS_PER_PRODUCER; i++) {
+        pcrdr_msg *event;
+        event = pcrdr_make_event_message(
+                PCRDR_MSG_TARGET_INSTANCE,
+                ((uint64_t)th_no << 16) | i,
+                "test", NULL,
+                PCRDR_MSG_ELEMENT_TYPE_VOID, NULL, NULL,
+                PCRDR_MSG_DATA_TYPE_VOID, NULL, 0);
+
+        // retry if the move buffer of the main instance is full;
+        // the message may be freed by the main instance once moved.
+        while (purc_inst_move_message(main_inst, event) == 0) {
+            if (purc_get_last_error() != PURC_ERROR_TOO_SMALL_BUFF) {
+                pcrdr_release_message(event);
+                break;
+            }
+            usleep(100);
+        }
+    }
+
+    purc_cleanup();
+    return NULL;
+}
+
+TEST(instance, producers)
+{
+    int ret;
+
+    ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.purc.test", "threads",
+            NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    main_inst = purc_inst_create_move_buffer(0, 16);
+    ASSERT_NE(main_inst, 0);
+
+    pthread_t producers[NR_PRODUCERS];
+    for (int i = 0; i < NR_PRODUCERS; i++) {
+        ret = pthread_create(&producers[i], NULL, producer_entry,
+                (void *)(intptr_t)i);
+        ASSERT_EQ(ret, 0);
+    }
+
+    // the messages from a producer are in the order they were moved
+    int next_seq[NR_PRODUCERS] = { };
+    int nr_got = 0;
+    while (nr_got < NR_PRODUCERS * NR_MSGS_PER_PRODUCER) {
+        size_t n;
+        ret = purc_inst_holding_messages_count(&n);
+        ASSERT_EQ(ret, 0);
+        ASSERT_LE(n, 16);
+
+        if (n == 0) {
+            usleep(100);
+            continue;
+        }
+
+        pcrdr_msg *msg = purc_inst_take_away_message(0);
+        ASSERT_NE(msg, nullptr);
+
+        int th_no = (int)(msg->targetValue >> 16);
+        int seq = (int)(msg->targetValue & 0xFFFF);
+        ASSERT_LT(th_no, NR_PRODUCERS);
+        ASSERT_EQ(seq, next_seq[th_no]);
+        ASSERT_STREQ(purc_variant_get_string_const(msg->eventName), "test");
+        next_seq[th_no]++;
+
+        pcrdr_release_message(msg);
+        nr_got++;
+    }
+
+    for (int i = 0; i < NR_PRODUCERS; i++) {
+        pthread_join(producers[i], NULL);
+    }
+
+    ssize_t nr = purc_inst_destroy_move_buffer();
+    ASSERT_EQ(nr, 0);
+
+    purc_cleanup();
+}
+
+#define NR_RECORDS          50000
+
+static volatile purc_atom_t worker_inst;
+
+static purc_variant_t make_records(void)
+{
+    purc_variant_t arr = purc_variant_make_array_0();
+    purc_variant_t name = purc_variant_make_string("record", false);
+
+    for (int i = 0; i < NR_RECORDS; i++) {
+        purc_variant_t id = purc_variant_make_longint(i);
+        purc_variant_t flag = (i % 2) ? purc_variant_make_boolean(true) :
+            purc_variant_make_null();
+        purc_variant_t obj = purc_variant_make_object_by_static_ckey(3,
+                "id", id, "name", name, "flag", flag);
+        purc_variant_array_append(arr, obj);
+        purc_variant_unref(obj);
+        purc_variant_unref(flag);
+        purc_variant_unref(id);
+    }
+
+    purc_variant_unref(name);
+    return arr;
+}
+
+static void* worker_entry(void* arg)
+{
+    sem_t *wait = (sem_t *)arg;
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.purc.test",
+            "worker", NULL);
+    if (ret != PURC_ERROR_OK) {
+        sem_post(wait);
+        return NULL;
+    }
+
+    worker_inst = purc_inst_create_move_buffer(0, 4);
+    sem_post(wait);
+
+    const struct purc_variant_stat *stat = purc_variant_usage_stat();
+    size_t nr_values = stat->nr_total_values;
+
+    // the first result is owned exclusively; the second one shares a record
+    purc_variant_t shared = PURC_VARIANT_INVALID;
+    for (int n = 0; n < 2; n++) {
+        pcrdr_msg *event;
+        purc_variant_t records = make_records();
+        if (n == 1) {
+            shared = purc_variant_array_get(records, 0);
+            purc_variant_ref(shared);
+        }
+
+        event = pcrdr_make_event_message(
+                PCRDR_MSG_TARGET_INSTANCE, n,
+                "result", NULL,
+                PCRDR_MSG_ELEMENT_TYPE_VOID, NULL, NULL,
+                PCRDR_MSG_DATA_TYPE_VOID, NULL, 0);
+        event->dataType = PCRDR_MSG_DATA_TYPE_JSON;
+        event->data = records;
+
+        if (purc_inst_move_message(main_inst, event) == 0)
+            pcrdr_release_message(event);
+    }
+
+    // wait for the main instance
+    size_t n;
+    while (purc_inst_holding_messages_count(&n) == 0 && n == 0)
+        usleep(1000);
+    pcrdr_release_message(purc_inst_take_away_message(0));
+
+    purc_variant_unref(shared);
+    if (stat->nr_total_values != nr_values)
+        purc_log_error("values leaked in worker: %u\n",
+                (unsigned)(stat->nr_total_values - nr_values));
+
+    purc_inst_destroy_move_buffer();
+    purc_cleanup();
+    return NULL;
+}
+
+TEST(instance, move_large)
+{
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.purc.test",
+            "threads", NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    main_inst = purc_inst_create_move_buffer(0, 4);
+    ASSERT_NE(main_inst, 0);
+
+    const struct purc_variant_stat *stat = purc_variant_usage_stat();
+    size_t nr_values = stat->nr_total_values;
+
+    pthread_t worker;
+    sem_t wait;
+    sem_init(&wait, 0, 0);
+    ret = pthread_create(&worker, NULL, worker_entry, &wait);
+    ASSERT_EQ(ret, 0);
+    sem_wait(&wait);
+    sem_destroy(&wait);
+    ASSERT_NE(worker_inst, 0);
+
+    for (int nr_got = 0; nr_got < 2; ) {
+        size_t n;
+        ret = purc_inst_holding_messages_count(&n);
+        ASSERT_EQ(ret, 0);
+        if (n == 0) {
+            usleep(1000);
+            continue;
+        }
+
+        pcrdr_msg *msg = purc_inst_take_away_message(0);
+        ASSERT_NE(msg, nullptr);
+        ASSERT_EQ(msg->targetValue, (uint64_t)nr_got);
+
+        // the values are counted in the heap of the main instance now
+        ASSERT_GT(stat->nr_total_values, nr_values + NR_RECORDS * 4);
+
+        purc_variant_t records = msg->data;
+        ASSERT_TRUE(purc_variant_is_array(records));
+        ASSERT_EQ(purc_variant_array_get_size(records), NR_RECORDS);
+        for (int i = 0; i < NR_RECORDS; i += 999) {
+            purc_variant_t obj = purc_variant_array_get(records, i);
+            purc_variant_t v = purc_variant_object_get_by_ckey(obj, "id");
+            int64_t id;
+            ASSERT_TRUE(purc_variant_cast_to_longint(v, &id, false));
+            ASSERT_EQ(id, i);
+            v = purc_variant_object_get_by_ckey(obj, "name");
+            ASSERT_STREQ(purc_variant_get_string_const(v), "record");
+            v = purc_variant_object_get_by_ckey(obj, "flag");
+            ASSERT_TRUE((i % 2) ? purc_variant_is_true(v) :
+                    purc_variant_is_null(v));
+        }
+
+        pcrdr_release_message(msg);
+        ASSERT_EQ(stat->nr_total_values, nr_values);
+        nr_got++;
+    }
+
+    pcrdr_msg *done = pcrdr_make_event_message(
+            PCRDR_MSG_TARGET_INSTANCE, 0,
+            "done", NULL,
+            PCRDR_MSG_ELEMENT_TYPE_VOID, NULL, NULL,
+            PCRDR_MSG_DATA_TYPE_VOID, NULL, 0);
+    if (purc_inst_move_message(worker_inst, done) == 0)
+        pcrdr_release_message(done);
+    pthread_join(worker, NULL);
+
+    purc_inst_destroy_move_buffer();
+    purc_cleanup();
+}
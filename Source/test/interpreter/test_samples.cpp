@@ -203,6 +203,24 @@ TEST(samples, basic)
     purc_run((purc_cond_handler)my_cond_handler);
 }
 
+TEST(samples, sleep)
+{
+    PurCInstance purc;
+
+    ASSERT_TRUE(purc);
+
+    // the scheduler sleeps while the timer is pending; it must be woken
+    // up by the timer, which fires without a current coroutine
+    struct sample_data sample = {
+        .input_hvml = "<hvml target=\"html\"><head></head><body>"
+            "<sleep for=\"200ms\" /><p>done</p></body></hvml>",
+        .expected_html = "<html><head></head><body><p>done</p></body></html>",
+    };
+    add_sample(&sample);
+
+    purc_run((purc_cond_handler)my_cond_handler);
+}
+
 static void
 run_tests(struct sample_data *samples, size_t nr, int parallel)
 {
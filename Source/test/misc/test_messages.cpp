@@ -18,6 +18,7 @@
 */
 
 #include "purc.h"
+#include "private/pcrdr.h"
 
 #include <stdio.h>
 #include <errno.h>
@@ -93,3 +94,128 @@ TEST(instance, messages)
     purc_cleanup();
 }
 
+
+TEST(instance, binary_messages)
+{
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, NULL, NULL, NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    pcrdr_msg *msgs[4];
+    msgs[0] = pcrdr_make_request_message(PCRDR_MSG_TARGET_DOM,
+            random(), PCRDR_OPERATION_UPDATE, "request-id", NULL,
+            PCRDR_MSG_ELEMENT_TYPE_HANDLE, "7f3a2c10", "textContent",
+            PCRDR_MSG_DATA_TYPE_PLAIN, "The data", 0);
+    msgs[1] = pcrdr_make_request_message(PCRDR_MSG_TARGET_SESSION,
+            random(), "to_do_something", NULL, "request-id",
+            PCRDR_MSG_ELEMENT_TYPE_ID, "the-id", NULL,
+            PCRDR_MSG_DATA_TYPE_VOID, NULL, 0);
+    msgs[2] = pcrdr_make_response_message("request-id", NULL,
+            PCRDR_SC_OK, random(), PCRDR_MSG_DATA_TYPE_HTML, "<p>x</p>", 8);
+    msgs[3] = pcrdr_make_event_message(PCRDR_MSG_TARGET_PLAINWINDOW,
+            random(), "click", "edpt://localhost/app/runner",
+            PCRDR_MSG_ELEMENT_TYPE_CSS, "#the-id", NULL,
+            PCRDR_MSG_DATA_TYPE_PLAIN, "", 0);
+
+    for (size_t i = 0; i < PCA_TABLESIZE(msgs); i++) {
+        ASSERT_NE(msgs[i], nullptr);
+
+        pcrdr_msg *msg_parsed;
+        struct buff_info info_a = { buffer_a, sizeof (buffer_a), 0 };
+        struct buff_info info_b = { buffer_b, sizeof (buffer_b), 0 };
+
+        ret = pcrdr_serialize_message_binary(msgs[i], write_to_buf, &info_a);
+        ASSERT_EQ(ret, 0);
+        ASSERT_TRUE(pcrdr_is_binary_packet(buffer_a, info_a.pos));
+
+        /* truncated packets are rejected */
+        ret = pcrdr_parse_binary_packet(buffer_a, info_a.pos - 1, &msg_parsed);
+        ASSERT_EQ(ret, -1);
+
+        ret = pcrdr_parse_binary_packet(buffer_a, info_a.pos, &msg_parsed);
+        ASSERT_EQ(ret, 0);
+
+        ret = pcrdr_compare_messages(msgs[i], msg_parsed);
+        ASSERT_EQ(ret, 0);
+
+        /* the encoding is stable */
+        pcrdr_serialize_message_binary(msg_parsed, write_to_buf, &info_b);
+        ASSERT_EQ(info_a.pos, info_b.pos);
+        ASSERT_EQ(memcmp(buffer_a, buffer_b, info_a.pos), 0);
+
+        pcrdr_release_message(msg_parsed);
+        pcrdr_release_message(msgs[i]);
+    }
+
+    purc_cleanup();
+}
+
+TEST(instance, messages_in_place)
+{
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, NULL, NULL, NULL);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    pcrdr_msg *msg;
+    msg = pcrdr_make_event_message(PCRDR_MSG_TARGET_PLAINWINDOW,
+            random(), "change", "edpt://localhost/app/runner",
+            PCRDR_MSG_ELEMENT_TYPE_HANDLE, "7f3a2c10", "value",
+            PCRDR_MSG_DATA_TYPE_PLAIN, "The new value of the input", 26);
+
+    struct buff_info info = { buffer_a, sizeof (buffer_a), 0 };
+    pcrdr_serialize_message(msg, write_to_buf, &info);
+
+    struct pcrdr_packet_pool *pool = pcrdr_packet_pool_new();
+    ASSERT_NE(pool, nullptr);
+
+    purc_variant_t data = PURC_VARIANT_INVALID;
+    const char *held = NULL;
+    for (int i = 0; i < 100; i++) {
+        char *packet = pcrdr_packet_get(pool, info.pos + 1);
+        ASSERT_NE(packet, nullptr);
+        memcpy(packet, buffer_a, info.pos);
+        packet[info.pos] = '\0';
+
+        pcrdr_msg *msg_parsed;
+        ret = pcrdr_parse_packet_in_place(packet, info.pos + 1, &msg_parsed);
+        pcrdr_packet_unref(packet);
+        ASSERT_EQ(ret, 0);
+
+        ret = pcrdr_compare_messages(msg, msg_parsed);
+        ASSERT_EQ(ret, 0);
+
+        /* the data refers to the packet */
+        const char *text = purc_variant_get_string_const(msg_parsed->data);
+        ASSERT_TRUE(text >= packet && text < packet + info.pos);
+
+        if (i == 0) {
+            /* a clone keeps the packet alive */
+            pcrdr_msg *msg_cloned = pcrdr_clone_message(msg_parsed);
+            pcrdr_release_message(msg_parsed);
+            ASSERT_STREQ(purc_variant_get_string_const(msg_cloned->eventName),
+                    "change");
+
+            /* the data referenced by others keeps the packet alive */
+            data = purc_variant_ref(msg_cloned->data);
+            held = text;
+            pcrdr_release_message(msg_cloned);
+            ASSERT_EQ(purc_variant_get_string_const(data), held);
+        }
+        else {
+            pcrdr_release_message(msg_parsed);
+        }
+    }
+
+    /* the packet held by the data is not reused, but the other one is */
+    ASSERT_EQ(pcrdr_packet_pool_allocated(pool), 2);
+
+    size_t nr_chars;
+    ASSERT_TRUE(purc_variant_string_chars(data, &nr_chars));
+    ASSERT_EQ(nr_chars, 26);
+    ASSERT_EQ(purc_variant_get_string_const(data), held);
+    ASSERT_STREQ(held, "The new value of the input");
+    purc_variant_unref(data);
+
+    pcrdr_packet_pool_delete(pool);
+    pcrdr_release_message(msg);
+
+    purc_cleanup();
+}
@@ -34,6 +34,8 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 
 #define ATOM_BUCKET     1
@@ -353,6 +355,59 @@ TEST(utils, atom_buckets)
     purc_cleanup ();
 }
 
+// to test interning, looking up and removing atoms in several threads
+static void
+intern_and_remove(int id, int *nr_errors)
+{
+    char buf[64];
+
+    for (int i = 0; i < 1000; i++) {
+        snprintf(buf, sizeof(buf), "thread-%d-%d", id, i);
+        purc_atom_t atom = purc_atom_from_string(buf);
+        if (atom == 0 || purc_atom_try_string(buf) != atom ||
+                strcmp(purc_atom_to_string(atom), buf))
+            (*nr_errors)++;
+
+        if (i % 2 == 0) {
+            if (!purc_atom_remove_string(buf) || purc_atom_try_string(buf))
+                (*nr_errors)++;
+        }
+
+        atom = purc_atom_try_string("displace");
+        if (atom == 0 || strcmp(purc_atom_to_string(atom), "displace"))
+            (*nr_errors)++;
+    }
+}
+
+TEST(utils, atom_threads)
+{
+    int ret = purc_init_ex(PURC_MODULE_UTILS, "cn.fmsoft.hybridos.test",
+            "utils", NULL);
+    ASSERT_EQ (ret, PURC_ERROR_OK);
+
+    purc_atom_from_static_string("displace");
+
+    const int nr_threads = 4;
+    int nr_errors[nr_threads] = { };
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nr_threads; i++)
+        threads.emplace_back(intern_and_remove, i, &nr_errors[i]);
+    for (auto &th : threads)
+        th.join();
+
+    for (int i = 0; i < nr_threads; i++) {
+        ASSERT_EQ(nr_errors[i], 0);
+
+        char buf[64];
+        snprintf(buf, sizeof(buf), "thread-%d-%d", i, 999);
+        ASSERT_NE(purc_atom_try_string(buf), 0);
+        snprintf(buf, sizeof(buf), "thread-%d-%d", i, 998);
+        ASSERT_EQ(purc_atom_try_string(buf), 0);
+    }
+
+    purc_cleanup ();
+}
+
 // to test sorted array
 static int sortv[10] = { 1, 8, 7, 5, 4, 6, 9, 0, 2, 3 };
 
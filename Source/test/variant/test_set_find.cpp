@@ -115,3 +115,91 @@ TEST(set, unique_key_find)
     ASSERT_EQ (cleanup, true);
 }
 
+TEST(set, hashed_index)
+{
+    purc_instance_extra_info info = {};
+    int ret = 0;
+    bool cleanup = false;
+
+    ret = purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    const int nr_items = 1000;
+    char buf[64];
+
+    purc_variant_t set = purc_variant_make_set_by_ckey(0, NULL,
+            PURC_VARIANT_INVALID);
+    ASSERT_NE(set, PURC_VARIANT_INVALID);
+
+    for (int i = 0; i < nr_items; i++) {
+        snprintf(buf, sizeof(buf), "item-%04d", (i * 7919) % nr_items);
+        purc_variant_t v = purc_variant_make_string(buf, false);
+        ASSERT_TRUE(purc_variant_set_add(set, v, false));
+        purc_variant_unref(v);
+    }
+    ASSERT_EQ(purc_variant_set_get_size(set), (ssize_t)nr_items);
+
+    // duplicates are found through the index
+    for (int i = 0; i < nr_items; i++) {
+        snprintf(buf, sizeof(buf), "item-%04d", i);
+        purc_variant_t v = purc_variant_make_string(buf, false);
+        ASSERT_NE(pcvariant_set_find(set, v), PURC_VARIANT_INVALID);
+        ASSERT_FALSE(purc_variant_set_add(set, v, false));
+        purc_variant_unref(v);
+    }
+    ASSERT_EQ(purc_variant_set_get_size(set), (ssize_t)nr_items);
+
+    // remove the odd ones; the clusters of the index must stay reachable
+    for (int i = 1; i < nr_items; i += 2) {
+        snprintf(buf, sizeof(buf), "item-%04d", i);
+        purc_variant_t v = purc_variant_make_string(buf, false);
+        ASSERT_TRUE(purc_variant_set_remove(set, v, false));
+        purc_variant_unref(v);
+    }
+    ASSERT_EQ(purc_variant_set_get_size(set), (ssize_t)nr_items / 2);
+
+    for (int i = 0; i < nr_items; i++) {
+        snprintf(buf, sizeof(buf), "item-%04d", i);
+        purc_variant_t v = purc_variant_make_string(buf, false);
+        if (i % 2)
+            ASSERT_EQ(pcvariant_set_find(set, v), PURC_VARIANT_INVALID);
+        else
+            ASSERT_NE(pcvariant_set_find(set, v), PURC_VARIANT_INVALID);
+        purc_variant_unref(v);
+    }
+
+    // ordered traversal still follows the unique keys
+    int expected = 0;
+    struct purc_variant_set_iterator *it;
+    it = purc_variant_set_make_iterator_begin(set);
+    ASSERT_NE(it, nullptr);
+    do {
+        purc_variant_t v = purc_variant_set_iterator_get_value(it);
+        snprintf(buf, sizeof(buf), "item-%04d", expected);
+        ASSERT_STREQ(purc_variant_get_string_const(v), buf);
+        expected += 2;
+    } while (purc_variant_set_iterator_next(it));
+    purc_variant_set_release_iterator(it);
+    ASSERT_EQ(expected, nr_items);
+
+    purc_variant_unref(set);
+
+    // caseless sets hash the folded text
+    set = purc_variant_make_set_by_ckey_ex(0, NULL, true,
+            PURC_VARIANT_INVALID);
+    ASSERT_NE(set, PURC_VARIANT_INVALID);
+
+    const char *words[] = { "Hello", "HELLO", "hello", "kilo", "KILO" };
+    for (size_t i = 0; i < PCA_TABLESIZE(words); i++) {
+        purc_variant_t v = purc_variant_make_string(words[i], false);
+        purc_variant_set_add(set, v, true);
+        purc_variant_unref(v);
+    }
+    ASSERT_EQ(purc_variant_set_get_size(set), 2);
+
+    purc_variant_unref(set);
+
+    cleanup = purc_cleanup ();
+    ASSERT_EQ (cleanup, true);
+}
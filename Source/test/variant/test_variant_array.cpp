@@ -26,6 +26,8 @@
 
 #include <stdio.h>
 #include <errno.h>
+#include <strings.h>
+#include <vector>
 #include <gtest/gtest.h>
 
 TEST(variant_array, init_with_1_str)
@@ -439,6 +441,79 @@ TEST(variant_array, make_ref_add_unref_unref)
     ASSERT_EQ (cleanup, true);
 }
 
+TEST(variant_array, insert_and_remove_anywhere)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    purc_variant_t arr = purc_variant_make_array(0, PURC_VARIANT_INVALID);
+    ASSERT_NE(arr, nullptr);
+
+    std::vector<int64_t> expected;
+    unsigned int seed = 1;
+    for (int64_t i = 0; i < 2000; i++) {
+        size_t sz = expected.size();
+        size_t pos = sz ? rand_r(&seed) % sz : 0;
+        purc_variant_t v = purc_variant_make_longint(i);
+        bool ok = true;
+
+        switch (rand_r(&seed) % 5) {
+        case 0:
+            ok = purc_variant_array_append(arr, v);
+            expected.push_back(i);
+            break;
+        case 1:
+            ok = purc_variant_array_prepend(arr, v);
+            expected.insert(expected.begin(), i);
+            break;
+        case 2:
+            ok = purc_variant_array_insert_before(arr, pos, v);
+            expected.insert(expected.begin() + pos, i);
+            break;
+        case 3:
+            if (sz) {
+                ok = purc_variant_array_remove(arr, pos);
+                expected.erase(expected.begin() + pos);
+            }
+            break;
+        case 4:
+            if (sz) {
+                ok = purc_variant_array_set(arr, pos, v);
+                expected[pos] = i;
+            }
+            break;
+        }
+        purc_variant_unref(v);
+        ASSERT_TRUE(ok);
+        ASSERT_EQ(purc_variant_array_get_size(arr), expected.size());
+    }
+
+    purc_variant_t val;
+    size_t idx;
+    foreach_value_in_variant_array(arr, val, idx)
+        int64_t i64;
+        ASSERT_TRUE(purc_variant_cast_to_longint(val, &i64, false));
+        ASSERT_EQ(i64, expected[idx]);
+    end_foreach;
+
+    size_t left = expected.size();
+    foreach_value_in_variant_array_reverse_safe(arr, val, idx)
+        int64_t i64;
+        ASSERT_TRUE(purc_variant_cast_to_longint(val, &i64, false));
+        ASSERT_EQ(i64, expected[idx]);
+        if (i64 % 2) {
+            ASSERT_TRUE(purc_variant_array_remove(arr, idx));
+            left--;
+        }
+    end_foreach;
+    ASSERT_EQ(purc_variant_array_get_size(arr), left);
+
+    purc_variant_unref(arr);
+    ASSERT_TRUE(purc_cleanup());
+}
+
 static inline purc_variant_t
 make_array(const int *vals, size_t nr)
 {
@@ -533,3 +608,74 @@ TEST(variant_array, sort)
     ASSERT_STREQ(inbuf, outbuf);
 }
 
+
+TEST(variant_array, sort_by_keys)
+{
+    purc_instance_extra_info info = {};
+    int ret = 0;
+    bool cleanup = false;
+
+    ret = purc_init_ex (PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    static const char *names[] = { "pear", "Apple", "apple", "Banana" };
+    const size_t nr = 20000;    // large enough to take the parallel path
+
+    purc_variant_t arr = purc_variant_make_array(0, PURC_VARIANT_INVALID);
+    ASSERT_NE(arr, nullptr);
+    for (size_t i = 0; i < nr; ++i) {
+        purc_variant_t name, score, seq, obj;
+        name = purc_variant_make_string_static(names[i % 4], false);
+        score = purc_variant_make_longint((i * 7919) % 10);
+        seq = purc_variant_make_ulongint(i);
+        obj = purc_variant_make_object_by_static_ckey(3,
+                "name", name, "score", score, "seq", seq);
+        ASSERT_NE(obj, nullptr);
+        ASSERT_TRUE(purc_variant_array_append(arr, obj));
+        purc_variant_unref(name);
+        purc_variant_unref(score);
+        purc_variant_unref(seq);
+        purc_variant_unref(obj);
+    }
+
+    struct pcvariant_sort_key keys[] = {
+        { "name", PCVARIANT_COMPARE_OPT_CASELESS, false },
+        { "score", PCVARIANT_COMPARE_OPT_NUMBER, true },
+    };
+    ret = pcvariant_array_sort_by_keys(arr, keys, PCA_TABLESIZE(keys));
+    ASSERT_EQ(ret, 0);
+    ASSERT_EQ(purc_variant_array_get_size(arr), nr);
+
+    for (size_t i = 1; i < nr; ++i) {
+        purc_variant_t l = purc_variant_array_get(arr, i - 1);
+        purc_variant_t r = purc_variant_array_get(arr, i);
+        const char *ln = purc_variant_get_string_const(
+                purc_variant_object_get_by_ckey(l, "name"));
+        const char *rn = purc_variant_get_string_const(
+                purc_variant_object_get_by_ckey(r, "name"));
+        int c = strcasecmp(ln, rn);
+        ASSERT_LE(c, 0);
+        if (c)
+            continue;
+
+        double ls = purc_variant_numberify(
+                purc_variant_object_get_by_ckey(l, "score"));
+        double rs = purc_variant_numberify(
+                purc_variant_object_get_by_ckey(r, "score"));
+        ASSERT_GE(ls, rs);
+        if (ls != rs)
+            continue;
+
+        // stable: the equal members keep their original order
+        ASSERT_LT(purc_variant_numberify(
+                    purc_variant_object_get_by_ckey(l, "seq")),
+                purc_variant_numberify(
+                    purc_variant_object_get_by_ckey(r, "seq")));
+    }
+
+    purc_variant_unref(arr);
+
+    cleanup = purc_cleanup ();
+    ASSERT_EQ (cleanup, true);
+}
@@ -466,3 +466,94 @@ TEST(object, compare)
     purc_variant_unref(obj2);
 }
 
+
+TEST(object, large)
+{
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_VARIANT, "cn.fmsoft.hybridos.test",
+            "test_init", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    const int nr_keys = 200;
+    char key[32];
+
+    purc_variant_t obj = purc_variant_make_object(0,
+            PURC_VARIANT_INVALID, PURC_VARIANT_INVALID);
+    ASSERT_NE(obj, PURC_VARIANT_INVALID);
+
+    // insert in a shuffled order, crossing the size of small objects
+    for (int i = 0; i < nr_keys; i++) {
+        snprintf(key, sizeof(key), "key-%03d", (i * 37) % nr_keys);
+        purc_variant_t k = purc_variant_make_string(key, false);
+        purc_variant_t v = purc_variant_make_longint(i);
+        ASSERT_TRUE(purc_variant_object_set(obj, k, v));
+        purc_variant_unref(k);
+        purc_variant_unref(v);
+    }
+
+    size_t sz;
+    ASSERT_TRUE(purc_variant_object_size(obj, &sz));
+    ASSERT_EQ(sz, (size_t)nr_keys);
+
+    for (int i = 0; i < nr_keys; i++) {
+        snprintf(key, sizeof(key), "key-%03d", (i * 37) % nr_keys);
+        purc_variant_t v = purc_variant_object_get_by_ckey(obj, key);
+        ASSERT_NE(v, PURC_VARIANT_INVALID);
+        int64_t l;
+        ASSERT_TRUE(purc_variant_cast_to_longint(v, &l, false));
+        ASSERT_EQ(l, i);
+    }
+
+    // remove the odd keys, leaving holes among the members
+    for (int i = 1; i < nr_keys; i += 2) {
+        snprintf(key, sizeof(key), "key-%03d", i);
+        ASSERT_TRUE(purc_variant_object_remove_by_static_ckey(obj,
+                    key, false));
+    }
+
+    ASSERT_TRUE(purc_variant_object_size(obj, &sz));
+    ASSERT_EQ(sz, (size_t)nr_keys / 2);
+
+    // the members are still visited in the order of the keys
+    int expected = 0;
+    struct purc_variant_object_iterator *it;
+    it = purc_variant_object_make_iterator_begin(obj);
+    ASSERT_NE(it, nullptr);
+    do {
+        purc_variant_t k = purc_variant_object_iterator_get_key(it);
+        snprintf(key, sizeof(key), "key-%03d", expected);
+        ASSERT_STREQ(purc_variant_get_string_const(k), key);
+        expected += 2;
+    } while (purc_variant_object_iterator_next(it));
+    purc_variant_object_release_iterator(it);
+    ASSERT_EQ(expected, nr_keys);
+
+    purc_variant_t v;
+    for (int i = 0; i < nr_keys; i++) {
+        snprintf(key, sizeof(key), "key-%03d", i);
+        v = purc_variant_object_get_by_ckey(obj, key);
+        if (i % 2)
+            ASSERT_EQ(v, PURC_VARIANT_INVALID);
+        else
+            ASSERT_NE(v, PURC_VARIANT_INVALID);
+    }
+
+    // displacing the members clears the object while iterating over it
+    v = purc_variant_make_longint(1);
+    purc_variant_t src = purc_variant_make_object_by_static_ckey(1,
+            "key-001", v);
+    purc_variant_unref(v);
+    ASSERT_NE(src, PURC_VARIANT_INVALID);
+    ASSERT_TRUE(purc_variant_container_displace(obj, src, false));
+    ASSERT_TRUE(purc_variant_object_size(obj, &sz));
+    ASSERT_EQ(sz, (size_t)1);
+    ASSERT_NE(purc_variant_object_get_by_ckey(obj, "key-001"),
+            PURC_VARIANT_INVALID);
+    ASSERT_EQ(purc_variant_object_get_by_ckey(obj, "key-000"),
+            PURC_VARIANT_INVALID);
+    purc_variant_unref(src);
+
+    purc_variant_unref(obj);
+
+    purc_cleanup();
+}
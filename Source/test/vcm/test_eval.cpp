@@ -20,6 +20,8 @@
 #include "purc.h"
 #include "private/vcm.h"
 
+#include <string>
+
 #include <gtest/gtest.h>
 
 purc_variant_t find_var(void* ctxt, const char* name)
@@ -117,3 +119,99 @@ TEST_P(test_vcm_eval, eval_silently)
 
 INSTANTIATE_TEST_SUITE_P(vcm_eval, test_vcm_eval,
         testing::ValuesIn(test_cases));
+
+static purc_variant_t find_var_in_object(void* ctxt, const char* name)
+{
+    return purc_variant_object_get_by_ckey(purc_variant_t(ctxt), name);
+}
+
+static std::string serialize(purc_variant_t v)
+{
+    if (v == PURC_VARIANT_INVALID)
+        return "<invalid>";
+
+    purc_rwstream_t rws = purc_rwstream_new_buffer(32, 0);
+    purc_variant_serialize(v, rws, 0, PCVARIANT_SERIALIZE_OPT_PLAIN, NULL);
+    size_t sz = 0;
+    const char *buf = (const char *)purc_rwstream_get_mem_buffer(rws, &sz);
+    std::string s(buf, sz);
+    purc_rwstream_destroy(rws);
+    return s;
+}
+
+/* the first evaluation uses the tree walker, the later ones the program */
+TEST(vcm_eval, compiled_program)
+{
+    static const char *exprs[] = {
+        "$X.title",
+        "$X.arr[1]",
+        "$X.arr[-1]",
+        "$X.arr['2']",
+        "$X['title']",
+        "$X.none",
+        "\"$X.title: $X.num\"",
+        "\"abc\"",
+        "[1, $X.title, { \"k\": $X.num, \"t\": true }]",
+        "{{ $X.zero && $X.title }}",
+        "{{ $X.zero || $X.title }}",
+        "{{ $X.title && $X.zero || $X.num }}",
+        "{{ $X.title ; $X.num ; }}",
+        "$EJSON.count($X.arr)",
+        "$EJSON.type($X.title)",
+        "$X.title.no.such.element",
+    };
+
+    purc_instance_extra_info info = {};
+    int ret = purc_init_ex(PURC_MODULE_EJSON, "cn.fmsoft.hybridos.test",
+            "vcm_eval", &info);
+    ASSERT_EQ(ret, PURC_ERROR_OK);
+
+    const char *json = "{ \"title\": \"Object title\", \"num\": 3, "
+        "\"zero\": 0, \"arr\": [ \"a\", \"b\", \"c\" ] }";
+    struct purc_ejson_parse_tree *ptree;
+    ptree = purc_variant_ejson_parse_string(json, strlen(json));
+    purc_variant_t obj = purc_variant_ejson_parse_tree_evalute(ptree, NULL,
+            PURC_VARIANT_INVALID, false);
+    purc_variant_ejson_parse_tree_destroy(ptree);
+    ASSERT_NE(obj, nullptr);
+
+    purc_variant_t vars = purc_variant_make_object(0, PURC_VARIANT_INVALID,
+            PURC_VARIANT_INVALID);
+    purc_variant_t ejson = purc_dvobj_ejson_new();
+    purc_variant_object_set_by_static_ckey(vars, "X", obj);
+    purc_variant_object_set_by_static_ckey(vars, "EJSON", ejson);
+    purc_variant_unref(ejson);
+    purc_variant_unref(obj);
+
+    for (size_t i = 0; i < PCA_TABLESIZE(exprs); i++) {
+        for (int mode = 0; mode < 4; mode++) {
+            bool silently = mode & 1;
+            ptree = purc_variant_ejson_parse_string(exprs[i],
+                    strlen(exprs[i]));
+            ASSERT_NE(ptree, nullptr) << exprs[i];
+
+            /* names are interned when the tree is attached to vDOM */
+            if (mode & 2)
+                pcvcm_intern_variable_names((struct pcvcm_node *)ptree);
+
+            std::string first;
+            for (int round = 0; round < 4; round++) {
+                purc_variant_t v = purc_variant_ejson_parse_tree_evalute(
+                        ptree, find_var_in_object, vars, silently);
+                std::string s = serialize(v);
+                if (v)
+                    purc_variant_unref(v);
+
+                if (round == 0)
+                    first = s;
+                else
+                    ASSERT_EQ(s, first) << exprs[i] << " round " << round;
+            }
+
+            purc_variant_ejson_parse_tree_destroy(ptree);
+        }
+    }
+
+    purc_variant_unref(vars);
+    purc_cleanup();
+}
@@ -20,6 +20,8 @@
 #include "purc.h"
 #include "private/vdom.h"
 #include "private/hvml.h"
+#include "private/ports.h"
+#include "private/utils.h"
 #include "hvml-token.h"
 #include "hvml-gen.h"
 
@@ -160,3 +162,83 @@ end:
     purc_cleanup ();
 }
 
+
+static int
+append_to_string(const char *buf, size_t len, void *ctxt)
+{
+    std::string *s = (std::string *)ctxt;
+    s->append(buf, len);
+    return 0;
+}
+
+static std::string
+serialize_document(struct pcvdom_document *doc)
+{
+    std::string s;
+    pcvdom_util_node_serialize(pcvdom_node_from_document(doc),
+            append_to_string, &s);
+    return s;
+}
+
+static void
+_check_image(const char *fn)
+{
+    unsigned char md5[MD5_DIGEST_SIZE];
+    size_t length;
+    ASSERT_TRUE(pcutils_file_md5(fn, md5, &length)) << fn;
+
+    purc_rwstream_t rin = purc_rwstream_new_from_file(fn, "r");
+    ASSERT_NE(rin, nullptr) << fn;
+    struct pcvdom_pos pos;
+    struct pcvdom_document *doc = pcvdom_util_document_from_stream(rin, &pos);
+    purc_rwstream_destroy(rin);
+    if (doc == NULL)        // negative samples
+        return;
+
+    purc_rwstream_t out = purc_rwstream_new_buffer(1024, 0);
+    ASSERT_EQ(pcvdom_document_write_image(doc, md5, out), 0) << fn;
+
+    size_t sz;
+    const char *image = (const char *)purc_rwstream_get_mem_buffer(out, &sz);
+    struct pcvdom_document *loaded = pcvdom_document_from_image(image, sz, md5);
+    ASSERT_NE(loaded, nullptr) << fn;
+    EXPECT_EQ(serialize_document(loaded), serialize_document(doc)) << fn;
+
+    EXPECT_EQ(pcvdom_document_get_root(loaded) == NULL,
+            pcvdom_document_get_root(doc) == NULL) << fn;
+    pcvdom_document_unref(loaded);
+
+    /* stale or truncated images are refused */
+    unsigned char other[MD5_DIGEST_SIZE];
+    memcpy(other, md5, sizeof(other));
+    other[0] ^= 0xff;
+    EXPECT_EQ(pcvdom_document_from_image(image, sz, other), nullptr) << fn;
+    EXPECT_EQ(pcvdom_document_from_image(image, sz - 1, md5), nullptr) << fn;
+
+    purc_rwstream_destroy(out);
+    pcvdom_document_unref(doc);
+}
+
+TEST(vdom_gen, image)
+{
+    glob_t globbuf;
+    memset(&globbuf, 0, sizeof(globbuf));
+
+    purc_instance_extra_info info = {};
+    int r = purc_init_ex(PURC_MODULE_HVML, "cn.fmsoft.hybridos.test",
+        "vdom_gen", &info);
+    ASSERT_EQ(r, PURC_ERROR_OK);
+
+    char path[PATH_MAX+1];
+    test_getpath_from_env_or_rel(path, sizeof(path),
+        "SOURCE_FILES", "/data/*.hvml");
+
+    if (path[0] && glob(path, 0, NULL, &globbuf) == 0) {
+        for (size_t i=0; i<globbuf.gl_pathc; ++i) {
+            _check_image(globbuf.gl_pathv[i]);
+        }
+        globfree(&globbuf);
+    }
+
+    purc_cleanup ();
+}